@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace graft::bench
+{
+
+//State of a benchmark run. The body of a benchmark prepares its data and runs the measured code in the loop
+//  while(state.keepRunning()) { ... }
+//the runner increases the number of iterations until the run takes at least --min-time.
+//Benchmarks which measure themselves (e.g. multithreaded ones) run state.iterations() operations and call setElapsed().
+class State
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit State(uint64_t iterations) : m_iterations(iterations), m_left(iterations) { }
+
+    uint64_t iterations() const { return m_iterations; }
+
+    bool keepRunning()
+    {
+        if(!m_started)
+        {
+            m_started = true;
+            m_start = Clock::now();
+        }
+        if(m_left)
+        {
+            --m_left;
+            return true;
+        }
+        setElapsed(Clock::now() - m_start);
+        return false;
+    }
+
+    void setElapsed(Clock::duration elapsed) { m_elapsed = elapsed; m_measured = true; }
+    Clock::duration elapsed() const { return m_elapsed; }
+    bool measured() const { return m_measured; }
+
+    //number of processed items per run, iterations by default
+    void setItems(uint64_t items) { m_items = items; }
+    uint64_t items() const { return m_items ? m_items : m_iterations; }
+
+    //extra values to report, e.g. latency percentiles
+    void counter(const std::string& name, double value) { m_counters.emplace_back(name, value); }
+    const std::vector<std::pair<std::string, double>>& counters() const { return m_counters; }
+
+    //marks the benchmark as failed, the message is reported instead of the results
+    void error(const std::string& message) { m_error = message; setElapsed(Clock::duration::zero()); }
+    const std::string& error() const { return m_error; }
+
+private:
+    const uint64_t m_iterations;
+    uint64_t m_left;
+    bool m_started = false;
+    bool m_measured = false;
+    Clock::time_point m_start;
+    Clock::duration m_elapsed{0};
+    uint64_t m_items = 0;
+    std::vector<std::pair<std::string, double>> m_counters;
+    std::string m_error;
+};
+
+using Function = std::function<void(State&)>;
+
+//iterations == 0 means the number of iterations is chosen by the runner
+bool registerBenchmark(const std::string& name, Function function, uint64_t iterations = 0);
+
+//value of the command line option --name=value
+std::string option(const std::string& name, const std::string& defaultValue);
+int option(const std::string& name, int defaultValue);
+
+//prevents the compiler from optimizing out the computation of the value
+template<typename T>
+inline void doNotOptimize(const T& value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+}//namespace graft::bench
+
+#define GRAFT_BENCHMARK_IMPL(name, iterations) \
+    static void name(graft::bench::State& state); \
+    static const bool name##_registered = graft::bench::registerBenchmark(#name, name, iterations); \
+    static void name(graft::bench::State& state)
+
+#define GRAFT_BENCHMARK(name) GRAFT_BENCHMARK_IMPL(name, 0)
+
+//benchmark which is run once, e.g. load test reporting its own counters
+#define GRAFT_BENCHMARK_ONCE(name) GRAFT_BENCHMARK_IMPL(name, 1)
+
@@ -0,0 +1,266 @@
+#include "benchmark.h"
+
+#include "lib/graft/graft_utility.hpp"
+#include "lib/graft/inout.h"
+#include "lib/graft/jsonrpc.h"
+#include "lib/graft/router.h"
+#include "lib/graft/sys_info.h"
+#include "lib/graft/thread_pool/thread_pool.hpp"
+#include "supernode/requests.h"
+#include "supernode/requests/send_supernode_announce.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace graft;
+using bench::State;
+using bench::doNotOptimize;
+
+namespace
+{
+
+size_t threadsCount()
+{
+    return std::max(2u, std::thread::hardware_concurrency());
+}
+
+}
+
+/////////////////////////////////
+// thread pool
+
+//throughput of posting small jobs from a single thread to all workers, each job is counted when it is done
+GRAFT_BENCHMARK(ThreadPool_postAndRun)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(threadsCount());
+    options.setQueueSize(4096);
+    tp::ThreadPool pool(options);
+
+    std::atomic<uint64_t> done{0};
+    auto start = State::Clock::now();
+    for(uint64_t i = 0; i < state.iterations(); ++i)
+    {
+        while(!pool.tryPost([&done]{ done.fetch_add(1, std::memory_order_relaxed); }))
+        {
+            std::this_thread::yield();
+        }
+    }
+    while(done.load(std::memory_order_relaxed) != state.iterations())
+    {
+        std::this_thread::yield();
+    }
+    state.setElapsed(State::Clock::now() - start);
+}
+
+/////////////////////////////////
+// TSHashtable
+
+namespace
+{
+
+std::vector<std::string> makeKeys(size_t count)
+{
+    std::vector<std::string> keys;
+    keys.reserve(count);
+    for(size_t i = 0; i < count; ++i)
+    {
+        keys.push_back("payment-" + std::to_string(i * 2654435761u));
+    }
+    return keys;
+}
+
+}
+
+GRAFT_BENCHMARK(TSHashtable_addOrUpdate)
+{
+    TSHashtable<std::string, std::string> table;
+    const std::vector<std::string> keys = makeKeys(4096);
+    const std::string value(64, 'v');
+
+    size_t i = 0;
+    while(state.keepRunning())
+    {
+        table.addOrUpdate(keys[i++ & 4095], value);
+    }
+}
+
+GRAFT_BENCHMARK(TSHashtable_valueFor)
+{
+    TSHashtable<std::string, std::string> table;
+    const std::vector<std::string> keys = makeKeys(4096);
+    for(auto& key : keys) table.addOrUpdate(key, std::string(64, 'v'));
+
+    size_t i = 0;
+    while(state.keepRunning())
+    {
+        std::string value = table.valueFor(keys[i++ & 4095]);
+        doNotOptimize(value);
+    }
+}
+
+//readers and writers of the global context from all cores, 1 write per 8 reads
+GRAFT_BENCHMARK(TSHashtable_mixedContended)
+{
+    TSHashtable<std::string, std::string> table;
+    const std::vector<std::string> keys = makeKeys(4096);
+    const std::string value(64, 'v');
+    for(auto& key : keys) table.addOrUpdate(key, value);
+
+    const size_t threads = threadsCount();
+    const uint64_t perThread = std::max<uint64_t>(1, state.iterations() / threads);
+
+    auto start = State::Clock::now();
+    std::vector<std::thread> th;
+    for(size_t t = 0; t < threads; ++t)
+    {
+        th.emplace_back([&, t]
+        {
+            size_t k = t * 977;
+            for(uint64_t i = 0; i < perThread; ++i, ++k)
+            {
+                const std::string& key = keys[k & 4095];
+                if((i & 7) == 0)
+                {
+                    table.addOrUpdate(key, value);
+                }
+                else
+                {
+                    std::string v = table.valueFor(key);
+                    doNotOptimize(v);
+                }
+            }
+        });
+    }
+    for(auto& t : th) t.join();
+    state.setElapsed(State::Clock::now() - start);
+    state.setItems(perThread * threads);
+}
+
+/////////////////////////////////
+// router
+
+namespace
+{
+
+//routes of the supernode
+void registerSupernodeRoutes(Router::Root& root)
+{
+    Router dapi("/dapi/v2.0");
+    supernode::request::registerRTARequests(dapi);
+    supernode::request::registerDebugRequests(dapi);
+    root.addRouter(dapi);
+
+    Router forward;
+    supernode::request::registerForwardRequests(forward);
+    root.addRouter(forward);
+}
+
+}
+
+GRAFT_BENCHMARK(Router_match)
+{
+    Router::Root root;
+    registerSupernodeRoutes(root);
+    if(!root.arm())
+    {
+        state.error("routes cannot be armed");
+        return;
+    }
+
+    const std::vector<std::pair<std::string, int>> targets = {
+        {"/dapi/v2.0/sale", METHOD_POST},
+        {"/dapi/v2.0/pay", METHOD_POST},
+        {"/dapi/v2.0/sale_status", METHOD_POST},
+        {"/dapi/v2.0/cryptonode/authorize_rta_tx_request", METHOD_POST},
+        {"/dapi/v2.0/debug/auth_sample/aabbccddeeff", METHOD_GET},
+        {"/json_rpc", METHOD_POST},
+        {"/getblocks.bin", METHOD_POST},
+        {"/dapi/v2.0/unknown", METHOD_POST},
+    };
+
+    size_t i = 0;
+    while(state.keepRunning())
+    {
+        const auto& target = targets[i++ % targets.size()];
+        Router::JobParams params;
+        bool found = root.match(target.first, target.second, params);
+        doNotOptimize(found);
+    }
+}
+
+/////////////////////////////////
+// JSON
+
+namespace
+{
+
+supernode::request::SupernodeAnnounce makeAnnounce()
+{
+    supernode::request::SupernodeAnnounce announce;
+    announce.supernode_public_id = std::string(64, 'a');
+    announce.height = 123456;
+    announce.signature = std::string(128, 'b');
+    announce.network_address = "http://127.0.0.1:28690/dapi/v2.0";
+    return announce;
+}
+
+}
+
+GRAFT_BENCHMARK(Json_serialize)
+{
+    supernode::request::SendSupernodeAnnounceJsonRpcRequest request;
+    request.method = "send_supernode_announce";
+    request.params = makeAnnounce();
+
+    while(state.keepRunning())
+    {
+        Output output;
+        output.load(request);
+        doNotOptimize(output.body);
+    }
+}
+
+GRAFT_BENCHMARK(Json_deserialize)
+{
+    supernode::request::SendSupernodeAnnounceJsonRpcRequest request;
+    request.method = "send_supernode_announce";
+    request.params = makeAnnounce();
+    Output output;
+    output.load(request);
+
+    Input input;
+    input.load(output.body);
+    while(state.keepRunning())
+    {
+        supernode::request::SendSupernodeAnnounceJsonRpcRequest parsed = input.get<supernode::request::SendSupernodeAnnounceJsonRpcRequest>();
+        doNotOptimize(parsed);
+    }
+}
+
+
+/////////////////////////////////
+// latency histograms
+
+//recording of a stage latency, it is done for every request
+GRAFT_BENCHMARK(SysInfo_recordStageLatency)
+{
+    request::system_info::Counter counter;
+    uint64_t i = 0;
+    while(state.keepRunning())
+    {
+        counter.record_stage_latency(request::system_info::Counter::Stage::WorkerAction, i++ & 0xffff);
+    }
+}
+
+//recording of a route latency, the histogram is found by the route name
+GRAFT_BENCHMARK(SysInfo_recordRouteLatency)
+{
+    request::system_info::Counter counter;
+    const std::string route = "/dapi/v2.0/presale";
+    uint64_t i = 0;
+    while(state.keepRunning())
+    {
+        counter.record_route_latency(route, i++ & 0xffff);
+    }
+}
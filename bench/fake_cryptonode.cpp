@@ -0,0 +1,514 @@
+#include "fake_cryptonode.h"
+
+#include "lib/graft/inout.h"
+#include "lib/graft/jsonrpc.h"
+#include "lib/graft/mongoosex.h"
+#include "rta/fullsupernodelist.h"
+#include "rta/supernode.h"
+#include "supernode/requests/blockchain_based_list.h"
+#include "supernode/requests/broadcast.h"
+#include "supernode/requests/multicast.h"
+#include "supernode/requests/send_raw_tx.h"
+#include "supernode/requests/send_supernode_announce.h"
+#include "supernode/requests/send_supernode_stakes.h"
+#include "supernode/requests/unicast.h"
+
+#include <misc_log_ex.h>
+
+#include <stdexcept>
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "bench.fakecryptonode"
+
+namespace graft::bench
+{
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int POLL_INTERVAL_MS = 1;
+constexpr double DELIVERY_TIMEOUT_S = 10;
+constexpr uint64_t STAKE_UNLOCK_BLOCKS = 100000;
+
+//params of send_supernode_stakes and send_supernode_blockchain_based_list sent by DaemonRpcClient
+GRAFT_DEFINE_IO_STRUCT_INITED(SupernodeListRequest,
+                              (std::string, network_address, std::string()),
+                              (std::string, supernode_public_id, std::string()),
+                              (uint64_t, last_received_block_height, 0)
+                              );
+
+GRAFT_DEFINE_JSON_RPC_REQUEST(SupernodeListJsonRpcRequest, SupernodeListRequest);
+
+GRAFT_DEFINE_IO_STRUCT_INITED(SupernodeListResponse,
+                              (int, status, STATUS_OK)
+                              );
+
+GRAFT_DEFINE_JSON_RPC_RESPONSE_RESULT(SupernodeListJsonRpcResponse, SupernodeListResponse);
+
+uint64_t tierStakeAmount(uint32_t tier)
+{
+    static const uint64_t amounts[] = {
+        Supernode::TIER1_STAKE_AMOUNT, Supernode::TIER2_STAKE_AMOUNT, Supernode::TIER3_STAKE_AMOUNT, Supernode::TIER4_STAKE_AMOUNT
+    };
+    return amounts[tier - 1];
+}
+
+//callbacks of unicast answers carry the task id, it is cut off so that all of them are counted together
+std::string latencyKey(const std::string& callback_uri)
+{
+    static const std::string callbackPrefix = "/cryptonode/callback/";
+    if(callback_uri.compare(0, callbackPrefix.size(), callbackPrefix) != 0)
+        return callback_uri;
+    return callback_uri.substr(0, callback_uri.find('/', callbackPrefix.size()));
+}
+
+template<typename T>
+std::string toJson(const T& t)
+{
+    Output output;
+    output.load(t);
+    return output.body;
+}
+
+std::string errorJson(uint64_t id, int64_t code, const std::string& message)
+{
+    JsonRpcErrorResponse response;
+    response.id = id;
+    response.error.code = code;
+    response.error.message = message;
+    return toJson(response);
+}
+
+}
+
+struct FakeCryptonode::Reply
+{
+    mg_connection* nc = nullptr;
+    std::string method;
+    std::string body;
+    Clock::time_point start;
+    size_t remaining = 0;
+};
+
+struct FakeCryptonode::Delivery
+{
+    FakeCryptonode* self;
+    std::string callback_uri;
+    std::shared_ptr<Reply> reply;
+    Clock::time_point start;
+    bool done = false;
+};
+
+FakeCryptonode::FakeCryptonode(const std::string& address, uint64_t blockHeight)
+    : m_address(address)
+    , m_blockHeight(blockHeight)
+    , m_mgr(std::make_unique<mg_mgr>())
+{
+    mg_mgr_init(m_mgr.get(), this, nullptr);
+    mg_connection* nc = mg_bind(m_mgr.get(), m_address.c_str(), serverHandler);
+    if(!nc)
+    {
+        mg_mgr_free(m_mgr.get());
+        throw std::runtime_error("fake cryptonode cannot bind " + m_address);
+    }
+    mg_set_protocol_http_websocket(nc);
+
+    m_thread = std::thread([this]{ run(); });
+}
+
+FakeCryptonode::~FakeCryptonode()
+{
+    m_stop = true;
+    m_thread.join();
+    mg_mgr_free(m_mgr.get());
+}
+
+void FakeCryptonode::addSupernode(const SupernodeInfo& supernode)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_supernodes[supernode.id] = supernode;
+}
+
+void FakeCryptonode::publishSupernodeList()
+{
+    for(const SupernodeInfo& supernode : supernodes())
+    {
+        sendStakes(supernode.network_address);
+        sendBlockchainBasedList(supernode.network_address);
+    }
+}
+
+bool FakeCryptonode::waitIdle(std::chrono::milliseconds timeout) const
+{
+    const Clock::time_point end = Clock::now() + timeout;
+    while(m_inFlight)
+    {
+        if(end < Clock::now()) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+void FakeCryptonode::run()
+{
+    while(!m_stop)
+    {
+        mg_mgr_poll(m_mgr.get(), POLL_INTERVAL_MS);
+        connectQueued();
+    }
+}
+
+void FakeCryptonode::serverHandler(mg_connection* nc, int ev, void* ev_data)
+{
+    FakeCryptonode* self = static_cast<FakeCryptonode*>(nc->mgr->user_data);
+    switch(ev)
+    {
+    case MG_EV_HTTP_REQUEST:
+        self->onRequest(nc, *static_cast<http_message*>(ev_data));
+        break;
+    case MG_EV_CLOSE:
+        //the sender has gone, the relay is completed without answering
+        if(Reply* reply = static_cast<Reply*>(nc->user_data)) reply->nc = nullptr;
+        nc->user_data = nullptr;
+        break;
+    default:
+        break;
+    }
+}
+
+void FakeCryptonode::deliveryHandler(mg_connection* nc, int ev, void* ev_data)
+{
+    Delivery* delivery = static_cast<Delivery*>(nc->user_data);
+    if(!delivery) return;
+
+    switch(ev)
+    {
+    case MG_EV_HTTP_REPLY:
+    {
+        mg_set_timer(nc, 0);
+        const http_message* hm = static_cast<http_message*>(ev_data);
+        delivery->done = true;
+        delivery->self->onDeliveryDone(*delivery, hm->resp_code == 200);
+        nc->flags |= MG_F_CLOSE_IMMEDIATELY;
+    } break;
+    case MG_EV_TIMER:
+        nc->flags |= MG_F_CLOSE_IMMEDIATELY;
+        break;
+    case MG_EV_CLOSE:
+        if(!delivery->done) delivery->self->onDeliveryDone(*delivery, false);
+        nc->user_data = nullptr;
+        delete delivery;
+        break;
+    default:
+        break;
+    }
+}
+
+void FakeCryptonode::onRequest(mg_connection* nc, const http_message& hm)
+{
+    const std::string uri(hm.uri.p, hm.uri.len);
+    const std::string body(hm.body.p, hm.body.len);
+
+    if(uri == "/json_rpc/rta")
+    {
+        onRtaRequest(nc, body);
+    }
+    else if(uri == "/sendrawtransaction")
+    {
+        //transactions are accepted as is, there is no pool to check double spends against
+        ++m_rawTransactions;
+        supernode::request::SendRawTxResponse response;
+        response.status = "OK";
+        response.not_relayed = response.low_mixin = response.double_spend = response.invalid_input = false;
+        response.invalid_output = response.too_big = response.overspend = response.fee_too_low = response.not_rct = false;
+        sendReply(nc, toJson(response));
+    }
+    else
+    {
+        mg_send_head(nc, 404, 0, nullptr);
+    }
+}
+
+void FakeCryptonode::onRtaRequest(mg_connection* nc, const std::string& body)
+{
+    using namespace supernode::request;
+
+    Input input;
+    input.load(body);
+
+    JsonRpcRequestHeader header;
+    if(!input.get(header))
+    {
+        sendReply(nc, errorJson(0, ERROR_PARSE_ERROR, "cannot parse json-rpc request"));
+        return;
+    }
+
+    if(header.method == "multicast")
+    {
+        MulticastRequestJsonRpc request;
+        if(!input.get(request))
+        {
+            sendReply(nc, errorJson(header.id, ERROR_INVALID_PARAMS, "invalid multicast request"));
+            return;
+        }
+        MulticastResponseFromCryptonodeJsonRpc response;
+        response.id = header.id;
+        relay(nc, header.method, toJson(response), request.params.receiver_addresses, request.params.callback_uri, body);
+    }
+    else if(header.method == "broadcast")
+    {
+        BroadcastRequestJsonRpc request;
+        if(!input.get(request))
+        {
+            sendReply(nc, errorJson(header.id, ERROR_INVALID_PARAMS, "invalid broadcast request"));
+            return;
+        }
+        std::vector<std::string> receivers;
+        for(const SupernodeInfo& supernode : supernodes())
+        {
+            if(supernode.id != request.params.sender_address) receivers.push_back(supernode.id);
+        }
+        BroadcastResponseFromCryptonodeJsonRpc response;
+        response.id = header.id;
+        relay(nc, header.method, toJson(response), receivers, request.params.callback_uri, body);
+    }
+    else if(header.method == "unicast")
+    {
+        UnicastRequestJsonRpc request;
+        if(!input.get(request))
+        {
+            sendReply(nc, errorJson(header.id, ERROR_INVALID_PARAMS, "invalid unicast request"));
+            return;
+        }
+        UnicastResponseFromCryptonodeJsonRpc response;
+        response.id = header.id;
+        sendReply(nc, toJson(response));
+        m_rpcLatency.get(header.method).record(0);
+        relay(nullptr, header.method, std::string(), {request.params.receiver_address}, request.params.callback_uri, body);
+    }
+    else if(header.method == "send_supernode_announce")
+    {
+        SendSupernodeAnnounceJsonRpcRequest request;
+        if(!input.get(request))
+        {
+            sendReply(nc, errorJson(header.id, ERROR_INVALID_PARAMS, "invalid announce"));
+            return;
+        }
+        {
+            //announces of unknown supernodes make them reachable, but they have no stake
+            std::lock_guard<std::mutex> lock(m_mutex);
+            SupernodeInfo& supernode = m_supernodes[request.params.supernode_public_id];
+            if(supernode.id.empty())
+            {
+                supernode.id = request.params.supernode_public_id;
+                supernode.tier = 0;
+            }
+            supernode.network_address = request.params.network_address;
+        }
+        SendSupernodeAnnounceJsonRpcResponse response;
+        response.id = header.id;
+        response.result.Status = STATUS_OK;
+        sendReply(nc, toJson(response));
+    }
+    else if(header.method == "send_supernode_stakes" || header.method == "send_supernode_blockchain_based_list")
+    {
+        SupernodeListJsonRpcRequest request;
+        if(!input.get(request))
+        {
+            sendReply(nc, errorJson(header.id, ERROR_INVALID_PARAMS, "invalid " + header.method + " request"));
+            return;
+        }
+        SupernodeListJsonRpcResponse response;
+        response.id = header.id;
+        sendReply(nc, toJson(response));
+
+        if(header.method == "send_supernode_stakes")
+            sendStakes(request.params.network_address);
+        else
+            sendBlockchainBasedList(request.params.network_address);
+    }
+    else
+    {
+        sendReply(nc, errorJson(header.id, ERROR_METHOD_NOT_FOUND, "unknown method " + header.method));
+    }
+}
+
+void FakeCryptonode::relay(mg_connection* nc, const std::string& method, const std::string& answer,
+                           const std::vector<std::string>& receivers, const std::string& callback_uri, const std::string& body)
+{
+    std::shared_ptr<Reply> reply;
+    if(nc)
+    {
+        reply = std::make_shared<Reply>();
+        reply->nc = nc;
+        reply->method = method;
+        reply->body = answer;
+        reply->start = Clock::now();
+    }
+
+    std::vector<Outgoing> deliveries;
+    deliveries.reserve(receivers.size());
+    for(const std::string& id : receivers)
+    {
+        std::string network_address;
+        if(!findNetworkAddress(id, network_address))
+        {
+            LOG_PRINT_L1("fake cryptonode: unknown receiver " << id << " of " << method);
+            ++m_failedDeliveries;
+            continue;
+        }
+        deliveries.push_back({network_address + callback_uri, callback_uri, body, reply});
+    }
+
+    if(reply)
+    {
+        reply->remaining = deliveries.size();
+        if(deliveries.empty())
+        {
+            m_rpcLatency.get(method).record(0);
+            sendReply(nc, answer);
+            return;
+        }
+        nc->user_data = reply.get();
+    }
+
+    for(Outgoing& outgoing : deliveries)
+    {
+        ++m_inFlight;
+        connect(std::move(outgoing));
+    }
+}
+
+void FakeCryptonode::onDeliveryDone(Delivery& delivery, bool ok)
+{
+    if(ok)
+    {
+        ++m_deliveries;
+        m_deliveryLatency.get(latencyKey(delivery.callback_uri)).record(
+                    std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - delivery.start).count());
+    }
+    else
+    {
+        ++m_failedDeliveries;
+    }
+    --m_inFlight;
+
+    std::shared_ptr<Reply> reply = std::move(delivery.reply);
+    if(!reply || --reply->remaining != 0) return;
+
+    m_rpcLatency.get(reply->method).record(
+                std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - reply->start).count());
+    if(!reply->nc) return;
+    reply->nc->user_data = nullptr;
+    //connections are not answered while they are being closed on shutdown
+    if(!m_stop) sendReply(reply->nc, reply->body);
+}
+
+void FakeCryptonode::sendReply(mg_connection* nc, const std::string& body)
+{
+    mg_send_head(nc, 200, body.size(), "Content-Type: application/json");
+    mg_send(nc, body.data(), body.size());
+}
+
+void FakeCryptonode::sendStakes(const std::string& network_address)
+{
+    supernode::request::SendSupernodeStakesJsonRpcRequest request;
+    request.method = "send_supernode_stakes";
+    request.params.block_height = m_blockHeight;
+    for(const SupernodeInfo& supernode : supernodes())
+    {
+        if(supernode.tier == 0) continue;
+
+        supernode::request::SupernodeStake stake;
+        stake.amount = tierStakeAmount(supernode.tier);
+        stake.tier = supernode.tier;
+        stake.block_height = 1;
+        stake.unlock_time = m_blockHeight + STAKE_UNLOCK_BLOCKS;
+        stake.supernode_public_id = supernode.id;
+        stake.supernode_public_address = supernode.wallet_address;
+        request.params.stakes.push_back(stake);
+    }
+
+    ++m_inFlight;
+    enqueue({network_address + "/send_supernode_stakes", "/send_supernode_stakes", toJson(request), nullptr});
+}
+
+void FakeCryptonode::sendBlockchainBasedList(const std::string& network_address)
+{
+    supernode::request::BlockchainBasedListJsonRpcRequest request;
+    request.method = "blockchain_based_list";
+    request.params.block_height = m_blockHeight;
+    request.params.tiers.resize(FullSupernodeList::TIERS);
+    for(const SupernodeInfo& supernode : supernodes())
+    {
+        if(supernode.tier == 0) continue;
+
+        supernode::request::BlockchainBasedListTierEntry entry;
+        entry.supernode_public_id = supernode.id;
+        entry.supernode_public_address = supernode.wallet_address;
+        entry.amount = tierStakeAmount(supernode.tier);
+        request.params.tiers[supernode.tier - 1].supernodes.push_back(entry);
+    }
+
+    ++m_inFlight;
+    enqueue({network_address + "/blockchain_based_list", "/blockchain_based_list", toJson(request), nullptr});
+}
+
+void FakeCryptonode::enqueue(Outgoing&& outgoing)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.push_back(std::move(outgoing));
+}
+
+void FakeCryptonode::connectQueued()
+{
+    std::vector<Outgoing> queue;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        queue.swap(m_queue);
+    }
+    for(Outgoing& outgoing : queue)
+    {
+        connect(std::move(outgoing));
+    }
+}
+
+void FakeCryptonode::connect(Outgoing&& outgoing)
+{
+    Delivery* delivery = new Delivery{this, std::move(outgoing.callback_uri), std::move(outgoing.reply), Clock::now()};
+    mg_connection* nc = mg_connect_http(m_mgr.get(), deliveryHandler, outgoing.url.c_str(),
+                                        "Content-Type: application/json\r\n", outgoing.body.c_str());
+    if(!nc)
+    {
+        onDeliveryDone(*delivery, false);
+        delete delivery;
+        return;
+    }
+    nc->user_data = delivery;
+    mg_set_timer(nc, mg_time() + DELIVERY_TIMEOUT_S);
+}
+
+std::vector<FakeCryptonode::SupernodeInfo> FakeCryptonode::supernodes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<SupernodeInfo> result;
+    result.reserve(m_supernodes.size());
+    for(auto& it : m_supernodes)
+    {
+        if(!it.second.network_address.empty()) result.push_back(it.second);
+    }
+    return result;
+}
+
+bool FakeCryptonode::findNetworkAddress(const std::string& id, std::string& network_address) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_supernodes.find(id);
+    if(it == m_supernodes.end() || it->second.network_address.empty()) return false;
+    network_address = it->second.network_address;
+    return true;
+}
+
+}//namespace graft::bench
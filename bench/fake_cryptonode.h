@@ -0,0 +1,115 @@
+#pragma once
+
+#include "lib/graft/sys_info.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct mg_connection;
+struct mg_mgr;
+struct http_message;
+
+namespace graft::bench
+{
+
+//In-process replacement of the cryptonode RTA relay for benchmarks running on a single box.
+//It serves /json_rpc/rta (multicast, broadcast, unicast, announce, stakes and blockchain based list requests)
+//and /sendrawtransaction, delivering RTA messages to the registered supernodes over loopback HTTP.
+//Multicast and broadcast are answered when all deliveries are done, so the answer time is the fan-out time;
+//unicast is answered immediately as the sender waits for a callback anyway.
+class FakeCryptonode
+{
+public:
+    using LatencyHistogramSet = request::system_info::LatencyHistogramSet;
+
+    struct SupernodeInfo
+    {
+        std::string id;              //public id key as hex
+        std::string wallet_address;
+        std::string network_address; //e.g. http://127.0.0.1:28690/dapi/v2.0
+        uint32_t tier = 1;           //1..4
+    };
+
+    FakeCryptonode(const std::string& address, uint64_t blockHeight);
+    ~FakeCryptonode();
+    FakeCryptonode(const FakeCryptonode&) = delete;
+    FakeCryptonode& operator = (const FakeCryptonode&) = delete;
+
+    const std::string& address() const { return m_address; }
+    uint64_t blockHeight() const { return m_blockHeight; }
+
+    void addSupernode(const SupernodeInfo& supernode);
+    //sends stakes and the blockchain based list to all registered supernodes
+    void publishSupernodeList();
+    //returns when all queued and in flight deliveries are done or timeout expires
+    bool waitIdle(std::chrono::milliseconds timeout) const;
+
+    //latency of deliveries to the supernodes by callback uri
+    const LatencyHistogramSet& deliveryLatency() const { return m_deliveryLatency; }
+    //time from receiving a /json_rpc/rta request to the answer by method
+    const LatencyHistogramSet& rpcLatency() const { return m_rpcLatency; }
+
+    uint64_t deliveries() const { return m_deliveries; }
+    uint64_t failedDeliveries() const { return m_failedDeliveries; }
+    uint64_t rawTransactions() const { return m_rawTransactions; }
+
+private:
+    struct Reply;
+    struct Delivery;
+    struct Outgoing
+    {
+        std::string url;
+        std::string callback_uri;
+        std::string body;
+        std::shared_ptr<Reply> reply;
+    };
+
+    void run();
+    static void serverHandler(mg_connection* nc, int ev, void* ev_data);
+    static void deliveryHandler(mg_connection* nc, int ev, void* ev_data);
+
+    void onRequest(mg_connection* nc, const http_message& hm);
+    void onRtaRequest(mg_connection* nc, const std::string& body);
+    void onDeliveryDone(Delivery& delivery, bool ok);
+
+    //fans the body out to the receivers, the answer is sent to nc when all of them respond
+    void relay(mg_connection* nc, const std::string& method, const std::string& answer,
+               const std::vector<std::string>& receivers, const std::string& callback_uri, const std::string& body);
+    void sendReply(mg_connection* nc, const std::string& body);
+    void sendStakes(const std::string& network_address);
+    void sendBlockchainBasedList(const std::string& network_address);
+
+    //deliveries from other threads are queued and connected by the polling thread
+    void enqueue(Outgoing&& outgoing);
+    void connectQueued();
+    void connect(Outgoing&& outgoing);
+
+    std::vector<SupernodeInfo> supernodes() const;
+    bool findNetworkAddress(const std::string& id, std::string& network_address) const;
+
+    const std::string m_address;
+    const uint64_t m_blockHeight;
+    std::unique_ptr<mg_mgr> m_mgr;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, SupernodeInfo> m_supernodes;
+    std::vector<Outgoing> m_queue;
+
+    std::atomic<uint64_t> m_inFlight{0};
+    std::atomic<uint64_t> m_deliveries{0};
+    std::atomic<uint64_t> m_failedDeliveries{0};
+    std::atomic<uint64_t> m_rawTransactions{0};
+    LatencyHistogramSet m_deliveryLatency;
+    LatencyHistogramSet m_rpcLatency;
+
+    std::atomic_bool m_stop{false};
+    std::thread m_thread;
+};
+
+}//namespace graft::bench
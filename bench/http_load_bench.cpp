@@ -0,0 +1,194 @@
+#include "benchmark.h"
+#include "server_runner.h"
+
+#include "lib/graft/connection.h"
+#include "lib/graft/sys_info.h"
+
+using namespace graft;
+using bench::ServerRunner;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+using LatencyHistogram = request::system_info::LatencyHistogram;
+
+//Keeps the given number of requests in flight through mongoose loopback connections,
+//a new connection is opened as soon as the response of the previous one arrives.
+class LoadGenerator
+{
+public:
+    LoadGenerator(const std::string& url, const std::string& body, int connections)
+        : m_url(url), m_body(body), m_connections(connections)
+    {
+        mg_mgr_init(&m_mgr, this, nullptr);
+    }
+
+    ~LoadGenerator()
+    {
+        mg_mgr_free(&m_mgr);
+    }
+
+    void run(std::chrono::milliseconds duration)
+    {
+        m_sending = true;
+        for(int i = 0; i < m_connections; ++i) connect();
+
+        const Clock::time_point end = Clock::now() + duration;
+        while(Clock::now() < end)
+        {
+            mg_mgr_poll(&m_mgr, 1);
+        }
+
+        //responses to the requests in flight are not counted
+        m_sending = false;
+        const Clock::time_point drainEnd = Clock::now() + std::chrono::seconds(5);
+        while(m_inFlight && Clock::now() < drainEnd)
+        {
+            mg_mgr_poll(&m_mgr, 1);
+        }
+    }
+
+    uint64_t completed() const { return m_completed; }
+    uint64_t failed() const { return m_failed; }
+    const LatencyHistogram& latency() const { return m_latency; }
+
+private:
+    struct Request
+    {
+        LoadGenerator* generator;
+        Clock::time_point start;
+        bool replied = false;
+    };
+
+    void connect()
+    {
+        mg_connection* nc = mg_connect_http(&m_mgr, evHandler, m_url.c_str(), "Content-Type: application/json\r\n", m_body.c_str());
+        if(!nc)
+        {
+            ++m_failed;
+            return;
+        }
+        nc->user_data = new Request{this, Clock::now()};
+        ++m_inFlight;
+    }
+
+    static void evHandler(mg_connection* nc, int ev, void* ev_data)
+    {
+        Request* request = static_cast<Request*>(nc->user_data);
+        if(!request) return;
+        LoadGenerator* self = request->generator;
+
+        switch(ev)
+        {
+        case MG_EV_HTTP_REPLY:
+        {
+            http_message* hm = static_cast<http_message*>(ev_data);
+            if(self->m_sending)
+            {
+                if(hm->resp_code == 200)
+                {
+                    ++self->m_completed;
+                    self->m_latency.record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - request->start).count());
+                }
+                else
+                {
+                    ++self->m_failed;
+                }
+            }
+            request->replied = true;
+            nc->flags |= MG_F_CLOSE_IMMEDIATELY;
+        } break;
+        case MG_EV_CLOSE:
+        {
+            if(!request->replied && self->m_sending) ++self->m_failed;
+            nc->user_data = nullptr;
+            delete request;
+            --self->m_inFlight;
+            if(self->m_sending) self->connect();
+        } break;
+        default:
+            break;
+        }
+    }
+
+    const std::string m_url;
+    const std::string m_body;
+    const int m_connections;
+
+    mg_mgr m_mgr;
+    bool m_sending = false;
+    int m_inFlight = 0;
+    uint64_t m_completed = 0;
+    uint64_t m_failed = 0;
+    LatencyHistogram m_latency;
+};
+
+ConfigOpts makeConfigOpts()
+{
+    ConfigOpts copts;
+    copts.http_address = bench::option("http-address", std::string("127.0.0.1:9190"));
+    copts.coap_address = "udp://127.0.0.1:9191";
+    copts.http_connection_timeout = 10;
+    copts.upstream_request_timeout = 10;
+    copts.workers_count = bench::option("http-workers", 0);
+    copts.worker_queue_len = 0;
+    copts.workers_expelling_interval_ms = 1000;
+    copts.cryptonode_rpc_address = "127.0.0.1:1234";
+    copts.timer_poll_interval_ms = 50;
+    copts.lru_timeout_ms = 60000;
+    return copts;
+}
+
+Status echo(const Router::vars_t& vars, const Input& input, Context& ctx, Output& output)
+{
+    output.body = input.body;
+    return Status::Ok;
+}
+
+void runLoad(bench::State& state, const Router::Handler3& h3)
+{
+    Router router;
+    router.addRoute("/bench/echo", METHOD_POST, h3);
+
+    ConfigOpts copts = makeConfigOpts();
+    ServerRunner server(router, copts);
+
+    const std::string body(bench::option("http-body-size", 256), 'x');
+    const std::chrono::milliseconds duration(bench::option("http-duration-ms", 3000));
+
+    LoadGenerator generator("http://" + copts.http_address + "/bench/echo", body, bench::option("http-connections", 32));
+    generator.run(duration);
+
+    if(!generator.completed())
+    {
+        state.error("no responses from the server");
+        return;
+    }
+
+    state.setElapsed(duration);
+    state.setItems(generator.completed());
+
+    const LatencyHistogram& latency = generator.latency();
+    state.counter("p50_us", latency.percentile(0.5));
+    state.counter("p90_us", latency.percentile(0.9));
+    state.counter("p99_us", latency.percentile(0.99));
+    state.counter("p999_us", latency.percentile(0.999));
+    state.counter("max_us", latency.max());
+    state.counter("failed", generator.failed());
+}
+
+}
+
+//handler runs in the IO thread
+GRAFT_BENCHMARK_ONCE(Http_echoIoThread)
+{
+    runLoad(state, Router::Handler3(echo, nullptr, nullptr, "echo"));
+}
+
+//handler runs in the thread pool, the request goes IO thread -> worker -> IO thread
+GRAFT_BENCHMARK_ONCE(Http_echoWorker)
+{
+    runLoad(state, Router::Handler3(nullptr, echo, nullptr, "echo"));
+}
+
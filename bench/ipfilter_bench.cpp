@@ -0,0 +1,164 @@
+#include "benchmark.h"
+
+#include "lib/graft/blacklist.h"
+#include "lib/graft/rate_limiter.h"
+
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
+using namespace graft;
+using bench::State;
+using bench::doNotOptimize;
+
+namespace
+{
+
+//number of distinct source addresses
+constexpr uint32_t sourcesCount = 1 << 20;
+
+//pseudo random addresses spread over the whole address space
+class Sources
+{
+public:
+    explicit Sources(uint32_t seed) : m_state(seed * 2654435761u + 1) { }
+
+    uint32_t next()
+    {
+        m_state = m_state * 1664525u + 1013904223u;
+        return ((m_state >> 8) % sourcesCount) * 4093u + 1;
+    }
+
+private:
+    uint32_t m_state;
+};
+
+//a rules file of mixed IPv4 and IPv6 networks
+std::string makeRules(size_t count)
+{
+    std::ostringstream oss;
+    Sources sources(7);
+    for(size_t i = 0; i < count; ++i)
+    {
+        uint32_t a = sources.next() * 2654435761u;
+        oss << ((i & 1)? "deny " : "allow ");
+        if(i % 3 == 0)
+        {
+            oss << "2001:db8:" << std::hex << (a >> 16) << ':' << (a & 0xFFFF) << std::dec << "::/" << 48 + a % 17;
+        }
+        else
+        {
+            oss << (a >> 24) << '.' << ((a >> 16) & 0xFF) << '.' << ((a >> 8) & 0xFF) << '.' << (a & 0xFF) << '/' << 16 + a % 17;
+        }
+        oss << " ;; rule " << i << '\n';
+    }
+    oss << "allow all\n";
+    return oss.str();
+}
+
+size_t threadsCount()
+{
+    return std::max(2u, std::thread::hardware_concurrency());
+}
+
+}
+
+/////////////////////////////////
+// rate limiter
+
+//checks of 1M source IPs from a single thread, most of the buckets are created and evicted on the way
+GRAFT_BENCHMARK(RateLimiter_check)
+{
+    RateLimiter limiter(10, 50, std::chrono::seconds(300));
+    Sources sources(1);
+
+    while(state.keepRunning())
+    {
+        doNotOptimize(limiter.check(sources.next()));
+    }
+    state.counter("buckets", limiter.size());
+}
+
+//the same from all cores, the shards are shared by the threads
+GRAFT_BENCHMARK(RateLimiter_checkContended)
+{
+    RateLimiter limiter(10, 50, std::chrono::seconds(300));
+
+    const size_t threads = threadsCount();
+    const uint64_t perThread = std::max<uint64_t>(1, state.iterations() / threads);
+
+    auto start = State::Clock::now();
+    std::vector<std::thread> th;
+    for(size_t t = 0; t < threads; ++t)
+    {
+        th.emplace_back([&, t]
+        {
+            Sources sources(t + 1);
+            for(uint64_t i = 0; i < perThread; ++i)
+            {
+                doNotOptimize(limiter.check(sources.next()));
+            }
+        });
+    }
+    for(auto& t : th) t.join();
+    state.setElapsed(State::Clock::now() - start);
+    state.setItems(perThread * threads);
+    state.counter("buckets", limiter.size());
+}
+
+//an accepted connection with the default [ipfilter] options and a few rules
+GRAFT_BENCHMARK(BlackList_processIp)
+{
+    auto blackList = BlackList::Create(100, 5, 300);
+    std::istringstream rules("deny 10.0.0.0/8\nallow 10.1.0.0/16\ndeny 192.168.1.1\n");
+    blackList->readRules(rules);
+    Sources sources(1);
+
+    while(state.keepRunning())
+    {
+        doNotOptimize(blackList->processIp(sources.next(), false));
+    }
+}
+
+//the same for IPv6 clients, the rules of both families are in one table
+GRAFT_BENCHMARK(BlackList_processIp6)
+{
+    auto blackList = BlackList::Create(100, 5, 300);
+    std::istringstream rules("deny 2001:db8::/32\nallow 2001:db8:1::/48\ndeny 10.0.0.0/8\n");
+    blackList->readRules(rules);
+    Sources sources(1);
+
+    while(state.keepRunning())
+    {
+        IpAddress addr(0x2001000000000000ull | (uint64_t(sources.next()) << 16), 1);
+        doNotOptimize(blackList->processIp(addr));
+    }
+}
+
+//parsing of a rules file of 100k rules and building of its table
+GRAFT_BENCHMARK(BlackList_readRules100k)
+{
+    auto blackList = BlackList::Create(0, 0, 0);
+    const std::string rules = makeRules(100000);
+
+    while(state.keepRunning())
+    {
+        std::istringstream iss(rules);
+        blackList->readRules(iss);
+    }
+    state.counter("rules", blackList->rulesCount());
+}
+
+//lookups in the table of 100k rules, the limiter is disabled
+GRAFT_BENCHMARK(BlackList_processIpRules100k)
+{
+    auto blackList = BlackList::Create(0, 0, 0);
+    std::istringstream rules(makeRules(100000));
+    blackList->readRules(rules);
+    Sources sources(1);
+
+    while(state.keepRunning())
+    {
+        doNotOptimize(blackList->processIp(sources.next() * 2654435761u, false));
+    }
+}
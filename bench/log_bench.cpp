@@ -0,0 +1,85 @@
+#include "benchmark.h"
+
+#include "lib/graft/async_logger.h"
+#include "lib/graft/log.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace graft;
+using bench::State;
+using bench::doNotOptimize;
+
+namespace
+{
+
+const std::string LOG_LINE = "2018-11-01 10:00:00.000\t140213\tDEBUG\tsupernode.task\ttask.cpp:1102\t[127.0.0.1:52214] CryptoNode answered\n";
+const size_t THREADS = 4;
+
+std::string tempLogFile(const std::string& name)
+{
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path(name + "-%%%%%%%%.log");
+    return path.string();
+}
+
+//state.iterations() log lines are written from THREADS threads
+template<typename Write>
+void writeLines(State& state, Write write)
+{
+    const uint64_t perThread = std::max<uint64_t>(1, state.iterations() / THREADS);
+
+    auto start = State::Clock::now();
+    std::vector<std::thread> threads;
+    for(size_t t = 0; t < THREADS; ++t)
+    {
+        threads.emplace_back([&]{ for(uint64_t i = 0; i < perThread; ++i) write(std::string(LOG_LINE)); });
+    }
+    for(auto& th : threads) th.join();
+    state.setElapsed(State::Clock::now() - start);
+    state.setItems(perThread * THREADS);
+}
+
+}
+
+//log calls of the async logger, the lines are written to the file by its own thread
+GRAFT_BENCHMARK(Log_asyncWrite)
+{
+    const std::string filename = tempLogFile("bench");
+    {
+        AsyncLogger logger(filename, false, std::max<uint64_t>(state.iterations(), 8192));
+        writeLines(state, [&logger](std::string&& line){ logger.write(std::move(line)); });
+        logger.flush();
+        state.counter("dropped", logger.dropped());
+    }
+    boost::filesystem::remove(filename);
+}
+
+//the same lines written synchronously under a lock as the default logger does
+GRAFT_BENCHMARK(Log_syncWrite)
+{
+    const std::string filename = tempLogFile("bench");
+    {
+        std::ofstream file(filename, std::ios::app);
+        std::mutex mutex;
+        writeLines(state, [&](std::string&& line){ std::lock_guard<std::mutex> lk(mutex); file << line; file.flush(); });
+    }
+    boost::filesystem::remove(filename);
+}
+
+//dump of a 1 MB body with a new line every 64 bytes, items are megabytes
+GRAFT_BENCHMARK(Log_dumpOutput)
+{
+    std::string body(1 << 20, 'x');
+    for(size_t i = 0; i < body.size(); i += 64) body[i] = '\n';
+
+    while(state.keepRunning())
+    {
+        std::string dump = make_dump_output(body, -1);
+        doNotOptimize(dump);
+    }
+}
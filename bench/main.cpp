@@ -0,0 +1,173 @@
+#include "benchmark.h"
+
+#include <misc_log_ex.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <regex>
+
+namespace graft::bench
+{
+
+namespace
+{
+
+struct Benchmark
+{
+    std::string name;
+    Function function;
+    uint64_t iterations;
+};
+
+std::vector<Benchmark>& benchmarks()
+{
+    static std::vector<Benchmark> list;
+    return list;
+}
+
+std::map<std::string, std::string>& options()
+{
+    static std::map<std::string, std::string> opts;
+    return opts;
+}
+
+//runs the benchmark with increasing number of iterations until it takes at least minTime
+State run(const Benchmark& b, double minTime)
+{
+    uint64_t iterations = b.iterations ? b.iterations : 1;
+    for(;;)
+    {
+        State state(iterations);
+        b.function(state);
+        double elapsed = std::chrono::duration<double>(state.elapsed()).count();
+        if(b.iterations || !state.error().empty() || minTime <= elapsed || iterations >= 1000000000)
+            return state;
+
+        double scale = (elapsed <= 0) ? 100 : std::min(100.0, 1.4 * minTime / elapsed);
+        iterations = std::max(iterations + 1, uint64_t(iterations * scale));
+    }
+}
+
+void report(const std::string& name, const State& state)
+{
+    std::cout << std::left << std::setw(40) << name << std::right;
+    if(!state.error().empty())
+    {
+        std::cout << " ERROR: " << state.error() << std::endl;
+        return;
+    }
+
+    double elapsed = std::chrono::duration<double>(state.elapsed()).count();
+    double ns = elapsed * 1e9 / state.iterations();
+    double perSecond = elapsed > 0 ? state.items() / elapsed : 0;
+
+    std::cout << std::setw(12) << state.iterations()
+              << std::setw(14) << std::fixed << std::setprecision(1) << ns << " ns"
+              << std::setw(14) << std::setprecision(0) << perSecond << " items/s";
+    for(auto& c : state.counters())
+    {
+        std::cout << "  " << c.first << "=" << std::setprecision(1) << c.second;
+    }
+    std::cout << std::endl;
+}
+
+void usage()
+{
+    std::cout << "Usage: graft_bench [--filter=<regex>] [--min-time=<seconds>] [--list] [--<option>=<value>...]\n"
+                 "  --filter     run benchmarks whose names match the regex\n"
+                 "  --min-time   minimal duration of a benchmark run, 0.5 by default\n"
+                 "  --list       list benchmarks\n"
+                 "Options of the HTTP load benchmark:\n"
+                 "  --http-connections  concurrent connections, 32 by default\n"
+                 "  --http-duration-ms  duration of the load, 3000 by default\n"
+                 "  --http-workers      worker threads of the server, 0 means number of cores\n"
+                 "  --http-body-size    size of the request body, 256 by default\n"
+                 "Options of the RTA payment flow benchmark:\n"
+                 "  --rta-supernodes          supernodes hosted in the process, 16 by default\n"
+                 "  --rta-payments            concurrent payments, 16 by default\n"
+                 "  --rta-duration-ms         duration of the load, 5000 by default\n"
+                 "  --rta-workers             worker threads of each supernode, 2 by default\n"
+                 "  --rta-base-port           first port of the supernodes, 9300 by default\n"
+                 "  --rta-cryptonode-address  address of the fake cryptonode, 127.0.0.1:9290 by default\n"
+                 "  --rta-binary-payloads     1 to use binary payloads of multicasts\n";
+}
+
+}
+
+bool registerBenchmark(const std::string& name, Function function, uint64_t iterations)
+{
+    benchmarks().push_back({name, std::move(function), iterations});
+    return true;
+}
+
+std::string option(const std::string& name, const std::string& defaultValue)
+{
+    auto it = options().find(name);
+    return it == options().end() ? defaultValue : it->second;
+}
+
+int option(const std::string& name, int defaultValue)
+{
+    auto it = options().find(name);
+    return it == options().end() ? defaultValue : std::stoi(it->second);
+}
+
+}//namespace graft::bench
+
+int main(int argc, char** argv)
+{
+    using namespace graft::bench;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if(arg == "--help" || arg == "-h")
+        {
+            usage();
+            return 0;
+        }
+        if(arg.compare(0, 2, "--") != 0)
+        {
+            std::cerr << "unknown argument " << arg << std::endl;
+            usage();
+            return 1;
+        }
+        size_t eq = arg.find('=');
+        if(eq == std::string::npos)
+            options()[arg.substr(2)] = "1";
+        else
+            options()[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+    }
+
+    mlog_configure("graft_bench.log", false);
+    mlog_set_log_level(0);
+
+    std::vector<Benchmark> list = benchmarks();
+    std::sort(list.begin(), list.end(), [](const Benchmark& a, const Benchmark& b){ return a.name < b.name; });
+
+    std::regex filter(option("filter", std::string(".*")));
+    double minTime = std::stod(option("min-time", std::string("0.5")));
+    bool listOnly = options().count("list");
+
+    if(!listOnly)
+    {
+        std::cout << std::left << std::setw(40) << "benchmark" << std::right
+                  << std::setw(12) << "iterations" << std::setw(17) << "time/iteration" << std::setw(22) << "throughput" << std::endl;
+    }
+
+    for(const Benchmark& b : list)
+    {
+        if(!std::regex_search(b.name, filter)) continue;
+        if(listOnly)
+        {
+            std::cout << b.name << std::endl;
+            continue;
+        }
+        report(b.name, run(b, minTime));
+    }
+    return 0;
+}
+
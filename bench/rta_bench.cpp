@@ -0,0 +1,480 @@
+#include "benchmark.h"
+
+#include "lib/graft/inout.h"
+#include "supernode/requests/authorize_rta_tx.h"
+#include "supernode/requests/send_supernode_announce.h"
+
+#include <rta/announcefilter.h>
+#include <rta/fullsupernodelist.h>
+#include <rta/signatureverifier.h>
+#include <rta/supernode.h>
+
+#include <string_tools.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace graft;
+using bench::doNotOptimize;
+
+namespace
+{
+
+const std::string DAEMON_ADDRESS = "localhost:28881";
+const bool TESTNET = true;
+
+FullSupernodeList::supernode_stake_array generateStakes(size_t supernodes_per_tier)
+{
+    const uint64_t tier_amounts[FullSupernodeList::TIERS] = {
+        Supernode::TIER1_STAKE_AMOUNT, Supernode::TIER2_STAKE_AMOUNT, Supernode::TIER3_STAKE_AMOUNT, Supernode::TIER4_STAKE_AMOUNT
+    };
+
+    FullSupernodeList::supernode_stake_array stakes;
+
+    for (int tier = 0; tier < FullSupernodeList::TIERS; ++tier)
+    {
+        for (size_t i = 0; i < supernodes_per_tier; ++i)
+        {
+            crypto::public_key id_key;
+            crypto::secret_key secret_key;
+            crypto::generate_keys(id_key, secret_key);
+
+            supernode_stake stake;
+            stake.amount = tier_amounts[tier];
+            stake.block_height = 1;
+            stake.unlock_time = 100000;
+            stake.supernode_public_id = epee::string_tools::pod_to_hex(id_key);
+            stakes.push_back(stake);
+        }
+    }
+
+    return stakes;
+}
+
+FullSupernodeList::blockchain_based_list_ptr makeBlockchainBasedList(const FullSupernodeList::supernode_stake_array& stakes, size_t supernodes_per_tier)
+{
+    FullSupernodeList::blockchain_based_list_ptr list = std::make_shared<FullSupernodeList::blockchain_based_list>();
+
+    for (size_t i = 0; i < stakes.size(); ++i)
+    {
+        if (i % supernodes_per_tier == 0)
+            list->emplace_back();
+
+        FullSupernodeList::blockchain_based_list_entry entry;
+        entry.supernode_public_id = stakes[i].supernode_public_id;
+        entry.amount = stakes[i].amount;
+        list->back().push_back(entry);
+    }
+
+    return list;
+}
+
+//supernode list of 4 tiers with given number of supernodes in each
+std::unique_ptr<FullSupernodeList> makeSupernodeList(size_t supernodes_per_tier, uint64_t block_number)
+{
+    auto fsl = std::make_unique<FullSupernodeList>(DAEMON_ADDRESS, TESTNET);
+    FullSupernodeList::supernode_stake_array stakes = generateStakes(supernodes_per_tier);
+    fsl->updateStakes(block_number, stakes, DAEMON_ADDRESS, TESTNET);
+    fsl->setBlockchainBasedList(block_number, makeBlockchainBasedList(stakes, supernodes_per_tier));
+    return fsl;
+}
+
+size_t threadsCount()
+{
+    return std::max(2u, std::thread::hardware_concurrency());
+}
+
+struct SignedMessage
+{
+    std::string msg;
+    crypto::public_key pkey;
+    crypto::signature signature;
+};
+
+std::vector<SignedMessage> makeSignedMessages(size_t count)
+{
+    std::vector<SignedMessage> messages(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        crypto::secret_key skey;
+        crypto::generate_keys(messages[i].pkey, skey);
+        messages[i].msg = "payment " + std::to_string(i) + std::string(64, 'x');
+
+        crypto::hash hash;
+        crypto::cn_fast_hash(messages[i].msg.data(), messages[i].msg.size(), hash);
+        crypto::generate_signature(hash, messages[i].pkey, skey, messages[i].signature);
+    }
+    return messages;
+}
+
+std::string signedHex(const std::string& msg, const crypto::public_key& pkey, const crypto::secret_key& skey)
+{
+    crypto::hash hash;
+    crypto::cn_fast_hash(msg.data(), msg.size(), hash);
+    crypto::signature sign;
+    crypto::generate_signature(hash, pkey, skey, sign);
+    return epee::string_tools::pod_to_hex(sign);
+}
+
+//announce of a new supernode signed with its id key
+supernode::request::SupernodeAnnounce makeAnnounce(uint64_t height)
+{
+    crypto::public_key id_key;
+    crypto::secret_key secret_key;
+    crypto::generate_keys(id_key, secret_key);
+
+    supernode::request::SupernodeAnnounce announce;
+    announce.supernode_public_id = epee::string_tools::pod_to_hex(id_key);
+    announce.height = height;
+    announce.signature = signedHex(announce.supernode_public_id, id_key, secret_key);
+    announce.network_address = "http://localhost:28690/dapi/v2.0";
+    return announce;
+}
+
+//auth vote, the most frequent multicast payload
+supernode::request::AuthorizeRtaTxResponse makeAuthVote()
+{
+    crypto::public_key pkey;
+    crypto::secret_key skey;
+    crypto::generate_keys(pkey, skey);
+
+    crypto::hash tx_hash;
+    crypto::cn_fast_hash("tx", 2, tx_hash);
+
+    supernode::request::AuthorizeRtaTxResponse vote;
+    vote.tx_id = epee::string_tools::pod_to_hex(tx_hash);
+    vote.result = static_cast<int>(RTAAuthResult::Approved);
+    vote.signature.id_key = epee::string_tools::pod_to_hex(pkey);
+    vote.signature.result_signature = signedHex(vote.tx_id + ":" + std::to_string(vote.result), pkey, skey);
+    vote.signature.tx_signature = signedHex(vote.tx_id, pkey, skey);
+    return vote;
+}
+
+//decodes the auth vote payload serialized with format S
+template<template<typename> class S>
+void decodeAuthVote(bench::State& state)
+{
+    using Vote = supernode::request::AuthorizeRtaTxResponse;
+    Output out;
+    out.loadT<S>(makeAuthVote());
+
+    Input in;
+    Vote decoded;
+    while (state.keepRunning())
+    {
+        in.load(out.data());
+        if (!in.getT<serializer::ANY_B64>(decoded))
+        {
+            state.error("cannot decode payload");
+            return;
+        }
+        doNotOptimize(decoded);
+    }
+    state.counter("bytes", out.data().size());
+}
+
+}
+
+GRAFT_BENCHMARK(Rta_decodeAuthVoteJson)
+{
+    decodeAuthVote<serializer::JSON_B64>(state);
+}
+
+GRAFT_BENCHMARK(Rta_decodeAuthVoteBinary)
+{
+    decodeAuthVote<serializer::BIN_B64>(state);
+}
+
+GRAFT_BENCHMARK(Rta_buildAuthSample)
+{
+    const uint64_t block_number = 100;
+    std::unique_ptr<FullSupernodeList> fsl = makeSupernodeList(64, block_number);
+
+    FullSupernodeList::supernode_array sample;
+    uint64_t auth_block_number = 0;
+    uint64_t i = 0;
+    while (state.keepRunning())
+    {
+        // different payment ids select different samples
+        if (!fsl->buildAuthSample(block_number, "aabbccddeeff" + std::to_string(i++ & 1023), sample, auth_block_number))
+        {
+            state.error("buildAuthSample failed");
+            return;
+        }
+        doNotOptimize(sample);
+    }
+}
+
+//buildAuthSample from all cores while a writer republishes stakes and blockchain based list every 10 ms
+GRAFT_BENCHMARK(Rta_buildAuthSampleContended)
+{
+    constexpr size_t SUPERNODES_PER_TIER = 64;
+    const uint64_t block_number = 100;
+
+    FullSupernodeList fsl(DAEMON_ADDRESS, TESTNET);
+    FullSupernodeList::supernode_stake_array stakes = generateStakes(SUPERNODES_PER_TIER);
+    FullSupernodeList::blockchain_based_list_ptr bbl = makeBlockchainBasedList(stakes, SUPERNODES_PER_TIER);
+    fsl.updateStakes(block_number, stakes, DAEMON_ADDRESS, TESTNET);
+    fsl.setBlockchainBasedList(block_number, bbl);
+
+    const size_t threads = threadsCount();
+    const uint64_t perThread = std::max<uint64_t>(1, state.iterations() / threads);
+    std::atomic_bool stop{false};
+    std::atomic<uint64_t> failures{0}, max_latency_us{0};
+
+    std::thread writer([&]()
+    {
+        uint64_t next_block_number = block_number;
+        while (!stop)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            ++next_block_number;
+            fsl.updateStakes(next_block_number, stakes, DAEMON_ADDRESS, TESTNET);
+            fsl.setBlockchainBasedList(next_block_number, bbl);
+        }
+    });
+
+    auto start = bench::State::Clock::now();
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < threads; ++t)
+    {
+        readers.emplace_back([&]()
+        {
+            FullSupernodeList::supernode_array sample;
+            uint64_t auth_block_number = 0;
+            for (uint64_t i = 0; i < perThread; ++i)
+            {
+                auto call_start = std::chrono::steady_clock::now();
+                if (!fsl.buildAuthSample(block_number, "aabbccddeeff", sample, auth_block_number))
+                    ++failures;
+                uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - call_start).count();
+
+                uint64_t prev = max_latency_us;
+                while (us > prev && !max_latency_us.compare_exchange_weak(prev, us));
+            }
+        });
+    }
+    for (auto& th : readers)
+        th.join();
+    state.setElapsed(bench::State::Clock::now() - start);
+    stop = true;
+    writer.join();
+
+    if (failures)
+    {
+        state.error("buildAuthSample failed");
+        return;
+    }
+    state.setItems(perThread * threads);
+    state.counter("max_latency_us", max_latency_us);
+}
+
+//announces of new supernodes are queued and applied in batches while buildAuthSample runs from all cores
+GRAFT_BENCHMARK_ONCE(Rta_announceStorm)
+{
+    constexpr size_t SUPERNODES_PER_TIER = 16;
+    const size_t announces_count = bench::option("rta-storm-announces", 2000);
+    const uint64_t block_number = 100;
+
+    FullSupernodeList fsl(DAEMON_ADDRESS, TESTNET);
+    FullSupernodeList::supernode_stake_array stakes = generateStakes(SUPERNODES_PER_TIER);
+    fsl.updateStakes(block_number, stakes, DAEMON_ADDRESS, TESTNET);
+    fsl.setBlockchainBasedList(block_number, makeBlockchainBasedList(stakes, SUPERNODES_PER_TIER));
+
+    std::vector<supernode::request::SupernodeAnnounce> announces;
+    for (size_t i = 0; i < announces_count; ++i)
+        announces.push_back(makeAnnounce(block_number));
+
+    const size_t threads = threadsCount();
+    std::atomic_bool stop{false};
+    std::atomic<uint64_t> samples{0}, failures{0}, max_latency_us{0};
+
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < threads; ++t)
+    {
+        readers.emplace_back([&]()
+        {
+            FullSupernodeList::supernode_array sample;
+            uint64_t auth_block_number = 0;
+            while (!stop)
+            {
+                auto call_start = std::chrono::steady_clock::now();
+                if (!fsl.buildAuthSample(block_number, "aabbccddeeff", sample, auth_block_number))
+                    ++failures;
+                uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - call_start).count();
+                ++samples;
+
+                uint64_t prev = max_latency_us;
+                while (us > prev && !max_latency_us.compare_exchange_weak(prev, us));
+            }
+        });
+    }
+
+    auto start = bench::State::Clock::now();
+    size_t applied = 0;
+    for (const auto& announce : announces)
+    {
+        if (fsl.queueAnnounce(announce) >= FullSupernodeList::ANNOUNCE_BATCH_SIZE)
+            applied += fsl.applyQueuedAnnounces();
+    }
+    applied += fsl.applyQueuedAnnounces();
+    state.setElapsed(bench::State::Clock::now() - start);
+
+    stop = true;
+    for (auto& th : readers)
+        th.join();
+
+    if (failures || applied != announces_count)
+    {
+        state.error("announces are not applied or buildAuthSample failed");
+        return;
+    }
+    state.setItems(applied);
+    state.counter("auth_samples", samples);
+    state.counter("max_latency_us", max_latency_us);
+}
+
+GRAFT_BENCHMARK(Rta_signMessage)
+{
+    crypto::public_key pkey;
+    crypto::secret_key skey;
+    crypto::generate_keys(pkey, skey);
+    const std::string msg(128, 'm');
+
+    while (state.keepRunning())
+    {
+        crypto::hash hash;
+        crypto::cn_fast_hash(msg.data(), msg.size(), hash);
+        crypto::signature signature;
+        crypto::generate_signature(hash, pkey, skey, signature);
+        doNotOptimize(signature);
+    }
+}
+
+GRAFT_BENCHMARK(Rta_verifySignature)
+{
+    const std::vector<SignedMessage> messages = makeSignedMessages(256);
+
+    size_t i = 0;
+    while (state.keepRunning())
+    {
+        const SignedMessage& m = messages[i++ & 255];
+        bool ok = Supernode::verifySignature(m.msg, m.pkey, m.signature);
+        doNotOptimize(ok);
+    }
+}
+
+//signatures of an auth sample response batch verified by all verifier threads
+GRAFT_BENCHMARK(Rta_signatureVerifierBatch)
+{
+    const std::vector<SignedMessage> messages = makeSignedMessages(SignatureVerifier::MAX_BATCH_SIZE);
+    SignatureVerifier verifier;
+
+    SignatureVerifier::Batch batch;
+    for (const SignedMessage& m : messages)
+        batch.push_back(SignatureVerifier::makeItem(m.msg, m.pkey, m.signature));
+
+    while (state.keepRunning())
+    {
+        SignatureVerifier::Results results = verifier.verify(batch);
+        doNotOptimize(results);
+    }
+    state.setItems(state.iterations() * batch.size());
+}
+
+
+//concurrent callers submitting batches of 2 signatures, like multicast handlers do
+GRAFT_BENCHMARK(Rta_signatureVerifierAsync)
+{
+    constexpr size_t ITEMS_PER_REQUEST = 2;
+    const std::vector<SignedMessage> messages = makeSignedMessages(256);
+    SignatureVerifier verifier;
+
+    SignatureVerifier::Batch batch;
+    for (const SignedMessage& m : messages)
+        batch.push_back(SignatureVerifier::makeItem(m.msg, m.pkey, m.signature));
+
+    const uint64_t requests = state.iterations();
+    uint64_t done = 0, failed = 0;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    auto start = bench::State::Clock::now();
+    for (uint64_t i = 0; i < requests; ++i)
+    {
+        size_t first = (i * ITEMS_PER_REQUEST) % batch.size();
+        SignatureVerifier::Batch request(batch.begin() + first, batch.begin() + first + ITEMS_PER_REQUEST);
+        verifier.verifyAsync(std::move(request), [&](const SignatureVerifier::Results& results)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (bool r : results)
+                if (!r) ++failed;
+            ++done;
+            cv.notify_one();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return done == requests; });
+    }
+    state.setElapsed(bench::State::Clock::now() - start);
+
+    if (failed)
+    {
+        state.error("signature verification failed");
+        return;
+    }
+    state.setItems(requests * ITEMS_PER_REQUEST);
+}
+
+//announces of 500 supernodes for 20 heights, every announce is relayed 10 times, checked from all cores
+GRAFT_BENCHMARK(Rta_announceFilterFlood)
+{
+    constexpr size_t SENDERS = 500;
+    constexpr size_t HEIGHTS = 20;
+    constexpr size_t COPIES = 10;
+
+    std::vector<supernode::request::SupernodeAnnounce> announces;
+    for (size_t sender = 0; sender < SENDERS; ++sender)
+    {
+        for (size_t height = 0; height < HEIGHTS; ++height)
+        {
+            supernode::request::SupernodeAnnounce announce;
+            announce.supernode_public_id = "supernode" + std::to_string(sender);
+            announce.height = height;
+            announce.signature = std::string(128, 'a' + height % 26) + std::to_string(sender);
+            announces.push_back(announce);
+        }
+    }
+
+    const size_t threads = threadsCount();
+    const uint64_t total = std::max<uint64_t>(state.iterations(), announces.size() * COPIES);
+    const uint64_t perThread = total / threads;
+
+    AnnounceFilter filter(std::chrono::milliseconds(0), 1, std::chrono::seconds(3600), SENDERS * HEIGHTS + 1);
+    std::atomic<uint64_t> next{0};
+
+    auto start = bench::State::Clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&]()
+        {
+            for (uint64_t i = 0; i < perThread; ++i)
+            {
+                const supernode::request::SupernodeAnnounce& announce = announces[next++ % announces.size()];
+                if (filter.check(announce.supernode_public_id, announce.height, announce.signature) == AnnounceFilter::Result::Accepted)
+                    filter.charge(announce.supernode_public_id);
+            }
+        });
+    }
+    for (auto& th : workers)
+        th.join();
+    state.setElapsed(bench::State::Clock::now() - start);
+
+    state.setItems(perThread * threads);
+    state.counter("duplicates", filter.duplicateCount());
+}
@@ -0,0 +1,381 @@
+#include "benchmark.h"
+#include "fake_cryptonode.h"
+#include "server_runner.h"
+
+#include "lib/graft/inout.h"
+#include "lib/graft/jsonrpc.h"
+#include "lib/graft/mongoosex.h"
+#include "lib/graft/sys_info.h"
+#include "rta/announcefilter.h"
+#include "rta/fullsupernodelist.h"
+#include "rta/signatureverifier.h"
+#include "rta/supernode.h"
+#include "supernode/requestdefines.h"
+#include "supernode/requests.h"
+#include "supernode/requests/sale.h"
+#include "supernode/requests/sale_details.h"
+
+#include <boost/make_shared.hpp>
+
+#include <ctime>
+#include <memory>
+#include <random>
+
+using namespace graft;
+using bench::FakeCryptonode;
+using bench::ServerRunner;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+using LatencyHistogram = request::system_info::LatencyHistogram;
+
+const bool TESTNET = true;
+const uint64_t BLOCK_HEIGHT = 100;
+
+GRAFT_DEFINE_JSON_RPC_REQUEST(SaleDetailsRequestJsonRpc, supernode::request::SaleDetailsRequest);
+GRAFT_DEFINE_JSON_RPC_RESPONSE_RESULT(SaleDetailsResponseJsonRpc, supernode::request::SaleDetailsResponse);
+
+ConfigOpts makeSupernodeOpts(int index, const std::string& cryptonodeAddress)
+{
+    const int port = bench::option("rta-base-port", 9300) + 2 * index;
+
+    ConfigOpts copts;
+    copts.http_address = "127.0.0.1:" + std::to_string(port);
+    copts.coap_address = "udp://127.0.0.1:" + std::to_string(port + 1);
+    copts.http_connection_timeout = 10;
+    copts.upstream_request_timeout = 10;
+    copts.workers_count = bench::option("rta-workers", 2);
+    copts.worker_queue_len = 0;
+    copts.workers_expelling_interval_ms = 1000;
+    copts.cryptonode_rpc_address = cryptonodeAddress;
+    copts.timer_poll_interval_ms = 50;
+    copts.log_trunc_to_size = -1;
+    copts.lru_timeout_ms = 60000;
+    return copts;
+}
+
+//Supernode with RTA routes and the global context prepared like graft::snd::Supernode::prepareSupernode does,
+//but with generated keys, no stake wallets and no periodic announces and synchronization.
+class HostedSupernode
+{
+public:
+    HostedSupernode(int index, const std::string& cryptonodeAddress)
+        : m_router("/dapi/v2.0")
+    {
+        const ConfigOpts copts = makeSupernodeOpts(index, cryptonodeAddress);
+
+        m_supernode = boost::make_shared<Supernode>("bench-wallet-" + std::to_string(index), crypto::public_key(),
+                                                    cryptonodeAddress, TESTNET);
+        m_supernode->initKeys();
+        m_supernode->setNetworkAddress("http://" + copts.http_address + "/dapi/v2.0");
+        //the supernode does not announce itself, it is kept fresh for auth sample selection this way
+        m_supernode->setLastUpdateTime(static_cast<int64_t>(std::time(nullptr)));
+
+        FullSupernodeListPtr fsl = boost::make_shared<FullSupernodeList>(cryptonodeAddress, TESTNET);
+        fsl->add(boost::make_shared<Supernode>(*m_supernode));
+        m_fsl = fsl;
+
+        supernode::request::registerRTARequests(m_router);
+
+        SupernodePtr supernode = m_supernode;
+        m_server = std::make_unique<ServerRunner>(m_router, copts, [supernode, fsl, cryptonodeAddress](Context& ctx)
+        {
+            ctx.global[CONTEXT_KEY_SUPERNODE] = supernode;
+            ctx.global[CONTEXT_KEY_FULLSUPERNODELIST] = fsl;
+            ctx.global[CONTEXT_KEY_SIGNATURE_VERIFIER] = boost::make_shared<SignatureVerifier>(1);
+            ctx.global[CONTEXT_KEY_ANNOUNCE_FILTER] = boost::make_shared<AnnounceFilter>(
+                        std::chrono::milliseconds(5000), 3, std::chrono::seconds(FullSupernodeList::ANNOUNCE_TTL_SECONDS), 1000);
+            ctx.global[CONTEXT_KEY_BINARY_PAYLOADS] = bench::option("rta-binary-payloads", 0) != 0;
+            ctx.global["testnet"] = TESTNET;
+            ctx.global["watchonly_wallets_path"] = std::string();
+            ctx.global["cryptonode_rpc_address"] = cryptonodeAddress;
+        });
+    }
+
+    FakeCryptonode::SupernodeInfo info(uint32_t tier) const
+    {
+        FakeCryptonode::SupernodeInfo info;
+        info.id = m_supernode->idKeyAsString();
+        info.wallet_address = m_supernode->walletAddress();
+        info.network_address = m_supernode->networkAddress();
+        info.tier = tier;
+        return info;
+    }
+
+    std::string networkAddress() const { return m_supernode->networkAddress(); }
+    uint64_t listBlockNumber() const { return m_fsl->getBlockchainBasedListMaxBlockNumber(); }
+
+private:
+    Router m_router;
+    SupernodePtr m_supernode;
+    FullSupernodeListPtr m_fsl;
+    std::unique_ptr<ServerRunner> m_server;
+};
+
+//Keeps the given number of payments in flight. A payment is a sale sent to a random point of sale supernode
+//followed by the sale details requested by the wallet from another random supernode; a new payment is started
+//as soon as the previous one is done.
+class PaymentGenerator
+{
+public:
+    PaymentGenerator(std::vector<std::string> networkAddresses, int concurrency)
+        : m_networkAddresses(std::move(networkAddresses))
+        , m_concurrency(concurrency)
+    {
+        mg_mgr_init(&m_mgr, this, nullptr);
+    }
+
+    ~PaymentGenerator()
+    {
+        mg_mgr_free(&m_mgr);
+    }
+
+    void run(std::chrono::milliseconds duration)
+    {
+        m_sending = true;
+        for(int i = 0; i < m_concurrency; ++i) startPayment();
+
+        const Clock::time_point end = Clock::now() + duration;
+        while(Clock::now() < end)
+        {
+            mg_mgr_poll(&m_mgr, 1);
+        }
+
+        //payments in flight are not counted
+        m_sending = false;
+        const Clock::time_point drainEnd = Clock::now() + std::chrono::seconds(15);
+        while(m_inFlight && Clock::now() < drainEnd)
+        {
+            mg_mgr_poll(&m_mgr, 1);
+        }
+    }
+
+    uint64_t completed() const { return m_completed; }
+    uint64_t failed() const { return m_failedSale + m_failedSaleDetails; }
+    uint64_t failedSale() const { return m_failedSale; }
+    uint64_t failedSaleDetails() const { return m_failedSaleDetails; }
+    const LatencyHistogram& paymentLatency() const { return m_paymentLatency; }
+    const LatencyHistogram& saleLatency() const { return m_saleLatency; }
+    const LatencyHistogram& saleDetailsLatency() const { return m_saleDetailsLatency; }
+
+private:
+    enum class Stage { Sale, SaleDetails };
+
+    struct Payment
+    {
+        PaymentGenerator* generator;
+        size_t pos;
+        size_t wallet;
+        Stage stage = Stage::Sale;
+        std::string payment_id;
+        uint64_t block_number = 0;
+        Clock::time_point start;
+        Clock::time_point stageStart;
+        bool ok = false;
+    };
+
+    void startPayment()
+    {
+        const size_t count = m_networkAddresses.size();
+        Payment* payment = new Payment{this};
+        payment->pos = m_rng() % count;
+        payment->wallet = (payment->pos + 1 + m_rng() % (count - 1)) % count;
+        payment->start = Clock::now();
+        ++m_inFlight;
+
+        supernode::request::SaleRequestJsonRpc request;
+        request.method = "sale";
+        request.params.Amount = 10000000000;
+        request.params.SaleDetails = "bench sale";
+        send(payment, m_networkAddresses[payment->pos] + "/sale", request);
+    }
+
+    void requestSaleDetails(Payment* payment)
+    {
+        payment->stage = Stage::SaleDetails;
+
+        SaleDetailsRequestJsonRpc request;
+        request.method = "sale_details";
+        request.params.PaymentID = payment->payment_id;
+        request.params.BlockNumber = payment->block_number;
+        send(payment, m_networkAddresses[payment->wallet] + "/sale_details", request);
+    }
+
+    template<typename T>
+    void send(Payment* payment, const std::string& url, const T& request)
+    {
+        Output output;
+        output.load(request);
+
+        payment->ok = false;
+        payment->stageStart = Clock::now();
+        mg_connection* nc = mg_connect_http(&m_mgr, evHandler, url.c_str(), "Content-Type: application/json\r\n", output.body.c_str());
+        if(!nc)
+        {
+            finish(payment);
+            return;
+        }
+        nc->user_data = payment;
+    }
+
+    bool onReply(Payment* payment, const http_message& hm)
+    {
+        if(hm.resp_code != 200) return false;
+
+        Input input;
+        input.load(hm.body.p, hm.body.len);
+        const uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - payment->stageStart).count();
+
+        if(payment->stage == Stage::Sale)
+        {
+            supernode::request::SaleResponseJsonRpc response;
+            if(!input.get(response) || response.result.PaymentID.empty()) return false;
+            payment->payment_id = response.result.PaymentID;
+            payment->block_number = response.result.BlockNumber;
+            if(m_sending) m_saleLatency.record(us);
+        }
+        else
+        {
+            SaleDetailsResponseJsonRpc response;
+            if(!input.get(response) || response.result.AuthSample.size() != FullSupernodeList::AUTH_SAMPLE_SIZE) return false;
+            if(m_sending) m_saleDetailsLatency.record(us);
+        }
+        return true;
+    }
+
+    void finish(Payment* payment)
+    {
+        if(m_sending)
+        {
+            if(payment->ok && payment->stage == Stage::SaleDetails)
+            {
+                ++m_completed;
+                m_paymentLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - payment->start).count());
+            }
+            else
+            {
+                ++(payment->stage == Stage::Sale ? m_failedSale : m_failedSaleDetails);
+            }
+        }
+        delete payment;
+        --m_inFlight;
+        if(m_sending) startPayment();
+    }
+
+    static void evHandler(mg_connection* nc, int ev, void* ev_data)
+    {
+        Payment* payment = static_cast<Payment*>(nc->user_data);
+        if(!payment) return;
+        PaymentGenerator* self = payment->generator;
+
+        switch(ev)
+        {
+        case MG_EV_HTTP_REPLY:
+            payment->ok = self->onReply(payment, *static_cast<http_message*>(ev_data));
+            nc->flags |= MG_F_CLOSE_IMMEDIATELY;
+            break;
+        case MG_EV_CLOSE:
+            nc->user_data = nullptr;
+            if(payment->ok && payment->stage == Stage::Sale)
+                self->requestSaleDetails(payment);
+            else
+                self->finish(payment);
+            break;
+        default:
+            break;
+        }
+    }
+
+    const std::vector<std::string> m_networkAddresses;
+    const int m_concurrency;
+
+    mg_mgr m_mgr;
+    std::mt19937 m_rng{std::random_device{}()};
+    bool m_sending = false;
+    int m_inFlight = 0;
+    uint64_t m_completed = 0;
+    uint64_t m_failedSale = 0;
+    uint64_t m_failedSaleDetails = 0;
+    LatencyHistogram m_paymentLatency;
+    LatencyHistogram m_saleLatency;
+    LatencyHistogram m_saleDetailsLatency;
+};
+
+void reportLatency(bench::State& state, const std::string& name, const LatencyHistogram& latency)
+{
+    state.counter(name + "_p50_us", latency.percentile(0.5));
+    state.counter(name + "_p99_us", latency.percentile(0.99));
+}
+
+}
+
+//Payments through N supernodes and the fake cryptonode on loopback. The flow stops at the sale details:
+// /pay is disabled in this tree and Supernode::getAmountFromTx is a stub, so no transaction can be authorized.
+//Stages: sale (multicast to the auth sample and sale status broadcast), sale_details (unicast to an auth sample
+//member and the callback), relay latencies of the fake cryptonode and delivery latencies to the supernodes.
+GRAFT_BENCHMARK_ONCE(Rta_paymentFlow)
+{
+    const int count = bench::option("rta-supernodes", 16);
+    if(count < FullSupernodeList::AUTH_SAMPLE_SIZE)
+    {
+        state.error("at least " + std::to_string(FullSupernodeList::AUTH_SAMPLE_SIZE) + " supernodes are required");
+        return;
+    }
+
+    FakeCryptonode cryptonode(bench::option("rta-cryptonode-address", std::string("127.0.0.1:9290")), BLOCK_HEIGHT);
+
+    std::vector<std::unique_ptr<HostedSupernode>> supernodes;
+    std::vector<std::string> networkAddresses;
+    for(int i = 0; i < count; ++i)
+    {
+        supernodes.push_back(std::make_unique<HostedSupernode>(i, cryptonode.address()));
+        cryptonode.addSupernode(supernodes.back()->info(i % FullSupernodeList::TIERS + 1));
+        networkAddresses.push_back(supernodes.back()->networkAddress());
+    }
+
+    cryptonode.publishSupernodeList();
+    if(!cryptonode.waitIdle(std::chrono::seconds(10)) || cryptonode.failedDeliveries())
+    {
+        state.error("supernode list is not delivered");
+        return;
+    }
+    for(auto& supernode : supernodes)
+    {
+        if(supernode->listBlockNumber() != BLOCK_HEIGHT)
+        {
+            state.error("supernode list is not applied");
+            return;
+        }
+    }
+
+    const std::chrono::milliseconds duration(bench::option("rta-duration-ms", 5000));
+    PaymentGenerator generator(networkAddresses, bench::option("rta-payments", 16));
+    generator.run(duration);
+    cryptonode.waitIdle(std::chrono::seconds(5));
+
+    if(!generator.completed())
+    {
+        state.error("no payments completed, failed sales: " + std::to_string(generator.failedSale())
+                    + ", failed sale details: " + std::to_string(generator.failedSaleDetails()));
+        return;
+    }
+
+    state.setElapsed(duration);
+    state.setItems(generator.completed());
+
+    reportLatency(state, "payment", generator.paymentLatency());
+    reportLatency(state, "sale", generator.saleLatency());
+    reportLatency(state, "sale_details", generator.saleDetailsLatency());
+    cryptonode.rpcLatency().for_each([&state](const std::string& name, const LatencyHistogram& latency)
+    {
+        if(latency.count()) reportLatency(state, "relay_" + name, latency);
+    });
+    cryptonode.deliveryLatency().for_each([&state](const std::string& name, const LatencyHistogram& latency)
+    {
+        if(latency.count()) reportLatency(state, "deliver" + name, latency);
+    });
+    state.counter("failed", generator.failed());
+    state.counter("failed_deliveries", cryptonode.failedDeliveries());
+}
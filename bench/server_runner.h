@@ -0,0 +1,89 @@
+#pragma once
+
+#include "lib/graft/context.h"
+#include "lib/graft/router.h"
+#include "lib/graft/serveropts.h"
+#include "supernode/server.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace graft::bench
+{
+
+//GraftServer with the routes and the global context given by a benchmark, config.ini is not read
+class BenchServer : public GraftServer
+{
+public:
+    using InitContext = std::function<void (Context& ctx)>;
+
+    BenchServer(Router& httpRouter, InitContext initContext)
+        : m_httpRouter(httpRouter)
+        , m_initContext(std::move(initContext))
+    { }
+
+    bool ready() const { return GraftServer::ready(); }
+    void stop() { GraftServer::stop(); }
+
+protected:
+    bool initConfigOption(int argc, const char** argv, ConfigOpts& configOpts) override
+    {
+        return true;
+    }
+    void initMisc(ConfigOpts& configOpts) override
+    {
+        if(!m_initContext) return;
+        Context ctx(getLooper().getGcm());
+        m_initContext(ctx);
+    }
+    void initRouters() override
+    {
+        getConMgr("HTTP")->addRouter(m_httpRouter);
+    }
+
+private:
+    Router& m_httpRouter;
+    InitContext m_initContext;
+};
+
+//GraftServer running in its own thread, the constructor returns when the server is ready.
+//The servers should be created one by one because GraftServer::run installs process wide signal handlers.
+class ServerRunner
+{
+public:
+    ServerRunner(Router& router, ConfigOpts copts, BenchServer::InitContext initContext = nullptr)
+        : m_copts(std::move(copts))
+        , m_server(std::make_unique<BenchServer>(router, std::move(initContext)))
+    {
+        m_thread = std::thread([this]
+        {
+            static const char* argv[] = { "graft_bench" };
+            m_server->init(1, argv, m_copts);
+            m_initialized = true;
+            m_server->run();
+        });
+        while(!m_initialized || !m_server->ready())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    ~ServerRunner()
+    {
+        m_server->stop();
+        m_thread.join();
+    }
+
+    const ConfigOpts& copts() const { return m_copts; }
+
+private:
+    ConfigOpts m_copts;
+    std::unique_ptr<BenchServer> m_server;
+    std::atomic_bool m_initialized{false};
+    std::thread m_thread;
+};
+
+}//namespace graft::bench
@@ -0,0 +1,338 @@
+#include "benchmark.h"
+#include "server_runner.h"
+
+#include "lib/graft/connection.h"
+#include "lib/graft/sys_info.h"
+#include "walletnode/batch_key_images.h"
+#include "walletnode/block_fetcher.h"
+#include "walletnode/requests.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace graft;
+using bench::ServerRunner;
+using walletnode::BatchKeyImages;
+using walletnode::SharedBlockFetcher;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+using LatencyHistogram = request::system_info::LatencyHistogram;
+
+//Serves /getblocks.bin like the cryptonode, the response of the given size is sent after the given delay
+//which stands for reading and serializing the blocks.
+class FakeBlockSource
+{
+public:
+    FakeBlockSource(const std::string& address, size_t responseSize, std::chrono::milliseconds delay)
+        : m_response(responseSize, 'b')
+        , m_delay(delay)
+    {
+        mg_mgr_init(&m_mgr, this, nullptr);
+        mg_connection* nc = mg_bind(&m_mgr, address.c_str(), evHandler);
+        if(!nc) throw std::runtime_error("cannot bind fake cryptonode to " + address);
+        mg_set_protocol_http_websocket(nc);
+        m_thread = std::thread([this]
+        {
+            while(!m_stop) mg_mgr_poll(&m_mgr, 1);
+        });
+    }
+
+    ~FakeBlockSource()
+    {
+        m_stop = true;
+        m_thread.join();
+        mg_mgr_free(&m_mgr);
+    }
+
+    uint64_t requests() const { return m_requests; }
+
+private:
+    static void evHandler(mg_connection* nc, int ev, void* ev_data)
+    {
+        FakeBlockSource* self = static_cast<FakeBlockSource*>(nc->mgr->user_data);
+
+        switch(ev)
+        {
+        case MG_EV_HTTP_REQUEST:
+        {
+            ++self->m_requests;
+            nc->flags |= MG_F_USER_1;
+            mg_set_timer(nc, mg_time() + std::chrono::duration<double>(self->m_delay).count());
+        } break;
+        case MG_EV_TIMER:
+        {
+            mg_set_timer(nc, 0);
+            if(!(nc->flags & MG_F_USER_1)) break;
+            nc->flags &= ~MG_F_USER_1;
+            mg_send_head(nc, 200, self->m_response.size(), "Content-Type: application/octet-stream");
+            mg_send(nc, self->m_response.data(), self->m_response.size());
+            nc->flags |= MG_F_SEND_AND_CLOSE;
+        } break;
+        default:
+            break;
+        }
+    }
+
+    const std::string m_response;
+    const std::chrono::milliseconds m_delay;
+
+    mg_mgr m_mgr;
+    std::atomic<uint64_t> m_requests{0};
+    std::atomic_bool m_stop{false};
+    std::thread m_thread;
+};
+
+//Wallets synchronizing through the walletnode. Wallets of a group are at the same height, so they send identical
+//getblocks.bin requests; every wallet sends its next request as soon as the response of the previous one arrives.
+class WalletSync
+{
+public:
+    WalletSync(const std::string& url, int wallets, int groups)
+        : m_url(url)
+    {
+        mg_mgr_init(&m_mgr, this, nullptr);
+        for(int i = 0; i < wallets; ++i)
+        {
+            m_wallets.push_back(Wallet{this, i % groups});
+        }
+    }
+
+    ~WalletSync()
+    {
+        mg_mgr_free(&m_mgr);
+    }
+
+    void run(std::chrono::milliseconds duration)
+    {
+        m_sending = true;
+        for(Wallet& wallet : m_wallets) sendRequest(wallet);
+
+        const Clock::time_point end = Clock::now() + duration;
+        while(Clock::now() < end)
+        {
+            mg_mgr_poll(&m_mgr, 1);
+        }
+
+        //responses to the requests in flight are not counted
+        m_sending = false;
+        const Clock::time_point drainEnd = Clock::now() + std::chrono::seconds(5);
+        while(m_inFlight && Clock::now() < drainEnd)
+        {
+            mg_mgr_poll(&m_mgr, 1);
+        }
+    }
+
+    uint64_t completed() const { return m_completed; }
+    uint64_t failed() const { return m_failed; }
+    const LatencyHistogram& latency() const { return m_latency; }
+
+private:
+    struct Wallet
+    {
+        WalletSync* sync;
+        int group;
+        uint64_t height = 0;
+        Clock::time_point start;
+        bool replied = false;
+    };
+
+    void sendRequest(Wallet& wallet)
+    {
+        //wallets of the group start from the same height and keep close to each other
+        const std::string body = "group " + std::to_string(wallet.group) + " start_height " + std::to_string(wallet.height);
+        mg_connection* nc = mg_connect_http(&m_mgr, evHandler, m_url.c_str(), "Content-Type: application/octet-stream\r\n", body.c_str());
+        if(!nc)
+        {
+            ++m_failed;
+            return;
+        }
+        wallet.start = Clock::now();
+        wallet.replied = false;
+        nc->user_data = &wallet;
+        ++m_inFlight;
+    }
+
+    static void evHandler(mg_connection* nc, int ev, void* ev_data)
+    {
+        Wallet* wallet = static_cast<Wallet*>(nc->user_data);
+        if(!wallet) return;
+        WalletSync* self = wallet->sync;
+
+        switch(ev)
+        {
+        case MG_EV_HTTP_REPLY:
+        {
+            http_message* hm = static_cast<http_message*>(ev_data);
+            if(self->m_sending)
+            {
+                if(hm->resp_code == 200)
+                {
+                    ++self->m_completed;
+                    ++wallet->height;
+                    self->m_latency.record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - wallet->start).count());
+                }
+                else
+                {
+                    ++self->m_failed;
+                }
+            }
+            wallet->replied = true;
+            nc->flags |= MG_F_CLOSE_IMMEDIATELY;
+        } break;
+        case MG_EV_CLOSE:
+        {
+            if(!wallet->replied && self->m_sending) ++self->m_failed;
+            nc->user_data = nullptr;
+            --self->m_inFlight;
+            if(self->m_sending) self->sendRequest(*wallet);
+        } break;
+        default:
+            break;
+        }
+    }
+
+    const std::string m_url;
+
+    mg_mgr m_mgr;
+    std::vector<Wallet> m_wallets;
+    bool m_sending = false;
+    int m_inFlight = 0;
+    uint64_t m_completed = 0;
+    uint64_t m_failed = 0;
+    LatencyHistogram m_latency;
+};
+
+ConfigOpts makeConfigOpts(const std::string& cryptonodeAddress)
+{
+    ConfigOpts copts;
+    copts.http_address = bench::option("walletnode-address", std::string("127.0.0.1:9290"));
+    copts.coap_address = "udp://127.0.0.1:9291";
+    copts.http_connection_timeout = 10;
+    copts.upstream_request_timeout = 10;
+    copts.workers_count = 1;
+    copts.worker_queue_len = 0;
+    copts.workers_expelling_interval_ms = 1000;
+    copts.cryptonode_rpc_address = cryptonodeAddress;
+    copts.timer_poll_interval_ms = 50;
+    copts.lru_timeout_ms = 60000;
+    return copts;
+}
+
+//every request of the wallets goes to the cryptonode, as wallets do without the walletnode proxy
+Status forwardBlocks(const Router::vars_t& vars, const Input& input, Context& ctx, Output& output)
+{
+    output.body = input.body;
+    if(ctx.local.getLastStatus() == Status::Forward) return Status::Ok;
+    output.path = "/getblocks.bin";
+    return Status::Forward;
+}
+
+//pending transaction of the wallet as BatchKeyImages sees it
+struct PendingTx
+{
+    cryptonote::transaction tx;
+};
+
+//transfers of a batch, every transfer is one transaction spending the given number of outputs
+std::vector<std::vector<PendingTx>> makeBatch(size_t transfers, size_t inputs)
+{
+    std::mt19937_64 random(transfers);
+    std::vector<std::vector<PendingTx>> batch(transfers, std::vector<PendingTx>(1));
+    for(std::vector<PendingTx>& transfer : batch)
+    {
+        for(size_t i = 0; i < inputs; ++i)
+        {
+            cryptonote::txin_to_key in;
+            for(size_t offset = 0; offset < sizeof(in.k_image); offset += sizeof(uint64_t))
+            {
+                uint64_t value = random();
+                std::memcpy(reinterpret_cast<char*>(&in.k_image) + offset, &value, sizeof(value));
+            }
+            transfer[0].tx.vin.push_back(in);
+        }
+    }
+    return batch;
+}
+
+void runSync(bench::State& state, bool shared)
+{
+    const std::string cryptonodeAddress = bench::option("walletnode-cryptonode-address", std::string("127.0.0.1:9292"));
+    FakeBlockSource cryptonode(cryptonodeAddress, bench::option("walletnode-blocks-size", 256 * 1024),
+                               std::chrono::milliseconds(bench::option("walletnode-blocks-delay-ms", 20)));
+
+    SharedBlockFetcher fetcher(std::chrono::milliseconds(bench::option("walletnode-blocks-ttl-ms", 500)),
+                               std::chrono::seconds(60), 1024);
+
+    Router router;
+    if(shared)
+        walletnode::request::registerDaemonRequests(router, fetcher);
+    else
+        router.addRoute("/getblocks.bin", METHOD_POST|METHOD_GET, Router::Handler3(forwardBlocks, nullptr, nullptr));
+
+    ConfigOpts copts = makeConfigOpts(cryptonodeAddress);
+    ServerRunner server(router, copts);
+
+    const std::chrono::milliseconds duration(bench::option("walletnode-duration-ms", 3000));
+
+    WalletSync wallets("http://" + copts.http_address + "/getblocks.bin",
+                       bench::option("walletnode-wallets", 128), bench::option("walletnode-wallet-groups", 4));
+    wallets.run(duration);
+
+    if(!wallets.completed())
+    {
+        state.error("no responses from the walletnode");
+        return;
+    }
+
+    state.setElapsed(duration);
+    state.setItems(wallets.completed());
+
+    const LatencyHistogram& latency = wallets.latency();
+    state.counter("p50_us", latency.percentile(0.5));
+    state.counter("p99_us", latency.percentile(0.99));
+    state.counter("max_us", latency.max());
+    state.counter("cryptonode_requests", cryptonode.requests());
+    state.counter("failed", wallets.failed());
+}
+
+}
+
+//128 wallets in 4 groups download blocks through the shared fetcher, a group downloads each range once
+GRAFT_BENCHMARK_ONCE(Walletnode_getBlocksShared)
+{
+    runSync(state, true);
+}
+
+//the same wallets with every request forwarded to the cryptonode
+GRAFT_BENCHMARK_ONCE(Walletnode_getBlocksDirect)
+{
+    runSync(state, false);
+}
+
+//bookkeeping of outputs spent by transfers of the largest batch, the transactions themselves are not created
+//because it needs a wallet with outputs and a cryptonode
+GRAFT_BENCHMARK(Walletnode_batchKeyImages)
+{
+    const size_t TRANSFERS = 256, INPUTS = 4;
+    const std::vector<std::vector<PendingTx>> batch = makeBatch(TRANSFERS, INPUTS);
+
+    while(state.keepRunning())
+    {
+        BatchKeyImages key_images;
+        bool reserved = true;
+        for(const std::vector<PendingTx>& transfer : batch)
+        {
+            reserved &= key_images.reserve(transfer);
+        }
+        bench::doNotOptimize(reserved);
+    }
+    state.setItems(state.iterations() * TRANSFERS);
+}
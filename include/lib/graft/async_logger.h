@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace graft {
+
+/*!
+ * \brief AsyncLogger - log backend which moves writing of log lines out of the threads which log them.
+ * Each logging thread puts its lines into its own single producer single consumer ring without locks,
+ * the background thread drains the rings and writes the lines to the file and/or the console.
+ * Logging never blocks, a line which does not fit into the full ring is dropped and counted.
+ * The order of lines of a thread is kept, lines of different threads can be interleaved within a drain interval.
+ */
+class AsyncLogger
+{
+public:
+    /*!
+     * \param filename - file to write to, empty means no file
+     * \param console - write to stdout too
+     * \param ringSize - max number of lines waiting in the ring of a thread, rounded up to a power of two
+     * \param maxFileSize - the file is rolled over when it grows larger, 0 means no limit
+     */
+    AsyncLogger(const std::string& filename, bool console, size_t ringSize = 8192, size_t maxFileSize = 104850000);
+    ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator = (const AsyncLogger&) = delete;
+
+    //the line is written as is, it should end with a new line; returns false if the line has been dropped
+    bool write(std::string&& line);
+    //waits until the lines written by now are written out
+    void flush();
+
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    uint64_t written() const { return m_written.load(std::memory_order_relaxed); }
+
+    static constexpr std::chrono::milliseconds DRAIN_INTERVAL{10};
+
+    class Ring;
+    using RingPtr = std::shared_ptr<Ring>;
+
+private:
+    Ring& threadRing();
+    void run();
+    void output(const std::string& line);
+    void rollOver();
+
+    const uint64_t m_id;
+    const std::string m_filename;
+    const bool m_console;
+    const size_t m_ringSize;
+    const size_t m_maxFileSize;
+
+    std::ofstream m_file;
+    size_t m_fileSize = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::condition_variable m_flushedCv;
+    std::vector<RingPtr> m_rings;
+    uint64_t m_flushRequest = 0;
+    uint64_t m_flushDone = 0;
+    bool m_stop = false;
+
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_written{0};
+
+    std::thread m_thread;
+};
+
+/*!
+ * \brief installAsyncLogger - routes the output of easylogging (MDEBUG, LOG_PRINT_L2 and others) to the logger.
+ * The lines are still formatted by easylogging in the logging thread and only if the level of the category is enabled,
+ * but they are written out in the background thread. It should be called once after mlog_configure.
+ */
+void installAsyncLogger(std::shared_ptr<AsyncLogger> logger);
+
+}//namespace graft
+
@@ -0,0 +1,268 @@
+
+#pragma once
+
+#include <boost/hana.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace graft::serializer::binary {
+
+/*
+ *  Compact binary encoding of the structures defined with GRAFT_DEFINE_IO_STRUCT (and other Boost.Hana structs).
+ *  Schema is fixed by the structure definition: members are written in the order of declaration without names.
+ *  ========================================================================
+ *   C++ type                                 | encoding
+ *  ------------------------------------------+-----------------------------
+ *   bool                                     | 1 byte
+ *   unsigned integral types                  | varint (LEB128)
+ *   signed integral types, enums             | zigzag varint
+ *   float and double                         | 8 bytes, IEEE 754 little-endian
+ *   std::string                              | varint (size << 1 | hex flag), bytes
+ *   std::vector, std::list                   | varint count, elements
+ *   Boost.Hana structs                       | members one by one
+ *  ------------------------------------------+-----------------------------
+ *  Lower case hex strings (keys, signatures, transactions) are packed to bytes, that halves their size.
+ *  The encoded structure is preceded by FORMAT_VERSION byte, data of other versions is rejected.
+ */
+
+// bumped on any incompatible change of the encoding, so mixed-version nodes reject data they can't read
+static constexpr uint8_t FORMAT_VERSION = 1;
+
+class BinaryParseError : public std::runtime_error
+{
+public:
+    explicit BinaryParseError(const std::string &what)
+        : std::runtime_error(std::string("Binary parse error: ") + what)
+    {
+    }
+};
+
+namespace detail {
+
+template<typename T> struct IsSequence : std::false_type { };
+template<typename T, typename A> struct IsSequence<std::vector<T, A>> : std::true_type { };
+template<typename T, typename A> struct IsSequence<std::list<T, A>> : std::true_type { };
+
+inline int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+inline bool isPackableHex(const std::string &s)
+{
+    if (s.empty() || s.size() % 2 != 0)
+        return false;
+    for (char c : s) {
+        if (hexValue(c) < 0)
+            return false;
+    }
+    return true;
+}
+
+} // namespace detail
+
+class Writer
+{
+public:
+    explicit Writer(std::string &out) : m_out(out) { }
+
+    void varint(uint64_t v)
+    {
+        while (v >= 0x80) {
+            m_out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+            v >>= 7;
+        }
+        m_out.push_back(static_cast<char>(v));
+    }
+
+    void bytes(const char *data, size_t size) { m_out.append(data, size); }
+
+    void string(const std::string &s)
+    {
+        if (detail::isPackableHex(s)) {
+            varint((uint64_t(s.size() / 2) << 1) | 1);
+            for (size_t i = 0; i < s.size(); i += 2)
+                m_out.push_back(static_cast<char>(detail::hexValue(s[i]) << 4 | detail::hexValue(s[i + 1])));
+        } else {
+            varint(uint64_t(s.size()) << 1);
+            bytes(s.data(), s.size());
+        }
+    }
+
+private:
+    std::string &m_out;
+};
+
+class Reader
+{
+public:
+    Reader(const char *data, size_t size) : m_pos(data), m_end(data + size) { }
+
+    bool atEnd() const { return m_pos == m_end; }
+
+    uint64_t varint()
+    {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (m_pos == m_end)
+                throw BinaryParseError("unexpected end of data");
+            uint8_t b = static_cast<uint8_t>(*m_pos++);
+            v |= uint64_t(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                return v;
+        }
+        throw BinaryParseError("varint is too long");
+    }
+
+    const char *bytes(size_t size)
+    {
+        if (size_t(m_end - m_pos) < size)
+            throw BinaryParseError("unexpected end of data");
+        const char *p = m_pos;
+        m_pos += size;
+        return p;
+    }
+
+    void string(std::string &s)
+    {
+        uint64_t header = varint();
+        size_t size = header >> 1;
+        const char *p = bytes(size);
+        if (header & 1) {
+            static const char digits[] = "0123456789abcdef";
+            s.resize(size * 2);
+            for (size_t i = 0; i < size; ++i) {
+                uint8_t b = static_cast<uint8_t>(p[i]);
+                s[2 * i] = digits[b >> 4];
+                s[2 * i + 1] = digits[b & 0x0f];
+            }
+        } else {
+            s.assign(p, size);
+        }
+    }
+
+    // number of elements can't exceed number of remaining bytes, protects from huge allocations on broken input
+    size_t count()
+    {
+        uint64_t n = varint();
+        if (n > uint64_t(m_end - m_pos))
+            throw BinaryParseError("invalid element count");
+        return static_cast<size_t>(n);
+    }
+
+private:
+    const char *m_pos;
+    const char *m_end;
+};
+
+template<typename T>
+void write(Writer &w, const T &value)
+{
+    if constexpr (std::is_same<T, bool>::value) {
+        w.varint(value ? 1 : 0);
+    } else if constexpr (std::is_enum<T>::value) {
+        write(w, static_cast<typename std::underlying_type<T>::type>(value));
+    } else if constexpr (std::is_integral<T>::value && std::is_unsigned<T>::value) {
+        w.varint(value);
+    } else if constexpr (std::is_integral<T>::value) {
+        int64_t v = value;
+        w.varint((uint64_t(v) << 1) ^ uint64_t(v >> 63));
+    } else if constexpr (std::is_floating_point<T>::value) {
+        double d = value;
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        char buf[sizeof(bits)];
+        for (size_t i = 0; i < sizeof(bits); ++i)
+            buf[i] = static_cast<char>(bits >> (8 * i));
+        w.bytes(buf, sizeof(buf));
+    } else if constexpr (std::is_same<T, std::string>::value) {
+        w.string(value);
+    } else if constexpr (detail::IsSequence<T>::value) {
+        w.varint(value.size());
+        for (const auto &item : value)
+            write(w, item);
+    } else {
+        static_assert(boost::hana::Struct<T>::value, "type is not supported by binary serializer");
+        boost::hana::for_each(boost::hana::keys(value), [&w, &value](auto key) {
+            write(w, boost::hana::at_key(value, key));
+        });
+    }
+}
+
+template<typename T>
+void read(Reader &r, T &value)
+{
+    if constexpr (std::is_same<T, bool>::value) {
+        value = r.varint() != 0;
+    } else if constexpr (std::is_enum<T>::value) {
+        typename std::underlying_type<T>::type v;
+        read(r, v);
+        value = static_cast<T>(v);
+    } else if constexpr (std::is_integral<T>::value && std::is_unsigned<T>::value) {
+        value = static_cast<T>(r.varint());
+    } else if constexpr (std::is_integral<T>::value) {
+        uint64_t u = r.varint();
+        value = static_cast<T>(int64_t(u >> 1) ^ -int64_t(u & 1));
+    } else if constexpr (std::is_floating_point<T>::value) {
+        const char *buf = r.bytes(sizeof(uint64_t));
+        uint64_t bits = 0;
+        for (size_t i = 0; i < sizeof(bits); ++i)
+            bits |= uint64_t(static_cast<uint8_t>(buf[i])) << (8 * i);
+        double d;
+        std::memcpy(&d, &bits, sizeof(d));
+        value = static_cast<T>(d);
+    } else if constexpr (std::is_same<T, std::string>::value) {
+        r.string(value);
+    } else if constexpr (detail::IsSequence<T>::value) {
+        size_t n = r.count();
+        value.clear();
+        for (size_t i = 0; i < n; ++i) {
+            typename T::value_type item;
+            read(r, item);
+            value.push_back(std::move(item));
+        }
+    } else {
+        static_assert(boost::hana::Struct<T>::value, "type is not supported by binary serializer");
+        boost::hana::for_each(boost::hana::keys(value), [&r, &value](auto key) {
+            read(r, boost::hana::at_key(value, key));
+        });
+    }
+}
+
+/*!
+ * \brief toBinary - serializes structure to compact binary form
+ */
+template<typename T>
+std::string toBinary(const T &value)
+{
+    std::string out(1, static_cast<char>(FORMAT_VERSION));
+    Writer w(out);
+    write(w, value);
+    return out;
+}
+
+/*!
+ * \brief fromBinary - deserializes structure, throws BinaryParseError if data is broken, has trailing bytes
+ *                     or is of other format version
+ */
+template<typename T>
+void fromBinary(const std::string &data, T &value)
+{
+    Reader r(data.data(), data.size());
+    uint8_t version = static_cast<uint8_t>(*r.bytes(1));
+    if (version != FORMAT_VERSION)
+        throw BinaryParseError("unsupported format version " + std::to_string(version) + ", expected " + std::to_string(FORMAT_VERSION));
+    read(r, value);
+    if (!r.atEnd())
+        throw BinaryParseError("trailing data");
+}
+
+} // namespace graft::serializer::binary
@@ -1,30 +1,50 @@
 #pragma once
 
+#include "lib/graft/ip_address.h"
+
 #include <utility>
 #include <cstdint>
 #include <functional>
 #include <memory>
-
-typedef uint32_t in_addr_t;
+#include <string>
 
 namespace graft {
 
+//IPv4 and IPv6 rules share one table, an IPv4 rule is an IPv4-mapped IPv6 one (::ffff:a.b.c.d/96+len)
 class BlackList
 {
 public:
     using Allow = bool;
 
+    //a token bucket per IPv4 address or IPv6 /64 network, it holds requests_per_sec * window_size_sec connections and refills at requests_per_sec
     //requests_per_sec == 0, means disable ban
     //ban_ip_sec == 0, means ban forever
     static std::unique_ptr<BlackList> Create(int requests_per_sec, int window_size_sec, int ban_ip_sec);
 
     virtual ~BlackList() = default;
 
+    //the rules are loaded into a new table which replaces the current one at once, it is safe while processIp is called
+    //on error, the current rules are kept and the exception is thrown
     virtual void readRules(const char* filepath) = 0;
     virtual void readRules(std::istream& is) = 0;
+    //warnings and errors of the last readRules
     virtual std::string getWarnings() = 0;
+    //number of effective rules except allow|deny all
+    virtual size_t rulesCount() = 0;
+
+    virtual bool processIp(const IpAddress& addr) = 0;
+    bool processIp(in_addr_t addr, bool networkOrder = true) { return processIp(IpAddress::fromV4(addr, networkOrder)); }
+
+    //limits requests of an IP to the paths starting with prefix, the longest matching prefix is applied
+    //burst == 0, means one second worth of requests
+    virtual void addRouteLimit(const std::string& prefix, int requests_per_sec, int burst = 0) = 0;
+    //returns false if the request to the path exceeds its route limit
+    virtual bool processRequest(const IpAddress& addr, const std::string& path) = 0;
 
-    virtual bool processIp(in_addr_t addr, bool networkOrder = true) = 0;
+    //replace the limits, the counters and bans of the replaced ones are dropped
+    //the same thread as processIp and processRequest should call them
+    virtual void setLimits(int requests_per_sec, int window_size_sec, int ban_ip_sec) = 0;
+    virtual void removeRouteLimits() = 0;
 protected:
     BlackList(const BlackList&) = delete;
     BlackList& operator = (const BlackList&) = delete;
@@ -36,11 +56,14 @@ class BlackListTest : public BlackList
 public:
     static std::unique_ptr<BlackListTest> Create(int requests_per_sec, int window_size_sec, int ban_ip_sec);
 
-    virtual void addEntry(const char* ip, int len = 32, Allow allow = false) = 0;
+    //changes the current rules in place, must not be called concurrently with processIp
+    //len is the prefix length in the address family of ip, -1 means the whole address
+    virtual void addEntry(const char* ip, int len = -1, Allow allow = false) = 0;
     virtual void addEntry(in_addr_t addr, bool networkOrder = true, Allow allow = false, int len = 32) = 0;
     virtual void removeEntry(const char* ip) = 0;
     virtual void removeEntry(in_addr_t addr, bool networkOrder = true) = 0;
     //returns a pair, first is true if a corresponding entry found, second is true if the addr is effectively allowed
+    virtual std::pair<bool, Allow> find(const IpAddress& addr) = 0;
     virtual std::pair<bool, Allow> find(in_addr_t addr, bool networkOrder = true) = 0;
     virtual std::pair<bool, Allow> find(const char* ip) = 0;
     virtual bool active(in_addr_t addr) = 0;
@@ -1,6 +1,7 @@
 
 #pragma once
 
+#include <functional>
 #include <string>
 #include <random>
 
@@ -17,5 +18,15 @@ T random_number(T startRange, T endRange)
     return dist(mt);
 }
 
+/*!
+ * \brief storeFileAtomically - replaces file so it always has either old or new complete content, even if process crashes
+ *        in the middle. store writes new content to temporary file with unique name next to file_name, the temporary file
+ *        is synced to disk and renamed to file_name. Concurrent stores of the same file don't interfere, the last rename wins.
+ *        Throws std::runtime_error on failure, file_name is left untouched then.
+ * \param file_name - target file
+ * \param store     - writes content to the file with the given name
+ */
+void storeFileAtomically(const std::string& file_name, const std::function<void(const std::string& tmp_file_name)>& store);
+
 }
 
@@ -111,6 +111,10 @@ public:
     bool ready() const { return m_ready; }
     bool stopped() const { return m_stop; }
 
+    //the handler is called in the IO thread after requestReload, requestReload can be called from a signal handler
+    void setReloadHandler(std::function<void()> handler) { m_reloadHandler = std::move(handler); }
+    void requestReload() { m_reload = true; }
+
     virtual mg_mgr* getMgMgr() override { return m_mgr.get(); }
 protected:
     std::unique_ptr<mg_mgr> m_mgr;
@@ -121,6 +125,8 @@ private:
     std::atomic_bool m_ready {false};
     std::atomic_bool m_stop {false};
     std::atomic_bool m_forceStop {false};
+    std::atomic_bool m_reload {false};
+    std::function<void()> m_reloadHandler;
 };
 
 class ConnectionManager
@@ -172,8 +178,14 @@ public:
     void setSysInfoCounter(std::unique_ptr<SysInfoCounter>& counter);
     void createSystemInfoCounter();
     void loadBlacklist(const ConfigOpts& copts);
+    //replaces the blacklist rules, the current rules are kept on error
+    bool reloadBlacklistRules(const std::string& filename);
+    //applies changed options of the blacklist and the looper, it should be called in the IO thread
+    void reconfigure(const ConfigOpts& copts);
     void createLooper(ConfigOpts& configOpts);
     void initConnectionManagers();
+    //adds a manager of other protocol or address, it should be called before bindConnectionManagers
+    void addConnectionManager(std::unique_ptr<ConnectionManager> cm);
     void bindConnectionManagers();
 
     bool ready() const { return m_looperReady && m_looper->ready(); }
@@ -218,14 +230,21 @@ public:
 class HttpConnectionManager final : public ConnectionManager
 {
 public:
-    HttpConnectionManager() : ConnectionManager("HTTP") { }
+    //listens on http_address of the options unless other address is given
+    HttpConnectionManager(const Proto& proto = "HTTP", const std::string& address = std::string())
+        : ConnectionManager(proto), m_address(address) { }
 
     void bind(Looper& looper) override;
+    //the actual address with the port, it is known after bind
+    const std::string& getBoundAddress() const { return m_boundAddress; }
 
 private:
     static void ev_handler_http(mg_connection *client, int ev, void *ev_data);
     static int translateMethod(const char *method, std::size_t len);
     static HttpConnectionManager* from_accepted(mg_connection* cn);
+
+    std::string m_address;
+    std::string m_boundAddress;
 };
 
 class CoapConnectionManager final : public ConnectionManager
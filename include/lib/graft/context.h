@@ -143,9 +143,22 @@ public:
         {
             return m_error;
         }
+        /*! \brief Sets function called in the IO thread if the task ends with a status other than Ok.
+         *  The handler is not called again when its forwarded request fails, so it can release its resources here. */
+        void setOnFailure(std::function<void(Context&)> onFailure)
+        {
+            m_on_failure = std::move(onFailure);
+        }
+        std::function<void(Context&)> takeOnFailure()
+        {
+            std::function<void(Context&)> onFailure;
+            onFailure.swap(m_on_failure);
+            return onFailure;
+        }
     protected:
         Status m_last_status = Status::None;
         std::string m_error;
+        std::function<void(Context&)> m_on_failure;
     };
 
     class LocalFriend : protected Local
@@ -11,6 +11,7 @@ namespace graft
     EXP(Error) \
     EXP(Drop) \
     EXP(Busy) \
+    EXP(TooManyRequests) \
     EXP(InternalError) \
     EXP(Postpone) \
     EXP(Stop) //for timer events
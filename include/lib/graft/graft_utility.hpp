@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <thread>
 #include <memory>
@@ -81,8 +82,12 @@ namespace graft
             std::lock_guard<std::mutex> lk(head->m);
             new_node->next = std::move(head->next);
             head->next = std::move(new_node);
+            m_size.fetch_add(1, std::memory_order_relaxed);
         }
 
+        //number of elements, it can be read without locks
+        size_t size() const { return m_size.load(std::memory_order_relaxed); }
+
         void forEach(func f, bool timeUpdate = false)
         {
             node* current = head.get();
@@ -168,6 +173,7 @@ namespace graft
                 {
                     std::shared_ptr<node> old_next = std::move(current->next);
                     current->next = std::move(next->next);
+                    m_size.fetch_sub(1, std::memory_order_relaxed);
                     next_lk.unlock();
                 }
                 else
@@ -202,6 +208,7 @@ namespace graft
 
                     std::shared_ptr<node> old_next = std::move(current->next);
                     current->next = std::move(next->next);
+                    m_size.fetch_sub(1, std::memory_order_relaxed);
                 }
                 else
                 {
@@ -232,6 +239,7 @@ namespace graft
 
                     std::shared_ptr<node> old_next = std::move(current->next);
                     current->next = std::move(next->next);
+                    m_size.fetch_sub(1, std::memory_order_relaxed);
                 }
                 else
                 {
@@ -241,6 +249,7 @@ namespace graft
         }
     private:
         std::shared_ptr<node> head = std::make_shared<node>();
+        std::atomic<size_t> m_size{0};
     };
 
     template <typename Key, typename Value, typename Hash=std::hash<Key> >
@@ -275,6 +284,11 @@ namespace graft
                 m_data.forEachNode(f);
             }
 
+            size_t size() const
+            {
+                return m_data.size();
+            }
+
             Value valueFor(Key const& key, Value const& default_value)
             {
                 BucketPtr const found_entry = findEntryFor(key);
@@ -524,6 +538,17 @@ namespace graft
             b.remove(key);
         }
 
+        //approximate number of entries, buckets are not locked
+        size_t size() const
+        {
+            size_t res = 0;
+            for(auto& b : m_buckets)
+            {
+                res += b->size();
+            }
+            return res;
+        }
+
         bool hasKey(Key const& key) const
         {
             BucketType& b = getBucket(key);
@@ -7,17 +7,25 @@ namespace graft
 
 namespace request::system_info { class Counter; }
 struct ConfigOpts;
+class Tracer;
 
 class HandlerAPI
 {
 public:
     virtual void sendUpstreamBlocking(Output& output, Input& input, std::string& err) = 0;
+    //sends output to upstream without waiting for the response, e.g. webhook callbacks; can be called from any thread
+    //returns false if the queue of such requests is full
+    virtual bool sendUpstreamAsync(Output&& output) = 0;
     virtual bool addPeriodicTask(const Router::Handler& h_worker,
                                  std::chrono::milliseconds interval_ms,
                                  std::chrono::milliseconds initial_interval_ms = std::chrono::milliseconds::max(),
                                  double random_factor = 0) = 0;
     virtual request::system_info::Counter& runtimeSysInfo() = 0;
     virtual const ConfigOpts& configOpts() const = 0;
+    virtual Tracer& tracer() = 0;
+    //resumes the postponed task with given uuid passing input to it; can be called from any thread
+    //returns false if the resume queue is full, the task then fails with an error without waiting for the postpone timeout
+    virtual bool resumePostponedTask(const Context::uuid_t& uuid, const Input& input) = 0;
 };
 
 }//namespace graft
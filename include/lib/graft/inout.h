@@ -3,6 +3,7 @@
 
 #include "lib/graft/graft_macros.h"
 #include "lib/graft/common/utils.h"
+#include "lib/graft/binary_serializer.h"
 
 #include "lib/graft/reflective-rapidjson/reflector-boosthana.h"
 #include "lib/graft/reflective-rapidjson/serializable.h"
@@ -116,6 +117,47 @@ namespace graft
             }
         };
 
+        // marks base64 encoded binary payload, the character is not in the base64 alphabet
+        static constexpr char BINARY_B64_MARK = '~';
+
+        template<typename T>
+        struct BIN_B64
+        {
+            static std::string serialize(const T& t)
+            {
+                return BINARY_B64_MARK + utils::base64_encode(binary::toBinary(t));
+            }
+            static void deserialize(const std::string& s, T& t)
+            {
+                if (s.empty() || s[0] != BINARY_B64_MARK)
+                    throw binary::BinaryParseError("no binary payload mark");
+                binary::fromBinary(utils::base64_decode(s.substr(1)), t);
+            }
+        };
+
+        /*!
+         * \brief ANY_B64 - deserializes both JSON_B64 and BIN_B64 payloads, serializes to JSON_B64
+         */
+        template<typename T>
+        struct ANY_B64
+        {
+            static bool isBinary(const std::string& s)
+            {
+                return !s.empty() && s[0] == BINARY_B64_MARK;
+            }
+            static std::string serialize(const T& t)
+            {
+                return JSON_B64<T>::serialize(t);
+            }
+            static void deserialize(const std::string& s, T& t)
+            {
+                if (isBinary(s))
+                    BIN_B64<T>::deserialize(s, t);
+                else
+                    JSON_B64<T>::deserialize(s, t);
+            }
+        };
+
 
 
     } //namespace serializer
@@ -160,6 +202,8 @@ namespace graft
         //You can use combine_headers() to do this, like following
         //  output.extra_headers = output.combine_headers();
         //  output.headers.clear();
+        //When Output is the response to a client, extra_headers replaces default
+        //"Content-Type: application/json\r\n" header, headers is ignored.
         std::vector<std::pair<std::string, std::string>> headers;
         std::string extra_headers;
     private:
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+typedef uint32_t in_addr_t;
+struct sockaddr;
+
+namespace graft {
+
+/*!
+ * \brief IpAddress - IPv6 address in host order, IPv4 addresses are kept as IPv4-mapped ones (::ffff:a.b.c.d),
+ * so both families can share one rule table and a dual-stack listener reports IPv4 clients the same way as an IPv4 one.
+ */
+class IpAddress
+{
+public:
+    IpAddress() = default;
+    IpAddress(uint64_t hi, uint64_t lo) : m_hi(hi), m_lo(lo) { }
+
+    static IpAddress fromV4(in_addr_t addr, bool networkOrder = true);
+    //16 bytes in network order
+    static IpAddress fromV6(const uint8_t* bytes);
+    //AF_INET or AF_INET6, :: for other families
+    static IpAddress fromSockaddr(const sockaddr* sa);
+    //parses a.b.c.d or an IPv6 address in any textual form, returns false on error
+    static bool parse(const char* str, IpAddress& addr);
+
+    bool isV4() const { return m_hi == 0 && (m_lo >> 32) == 0xffff; }
+    //host order, valid for IPv4 addresses only
+    in_addr_t v4() const { return static_cast<in_addr_t>(m_lo); }
+
+    uint64_t hi() const { return m_hi; }
+    uint64_t lo() const { return m_lo; }
+
+    //a.b.c.d for IPv4 addresses
+    std::string toString() const;
+
+    bool operator == (const IpAddress& rhs) const { return m_hi == rhs.m_hi && m_lo == rhs.m_lo; }
+    bool operator != (const IpAddress& rhs) const { return !(*this == rhs); }
+    bool operator < (const IpAddress& rhs) const { return m_hi < rhs.m_hi || (m_hi == rhs.m_hi && m_lo < rhs.m_lo); }
+
+private:
+    uint64_t m_hi = 0;
+    uint64_t m_lo = 0;
+};
+
+} //namespace graft
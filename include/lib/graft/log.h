@@ -2,6 +2,14 @@
 
 #include <string>
 
+//Log calls of levels above GRAFT_LOG_MAX_LEVEL are removed at compile time, e.g. -DGRAFT_LOG_MAX_LEVEL=2
+//removes level 3 and 4 (trace) calls together with formatting of their arguments.
+#ifndef GRAFT_LOG_MAX_LEVEL
+#define GRAFT_LOG_MAX_LEVEL 4
+#endif
+
+#define GRAFT_LOG_COMPILED(level) ((level) <= GRAFT_LOG_MAX_LEVEL)
+
 namespace graft
 {
 //The function truncates binary data for output to trunc_size characters.
@@ -0,0 +1,19 @@
+
+#pragma once
+
+#include <string>
+
+namespace graft { template<typename In, typename Out> class RouterT; class InHttp; class OutHttp; using Router = RouterT<InHttp, OutHttp>; }
+
+namespace graft::request::system_info { class Counter; }
+
+namespace graft::request::metrics {
+
+// Renders server metrics in Prometheus text exposition format (version 0.0.4).
+// Only atomic counters and the snapshot published by the IO thread are read, no locks are taken.
+std::string render(const system_info::Counter& counter);
+
+void register_request(Router& router);
+
+}
+
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace graft {
+
+/*!
+ * \brief PrefixTrie - path compressed binary trie of 128-bit prefixes with longest-match lookup.
+ * The nodes are kept in one vector, so a table of many thousands of prefixes is built with few allocations
+ * and a lookup visits a few cache lines.
+ */
+class PrefixTrie
+{
+public:
+    using Bits = unsigned __int128;
+
+    PrefixTrie();
+
+    void reserve(size_t prefixes) { m_nodes.reserve(2 * prefixes + 1); }
+
+    //bits of prefix beyond len are ignored, returns false if the prefix exists already
+    bool insert(Bits prefix, int len, bool value);
+    //returns false if the prefix does not exist
+    bool erase(Bits prefix, int len);
+    //the value of the longest prefix of the first len bits of addr, -1 if there is no such prefix
+    int longestMatch(Bits addr, int len = 128) const;
+
+    //number of prefixes
+    size_t size() const { return m_size; }
+
+    static Bits mask(Bits bits, int len)
+    {
+        return (len == 0)? 0 : bits & (~Bits(0) << (128 - len));
+    }
+
+private:
+    struct Node
+    {
+        Bits prefix;
+        int len;
+        int32_t child[2];
+        int8_t value; //-1 for internal nodes
+    };
+
+    int32_t addNode(Bits prefix, int len, int8_t value);
+
+    static int bitAt(Bits bits, int n) { return static_cast<int>(bits >> (127 - n)) & 1; }
+    //length of common prefix of a and b, max at most
+    static int commonLen(Bits a, Bits b, int max);
+
+    std::vector<Node> m_nodes;
+    size_t m_size = 0;
+};
+
+} //namespace graft
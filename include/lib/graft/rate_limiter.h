@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace graft {
+
+/*!
+ * \brief RateLimiter - token bucket per key (an IP address, for example).
+ * The buckets are kept in a number of shards, each with its own lock, hash map and LRU list, so a check is O(1)
+ * and checks of different keys rarely contend. A bucket is refilled lazily when its key is checked.
+ * Buckets which are full again, and so are the same as unknown ones, are evicted from the LRU tail a few per check.
+ * A key which exceeds its bucket can be banned, the ban expires lazily too.
+ */
+class RateLimiter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Key = uint64_t;
+
+    enum class Result
+    {
+        Allowed,
+        Limited, // the bucket is empty
+        Banned,  // the bucket has been exceeded within ban time
+    };
+
+    static constexpr Clock::duration NoBan = Clock::duration::zero();
+    static constexpr Clock::duration BanForever = Clock::duration::max();
+
+    /*!
+     * \param requests_per_sec - refill rate of a bucket, 0 disables the limiter
+     * \param burst - capacity of a bucket, number of requests accepted at once
+     * \param ban_time - time a key is banned for when its bucket is exceeded, NoBan, or BanForever
+     * \param shards - number of shards, rounded up to a power of two
+     */
+    RateLimiter(double requests_per_sec, size_t burst, Clock::duration ban_time = NoBan, size_t shards = 64);
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator = (const RateLimiter&) = delete;
+
+    bool enabled() const { return m_interval != Clock::duration::zero(); }
+
+    Result check(Key key, Clock::time_point now = Clock::now());
+
+    //number of remembered keys
+    size_t size() const;
+
+private:
+    struct Bucket
+    {
+        Key key;
+        //the time the bucket becomes full, one request moves it forward by m_interval
+        Clock::time_point full_at;
+        Clock::time_point banned_until;
+    };
+
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        //most recently used first
+        std::list<Bucket> lru;
+        std::unordered_map<Key, std::list<Bucket>::iterator> index;
+    };
+
+    Result take(Bucket& bucket, Clock::time_point now);
+    void evict(Shard& shard, Clock::time_point now);
+    Shard& shardOf(Key key)
+    {
+        //the shift by 64 is undefined, there is the only shard then
+        if(m_shardShift == 64) return m_shards[0];
+        //fibonacci hashing, the high bits are well mixed even for sequential keys
+        return m_shards[(key * 0x9E3779B97F4A7C15ull) >> m_shardShift];
+    }
+
+    Clock::duration m_interval;
+    Clock::duration m_capacity;
+    const Clock::duration m_banTime;
+    int m_shardShift;
+    size_t m_shardCount;
+    std::unique_ptr<Shard[]> m_shards;
+};
+
+} //namespace graft
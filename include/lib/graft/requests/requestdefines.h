@@ -26,12 +26,17 @@ GRAFT_DEFINE_IO_STRUCT(ErrorResponse,
 #define ERROR_INVALID_PARAMS                -32602
 #define ERROR_INTERNAL_ERROR                -32603
 
+//Server errors
+#define ERROR_TOO_MANY_REQUESTS             -32029
+
 static const std::string MESSAGE_INVALID_PARAMS("The request parameters are invalid.");
 static const std::string MESSAGE_INTERNAL_ERROR("Internal server error.");
+static const std::string MESSAGE_TOO_MANY_REQUESTS("Too many requests, try again later.");
 
 namespace graft {
 
 Status errorInvalidParams(Output &output);
+Status errorTooManyRequests(Output &output);
 
 } //namespace graft
 
@@ -54,6 +54,7 @@ public:
         Input input;
         vars_t vars;
         Handler3 h3;
+        const std::string* endpoint = nullptr; // endpoint of the matched route, routes outlive tasks
     };
 
     class Root
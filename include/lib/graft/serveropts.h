@@ -15,12 +15,30 @@ struct CommonOpts
     std::string wallet_public_address;
 };
 
+struct RouteLimitOpts
+{
+    //path prefix of the route class
+    std::string prefix;
+    int requests_per_sec = 0;
+    //0 means requests_per_sec
+    int burst = 0;
+};
+
 struct IPFilterOpts
 {
     int requests_per_sec = 0;
     int window_size_sec = 0;
     int ban_ip_sec = 0;
     std::string rules_filename;
+    //the rules file is reloaded when it is modified, checked every rules_reload_interval_sec, 0 means never
+    int rules_reload_interval_sec = 0;
+    std::vector<RouteLimitOpts> route_limits;
+};
+
+struct TraceOpts
+{
+    int sample_rate = 0;
+    int buffer_size = 65536;
 };
 
 struct ConfigOpts
@@ -39,6 +57,7 @@ struct ConfigOpts
     std::vector<std::string> graftlet_dirs;
     int lru_timeout_ms;
     IPFilterOpts ipfilter;
+    TraceOpts trace;
     CommonOpts common;
 
     void check_asserts() const
@@ -51,6 +70,7 @@ struct ConfigOpts
         assert(0 < timer_poll_interval_ms);
         assert(0 < lru_timeout_ms);
         assert(ipfilter.requests_per_sec == 0 || 0 < ipfilter.window_size_sec);
+        for(auto& limit : ipfilter.route_limits) assert(0 < limit.requests_per_sec);
     }
 };
 
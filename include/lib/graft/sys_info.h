@@ -4,6 +4,10 @@
 #include <atomic>
 #include <cstdint>
 #include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace graft { class Context; }
 
@@ -13,6 +17,120 @@ using u32 = std::uint32_t;
 using u64 = std::uint64_t;
 using SysClockTimePoint = std::chrono::time_point<std::chrono::system_clock>;
 
+// HDR-style histogram of latencies in microseconds, recording is lock-free.
+// Each power of two range is split into SUB_BUCKETS buckets, so the relative error is below 1/SUB_BUCKETS.
+class LatencyHistogram
+{
+  public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_BITS = 40; // values above ~12 days are clamped
+    static constexpr int BUCKETS = (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    LatencyHistogram(void);
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator = (const LatencyHistogram&) = delete;
+
+    void record(u64 us)
+    {
+        m_buckets[bucket_index(us)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(us, std::memory_order_relaxed);
+
+        u64 max = m_max.load(std::memory_order_relaxed);
+        while(max < us && !m_max.compare_exchange_weak(max, us, std::memory_order_relaxed));
+    }
+
+    u64 count(void) const { return m_count.load(std::memory_order_relaxed); }
+    u64 sum(void)   const { return m_sum.load(std::memory_order_relaxed); }
+    u64 max(void)   const { return m_max.load(std::memory_order_relaxed); }
+
+    // value which q-th part of recorded values does not exceed, q is in [0, 1]
+    u64 percentile(double q) const;
+
+    static int bucket_index(u64 us)
+    {
+        if(us < SUB_BUCKETS) return static_cast<int>(us);
+        if(us >> MAX_BITS) us = (u64(1) << MAX_BITS) - 1;
+        const int shift = (63 - __builtin_clzll(us)) - SUB_BUCKET_BITS;
+        return (shift + 1) * SUB_BUCKETS + static_cast<int>((us >> shift) & (SUB_BUCKETS - 1));
+    }
+    static u64 bucket_upper_bound(int index);
+
+  private:
+    std::atomic<u64> m_buckets[BUCKETS];
+    std::atomic<u64> m_count;
+    std::atomic<u64> m_sum;
+    std::atomic<u64> m_max;
+};
+
+// Histograms by name, lookups and insertions are lock-free.
+// The number of names is limited, values of names above the limit go to OVERFLOW_NAME histogram.
+class LatencyHistogramSet
+{
+  public:
+    static constexpr int CAPACITY = 256;
+    static constexpr const char* OVERFLOW_NAME = "(other)";
+
+    LatencyHistogramSet(void);
+    ~LatencyHistogramSet(void);
+    LatencyHistogramSet(const LatencyHistogramSet&) = delete;
+    LatencyHistogramSet& operator = (const LatencyHistogramSet&) = delete;
+
+    LatencyHistogram& get(const std::string& name);
+    void for_each(const std::function<void (const std::string& name, const LatencyHistogram& histogram)>& f) const;
+
+  private:
+    struct Entry
+    {
+        explicit Entry(const std::string& name) : name(name) { }
+        const std::string name;
+        LatencyHistogram histogram;
+    };
+
+    std::atomic<Entry*> m_entries[CAPACITY];
+    Entry m_overflow;
+};
+
+// State of the server taken by the IO thread, so that readers don't touch structures owned by it
+struct RuntimeSnapshot
+{
+    struct Upstream
+    {
+        std::string name;
+        u64 max_connections = 0; // 0 means unlimited
+        u64 idle_connections = 0;
+        u64 active_connections = 0;
+        u64 queued_tasks = 0;
+
+        bool operator == (const Upstream& other) const
+        {
+            return name == other.name && max_connections == other.max_connections && idle_connections == other.idle_connections
+                && active_connections == other.active_connections && queued_tasks == other.queued_tasks;
+        }
+    };
+
+    u64 thread_pool_jobs = 0; // jobs posted to the thread pool and not processed yet
+    u64 thread_pool_capacity = 0;
+    u64 thread_pool_active_workers = 0;
+    u64 thread_pool_expelled_workers = 0;
+    u64 postponed_tasks = 0;
+    u64 tasks_ready_to_resume = 0;
+    u64 global_context_entries = 0;
+    std::vector<Upstream> upstreams;
+
+    bool operator == (const RuntimeSnapshot& other) const
+    {
+        return thread_pool_jobs == other.thread_pool_jobs && thread_pool_capacity == other.thread_pool_capacity
+            && thread_pool_active_workers == other.thread_pool_active_workers
+            && thread_pool_expelled_workers == other.thread_pool_expelled_workers
+            && postponed_tasks == other.postponed_tasks && tasks_ready_to_resume == other.tasks_ready_to_resume
+            && global_context_entries == other.global_context_entries && upstreams == other.upstreams;
+    }
+};
+
+using RuntimeSnapshotPtr = std::shared_ptr<const RuntimeSnapshot>;
+
 class Counter
 {
   public:
@@ -59,6 +177,22 @@ class Counter
     u64 upstrm_http_req_bytes_raw_cnt(void)   const { return m_upstrm_http_req_bytes_raw_cnt; }
     u64 upstrm_http_resp_bytes_raw_cnt(void)  const { return m_upstrm_http_resp_bytes_raw_cnt; }
 
+    // latency of requests by route, of task stages and of upstream requests by upstream
+    enum class Stage { PreAction, QueueWait, WorkerAction, PostAction, Count };
+    static const char* stage_name(Stage stage);
+
+    void record_route_latency(const std::string& route, u64 us)    { m_route_latency.get(route).record(us); }
+    void record_stage_latency(Stage stage, u64 us)                 { m_stage_latency[static_cast<int>(stage)].record(us); }
+    void record_upstream_latency(const std::string& upstream, u64 us) { m_upstream_latency.get(upstream).record(us); }
+
+    const LatencyHistogramSet& route_latency(void) const          { return m_route_latency; }
+    const LatencyHistogram& stage_latency(Stage stage) const       { return m_stage_latency[static_cast<int>(stage)]; }
+    const LatencyHistogramSet& upstream_latency(void) const        { return m_upstream_latency; }
+    LatencyHistogram& upstream_latency(const std::string& upstream) { return m_upstream_latency.get(upstream); }
+
+    void set_runtime_snapshot(RuntimeSnapshotPtr snapshot)        { std::atomic_store(&m_runtime_snapshot, std::move(snapshot)); }
+    RuntimeSnapshotPtr runtime_snapshot(void) const                { return std::atomic_load(&m_runtime_snapshot); }
+
     u32 system_uptime_sec(void) const
     {
       return std::chrono::duration_cast<std::chrono::seconds>(
@@ -85,6 +219,12 @@ class Counter
     std::atomic<u64>  m_upstrm_http_req_bytes_raw_cnt;
     std::atomic<u64>  m_upstrm_http_resp_bytes_raw_cnt;
 
+    LatencyHistogramSet m_route_latency;
+    LatencyHistogram    m_stage_latency[static_cast<int>(Stage::Count)];
+    LatencyHistogramSet m_upstream_latency;
+
+    RuntimeSnapshotPtr  m_runtime_snapshot;
+
     const SysClockTimePoint m_system_start_time;
 };
 
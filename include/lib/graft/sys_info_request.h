@@ -61,6 +61,23 @@ GRAFT_DEFINE_IO_STRUCT_INITED(Running,
     (u32, uptime_sec, 0)
 );
 
+GRAFT_DEFINE_IO_STRUCT_INITED(LatencyStats,
+    (std::string, name, std::string()),
+    (u64, count, 0),
+    (u64, avg_us, 0),
+    (u64, p50_us, 0),
+    (u64, p90_us, 0),
+    (u64, p99_us, 0),
+    (u64, p999_us, 0),
+    (u64, max_us, 0)
+);
+
+GRAFT_DEFINE_IO_STRUCT_INITED(Latency,
+    (std::vector<LatencyStats>, routes, std::vector<LatencyStats>()),
+    (std::vector<LatencyStats>, stages, std::vector<LatencyStats>()),
+    (std::vector<LatencyStats>, upstreams, std::vector<LatencyStats>())
+);
+
 GRAFT_DEFINE_IO_STRUCT_INITED(EndPoint,
     (std::string, path, std::string()),
     (std::string, handler, std::string()),
@@ -94,6 +111,7 @@ GRAFT_DEFINE_IO_STRUCT_INITED(Response,
     (std::string, version, std::string()),
     (Configuratioon, configuration, Configuratioon()),
     (Running, running_info, Running()),
+    (Latency, latency, Latency()),
     (std::vector<DapiEntry>, dapi, std::vector<DapiEntry>()),
     (std::vector<Graftlet>, graftlets, std::vector<Graftlet>())
 );
@@ -10,22 +10,37 @@
 #include "lib/graft/router.h"
 #include "lib/graft/timer.h"
 #include "lib/graft/thread_pool.h"
+#include "lib/graft/trace.h"
 #include "misc_log_ex.h"
+#include <chrono>
 #include <future>
 #include <deque>
-
-#define LOG_PRINT_CLN(level,client,x) LOG_PRINT_L##level("[" << client_addr(client) << "] " << x)
+#include <mutex>
+#include <vector>
+
+//the arguments are formatted only if the level is enabled for the category,
+//calls of levels above GRAFT_LOG_MAX_LEVEL are removed at compile time
+#define LOG_PRINT_CLN(level,client,x) \
+do { \
+    if(GRAFT_LOG_COMPILED(level)) \
+    { \
+        LOG_PRINT_L##level("[" << client_addr(client) << "] " << x); \
+    } \
+} while(0)
 
 #define LOG_PRINT_RQS_BT(level,bt,x) \
 { \
-    ClientTask* cr = dynamic_cast<ClientTask*>(bt.get()); \
-    if(cr) \
+    if(GRAFT_LOG_COMPILED(level)) \
     { \
-        LOG_PRINT_CLN(level,cr->m_client,x); \
-    } \
-    else \
-    { \
-        LOG_PRINT_L##level(x); \
+        ClientTask* cr = dynamic_cast<ClientTask*>(bt.get()); \
+        if(cr) \
+        { \
+            LOG_PRINT_CLN(level,cr->m_client,x); \
+        } \
+        else \
+        { \
+            LOG_PRINT_L##level(x); \
+        } \
     } \
 }
 
@@ -121,6 +136,13 @@ public:
 
     const char* getStrStatus();
     static const char* getStrStatus(Status s);
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point getCreateTime() const { return m_createTime; }
+    Clock::time_point getJobPostTime() const { return m_jobPostTime; }
+    void setJobPostTime(Clock::time_point tp) { m_jobPostTime = tp; }
+    //the task is sampled by the tracer
+    bool isTraced() const { return m_traced; }
 protected:
     BaseTask(TaskManager& manager, const Router::JobParams& prms);
 
@@ -128,6 +150,9 @@ protected:
     Router::JobParams m_params;
     Output m_output;
     Context m_ctx;
+    Clock::time_point m_createTime;
+    Clock::time_point m_jobPostTime;
+    bool m_traced = false;
 };
 
 class UpstreamTask : public BaseTask
@@ -147,6 +172,20 @@ private:
     }
 };
 
+class UpstreamAsyncTask : public BaseTask
+{
+public:
+    virtual void finalize() override;
+private:
+    friend class SelfHolder<BaseTask>;
+    UpstreamAsyncTask(TaskManager& manager, Output&& output)
+        : BaseTask(manager, Router::JobParams({Input(), Router::vars_t(),
+                Router::Handler3(nullptr, nullptr, nullptr)}))
+    {
+        getOutput() = std::move(output);
+    }
+};
+
 class PeriodicTask : public BaseTask
 {
     friend class SelfHolder<BaseTask>;
@@ -224,12 +263,15 @@ public:
 
     //HandlerAPI implementation
     virtual void sendUpstreamBlocking(Output& output, Input& input, std::string& err) override;
+    virtual bool sendUpstreamAsync(Output&& output) override;
     virtual bool addPeriodicTask(const Router::Handler& h_worker,
                                  std::chrono::milliseconds interval_ms,
                                  std::chrono::milliseconds initial_interval_ms = std::chrono::milliseconds::max(),
                                  double random_factor = 0 ) override;
     virtual request::system_info::Counter& runtimeSysInfo() override;
     virtual const ConfigOpts& configOpts() const override;
+    virtual Tracer& tracer() override;
+    virtual bool resumePostponedTask(const Context::uuid_t& uuid, const Input& input) override;
 
     //
     void runWorkerActionFromTheThreadPool(BaseTaskPtr bt);
@@ -239,13 +281,25 @@ public:
     void cb_event(uint64_t cnt);
 
     void getThreadPoolInfo(uint64_t& activeWorkers, uint64_t& expelledWorkers) const;
+
+    //applies the options which can be changed on the fly, it should be called in the IO thread
+    //the upstreams are recreated at once when their options are changed
+    void reconfigure(const ConfigOpts& copts);
+    //new requests go to the upstreams created with current options, e.g. when OutHttp::uri_substitutions is changed,
+    //the previous upstreams are destroyed when their pending requests are done, it should be called in the IO thread
+    void reinitUpstreams();
 protected:
     bool canStop();
     void executePostponedTasks();
     void expelWorkers();
     void setIOThread(bool current);
     void checkUpstreamBlockingIO();
+    void checkUpstreamAsyncIO();
     void checkPeriodicTaskIO();
+    void checkResumeTaskIO();
+    void failResumeTask(const Context::uuid_t& uuid);
+    void publishRuntimeSnapshot();
+    void reconfigureIdle();
 
     ConfigOpts m_copts;
 private:
@@ -253,7 +307,9 @@ private:
     void processForward(BaseTaskPtr bt);
     void processOk(BaseTaskPtr bt);
     void respondAndDie(BaseTaskPtr bt, const std::string& s, bool die = true);
+    void runOnFailure(BaseTaskPtr bt);
     void postponeTask(BaseTaskPtr bt);
+    void resumeTask(const Context::uuid_t& uuid, Input&& input);
     void upstreamDoneProcess(UpstreamSender& uss);
 
     void checkThreadPoolOverflow(BaseTaskPtr bt);
@@ -267,6 +323,7 @@ private:
     static inline size_t next_pow2(size_t val);
 
     SysInfoCounter& m_sysInfoCounter;
+    std::unique_ptr<Tracer> m_tracer;
     GlobalContextMap m_gcm;
 
     uint64_t m_cntBaseTask = 0;
@@ -285,6 +342,11 @@ private:
     std::priority_queue<std::pair<std::chrono::time_point<std::chrono::steady_clock>,Context::uuid_t>> m_expireTaskQueue;
     std::unique_ptr<ExpiringList> m_futurePostponeUuids;
     std::unique_ptr<UpstreamManager> m_upstreamManager;
+    //replaced by reinitUpstreams, they are destroyed in reconfigureIdle when they have no pending requests
+    std::vector<std::unique_ptr<UpstreamManager>> m_drainingUpstreamManagers;
+
+    static constexpr int RUNTIME_SNAPSHOT_INTERVAL_MS = 100;
+    std::chrono::steady_clock::time_point m_nextRuntimeSnapshotTime;
 
     using PromiseItem = UpstreamTask::PromiseItem;
     using PromiseQueue = tp::MPMCBoundedQueue<PromiseItem>;
@@ -292,8 +354,18 @@ private:
     using PeridicTaskItem = std::tuple<Router::Handler3, std::chrono::milliseconds, std::chrono::milliseconds, double>;
     using PeriodicTaskQueue = tp::MPMCBoundedQueue<PeridicTaskItem>;
 
+    using ResumeItem = std::pair<Context::uuid_t, Input>;
+    using ResumeQueue = tp::MPMCBoundedQueue<ResumeItem>;
+
+    using UpstreamAsyncQueue = tp::MPMCBoundedQueue<Output>;
+
     std::unique_ptr<PromiseQueue> m_promiseQueue;
+    std::unique_ptr<UpstreamAsyncQueue> m_upstreamAsyncQueue;
     std::unique_ptr<PeriodicTaskQueue> m_periodicTaskQueue;
+    std::unique_ptr<ResumeQueue> m_resumeQueue;
+    //the tasks which cannot be resumed since m_resumeQueue is full
+    std::mutex m_resumeFailedMutex;
+    std::vector<Context::uuid_t> m_resumeFailed;
     static thread_local bool io_thread;
 
     friend class StateMachine;
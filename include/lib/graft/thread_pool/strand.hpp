@@ -4,6 +4,7 @@
 
 #include <atomic>
 #include <cassert>
+#include <stdexcept>
 
 namespace tp
 {
@@ -44,6 +45,18 @@ public:
     template <typename Handler>
     void post(Handler&& handler, bool to_any_queue = false);
 
+    /**
+      * @brief Post handler unless strand's queue is full
+      *
+      * @return false if strand's queue is full, the handler is not posted then.
+      * @throw std::runtime_error if thread pool queue is full.
+      */
+    template <typename Handler>
+    bool tryPost(Handler&& handler, bool to_any_queue = false);
+
+    /// Number of handlers posted and not completed yet
+    size_t pendingCount() const { return m_pending_count.load(std::memory_order_relaxed); }
+
 private:
     void invokeCall();
 
@@ -61,6 +74,7 @@ private:
     ThreadPool& m_thread_pool;
     Queue<Task> m_queue;
     std::atomic<size_t> m_deferred_calls_count;
+    std::atomic<size_t> m_pending_count;
 };
 
 template <typename Task, template<typename> class Queue>
@@ -68,6 +82,7 @@ StrandImpl<Task, Queue>::StrandImpl(ThreadPool& thread_pool, size_t queue_size)
   : m_thread_pool(thread_pool)
   , m_queue(queue_size)
   , m_deferred_calls_count()
+  , m_pending_count(0)
 {
 }
 
@@ -75,9 +90,26 @@ template <typename Task, template<typename> class Queue>
 template <typename Handler>
 void StrandImpl<Task, Queue>::post(Handler&& handler, bool to_any_queue)
 {
-    m_queue.push(std::forward<Handler>(handler));
+    if (!tryPost(std::forward<Handler>(handler), to_any_queue))
+        throw std::overflow_error("strand queue is full");
+}
+
+template <typename Task, template<typename> class Queue>
+template <typename Handler>
+bool StrandImpl<Task, Queue>::tryPost(Handler&& handler, bool to_any_queue)
+{
+    // counted before push, so completion of the handler never precedes the increment
+    m_pending_count.fetch_add(1, std::memory_order_relaxed);
+
+    if (!m_queue.push(std::forward<Handler>(handler)))
+    {
+        m_pending_count.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
 
     m_thread_pool.post(StrandImplHandler(*this), to_any_queue);
+
+    return true;
 }
 
 template <typename Task, template<typename> class Queue>
@@ -100,8 +132,10 @@ void StrandImpl<Task, Queue>::invokeCall()
         catch (...)
         {
             // suppress all exceptions
-        }           
-        
+        }
+
+        m_pending_count.fetch_sub(1, std::memory_order_relaxed);
+
         bool has_deferred_calls = m_deferred_calls_count.fetch_sub(1, std::memory_order_acq_rel) > 1;
 
         if (!has_deferred_calls)
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <boost/uuid/uuid.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace graft {
+
+/*!
+ * \brief Tracer - sampled tracing of requests.
+ * Events of a sampled task are keyed by the task uuid, so a request can be followed while it moves between
+ * the IO thread, the workers, upstreams and postponed state.
+ * Events are kept in a ring buffer of fixed size and dumped in Chrome trace format (chrome://tracing, Perfetto).
+ * A trace point of a task which is not sampled costs a single branch.
+ */
+class Tracer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Uuid = boost::uuids::uuid; //Context::uuid_t
+
+    /*!
+     * \param sampleRate - every sampleRate-th request is traced, 0 disables tracing
+     * \param capacity - max number of kept events, older ones are overwritten
+     */
+    Tracer(int sampleRate, size_t capacity);
+    Tracer(const Tracer&) = delete;
+    Tracer& operator = (const Tracer&) = delete;
+
+    bool enabled() const { return m_sampleRate != 0; }
+
+    //returns true if the next request should be traced
+    bool sample()
+    {
+        if(!m_sampleRate) return false;
+        return m_sampled.fetch_add(1, std::memory_order_relaxed) % m_sampleRate == 0;
+    }
+
+    //span of [start, end)
+    void span(const Uuid& uuid, const char* name, Clock::time_point start, Clock::time_point end, std::string detail = std::string());
+    //point in time
+    void instant(const Uuid& uuid, const char* name, Clock::time_point at = Clock::now(), std::string detail = std::string());
+
+    //all kept events in Chrome trace JSON format
+    std::string dumpChromeTrace() const;
+
+private:
+    struct Event
+    {
+        Uuid uuid;
+        const char* name = nullptr; //string literals only
+        bool instant = false;
+        int64_t ts_us = 0;
+        int64_t dur_us = 0;
+        uint32_t thread = 0;
+        std::string detail;
+    };
+
+    void add(Event&& event);
+    static uint32_t threadNumber();
+
+    const uint64_t m_sampleRate;
+    const Clock::time_point m_start;
+    std::atomic<uint64_t> m_sampled{0};
+
+    mutable std::mutex m_mutex;
+    std::vector<Event> m_events;
+    size_t m_next = 0;
+    bool m_full = false;
+};
+
+}//namespace graft
+
@@ -0,0 +1,103 @@
+#ifndef ANNOUNCEFILTER_H
+#define ANNOUNCEFILTER_H
+
+#include <crypto/hash.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <boost/shared_ptr.hpp>
+
+namespace graft {
+
+/*!
+ * \brief The AnnounceFilter class - drops copies of announces and too frequent announces of a supernode.
+ *        The same announce reaches supernode many times, each copy after the first one is dropped in O(1)
+ *        before its signature is verified. Rate of a supernode is charged only for announces with verified signatures,
+ *        so forged announces with its id can't make its own announces dropped.
+ */
+class AnnounceFilter
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    enum class Result
+    {
+        Accepted,
+        Duplicate, // same id, height and signature has been seen within dedup_ttl
+        Throttled, // too many verified announces from the supernode
+    };
+
+    /*!
+     * \brief AnnounceFilter
+     * \param min_interval      - average interval between announces of a supernode
+     * \param burst             - number of announces of a supernode accepted at once
+     * \param dedup_ttl         - time an announce is remembered for
+     * \param max_remembered    - max number of remembered announces, older ones are forgotten first
+     */
+    AnnounceFilter(std::chrono::milliseconds min_interval, size_t burst, std::chrono::seconds dedup_ttl, size_t max_remembered);
+
+    AnnounceFilter(const AnnounceFilter&) = delete;
+    AnnounceFilter& operator = (const AnnounceFilter&) = delete;
+
+    /*!
+     * \brief check - checks whether the announce is a copy of a remembered one, remembers it if not;
+     *               it is called before the signature is verified
+     * \param supernode_public_id
+     * \param height
+     * \param signature
+     * \param now
+     * \return Accepted or Duplicate
+     */
+    Result check(const std::string& supernode_public_id, uint64_t height, const std::string& signature, Clock::time_point now = Clock::now());
+
+    /*!
+     * \brief charge - charges rate of the supernode for the announce, it is called after the signature is verified
+     * \param supernode_public_id
+     * \param now
+     * \return Accepted or Throttled
+     */
+    Result charge(const std::string& supernode_public_id, Clock::time_point now = Clock::now());
+
+    uint64_t acceptedCount() const { return m_accepted; }
+    uint64_t duplicateCount() const { return m_duplicates; }
+    uint64_t throttledCount() const { return m_throttled; }
+
+private:
+    struct Sender
+    {
+        double tokens;
+        Clock::time_point last_time;
+    };
+
+    void expire(Clock::time_point now);
+
+    const std::chrono::milliseconds m_min_interval;
+    const size_t m_burst;
+    const std::chrono::seconds m_dedup_ttl;
+    const size_t m_max_remembered;
+
+    std::mutex m_mutex;
+    std::unordered_set<crypto::hash> m_remembered;
+    // remembered announces, oldest first
+    std::deque<std::pair<Clock::time_point, crypto::hash>> m_remembered_order;
+    // key is public id
+    std::unordered_map<std::string, Sender> m_senders;
+    Clock::time_point m_next_senders_cleanup;
+
+    std::atomic<uint64_t> m_accepted{0};
+    std::atomic<uint64_t> m_duplicates{0};
+    std::atomic<uint64_t> m_throttled{0};
+};
+
+using AnnounceFilterPtr = boost::shared_ptr<AnnounceFilter>;
+
+} // namespace graft
+
+#endif // ANNOUNCEFILTER_H
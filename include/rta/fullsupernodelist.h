@@ -10,6 +10,8 @@
 #include <string>
 #include <vector>
 #include <future>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 
 #include <boost/shared_ptr.hpp>
@@ -22,6 +24,8 @@ namespace utils {
     class ThreadPool;
 }
 
+namespace supernode::request { struct SupernodeAnnounce; }
+
 
 class FullSupernodeList
 {
@@ -31,6 +35,7 @@ public:
     static constexpr int32_t AUTH_SAMPLE_SIZE = TIERS * ITEMS_PER_TIER;
     static constexpr int64_t AUTH_SAMPLE_HASH_HEIGHT = 20; // block number for calculating auth sample should be calculated as current block height - AUTH_SAMPLE_HASH_HEIGHT;
     static constexpr int64_t ANNOUNCE_TTL_SECONDS = 60 * 60; // if more than ANNOUNCE_TTL_SECONDS passed from last annouce - supernode excluded from auth sample selection
+    static constexpr size_t ANNOUNCE_BATCH_SIZE = 64; // queued announces are applied once this number of supernodes is reached
 
     FullSupernodeList(const std::string &daemon_address, bool testnet = false);
     ~FullSupernodeList();
@@ -104,6 +109,20 @@ public:
      */
     std::vector<std::string> items() const;
 
+    /*!
+     * \brief queueAnnounce - queues announce which signature is already verified; only the latest announce of a supernode is kept
+     * \param announce
+     * \return         - number of supernodes with queued announces
+     */
+    size_t queueAnnounce(const supernode::request::SupernodeAnnounce& announce);
+
+    /*!
+     * \brief applyQueuedAnnounces - applies queued announces. New supernodes are created outside the lock; copies of known
+     *                               supernodes are updated and published together with new supernodes in one list update
+     * \return                      - number of applied announces
+     */
+    size_t applyQueuedAnnounces();
+
     /*!
      * \brief getBlockHash - returns block hash for given height
      * \param height       - block height
@@ -127,9 +146,32 @@ public:
     size_t refreshedItems() const;
 
     typedef std::vector<supernode_stake> supernode_stake_array;
+    // key is public id as a string
+    typedef std::unordered_map<std::string, supernode_stake> supernode_stake_map;
+
+    /*!
+     * \brief The stakes_delta struct - difference between two stake lists received from cryptonode
+     */
+    struct stakes_delta
+    {
+        supernode_stake_array    added;
+        supernode_stake_array    changed;
+        std::vector<std::string> removed; // public ids of supernodes whose stakes are not in the list anymore
+
+        bool empty() const { return added.empty() && changed.empty() && removed.empty(); }
+    };
 
     /*!
-     * \brief updateStakes - update stakes
+     * \brief diffStakes - compares stakes with the previous stakes
+     * \param prev       - previous stakes
+     * \param stakes     - received stakes
+     * \return
+     */
+    static stakes_delta diffStakes(const supernode_stake_map& prev, const supernode_stake_array& stakes);
+
+    /*!
+     * \brief updateStakes - update stakes; only supernodes with changed stakes are touched,
+     *                       list version is not changed if stakes are the same as for the previous block
      * \param              - array of stakes
      * \return
      */
@@ -140,6 +182,11 @@ public:
         std::string supernode_public_id;
         std::string supernode_public_address;
         uint64_t    amount;
+
+        bool operator == (const blockchain_based_list_entry& other) const
+        {
+            return supernode_public_id == other.supernode_public_id && supernode_public_address == other.supernode_public_address && amount == other.amount;
+        }
     };
     
     typedef std::vector<blockchain_based_list_entry> blockchain_based_list_tier;
@@ -147,7 +194,28 @@ public:
     typedef std::shared_ptr<blockchain_based_list>   blockchain_based_list_ptr;
 
     /*!
-     * \brief setBlockchainBasedList - updates full list of supernodes
+     * \brief The blockchain_based_list_delta struct - difference between two blockchain based lists, entries are paired with tier index
+     */
+    struct blockchain_based_list_delta
+    {
+        std::vector<std::pair<size_t, blockchain_based_list_entry>> added;
+        std::vector<std::pair<size_t, blockchain_based_list_entry>> removed;
+
+        bool empty() const { return added.empty() && removed.empty(); }
+    };
+
+    /*!
+     * \brief diffBlockchainBasedLists - compares tiers of two blockchain based lists; order of entries in a tier is ignored.
+     *                                   It is used for debug output, lists are stored as received
+     * \param prev                     - previous list
+     * \param list                     - new list
+     * \return
+     */
+    static blockchain_based_list_delta diffBlockchainBasedLists(const blockchain_based_list& prev, const blockchain_based_list& list);
+
+    /*!
+     * \brief setBlockchainBasedList - stores full list of supernodes for the block; if the list is the same as the previous one,
+     *                                 the previous list object is shared and list version is not changed
      * \return
      */
     void setBlockchainBasedList(uint64_t block_number, const blockchain_based_list_ptr& list);
@@ -187,6 +255,32 @@ public:
      * \return             - block number which was used for base list
      */
     uint64_t getBlockchainBasedListForAuthSample(uint64_t block_number, blockchain_based_list& list) const;
+
+    typedef std::unordered_map<uint64_t, blockchain_based_list_ptr> blockchain_based_list_map;
+
+    /*!
+     * \brief The Snapshot struct - immutable version of the list. Writers never modify a published snapshot or its supernodes,
+     *                              they copy the snapshot and each supernode they change, and publish the new version
+     */
+    struct Snapshot
+    {
+        // key is public id as a string
+        std::unordered_map<std::string, SupernodePtr> list;
+        blockchain_based_list_map blockchain_based_lists;
+        uint64_t blockchain_based_list_max_block_number = 0;
+        // incremented when stakes or blockchain based list content changes, unchanged lists received for new blocks keep the version
+        uint64_t stakes_version = 0;
+        uint64_t blockchain_based_list_version = 0;
+    };
+
+    typedef std::shared_ptr<const Snapshot> SnapshotPtr;
+
+    /*!
+     * \brief snapshot - returns current version of the list. Only the pointer copy is done under a short lock,
+     *                   readers never wait for writers. The returned snapshot stays valid (and unchanged) as long as the caller holds it
+     * \return
+     */
+    SnapshotPtr snapshot() const;
     
     /*!
      * \brief synchronizeWithCryptonode - synchronize with cryptonode
@@ -202,24 +296,31 @@ public:
 
 private:
     // bool loadWallet(const std::string &wallet_path);
-    void addImpl(SupernodePtr item);
-    bool selectSupernodes(size_t items_count, const std::string& payment_id, const blockchain_based_list_tier& src_array, supernode_array& dst_array);    
-
-    typedef std::unordered_map<uint64_t, blockchain_based_list_ptr> blockchain_based_list_map;
+    void addImpl(Snapshot& snapshot, SupernodePtr item);
+    // copies current snapshot for modification; m_write_access should be held by the caller
+    std::shared_ptr<Snapshot> cloneSnapshot() const;
+    void publish(std::shared_ptr<Snapshot> snapshot);
+    static uint64_t getBlockchainBasedListForAuthSample(const Snapshot& snapshot, uint64_t block_number, blockchain_based_list& list);
+    static bool selectSupernodes(const Snapshot& snapshot, std::mt19937_64& rng, size_t items_count, const std::string& payment_id,
+                                 const blockchain_based_list_tier& src_array, supernode_array& dst_array);
 
 private:
-    // key is public id as a string
-    std::unordered_map<std::string, SupernodePtr> m_list;
+    // published version of the list, m_snapshot_access guards the pointer only
+    SnapshotPtr m_snapshot;
+    mutable std::mutex m_snapshot_access;
     std::string m_daemon_address;
     bool m_testnet;
     mutable DaemonRpcClient m_rpc_client;
-    mutable boost::shared_mutex m_access;
+    // serializes writers; readers never take it
+    mutable boost::mutex m_write_access;
+    // announces waiting to be applied, key is public id
+    std::mutex m_announces_mutex;
+    std::unordered_map<std::string, std::shared_ptr<const supernode::request::SupernodeAnnounce>> m_queued_announces;
     std::unique_ptr<utils::ThreadPool> m_tp;
     std::atomic_size_t m_refresh_counter;
-    uint64_t m_blockchain_based_list_max_block_number;
     uint64_t m_stakes_max_block_number;
-    blockchain_based_list_map m_blockchain_based_lists;
-    std::mt19937_64 m_rng;
+    // last received stakes, updates are applied as a difference with them
+    supernode_stake_map m_stakes;
     boost::posix_time::ptime m_next_recv_stakes;
     boost::posix_time::ptime m_next_recv_blockchain_based_list;
 };
@@ -0,0 +1,107 @@
+#ifndef SIGNATUREVERIFIER_H
+#define SIGNATUREVERIFIER_H
+
+#include <crypto/crypto.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+namespace graft {
+
+/*!
+ * \brief The SignatureVerifier class - signature verification service. Pending checks from all callers are put
+ *        into a single queue, dedicated threads take them in batches and verify them in parallel.
+ *        Results are returned to the caller asynchronously through the callback.
+ */
+class SignatureVerifier
+{
+public:
+    static constexpr size_t MAX_BATCH_SIZE = 64;
+
+    struct Item
+    {
+        crypto::hash hash;
+        crypto::public_key pkey;
+        crypto::signature signature;
+    };
+
+    typedef std::vector<Item> Batch;
+    typedef std::vector<bool> Results;
+    typedef std::function<void(const Results& results)> Callback;
+
+    /*!
+     * \brief SignatureVerifier - starts verification threads
+     * \param threads           - number of threads, 0 means number of hardware CPU cores
+     */
+    explicit SignatureVerifier(size_t threads = 0);
+    ~SignatureVerifier();
+
+    SignatureVerifier(const SignatureVerifier&) = delete;
+    SignatureVerifier& operator = (const SignatureVerifier&) = delete;
+
+    /*!
+     * \brief makeItem - makes item to verify signature of the message, the message hashed the same way as Supernode::signMessage does
+     * \param msg      - message
+     * \param pkey     - signer's public key
+     * \param signature - signature
+     * \return
+     */
+    static Item makeItem(const std::string& msg, const crypto::public_key& pkey, const crypto::signature& signature);
+
+    /*!
+     * \brief verifyAsync - queues items for verification. callback is called from one of verification threads
+     *                      once all items of the batch are verified
+     * \param batch       - items to verify
+     * \param callback    - receives results in the same order as items
+     */
+    void verifyAsync(Batch batch, Callback callback);
+
+    /*!
+     * \brief verify - verifies batch using verification threads and waits for the result
+     * \param batch  - items to verify
+     * \return       - results in the same order as items
+     */
+    Results verify(Batch batch);
+
+    /*!
+     * \brief verifiedCount - total number of verified signatures
+     * \return
+     */
+    uint64_t verifiedCount() const { return m_verified; }
+
+private:
+    struct Request
+    {
+        Batch items;
+        // not std::vector<bool> since elements are written from different threads
+        std::vector<char> results;
+        std::atomic_size_t remaining;
+        Callback callback;
+    };
+
+    typedef std::pair<std::shared_ptr<Request>, size_t> PendingItem;
+
+    void run();
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<PendingItem> m_pending;
+    bool m_stop = false;
+    std::atomic<uint64_t> m_verified{0};
+    std::vector<std::thread> m_threads;
+};
+
+using SignatureVerifierPtr = boost::shared_ptr<SignatureVerifier>;
+
+} // namespace graft
+
+#endif // SIGNATUREVERIFIER_H
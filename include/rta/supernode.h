@@ -49,6 +49,13 @@ public:
 
     Supernode(const std::string &wallet_address, const crypto::public_key &id_key, const std::string &daemon_address, bool testnet = false);
 
+    /*!
+     * \brief Supernode - copies supernode; the supernode list changes copies only, supernodes of published list versions are never changed
+     * \param other     - supernode to copy
+     */
+    Supernode(const Supernode &other);
+    Supernode &operator=(const Supernode &) = delete;
+
     ~Supernode();
 
     /*!
@@ -89,19 +96,33 @@ public:
     /*!
      * \brief updateFromAnnounce - updates supernode from announce (helper to extract signed key images from graft::supernode::request::SupernodeAnnounce)
      * \param announce           - reference to graft::supernode::request::SupernodeAnnounce
+     * \param verify_signature   - false if signature of the announce is already verified by caller
      * \return                   - true on success
      */
-    bool updateFromAnnounce(const graft::supernode::request::SupernodeAnnounce& announce);
+    bool updateFromAnnounce(const graft::supernode::request::SupernodeAnnounce& announce, bool verify_signature = true);
 
     /*!
      * \brief createFromAnnounce - creates new Supernode instance from announce
      * \param announce           - announce object
      * \param testnet            - testnet flag
+     * \param verify_signature   - false if signature of the announce is already verified by caller
      * \return                   - Supernode pointer on success
      */
     static Supernode * createFromAnnounce(const graft::supernode::request::SupernodeAnnounce& announce,
                                           const std::string &daemon_address,
-                                          bool testnet);
+                                          bool testnet,
+                                          bool verify_signature = true);
+
+    /*!
+     * \brief parseAnnounce - parses id key and signature of the announce, doesn't check the signature
+     * \param announce      - announce object
+     * \param id_key        - output id key
+     * \param signature     - output signature
+     * \param msg           - output message signed by announce signature
+     * \return              - true on success
+     */
+    static bool parseAnnounce(const graft::supernode::request::SupernodeAnnounce& announce, crypto::public_key &id_key,
+                              crypto::signature &signature, std::string &msg);
 
     /*!
      * \brief createFromStake - creates new Supernode instance from a stake
@@ -233,6 +254,13 @@ public:
     const crypto::secret_key &secretKey() const;
     std::string idKeyAsString() const;
 
+    /*!
+     * \brief acceptsBinaryPayload - checks if supernode announced it decodes binary multicast/broadcast payloads
+     * \return
+     */
+    bool acceptsBinaryPayload() const { return m_accepts_binary_payload; }
+    void setAcceptsBinaryPayload(bool value) { m_accepts_binary_payload = value; }
+
 
 private:
     Supernode(bool testnet = false);
@@ -247,6 +275,7 @@ private:
     crypto::secret_key    m_secret_key;
     bool                  m_has_secret_key = false;
     std::atomic<int64_t>  m_last_update_time;
+    std::atomic<bool>     m_accepts_binary_payload{false};
     uint64_t              m_stake_amount;
     uint64_t              m_stake_block_height;
     uint64_t              m_stake_unlock_time;
@@ -23,23 +23,25 @@ static const std::string MESSAGE_RTA_CANT_BUILD_AUTH_SAMPLE("Can't build auth sa
 static const std::string MESSAGE_INVALID_TRANSACTION("Can't parse transaction");
 
 //Context Keys
-static const std::string CONTEXT_KEY_SALE_DETAILS(":saledetails");
-static const std::string CONTEXT_KEY_SALE(":sale");
-static const std::string CONTEXT_KEY_STATUS(":status");
-static const std::string CONTEXT_KEY_PAY(":pay");
+// key to map payment_id -> rta session
+static const std::string CONTEXT_KEY_RTA_SESSION(":rta_session");
+// key to map tx_id -> rta session
+static const std::string CONTEXT_KEY_RTA_SESSION_BY_TXID(":tx_id_to_rta_session");
 static const std::string CONTEXT_KEY_SUPERNODE("supernode");
 static const std::string CONTEXT_KEY_FULLSUPERNODELIST("fsl");
-// key to maintain auth responses from supernodes for given tx id
-static const std::string CONTEXT_KEY_AUTH_RESULT_BY_TXID(":tx_id_to_auth_resp");
-// key to map tx_id -> payment_id
-static const std::string CONTEXT_KEY_PAYMENT_ID_BY_TXID(":tx_id_to_payment_id");
-// key to map tx_id -> tx
-static const std::string CONTEXT_KEY_TX_BY_TXID(":tx_id_to_tx");
+// key to map payload hash -> decoded multicast/broadcast payload
+static const std::string CONTEXT_KEY_DECODED_PAYLOAD(":decoded_payload");
+// key to map tx hex hash -> decoded tx
+static const std::string CONTEXT_KEY_DECODED_TX(":decoded_tx");
+// key to map tx_id -> decoded tx
+// key to flag enabling binary multicast/broadcast payloads for the supernodes which support them
+static const std::string CONTEXT_KEY_BINARY_PAYLOADS("binary_payloads");
+// key to shared signature verification service
+static const std::string CONTEXT_KEY_SIGNATURE_VERIFIER("signature_verifier");
+// key to filter of duplicated and too frequent announces
+static const std::string CONTEXT_KEY_ANNOUNCE_FILTER("announce_filter");
 // key to store tx id in local context
 static const std::string CONTEXT_TX_ID("tx_id");
-// key to map tx_id -> amount
-static const std::string CONTEXT_KEY_AMOUNT_BY_TX_ID(":tx_id_to_amount");
-
 // key to store sale_details response coming from callback
 static const std::string CONTEXT_SALE_DETAILS_RESULT(":sale_details_result");
 
@@ -67,12 +69,6 @@ Status sendOkResponseToCryptonode(Output &output);
 
 
 bool errorFinishedPayment(int status, Output &output);
-/*!
- * \brief cleanPaySaleData - cleans any data associated with given payment id
- * \param payment_id       - payment-id
- * \param ctx              - context
- */
-void cleanPaySaleData(const std::string &payment_id, graft::Context &ctx);
 
 
 enum class RTAStatus : int
@@ -128,6 +124,7 @@ struct PayData
         ,Amount(amount)
     {
     }
+    PayData() = default;
 
     std::string Address;
     uint64_t BlockNumber;
@@ -138,7 +135,40 @@ struct PayData
  * \brief broadcastSaleStatus -  sale (pay) status helper
  * \return
  */
-void buildBroadcastSaleStatusOutput(const std::string &payment_id, int status, const SupernodePtr &supernode, Output &output);
+void buildBroadcastSaleStatusOutput(const std::string &payment_id, int status, const SupernodePtr &supernode, Output &output,
+                                    bool binary_payload = false);
+
+/*!
+ * \brief useBinaryPayload - checks if multicast/unicast payload can be sent in binary format:
+ *                           binary payloads enabled by configuration and all the receivers announced they decode it
+ * \param ctx
+ * \param receivers        - id keys of the receivers
+ * \return
+ */
+bool useBinaryPayload(Context &ctx, const std::vector<std::string> &receivers);
+
+/*!
+ * \brief useBinaryPayload - the same for broadcast, checks all known supernodes
+ * \param ctx
+ * \return
+ */
+bool useBinaryPayload(Context &ctx);
+
+/*!
+ * \brief loadPayload - serializes "data" of multicast/broadcast/unicast message in JSON_B64 or BIN_B64 format.
+ *                      receivers decode both formats with serializer::ANY_B64
+ * \param output
+ * \param payload
+ * \param binary
+ */
+template<typename T>
+void loadPayload(Output &output, const T &payload, bool binary)
+{
+    if (binary)
+        output.loadT<serializer::BIN_B64>(payload);
+    else
+        output.loadT<serializer::JSON_B64>(payload);
+}
 
 
 template<typename Response>
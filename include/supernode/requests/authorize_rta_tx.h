@@ -2,9 +2,16 @@
 #pragma once
 
 #include "lib/graft/router.h"
+#include "supernode/requestdefines.h"
 
 namespace graft::supernode::request {
 
+GRAFT_DEFINE_IO_STRUCT_INITED(SupernodeSignature,
+                              (std::string, id_key, std::string()),
+                              (std::string, result_signature, std::string()), // signarure for tx_id + result
+                              (std::string, tx_signature, std::string())      // signature for tx_id only
+                              );
+
 GRAFT_DEFINE_IO_STRUCT(AuthorizeRtaTxRequest,
                        (std::string, tx_hex),
                        (std::string, payment_id), // TODO: this should be put to tx.extra and removed from here
@@ -12,6 +19,13 @@ GRAFT_DEFINE_IO_STRUCT(AuthorizeRtaTxRequest,
                                                  // TODO: Amount needs to be protected with signature
                        );
 
+// rta auth result (vote) of auth sample member
+GRAFT_DEFINE_IO_STRUCT_INITED(AuthorizeRtaTxResponse,
+                       (std::string, tx_id, std::string()),
+                       (int, result, int(RTAAuthResult::Invalid)),
+                       (SupernodeSignature, signature, SupernodeSignature())
+                       );
+
 void registerAuthorizeRtaTxRequests(graft::Router& router);
 
 }
@@ -7,11 +7,15 @@
 
 namespace graft::supernode::request {
 
+// bits of SupernodeAnnounce::payload_formats, formats of multicast/broadcast payloads supernode can decode besides JSON
+static const uint32_t PAYLOAD_FORMAT_BINARY = 0x1;
+
 GRAFT_DEFINE_IO_STRUCT_INITED(SupernodeAnnounce,
                               (std::string, supernode_public_id, std::string()),
                               (uint64_t, height, 0),
                               (std::string, signature, std::string()),
-                              (std::string, network_address, std::string())
+                              (std::string, network_address, std::string()),
+                              (uint32_t, payload_formats, 0) // not signed, missing in announces of older supernodes
                        );
 
 
@@ -0,0 +1,162 @@
+
+#pragma once
+
+#include "supernode/requestdefines.h"
+#include "supernode/requests/authorize_rta_tx.h"
+#include "supernode/requests/sale_details.h"
+#include "lib/graft/context.h"
+
+#include <cryptonote_basic/cryptonote_basic.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace graft {
+
+class RtaSession;
+using RtaSessionPtr = std::shared_ptr<RtaSession>;
+
+/*!
+ * \brief The RtaSession class - state of a single payment: sale and pay data, transaction, auth sample votes and status.
+ *        Session is stored in the global context once per payment and indexed by payment id and by tx id,
+ *        so handler gets everything about the payment with one lookup. All the methods are thread-safe.
+ *        Session and its indexes expire in RTA_TX_TTL after the last state change, so a payment is kept while it progresses.
+ */
+class RtaSession : public std::enable_shared_from_this<RtaSession>
+{
+public:
+    using SupernodeSignature = graft::supernode::request::SupernodeSignature;
+    using SaleDetailsResponse = graft::supernode::request::SaleDetailsResponse;
+
+    explicit RtaSession(const std::string &payment_id);
+
+    /*!
+     * \brief find        - returns session for given payment id
+     * \param ctx
+     * \param payment_id
+     * \return            - session or nullptr if payment is unknown
+     */
+    static RtaSessionPtr find(Context &ctx, const std::string &payment_id);
+
+    /*!
+     * \brief findByTxId - returns session which given tx is bound to
+     * \param ctx
+     * \param tx_id
+     * \return           - session or nullptr if tx is unknown
+     */
+    static RtaSessionPtr findByTxId(Context &ctx, const std::string &tx_id);
+
+    /*!
+     * \brief getOrCreate - returns session for given payment id, creates new one if payment is unknown
+     * \param ctx
+     * \param payment_id
+     * \param created     - set to true if new session created
+     * \return
+     */
+    static RtaSessionPtr getOrCreate(Context &ctx, const std::string &payment_id, bool *created = nullptr);
+
+    /*!
+     * \brief bindTx - makes session accessible by tx id, stores tx and tx id in session
+     * \param ctx
+     * \param session
+     * \param tx_id
+     * \param tx
+     */
+    static void bindTx(Context &ctx, const RtaSessionPtr &session, const std::string &tx_id, const cryptonote::transaction &tx);
+
+    /*!
+     * \brief remove     - removes session and all its indexes from the global context
+     * \param ctx
+     * \param payment_id
+     */
+    static void remove(Context &ctx, const std::string &payment_id);
+
+    /*!
+     * \brief touch - stores session and its indexes with fresh RTA_TX_TTL, removed session is not stored again
+     * \param ctx
+     */
+    void touch(Context &ctx);
+
+    const std::string &paymentId() const { return m_payment_id; }
+
+    RTAStatus status() const;
+    /*!
+     * \brief setStatus - sets new status and extends session lifetime
+     * \param ctx
+     * \param status
+     */
+    void setStatus(Context &ctx, RTAStatus status);
+    /*!
+     * \brief updateStatus - sets new status unless current status is finite, extends session lifetime if status updated
+     * \param ctx
+     * \param status
+     * \return             - true if status updated
+     */
+    bool updateStatus(Context &ctx, RTAStatus status);
+
+    void setSale(const SaleData &sale);
+    bool sale(SaleData &sale) const;
+    bool hasSale() const;
+
+    void setSaleDetails(const std::string &details);
+    bool saleDetails(std::string &details) const;
+    bool hasSaleDetails() const;
+
+    void setPay(const PayData &pay);
+
+    /*!
+     * \brief saleDetailsResult - sale details response received from remote supernode
+     */
+    void setSaleDetailsResult(const SaleDetailsResponse &result);
+    bool saleDetailsResult(SaleDetailsResponse &result) const;
+
+    bool hasTx() const;
+    bool tx(cryptonote::transaction &tx) const;
+    std::string txId() const;
+
+    void setAmount(uint64_t amount);
+    bool amount(uint64_t &amount) const;
+
+    /*!
+     * \brief addAuthVote - stores vote of auth sample member
+     * \param signature   - signature of the member
+     * \param approved    - vote
+     * \param approved_count - number of approved votes including this one
+     * \param rejected_count - number of rejected votes including this one
+     * \return            - false if the member already voted
+     */
+    bool addAuthVote(const SupernodeSignature &signature, bool approved, size_t &approved_count, size_t &rejected_count);
+    std::vector<SupernodeSignature> approvedVotes() const;
+
+private:
+    bool votedLocked(const std::string &id_key) const;
+
+    const std::string m_payment_id;
+
+    mutable std::mutex m_mutex;
+    bool m_removed = false;
+    RTAStatus m_status = RTAStatus::None;
+
+    bool m_has_sale = false;
+    SaleData m_sale;
+    bool m_has_sale_details = false;
+    std::string m_sale_details;
+    bool m_has_sale_details_result = false;
+    SaleDetailsResponse m_sale_details_result;
+
+    bool m_has_pay = false;
+    PayData m_pay;
+
+    bool m_has_tx = false;
+    std::string m_tx_id;
+    cryptonote::transaction m_tx;
+    bool m_has_amount = false;
+    uint64_t m_amount = 0;
+
+    std::vector<SupernodeSignature> m_approved;
+    std::vector<SupernodeSignature> m_rejected;
+};
+
+}
@@ -0,0 +1,116 @@
+
+#pragma once
+
+#include "supernode/requestdefines.h"
+#include "supernode/requests/authorize_rta_tx.h"
+#include "lib/graft/context.h"
+#include "lib/graft/inout.h"
+
+#include <cryptonote_basic/cryptonote_basic.h>
+
+#include <memory>
+#include <string>
+#include <typeinfo>
+
+namespace graft {
+
+// time decoded payloads and transactions are kept in the global context
+static const std::chrono::seconds RTA_DECODE_CACHE_TTL(30);
+
+/*!
+ * \brief The DecodedTx struct - transaction decoded from hex blob together with the validation result
+ */
+struct DecodedTx
+{
+    bool valid = false;
+    std::string tx_id;
+    cryptonote::transaction tx;
+};
+
+using DecodedTxPtr = std::shared_ptr<const DecodedTx>;
+
+/*!
+ * \brief The DecodedPayload struct - inner JSON_B64 payload of multicast/broadcast message
+ */
+template<typename T>
+struct DecodedPayload
+{
+    bool valid = false;
+    T value;
+};
+
+/*!
+ * \brief The DecodedTxAuthRequest struct - RTA auth request payload with the transaction it carries
+ */
+struct DecodedTxAuthRequest
+{
+    bool valid = false;
+    supernode::request::AuthorizeRtaTxRequest request;
+    DecodedTxPtr tx;
+};
+
+using DecodedTxAuthRequestPtr = std::shared_ptr<const DecodedTxAuthRequest>;
+
+/*!
+ * \brief The RtaTxCache class - short-lived cache of decoded RTA payloads and transactions.
+ *        The same tx reaches supernode several times (multicast retries, several paths over the auth sample),
+ *        every delivery after the first one takes decoded tx from the cache and skips base64, JSON and blob parsing.
+ *        Entries are stored in the global context keyed by hash of the encoded data and expire in RTA_DECODE_CACHE_TTL.
+ *        Only successfully decoded data is cached, data which fails to decode is parsed again on every delivery.
+ *        Entries are immutable once stored, so they are safely shared between handlers.
+ */
+class RtaTxCache
+{
+public:
+    /*!
+     * \brief decodeTx - parses and validates tx from hex blob, once per RTA_DECODE_CACHE_TTL
+     * \param ctx
+     * \param tx_hex
+     * \return         - decoded tx, check "valid" before use
+     */
+    static DecodedTxPtr decodeTx(Context &ctx, const std::string &tx_hex);
+
+    /*!
+     * \brief decodeTxAuthRequest - decodes "data" of RTA auth request multicast and the tx it carries
+     * \param ctx
+     * \param data                - base64 encoded payload
+     * \return                    - decoded request, check "valid" before use
+     */
+    static DecodedTxAuthRequestPtr decodeTxAuthRequest(Context &ctx, const std::string &data);
+
+    /*!
+     * \brief decodePayload - decodes JSON_B64 payload of multicast/broadcast message, once per RTA_DECODE_CACHE_TTL
+     * \param ctx
+     * \param data          - base64 encoded payload
+     * \return              - decoded payload, check "valid" before use
+     */
+    template<typename T>
+    static std::shared_ptr<const DecodedPayload<T>> decodePayload(Context &ctx, const std::string &data)
+    {
+        using Ptr = std::shared_ptr<const DecodedPayload<T>>;
+        // the same payload can be decoded as different types, type is a part of the key
+        const std::string key = digest(data) + typeid(T).name() + CONTEXT_KEY_DECODED_PAYLOAD;
+        Ptr cached = ctx.global.get(key, Ptr());
+        if (cached)
+            return cached;
+
+        std::shared_ptr<DecodedPayload<T>> decoded = std::make_shared<DecodedPayload<T>>();
+        Input in;
+        in.load(data);
+        decoded->valid = in.getT<serializer::ANY_B64>(decoded->value);
+        // decode failures are not cached, see decodeTx
+        if (decoded->valid)
+            ctx.global.set(key, Ptr(decoded), RTA_DECODE_CACHE_TTL);
+        return decoded;
+    }
+
+    /*!
+     * \brief digest - cache key for encoded data, data is hashed with cryptographic hash
+     *                 so crafted payload can't substitute cached entry of other payload
+     * \param data
+     * \return       - hex string
+     */
+    static std::string digest(const std::string &data);
+};
+
+}
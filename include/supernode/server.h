@@ -4,6 +4,8 @@
 #include "lib/graft/serveropts.h"
 #include "lib/graft/connection.h"
 
+#include <map>
+
 namespace graftlet { class GraftletLoader; }
 namespace graft::request::system_info { class Counter; }
 
@@ -44,6 +46,7 @@ protected:
     bool ready() const { return m_connectionBaseReady && m_connectionBase->ready(); }
     void stop(bool force = false) { assert(m_connectionBase); m_connectionBase->stop(force); }
     ConnectionManager* getConMgr(const ConnectionManager::Proto& proto) { assert(m_connectionBase); return m_connectionBase->getConMgr(proto); }
+    void addConMgr(std::unique_ptr<ConnectionManager> cm) { assert(m_connectionBase); m_connectionBase->addConnectionManager(std::move(cm)); }
     Looper& getLooper() { assert(m_connectionBase); return m_connectionBase->getLooper(); }
     ConnectionBase& getConnectionBase() { assert(m_connectionBase); return *m_connectionBase; }
 private:
@@ -54,11 +57,23 @@ private:
     void serve();
     static void initSignals();
     void addGlobalCtxCleaner();
+    void addBlacklistReloader();
+    //returns true if the server should restart to apply the options which cannot be changed on the fly
+    bool reloadConfig();
     void initGraftlets();
     void initGraftletRouters();
 
     ConfigOpts& getCopts();
 
+    //to read the config file again on reload
+    int m_argc = 0;
+    const char** m_argv = nullptr;
+    bool m_logLevelFromCmdline = false;
+    //section.key -> value of the loaded config file, the changes of the options which cannot be applied on the fly are reported
+    std::map<std::string, std::string> m_configValues;
+    //the reloader stops when it is reset
+    std::shared_ptr<std::atomic_bool> m_blacklistReloaderActive;
+
     std::unique_ptr<graftlet::GraftletLoader> m_graftletLoader;
     std::atomic_bool m_connectionBaseReady{false};
     std::unique_ptr<ConnectionBase> m_connectionBase;
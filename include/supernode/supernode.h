@@ -12,6 +12,11 @@ class Supernode : public GraftServer
         std::string stake_wallet_name;
         size_t stake_wallet_refresh_interval_ms;
         double stake_wallet_refresh_interval_random_factor;
+        // send binary multicast/broadcast payloads to supernodes announced their support
+        bool binary_payloads;
+        // rate limit of announces of a supernode
+        size_t announce_min_interval_ms;
+        size_t announce_burst;
         // runtime parameters.
         // path to watch-only wallets (supernodes)
         std::string watchonly_wallets_path;
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cryptonote_basic/cryptonote_basic.h>
+
+#include <algorithm>
+#include <unordered_set>
+#include <vector>
+
+namespace graft
+{
+
+namespace walletnode
+{
+
+/// Key images of outputs spent by transfers of a batch.
+/// Transactions of a batch are not committed, so the wallet does not mark their outputs spent and may select
+/// the same outputs for several transfers of the batch. Only the first of such transfers can be sent.
+class BatchKeyImages
+{
+public:
+    /// Reserves outputs spent by the transactions of a transfer, nothing is reserved if any of them
+    /// is spent by a previous transfer. Transactions are pending transactions of the wallet or anything with tx member.
+    template<typename Transactions>
+    bool reserve(const Transactions& transactions)
+    {
+        m_key_images_of_transfer.clear();
+
+        for (const auto& transaction : transactions)
+            for (const cryptonote::txin_v& in : transaction.tx.vin)
+                if (const cryptonote::txin_to_key* in_to_key = boost::get<cryptonote::txin_to_key>(&in))
+                    m_key_images_of_transfer.push_back(in_to_key->k_image);
+
+        bool conflict = std::any_of(m_key_images_of_transfer.begin(), m_key_images_of_transfer.end(), [this](const crypto::key_image& key_image) {
+            return m_key_images.count(key_image) != 0;
+        });
+
+        if (conflict)
+            return false;
+
+        m_key_images.insert(m_key_images_of_transfer.begin(), m_key_images_of_transfer.end());
+
+        return true;
+    }
+
+private:
+    std::unordered_set<crypto::key_image> m_key_images;
+    std::vector<crypto::key_image>        m_key_images_of_transfer; // reused between transfers
+};
+
+}//namespace walletnode
+
+}//namespace graft
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "lib/graft/context.h"
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace graft
+{
+
+namespace walletnode
+{
+
+/// Shares block downloads between wallets.
+/// Wallets which are synchronized to the same block send identical getblocks.bin requests to the cryptonode.
+/// The first request is forwarded to the cryptonode, identical requests arriving meanwhile wait for its response
+/// and requests arriving shortly after get the cached response, so the same block range is downloaded once.
+/// The response is cached for a short time only: the request of a wallet at the chain tip is the same until a new block
+/// arrives, so a long lived response would hide new blocks from it.
+class SharedBlockFetcher
+{
+public:
+    using Waiter  = Context::uuid_t;
+    using Waiters = std::vector<Waiter>;
+
+    enum class Result
+    {
+      Cached, // response is ready
+      Wait,   // same request is being fetched, waiter will be resumed with its response
+      Fetch,  // caller has to fetch the response and pass it to complete()
+    };
+
+    SharedBlockFetcher(std::chrono::milliseconds cache_ttl, std::chrono::milliseconds fetch_timeout, size_t max_cached_responses);
+    SharedBlockFetcher(const SharedBlockFetcher&) = delete;
+    SharedBlockFetcher& operator = (const SharedBlockFetcher&) = delete;
+
+    /// Key of the request, requests with the same body get the same response
+    static std::string requestKey(const std::string& request_body);
+
+    /// Finds response for the request, registers waiter if the response is being fetched
+    Result acquire(const std::string& key, const Waiter& waiter, std::string& response);
+
+    /// Stores fetched response, returns waiters to resume with it
+    Waiters complete(const std::string& key, const std::string& response);
+
+    /// Drops failed fetch, returns its waiters to fetch themselves
+    Waiters abandon(const std::string& key);
+
+    /// Drops expired responses and fetches which took too long, returns waiters of dropped fetches to fetch themselves
+    Waiters expire();
+
+    /// Number of requests forwarded to the cryptonode
+    uint64_t fetchesCount() const;
+
+    /// Number of requests served with response of other request
+    uint64_t sharedCount() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+      bool              fetching = true;
+      std::string       response;
+      Clock::time_point expiration_time;
+      Waiters           waiters;
+    };
+
+    const std::chrono::milliseconds m_cache_ttl;
+    const std::chrono::milliseconds m_fetch_timeout;
+    const size_t                    m_max_cached_responses;
+
+    mutable std::mutex                     m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+    std::list<std::string>                 m_cached_keys; // keys of cached responses, oldest first
+    uint64_t                               m_fetches_count;
+    uint64_t                               m_shared_count;
+};
+
+}//namespace walletnode
+
+}//namespace graft
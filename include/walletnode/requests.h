@@ -8,11 +8,19 @@ namespace graft::walletnode {
 
 //forwards
 class WalletManager;
+class SharedBlockFetcher;
 
 namespace request {
 
 void registerWalletRequests(Router &router, WalletManager&);
 
+/// Routes of cryptonode requests of the wallets, blocks are downloaded through the shared fetcher.
+/// The routes proxy requests to the cryptonode, so they must not be served to clients of the walletnode
+void registerDaemonRequests(Router &router, SharedBlockFetcher&);
+
+/// Resumes requests waiting for shared fetches which took too long, they fetch blocks themselves
+void resumeExpiredBlockWaiters(Context& ctx, SharedBlockFetcher&);
+
 }
 
 }
@@ -37,6 +37,40 @@ GRAFT_DEFINE_IO_STRUCT(WalletPrepareTransferCallbackRequest,
 
 GRAFT_DEFINE_JSON_RPC_REQUEST(WalletPrepareTransferCallbackRequestJsonRpc, WalletPrepareTransferCallbackRequest)
 
+GRAFT_DEFINE_IO_STRUCT(WalletTransfer,
+    (std::vector<WalletTransferDestination>, Destinations)
+);
+
+GRAFT_DEFINE_IO_STRUCT(WalletPrepareTransfersRequest,
+    (std::string,                 WalletId),
+    (std::string,                 Account),
+    (std::string,                 Password),
+    (std::vector<WalletTransfer>, Transfers)
+);
+
+GRAFT_DEFINE_JSON_RPC_REQUEST(WalletPrepareTransfersRequestJsonRpc, WalletPrepareTransfersRequest)
+
+GRAFT_DEFINE_IO_STRUCT_INITED(WalletPrepareTransfersResponse,
+    (int, Result, 0)
+);
+
+GRAFT_DEFINE_JSON_RPC_REQUEST(WalletPrepareTransfersJsonRpc, WalletPrepareTransfersResponse)
+
+GRAFT_DEFINE_IO_STRUCT(WalletPreparedTransfer,
+    (int,                      Result),
+    (std::string,              Error),
+    (std::string,              Fee),
+    (std::vector<std::string>, Transactions)
+);
+
+GRAFT_DEFINE_IO_STRUCT(WalletPrepareTransfersCallbackRequest,
+    (int,                                 Result),
+    (std::string,                         Fee),
+    (std::vector<WalletPreparedTransfer>, Transfers)
+);
+
+GRAFT_DEFINE_JSON_RPC_REQUEST(WalletPrepareTransfersCallbackRequestJsonRpc, WalletPrepareTransfersCallbackRequest)
+
 }
 
 }
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "lib/graft/router.h"
+#include "lib/graft/jsonrpc.h"
+
+namespace graft {
+
+class Context;
+
+namespace walletnode::request {
+
+// only aggregate depths are reported, wallet ids are public addresses and are not disclosed to clients
+GRAFT_DEFINE_IO_STRUCT(WalletQueueStatsResponse,
+    (uint64, OutstandingOperations),
+    (uint64, MaxOutstandingOperations),
+    (uint64, MaxPendingRequests),
+    (uint64, RejectedRequests),
+    (uint64, BusyWallets),
+    (uint64, PendingRequests),
+    (uint64, PendingJobs),
+    (uint64, MaxWalletPendingJobs)
+);
+
+}
+
+}
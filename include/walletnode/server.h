@@ -28,10 +28,37 @@ private:
     void initWalletManager();
     void startPeriodicTasks();
     void setHttpRouters(ConnectionManager& httpcm);
+    void setDaemonProxyRouters();
     void registerWalletRequests(ConnectionManager& httpcm);
     void flushWalletDiskCaches();
 
-    ConfigOpts m_configOpts;
+    struct ConfigOptsEx : public ConfigOpts
+    {
+        // max number of wallets kept in memory, least recently used wallets are unloaded
+        size_t wallet_max_resident_count;
+        // time an unused wallet is kept in memory
+        size_t wallet_memory_cache_ttl_ms;
+        // interval of background refresh of resident wallets, 0 disables it
+        size_t wallet_refresh_interval_ms;
+        // max number of wallets refreshed in background at the same time
+        size_t wallet_refresh_concurrency;
+        // time to collect changes of a wallet before its cache is stored
+        size_t wallet_cache_flush_delay_ms;
+        // max bytes per second stored by background cache flushes, 0 means unlimited
+        uint64_t wallet_cache_flush_bandwidth;
+        // wallets download blocks through the walletnode, identical downloads are shared
+        bool shared_block_fetch;
+        // time block download is reused by other wallets, it is short so wallets at the chain tip see new blocks at once
+        size_t shared_block_fetch_ttl_ms;
+        // capacity of a wallet queue, rounded up to power of 2
+        size_t wallet_queue_size;
+        // client requests queued per wallet, excess requests are rejected with 429
+        size_t wallet_max_pending_requests;
+        // client requests queued for all wallets, excess requests are rejected with 429
+        size_t wallet_max_outstanding_operations;
+    };
+
+    ConfigOptsEx m_configOpts;
     std::unique_ptr<WalletManager> m_walletManager;
 };
 
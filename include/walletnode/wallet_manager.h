@@ -3,10 +3,16 @@
 #include "lib/graft/context.h"
 #include "lib/graft/task.h"
 #include "lib/graft/thread_pool/strand.hpp"
+#include "walletnode/block_fetcher.h"
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
 #include <string>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace tools
@@ -39,6 +45,19 @@ public:
     };
 
     using TransferDestinationArray = std::vector<TransferDestination>;
+    using TransferArray            = std::vector<TransferDestinationArray>;
+
+    struct QueueStats
+    {
+      size_t outstanding_operations;     // all wallets
+      size_t max_outstanding_operations;
+      size_t max_pending_requests;       // per wallet
+      size_t rejected_requests;
+      size_t busy_wallets;               // resident wallets with non-empty queues
+      size_t pending_requests;           // client requests queued or running in all wallets
+      size_t pending_jobs;               // all jobs in the wallet queues including background ones
+      size_t max_wallet_pending_jobs;    // the deepest wallet queue
+    };
 
     // Constructors / destructor
     WalletManager(TaskManager& task_manager, bool testnet = false);
@@ -46,47 +65,151 @@ public:
     WalletManager(const WalletManager&) = delete;
     WalletManager& operator = (const WalletManager&) = delete;
 
+    // Requests below return false if they are rejected because too many operations are queued already
+
     /// Create account
-    void createAccount(Context&, const std::string& password, const std::string& language, const Url& callback_url = Url());
+    bool createAccount(Context&, const std::string& password, const std::string& language, const Url& callback_url = Url());
 
     /// Restore account
-    void restoreAccount(Context&, const std::string& password, const std::string& seed, const Url& callback_url = Url());
+    bool restoreAccount(Context&, const std::string& password, const std::string& seed, const Url& callback_url = Url());
 
     /// Request balance
-    void requestBalance(Context&, const WalletId&, const std::string& account_data, const std::string& password, const Url& callback_url = Url());
+    bool requestBalance(Context&, const WalletId&, const std::string& account_data, const std::string& password, const Url& callback_url = Url());
 
     /// Prepare transfer
-    void prepareTransfer(Context&, const WalletId&, const std::string& account_data, const std::string& password, const TransferDestinationArray& destinations, const Url& callback_url = Url());
+    bool prepareTransfer(Context&, const WalletId&, const std::string& account_data, const std::string& password, const TransferDestinationArray& destinations, const Url& callback_url = Url());
+
+    /// Prepare several transfers in one wallet session, each transfer gets its own transactions.
+    /// Outputs are selected for each transfer separately, a transfer which selects outputs of a previous transfer fails
+    bool prepareTransfers(Context&, const WalletId&, const std::string& account_data, const std::string& password, const TransferArray& transfers, const Url& callback_url = Url());
+
+    /// Max number of transfers in one batch
+    static size_t maxBatchTransfers();
 
     /// Request transaction history
-    void requestTransactionHistory(Context&, const WalletId&, const std::string& account_data, const std::string& password, const Url& callback_url = Url());
+    bool requestTransactionHistory(Context&, const WalletId&, const std::string& account_data, const std::string& password, const Url& callback_url = Url());
 
     /// Flush disk caches
     void flushDiskCaches();
 
+    /// Unload wallets which were not used for a long time
+    void evictIdleWallets();
+
+    /// Number of wallets kept in memory
+    size_t residentWalletsCount() const;
+
+    /// Schedule background refresh of resident wallets which were refreshed least recently
+    void refreshResidentWallets();
+
+    /// Set limit of wallets kept in memory and time an unused wallet is kept in memory
+    void setResidencyLimits(size_t max_resident_count, std::chrono::milliseconds memory_cache_ttl);
+
+    /// Set limit of background refreshes running at the same time
+    void setMaxConcurrentRefreshes(size_t count) { m_max_concurrent_refreshes = count; }
+
+    /// Store caches of wallets which have been dirty for longer than flush delay, within flush bandwidth
+    void flushDirtyWallets();
+
+    /// Store caches of all dirty wallets regardless of delay and bandwidth, waits until they are stored
+    void flushAll();
+
+    /// Set time to collect changes of a wallet before its cache is stored
+    void setFlushDelay(std::chrono::milliseconds delay) { m_flush_delay = delay; }
+
+    /// Set limit of bytes stored per second by background flushes, 0 means unlimited
+    void setFlushBandwidth(uint64_t bytes_per_second) { m_flush_bandwidth = bytes_per_second; }
+
+    /// Share block downloads between wallets, wallets have to send their cryptonode requests to the walletnode
+    void enableSharedBlockFetch(std::chrono::milliseconds cache_ttl);
+
+    /// Shared block fetcher, nullptr if it's not enabled
+    SharedBlockFetcher* blockFetcher() { return m_block_fetcher.get(); }
+
+    /// Set size of the wallet queue (rounded up to power of 2), limit of client requests queued per wallet
+    /// and limit of operations queued for all wallets; limits apply to client requests, background jobs are not limited
+    void setQueueLimits(size_t queue_size, size_t max_pending_requests, size_t max_outstanding_operations);
+
+    /// Aggregate depths of wallet queues, no wallet is identified
+    QueueStats queueStats() const;
+
 private:
     struct WalletHolder;
     using WalletPtr = std::shared_ptr<WalletHolder>;
 
+    // Resident wallets ordered by last access, least recently used first
+    using WalletLru = std::list<WalletId>;
+
+    struct ResidentWallet
+    {
+      WalletPtr           wallet;
+      WalletLru::iterator lru_position;
+    };
+
+    struct DirtyWallet
+    {
+      WalletPtr                             wallet;
+      std::chrono::steady_clock::time_point dirty_since; // first change which is not stored yet
+    };
+
     // Creates new wallet
     WalletPtr createWallet(Context&);
 
-    // Returns wallet id in context
-    static std::string getContextWalletId(const std::string& public_address);
+    // Returns resident wallet, creates new one if wallet is not loaded
+    WalletPtr getResidentWallet(Context&, const WalletId&);
+
+    // Register wallet as resident unless the wallet is already registered, evicts least recently used wallets
+    // if there are too many of them; returns the resident wallet
+    WalletPtr registerWallet(const WalletId&, const WalletPtr&);
+
+    // Stores wallet cache if it's changed and releases wallet once its pending operations are done
+    void unloadWallet(const WalletId&, const WalletPtr&);
 
-    // Register wallet in global context
-    void registerWallet(Context&, const WalletId&, const WalletPtr&);
+    // Queues wallet cache to be stored by background flush, several changes of the wallet are stored at once
+    void scheduleFlush(const WalletId&, const WalletPtr&);
 
-    // Executes asynchronously for specific wallet
-    template <class Fn> void runAsyncForWallet(Context& context, const WalletId& wallet_id, const std::string& account_data,
+    // Posts cache store to the wallet strand, estimated_size is charged to flush bandwidth
+    void postFlush(const WalletId&, const WalletPtr&, int64_t estimated_size);
+
+    // Executes asynchronously for specific wallet, returns false if queue limit is reached;
+    // fn returns true if it changed the wallet, the wallet cache is stored then
+    template <class Fn> bool runAsyncForWallet(Context& context, const WalletId& wallet_id, const std::string& account_data,
         const std::string& password, const Url& callback_url, const Fn& fn);
-    template <class Fn> void runAsync(Context& context, const Url& callback_url, const Fn& fn);
+    template <class Fn> bool runAsync(Context& context, const Url& callback_url, const Fn& fn);
+
+    // Reserves slot of global outstanding operations limit
+    bool acquireOperation();
+    void releaseOperation();
 
     // Generate wallet cache file name from ID
     static std::string getWalletCacheFileName(const WalletId&);
 
     bool         m_testnet;
     TaskManager& m_task_manager;
+
+    mutable std::mutex                             m_wallets_mutex;
+    std::unordered_map<WalletId, ResidentWallet>   m_wallets;
+    WalletLru                                      m_wallets_lru;
+    std::atomic<size_t>                            m_max_resident_count;
+    std::atomic<std::chrono::milliseconds>         m_memory_cache_ttl;
+    std::atomic<size_t>                            m_max_concurrent_refreshes;
+    std::atomic<size_t>                            m_refreshes_in_progress;
+
+    std::mutex                                     m_flush_mutex;
+    std::condition_variable                        m_flush_done;
+    std::unordered_map<WalletId, DirtyWallet>      m_dirty_wallets;
+    size_t                                         m_flushes_in_progress;
+    std::chrono::milliseconds                      m_flush_delay;
+    std::atomic<uint64_t>                          m_flush_bandwidth;
+    int64_t                                        m_flush_budget; // bytes which can be stored now, negative if overspent
+    std::chrono::steady_clock::time_point          m_flush_budget_time;
+
+    std::unique_ptr<SharedBlockFetcher>            m_block_fetcher;
+
+    size_t                                         m_queue_size;
+    std::atomic<size_t>                            m_max_pending_requests;
+    std::atomic<size_t>                            m_max_outstanding_operations;
+    std::atomic<size_t>                            m_outstanding_operations;
+    std::atomic<size_t>                            m_rejected_requests;
 };
 
 }//namespace walletnode
@@ -0,0 +1,254 @@
+#include "lib/graft/async_logger.h"
+
+#include "misc_log_ex.h"
+
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <stdexcept>
+
+namespace graft {
+
+/*!
+ * \brief Ring - lines of a single thread waiting to be written.
+ * The logging thread is the only producer, the logger thread is the only consumer.
+ */
+class AsyncLogger::Ring
+{
+public:
+    explicit Ring(size_t size)
+    {
+        size_t capacity = 2;
+        while(capacity < size) capacity <<= 1;
+        m_slots.resize(capacity);
+        m_mask = capacity - 1;
+    }
+
+    bool push(std::string&& line)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if(tail - m_headCache == m_slots.size())
+        {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            if(tail - m_headCache == m_slots.size()) return false;
+        }
+        m_slots[tail & m_mask] = std::move(line);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    template<typename F>
+    size_t pop(F f)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        size_t count = tail - head;
+        for(; head != tail; ++head)
+        {
+            std::string& line = m_slots[head & m_mask];
+            f(line);
+            //the buffer is released by the consumer, the producer moves a new one in
+            std::string().swap(line);
+        }
+        m_head.store(head, std::memory_order_release);
+        return count;
+    }
+
+    bool empty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    //the producer thread has exited, the ring can be removed when it gets empty
+    void close() { m_closed.store(true, std::memory_order_release); }
+    bool closed() const { return m_closed.load(std::memory_order_acquire); }
+
+private:
+    std::vector<std::string> m_slots;
+    size_t m_mask;
+
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+    size_t m_headCache = 0; //producer's copy of m_head
+    std::atomic<bool> m_closed{false};
+};
+
+namespace
+{
+
+std::atomic<uint64_t> s_loggerId{0};
+
+//rings of the current thread, a thread can log into several loggers (e.g. in tests)
+struct ThreadRings
+{
+    std::vector<std::pair<uint64_t, AsyncLogger::RingPtr>> rings;
+
+    ~ThreadRings()
+    {
+        for(auto& r : rings) r.second->close();
+    }
+};
+
+thread_local ThreadRings t_rings;
+
+}
+
+constexpr std::chrono::milliseconds AsyncLogger::DRAIN_INTERVAL;
+
+AsyncLogger::AsyncLogger(const std::string& filename, bool console, size_t ringSize, size_t maxFileSize)
+    : m_id(++s_loggerId)
+    , m_filename(filename)
+    , m_console(console)
+    , m_ringSize(ringSize)
+    , m_maxFileSize(maxFileSize)
+{
+    if(!m_filename.empty())
+    {
+        m_file.open(m_filename, std::ios::out | std::ios::app | std::ios::binary);
+        if(!m_file.is_open()) throw std::runtime_error("cannot open log file " + m_filename);
+        m_file.seekp(0, std::ios::end);
+        m_fileSize = m_file.tellp();
+    }
+    m_thread = std::thread([this]{ run(); });
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+AsyncLogger::Ring& AsyncLogger::threadRing()
+{
+    for(auto& r : t_rings.rings)
+    {
+        if(r.first == m_id) return *r.second;
+    }
+
+    //first line of the thread
+    RingPtr ring = std::make_shared<Ring>(m_ringSize);
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_rings.push_back(ring);
+    }
+    t_rings.rings.emplace_back(m_id, ring);
+    return *ring;
+}
+
+bool AsyncLogger::write(std::string&& line)
+{
+    if(threadRing().push(std::move(line))) return true;
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void AsyncLogger::flush()
+{
+    std::unique_lock<std::mutex> lk(m_mutex);
+    uint64_t request = ++m_flushRequest;
+    m_cv.notify_all();
+    m_flushedCv.wait(lk, [this, request]{ return request <= m_flushDone; });
+}
+
+void AsyncLogger::run()
+{
+    std::vector<RingPtr> rings;
+    std::unique_lock<std::mutex> lk(m_mutex);
+    for(;;)
+    {
+        m_cv.wait_for(lk, DRAIN_INTERVAL, [this]{ return m_stop || m_flushDone != m_flushRequest; });
+        uint64_t request = m_flushRequest;
+        bool stop = m_stop;
+        rings = m_rings;
+        lk.unlock();
+
+        size_t count = 0;
+        for(auto& ring : rings)
+        {
+            count += ring->pop([this](const std::string& line){ output(line); });
+        }
+        if(count)
+        {
+            if(m_file.is_open()) m_file.flush();
+            if(m_console) std::cout.flush();
+            m_written.fetch_add(count, std::memory_order_relaxed);
+        }
+        rings.clear();
+
+        lk.lock();
+        //rings of exited threads which are drained
+        for(auto it = m_rings.begin(); it != m_rings.end();)
+        {
+            if((*it)->closed() && (*it)->empty())
+                it = m_rings.erase(it);
+            else
+                ++it;
+        }
+        m_flushDone = request;
+        m_flushedCv.notify_all();
+        if(stop) break;
+    }
+}
+
+void AsyncLogger::output(const std::string& line)
+{
+    if(m_console) std::cout.write(line.data(), line.size());
+    if(!m_file.is_open()) return;
+    m_file.write(line.data(), line.size());
+    m_fileSize += line.size();
+    if(m_maxFileSize && m_maxFileSize < m_fileSize) rollOver();
+}
+
+void AsyncLogger::rollOver()
+{
+    m_file.close();
+
+    std::time_t now = std::time(nullptr);
+    std::tm tm;
+    gmtime_r(&now, &tm);
+    char suffix[32];
+    std::strftime(suffix, sizeof(suffix), "-%Y-%m-%d-%H-%M-%S", &tm);
+    std::rename(m_filename.c_str(), (m_filename + suffix).c_str());
+
+    m_file.open(m_filename, std::ios::out | std::ios::trunc | std::ios::binary);
+    m_fileSize = 0;
+}
+
+namespace
+{
+
+std::shared_ptr<AsyncLogger> s_asyncLogger;
+
+class AsyncLogDispatchCallback : public el::LogDispatchCallback
+{
+protected:
+    void handle(const el::LogDispatchData* data) override
+    {
+        std::shared_ptr<AsyncLogger> logger = std::atomic_load(&s_asyncLogger);
+        if(!logger) return;
+        const el::LogMessage* msg = data->logMessage();
+        logger->write(msg->logger()->logBuilder()->build(msg, data->dispatchAction() == el::base::DispatchAction::NormalLog));
+    }
+};
+
+}
+
+void installAsyncLogger(std::shared_ptr<AsyncLogger> logger)
+{
+    std::atomic_store(&s_asyncLogger, logger);
+    if(!logger) return;
+
+    //easylogging formats the lines and calls the callback, the logger writes them out
+    el::Configurations conf = *el::Loggers::defaultConfigurations();
+    conf.setGlobally(el::ConfigurationType::ToFile, "false");
+    conf.setGlobally(el::ConfigurationType::ToStandardOutput, "false");
+    el::Loggers::setDefaultConfigurations(conf, true);
+    el::Helpers::installLogDispatchCallback<AsyncLogDispatchCallback>("graft_async_logger");
+}
+
+}//namespace graft
+
@@ -1,106 +1,177 @@
 #include "lib/graft/blacklist.h"
-#include "lib/graft/mongoosex.h"
-#include "radix_tree/radix_tree.hpp"
+#include "lib/graft/prefix_trie.h"
+#include "lib/graft/rate_limiter.h"
+#include <arpa/inet.h>
 #include <sstream>
 #include <fstream>
-#include <regex>
 #include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cctype>
+#include <cstring>
+#include <mutex>
+#include <vector>
 
 namespace graft {
 
 namespace
 {
 
-struct Window
-{
-    std::chrono::steady_clock::time_point m_tpStart;
-    int m_count;
+using Bits = PrefixTrie::Bits;
 
-    Window(std::chrono::steady_clock::time_point now, int count = 1) : m_tpStart(now), m_count(count) { }
+//a rule of the rules file, IPv4 rules are IPv4-mapped IPv6 ones
+struct Rule
+{
+    Bits prefix;
+    int len;
+    BlackList::Allow allow;
+    int line;
 };
 
-class IpMap
+Bits toBits(const IpAddress& addr)
+{
+    return (Bits(addr.hi()) << 64) | addr.lo();
+}
+
+//length of the prefix in the notation of the address, ::ffff:a.b.c.d/len is IPv6 one
+int notationBits(const char* ip)
+{
+    return std::strchr(ip, ':')? 128 : 32;
+}
+
+bool isSpace(char c)
+{
+    return std::isspace(static_cast<unsigned char>(c));
+}
+
+//The parser of the rules file. A line is
+//  {allow | deny} {<IP>[/<mask>] | all} [;; comment]
+//an IP is IPv4 or IPv6 address, the mask length is in the bits of its notation.
+class RulesParser
 {
 public:
-    IpMap(int requests_per_sec, int window_size_sec)
-        : m_requestsPerSec(requests_per_sec)
-        , m_wndSizeSec(window_size_sec)
-        , m_wndSize(std::chrono::seconds(window_size_sec))
-    { }
+    explicit RulesParser(std::ostream& warns) : m_warns(warns) { }
 
-    //return true if triggered
-    bool inc(in_addr_t addr, bool networkOrder)
+    //throws on error, the message is in warns
+    void parse(std::istream& is)
     {
-        if(networkOrder) addr = htonl(addr);
-        auto now = std::chrono::steady_clock::now();
-        auto it = m_ipwnd.find(addr);
-        bool triggered = false;
-        if(it != m_ipwnd.end())
+        std::string s;
+        for(int line = 1; ; ++line)
         {
-            while(true)
+            if(is.eof()) break;
+            std::getline(is, s);
+            if(is.fail() && !is.eof())
             {
-                Window& wnd = it->second;
-                auto tp_end = wnd.m_tpStart + m_wndSize;
-                if(tp_end + m_wndSize < now)
-                {//too old data
-                    wnd = Window(now);
-                    break;
-                }
-                if(tp_end + one_sec < now)
-                {
-                    auto secs = std::chrono::duration_cast<std::chrono::seconds>(now - tp_end);
-                    wnd.m_count -= secs.count() * m_requestsPerSec;
-                    if(wnd.m_count <= 0)
-                    {
-                        wnd = Window(now);
-                        break;
-                    }
-                    wnd.m_tpStart += std::chrono::seconds(secs.count());
-                }
-                if(m_wndSizeSec * m_requestsPerSec < ++wnd.m_count) triggered = true;
-                break;
+                m_warns << "error: reading error '" << s << "' at line " << line << '\n';
+                throw std::runtime_error("reading error");
             }
+            if(!parseLine(s, line)) break;
         }
-        else
+    }
+
+    std::vector<Rule>& rules() { return m_rules; }
+    bool terminatorFound() const { return m_terminatorFound; }
+    BlackList::Allow defaultAllow() const { return m_defaultAllow; }
+
+private:
+    //returns false if the rest of the file is to be skipped
+    bool parseLine(const std::string& s, int line)
+    {
+        const char* b = s.data();
+        const char* e = b + s.size();
+        //remove comment ;;
+        for(const char* p = b; p + 1 < e; ++p)
         {
-            auto res = m_ipwnd.emplace(std::make_pair(addr, Window(now)));
-            it = res.first;
+            if(p[0] == ';' && p[1] == ';') { e = p; break; }
         }
+        //trim
+        while(b < e && isSpace(*b)) ++b;
+        while(b < e && isSpace(e[-1])) --e;
 
-        removeItAndNeighbor(it, triggered, now);
+        if(b == e) return true;
+        if(m_terminatorFound)
+        {
+            m_warns << "warning: all rules are superseded starting from line " << line << '\n';
+            return false;
+        }
 
-        return triggered;
-    }
+        const char* p = b;
+        while(p < e && !isSpace(*p)) ++p;
+        std::string action(b, p);
+        const char* target = p;
+        while(target < e && isSpace(*target)) ++target;
+        if((action != "allow" && action != "deny") || target == p || std::find_if(target, e, isSpace) != e)
+        {
+            invalidFormat(b, e, line);
+        }
+        BlackList::Allow allow = (action == "allow");
 
-    size_t getCnt() { return m_ipwnd.size(); }
+        if(std::string(target, e) == "all")
+        {//allow|deny all
+            m_terminatorFound = true;
+            m_defaultAllow = allow;
+            return true;
+        }
 
-private:
-    using IpWnd = std::map<in_addr_t, Window>;
+        const char* slash = std::find(target, e, '/');
+        char ip[INET6_ADDRSTRLEN];
+        if(slash == target || INET6_ADDRSTRLEN <= slash - target)
+        {
+            invalidFormat(b, e, line);
+        }
+        for(const char* c = target; c < slash; ++c)
+        {
+            if(!std::isxdigit(static_cast<unsigned char>(*c)) && *c != ':' && *c != '.') invalidFormat(b, e, line);
+        }
+        std::copy(target, slash, ip);
+        ip[slash - target] = '\0';
 
-    const std::chrono::steady_clock::duration one_sec = std::chrono::seconds(1);
+        int len = -1;
+        if(slash != e)
+        {
+            const char* digits = slash + 1;
+            if(digits == e || 3 < e - digits) invalidFormat(b, e, line);
+            len = 0;
+            for(const char* c = digits; c < e; ++c)
+            {
+                if(!std::isdigit(static_cast<unsigned char>(*c))) invalidFormat(b, e, line);
+                len = len * 10 + (*c - '0');
+            }
+        }
 
-    int m_requestsPerSec;
-    int m_wndSizeSec;
-    std::chrono::steady_clock::duration m_wndSize;
-    //host order
-    IpWnd m_ipwnd;
+        addRule(allow, ip, len, line);
+        return true;
+    }
 
-    void removeItAndNeighbor(IpWnd::iterator it, bool triggered, std::chrono::steady_clock::time_point now)
+    void addRule(BlackList::Allow allow, const char* ip, int len, int line)
     {
-        //remove data if triggered, and position to neighbor
-        if(triggered)
+        IpAddress addr;
+        if(!IpAddress::parse(ip, addr))
         {
-            it = m_ipwnd.erase(it);
+            m_warns << "error: invalid address " << ip << " at line " << line << '\n';
+            throw std::runtime_error("invalid address error; addRule");
         }
-        else ++it;
-        if(it == m_ipwnd.end()) it = m_ipwnd.begin();
-
-        if(it != m_ipwnd.end())
-        {//remove neighbor if old
-            Window& wnd = it->second;
-            if(wnd.m_tpStart + m_wndSize + m_wndSize <= now) m_ipwnd.erase(it);
+        int bits = notationBits(ip);
+        if(len < 0) len = bits;
+        if(len == 0 || bits < len)
+        {
+            m_warns << "error: invalid mask length " << len << " at line " << line << '\n';
+            throw std::runtime_error("invalid mask");
         }
+        m_rules.push_back(Rule{toBits(addr), len + 128 - bits, allow, line});
     }
+
+    [[noreturn]] void invalidFormat(const char* b, const char* e, int line)
+    {
+        m_warns << "error: invalid rule format '" << std::string(b, e) << "' at line " << line << '\n';
+        throw std::runtime_error("invalid rule");
+    }
+
+    std::ostream& m_warns;
+    std::vector<Rule> m_rules;
+    bool m_terminatorFound = false;
+    BlackList::Allow m_defaultAllow = true;
 };
 
 } // namespace
@@ -109,187 +180,156 @@ class BlackListImpl : public BlackListTest
 {
 public:
     BlackListImpl(int requests_per_sec, int window_size_sec, int ban_ip_sec)
-        : banEnabled(requests_per_sec != 0)
-        , m_ipmap(requests_per_sec, window_size_sec)
-        , m_banTimeout(std::chrono::seconds(ban_ip_sec))
+        : m_rules(std::make_shared<RuleSet>())
+        , m_limiter(makeLimiter(requests_per_sec, window_size_sec, ban_ip_sec))
     { }
 
     virtual ~BlackListImpl() override = default;
 
-    //radix table entry
-    struct RtEntry
+private:
+    struct RuleSet
     {
-        //host order
-        in_addr_t m_addr = 0;
-        int m_prefixLen = 0;
-
-        //
-        in_addr_t operator [] (int n) const
-        {
-            return (m_addr & (0x80000000 >> n))? 1 : 0;
-        }
-
-        bool operator == (const RtEntry &rhs) const
-        {
-            return m_prefixLen == rhs.m_prefixLen && m_addr == rhs.m_addr;
-        }
-
-        bool operator< (const RtEntry &rhs) const
-        {
-            if (m_addr == rhs.m_addr)
-                return m_prefixLen < rhs.m_prefixLen;
-            else
-                return m_addr < rhs.m_addr;
-        }
+        PrefixTrie table;
+        Allow defaultAllow = true;
     };
 
-private:
-    using Table = radix_tree<RtEntry, Allow>;
-
-    Table m_table;
-    Allow m_defaultAllow = true;
-    std::ostringstream m_warns;
+    //the rules are replaced as a whole, so a lookup sees either the old or the new ones
+    std::shared_ptr<RuleSet> m_rules;
+    //serializes loading of the rules
+    std::mutex m_loadMutex;
+    std::string m_warns;
 
-    bool banEnabled;
-    IpMap m_ipmap;
-    std::chrono::steady_clock::duration m_banTimeout;
-    std::deque< std::pair<std::chrono::steady_clock::time_point, in_addr_t> > m_bannedIPs;
+    //connections per IP, bans are kept by the limiter and do not touch the rules
+    std::unique_ptr<RateLimiter> m_limiter;
+    //sorted by prefix length, longest first
+    std::vector<std::pair<std::string, std::unique_ptr<RateLimiter>>> m_routeLimits;
 
-    void unban()
+    std::shared_ptr<RuleSet> rules() const
     {
-        auto now = std::chrono::steady_clock::now();
-        while(!m_bannedIPs.empty())
-        {
-            auto& item = m_bannedIPs.front();
-            if(now < item.first) break;
-            removeEntry(item.second, false);
-            m_bannedIPs.pop_front();
-        }
+        return std::atomic_load(&m_rules);
     }
 
-    void ban(in_addr_t addr)
+    static std::unique_ptr<RateLimiter> makeLimiter(int requests_per_sec, int window_size_sec, int ban_ip_sec)
     {
-        addEntry(addr, false, false, 32);
-
-        if(m_banTimeout.count() == 0) return;
-        m_bannedIPs.emplace_back( std::make_pair(
-                                      std::chrono::steady_clock::now() + m_banTimeout,
-                                      addr ) );
+        return std::make_unique<RateLimiter>(requests_per_sec, size_t(requests_per_sec) * window_size_sec,
+                    (ban_ip_sec == 0)? RateLimiter::BanForever : std::chrono::seconds(ban_ip_sec));
     }
 
-    void addRule(Allow allow, const char* ip, int len, int line)
+    //the key of the limiters, an IPv6 host usually owns a whole /64 network
+    static RateLimiter::Key limiterKey(const IpAddress& addr)
     {
-        assert(0 < len && len <= 32);
-        in_addr addr;
-        if(inet_aton(ip, &addr) == 0)
-        {
-            m_warns << "error: invalid address " << ip << " at line " << line << '\n';
-            throw std::runtime_error("invalid address error; addRule");
-        }
-        addr.s_addr = ntohl(addr.s_addr);
-
-        in_addr_t mask = -1;
-        if(len < 32)
-        {
-            mask = ~((1 << (32 - len)) - 1);
-        }
-        addr.s_addr &= mask;
+        return addr.isV4()? addr.lo() : addr.hi();
+    }
 
-        if(find(addr.s_addr, false).first)
+    static IpAddress parseIp(const char* ip)
+    {
+        IpAddress addr;
+        if(!IpAddress::parse(ip, addr))
         {
-            m_warns << "warning: the rule at line " << line << " is superceded by one of previous rule\n";
-            return;
+            std::stringstream ss;
+            ss << "invalid address " << ip;
+            throw std::runtime_error(ss.str());
         }
+        return addr;
+    }
 
-        RtEntry entry{addr.s_addr, len};
-        m_table.insert(std::make_pair(entry,allow));
+    //len is the prefix length in bits of notation, -1 means the whole address
+    static int tableLen(int len, int bits)
+    {
+        if(len < 0) len = bits;
+        assert(0 < len && len <= bits);
+        return len + 128 - bits;
     }
+
 public:
-    virtual bool processIp(in_addr_t addr, bool networkOrder = true) override
+    using BlackList::processIp;
+
+    virtual bool processIp(const IpAddress& addr) override
     {
-        if(banEnabled && m_banTimeout.count() != 0)
-        {
-            unban();
-        }
+        if(!find(addr).second) return false;
 
-        if(networkOrder) addr = ntohl(addr);
-        if(!find(addr, false).second) return false;
+        return m_limiter->check(limiterKey(addr)) == RateLimiter::Result::Allowed;
+    }
 
-        if(!banEnabled) return true;
+    virtual void setLimits(int requests_per_sec, int window_size_sec, int ban_ip_sec) override
+    {
+        m_limiter = makeLimiter(requests_per_sec, window_size_sec, ban_ip_sec);
+    }
 
-        bool triggered = m_ipmap.inc( addr, false);
-        if(triggered)
+    virtual void addRouteLimit(const std::string& prefix, int requests_per_sec, int burst) override
+    {
+        assert(0 < requests_per_sec);
+        if(burst <= 0) burst = requests_per_sec;
+        auto it = std::find_if(m_routeLimits.begin(), m_routeLimits.end(),
+                               [&prefix](const auto& item){ return item.first.size() <= prefix.size(); });
+        m_routeLimits.emplace(it, prefix, std::make_unique<RateLimiter>(requests_per_sec, burst));
+    }
+
+    virtual bool processRequest(const IpAddress& addr, const std::string& path) override
+    {
+        for(auto& item : m_routeLimits)
         {
-            ban(addr);
-            return false;
+            if(path.compare(0, item.first.size(), item.first) != 0) continue;
+            return item.second->check(limiterKey(addr)) == RateLimiter::Result::Allowed;
         }
         return true;
     }
 
+    virtual void removeRouteLimits() override
+    {
+        m_routeLimits.clear();
+    }
+
     virtual std::string getWarnings() override
     {
-        return m_warns.str();
+        std::lock_guard<std::mutex> lk(m_loadMutex);
+        return m_warns;
     }
 
+    virtual size_t rulesCount() override
+    {
+        return rules()->table.size();
+    }
+
+    //the entries are changed in place, it is not synchronized with lookups
     virtual void addEntry(const char* ip, int len, Allow allow) override
     {
-        assert(0<len && len<=32);
-        in_addr addr;
-        int res = inet_aton(ip,&addr);
-        assert(res);
-        addEntry(addr.s_addr, true, allow, len);
+        m_rules->table.insert(toBits(parseIp(ip)), tableLen(len, notationBits(ip)), allow);
     }
     virtual void addEntry(in_addr_t addr, bool networkOrder, Allow allow, int len) override
     {
-        assert(0<len && len<=32);
-        if(networkOrder) addr = ntohl(addr);
-        RtEntry entry{ addr, len };
-        m_table.insert(std::make_pair(entry,allow));
+        m_rules->table.insert(toBits(IpAddress::fromV4(addr, networkOrder)), tableLen(len, 32), allow);
     }
 
     virtual void removeEntry(const char* ip) override
     {
-        in_addr addr;
-        int res = inet_aton(ip,&addr);
-        assert(res);
-        removeEntry(addr.s_addr, true);
+        m_rules->table.erase(toBits(parseIp(ip)), tableLen(-1, notationBits(ip)));
     }
 
     virtual void removeEntry(in_addr_t addr, bool networkOrder = true) override
     {
-        if(networkOrder) addr = ntohl(addr);
+        m_rules->table.erase(toBits(IpAddress::fromV4(addr, networkOrder)), 128);
+    }
 
-        RtEntry entry{ addr, 32 };
-        m_table.erase(entry);
+    virtual std::pair<bool, Allow> find(const IpAddress& addr) override
+    {
+        std::shared_ptr<RuleSet> rs = rules();
+        int res = rs->table.longestMatch(toBits(addr));
+        if(res == -1) return std::make_pair(false, rs->defaultAllow);
+        return std::make_pair(true, Allow(res));
     }
 
     virtual std::pair<bool, Allow> find(in_addr_t addr, bool networkOrder) override
     {
-        if(networkOrder) addr = ntohl(addr);
-
-        RtEntry entry{addr, 32};
-
-        Table::iterator it = m_table.longest_match(entry);
-        if (it == m_table.end())
-        {
-            return std::make_pair(false, m_defaultAllow);
-        }
-        return std::make_pair(true, it->second);
+        return find(IpAddress::fromV4(addr, networkOrder));
     }
 
     virtual std::pair<bool, Allow> find(const char* ip) override
     {
-        in_addr addr;
-        if(!inet_aton(ip, &addr))
-        {
-            std::stringstream ss;
-            ss << "invalid address " << ip << " in find()";
-            throw std::runtime_error(ss.str());
-        }
-        return find(addr.s_addr, true);
+        return find(parseIp(ip));
     }
 
-    virtual void readRules(const char* filepath)
+    virtual void readRules(const char* filepath) override
     {
         std::ifstream ifs(filepath);
         if(!ifs.is_open())
@@ -303,78 +343,47 @@ public:
 
     virtual void readRules(std::istream& is) override
     {
-        m_warns.clear();
-        m_table.clear();
-        bool terminator_found = false;
-        for(int line = 1; ; ++line)
+        std::lock_guard<std::mutex> lk(m_loadMutex);
+        std::ostringstream warns;
+        try
         {
-            if(is.eof()) break;
-            std::string s;
-            std::getline(is, s);
-            if(is.fail() && !is.eof())
-            {
-                m_warns << "error: reading error '" << s << "' at line " << line << '\n';
-                throw std::runtime_error("reading error");
-            }
-
-            {//remove comment ;;
-                std::regex r(R"(^\s*(.*?);;.*(\r)?$)");
-                s = std::regex_replace(s, r, "$1");
-            }
-            {//trim
-                std::regex r(R"(^\s*(.*?)\s*(\r)?$)");
-                s = std::regex_replace(s, r, "$1");
-            }
-
-            if(s.empty()) continue;
-            if(terminator_found)
-            {
-                m_warns << "warning: all rules are superseded starting from line " << line << '\n';
-                break;
-            }
-            std::regex regex(R"(^(allow|deny)\s+(all|((\d{1,3}\.\d{1,3}\.\d{1,3}\.\d{1,3})(/(\d{1,2}))?))$)");
-            std::smatch m;
-            if(!std::regex_match(s, m, regex))
+            RulesParser parser(warns);
+            parser.parse(is);
+
+            auto rs = std::make_shared<RuleSet>();
+            rs->defaultAllow = parser.defaultAllow();
+            std::vector<Rule>& rules = parser.rules();
+            rs->table.reserve(rules.size());
+            for(const Rule& rule : rules)
             {
-                m_warns << "error: invalid rule format '" << s << "' at line " << line << '\n';
-                throw std::runtime_error("invalid rule");
-            }
-            assert(2 < m.size());
-            assert(m[1] == "allow" || m[1] == "deny");
-            bool allow = (m[1] == "allow")? true : false;
-            if(m[2] == "all")
-            {//allow|deny all
-                terminator_found = true;
-                m_defaultAllow = allow;
-            }
-            else
-            {
-                assert(4 < m.size());
-                std::string ip = m[4];
-                int prefix_len = 32;
-                if(6 < m.size() && m[6].matched)
+                //the rules are stacked, a rule within a prefix of a previous one never matches
+                if(rs->table.longestMatch(rule.prefix, rule.len) != -1)
                 {
-                    prefix_len = std::stoi(m[6]);
-                    if(prefix_len == 0 || 32 < prefix_len)
-                    {
-                        m_warns << "error: invalid mask length " << prefix_len << " at line " << line << '\n';
-                        throw std::runtime_error("invalid mask");
-                    }
+                    warns << "warning: the rule at line " << rule.line << " is superceded by one of previous rule\n";
+                    continue;
                 }
-                addRule(allow, ip.c_str(), prefix_len, line);
+                rs->table.insert(rule.prefix, rule.len, rule.allow);
             }
+
+            std::atomic_store(&m_rules, rs);
         }
+        catch(...)
+        {
+            m_warns = warns.str();
+            throw;
+        }
+        m_warns = warns.str();
     }
 
     //for testing
     virtual bool active(in_addr_t addr) override
     {
-        return m_ipmap.inc(addr, false);
+        return m_limiter->check(limiterKey(IpAddress::fromV4(addr, false))) != RateLimiter::Result::Allowed;
     }
 
     virtual size_t activeCnt() override
     {
-        return m_ipmap.getCnt();
+        return m_limiter->size();
     }
 };
 
@@ -389,37 +398,3 @@ std::unique_ptr<BlackListTest> BlackListTest::Create(int requests_per_sec, int w
 }
 
 } //namespace graft
-
-template<>
-inline int radix_length<graft::BlackListImpl::RtEntry>(const graft::BlackListImpl::RtEntry &entry)
-{
-    return entry.m_prefixLen;
-}
-
-template<>
-inline graft::BlackListImpl::RtEntry radix_substr<graft::BlackListImpl::RtEntry>(const graft::BlackListImpl::RtEntry &entry, int begin, int num)
-{
-    assert(num + begin <= 32);
-    in_addr_t mask;
-    if (num == 32) mask = 0;
-    else mask = 1 << num;
-    mask  -= 1;
-    mask <<= 32 - num - begin;
-
-    graft::BlackListImpl::RtEntry res;
-    res.m_addr = (entry.m_addr & mask) << begin;
-    res.m_prefixLen = num;
-    return res;
-}
-
-template<>
-inline graft::BlackListImpl::RtEntry radix_join(const graft::BlackListImpl::RtEntry& entry1, const graft::BlackListImpl::RtEntry& entry2)
-{
-    graft::BlackListImpl::RtEntry res;
-
-    res.m_addr = entry1.m_addr;
-    res.m_addr |= entry2.m_addr >> entry1.m_prefixLen;
-    res.m_prefixLen  = entry1.m_prefixLen + entry2.m_prefixLen;
-
-    return res;
-}
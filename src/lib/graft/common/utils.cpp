@@ -1,7 +1,18 @@
 #include "utils/utils.h"
+#include "lib/graft/common/utils.h"
 #include <locale>            // epee::string_coding uses std::locale but misses include
 #include <string_coding.h>
 
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <libgen.h>
+#include <unistd.h>
+
 
 namespace graft {
 namespace utils {
@@ -16,5 +27,59 @@ std::string base64_encode(const std::string &data)
     return epee::string_encoding::base64_encode(data);
 }
 
+namespace {
+
+void syncPath(const std::string& path, int flags)
+{
+    int fd = ::open(path.c_str(), flags);
+    if (fd < 0)
+        throw std::runtime_error("cannot open '" + path + "': " + std::strerror(errno));
+    int res = ::fsync(fd);
+    int err = errno;
+    ::close(fd);
+    if (res != 0)
+        throw std::runtime_error("cannot sync '" + path + "': " + std::strerror(err));
+}
+
+std::string dirName(const std::string& file_name)
+{
+    std::string path = file_name; // dirname modifies its argument
+    return ::dirname(&path[0]);
+}
+
+}
+
+void storeFileAtomically(const std::string& file_name, const std::function<void(const std::string& tmp_file_name)>& store)
+{
+    // unique name, so concurrent stores of the same file never write the same temporary file
+    std::string tmp_file_name = file_name + ".tmp.XXXXXX";
+    int fd = ::mkstemp(&tmp_file_name[0]);
+    if (fd < 0)
+        throw std::runtime_error("cannot create temporary file for '" + file_name + "': " + std::strerror(errno));
+    ::close(fd);
+
+    try
+    {
+        store(tmp_file_name);
+        // data must reach the disk before rename, otherwise file_name can be empty after power loss
+        syncPath(tmp_file_name, O_RDONLY);
+    }
+    catch (...)
+    {
+        std::remove(tmp_file_name.c_str());
+        throw;
+    }
+
+    if (std::rename(tmp_file_name.c_str(), file_name.c_str()) != 0)
+    {
+        int err = errno;
+        std::remove(tmp_file_name.c_str());
+        throw std::runtime_error("cannot rename '" + tmp_file_name + "' to '" + file_name + "': " + std::strerror(err));
+    }
+
+    // persists the rename itself
+    syncPath(dirName(file_name), O_RDONLY | O_DIRECTORY);
+}
+
 }
 }
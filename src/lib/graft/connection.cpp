@@ -12,15 +12,18 @@ namespace graft {
 std::string client_addr(mg_connection* client)
 {
     if(!client) return "disconnected";
+    IpAddress addr = IpAddress::fromSockaddr(&client->sa.sa);
     std::ostringstream oss;
-    oss << inet_ntoa(client->sa.sin.sin_addr) << ':' << ntohs(client->sa.sin.sin_port);
+    //a dual-stack listener reports IPv4 clients as AF_INET6 ones, sin_port and sin6_port share the offset
+    if(addr.isV4()) oss << addr.toString() << ':' << ntohs(client->sa.sin.sin_port);
+    else oss << '[' << addr.toString() << "]:" << ntohs(client->sa.sin6.sin6_port);
     return oss.str();
 }
 
 std::string client_host(mg_connection* client)
 {
     if(!client) return "disconnected";
-    return inet_ntoa(client->sa.sin.sin_addr);
+    return IpAddress::fromSockaddr(&client->sa.sa).toString();
 }
 
 void* getUserData(mg_mgr* mgr) { return mgr->user_data; }
@@ -225,6 +228,11 @@ void ConnectionBase::loadBlacklist(const ConfigOpts& copts)
                 ipfilter.window_size_sec,
                 ipfilter.ban_ip_sec);
 
+    for(auto& limit : ipfilter.route_limits)
+    {
+        m_blackList->addRouteLimit(limit.prefix, limit.requests_per_sec, limit.burst);
+    }
+
     if(!ipfilter.rules_filename.empty())
     {
         LOG_PRINT_L1("Loading blacklist from file " << ipfilter.rules_filename);
@@ -249,6 +257,77 @@ void ConnectionBase::loadBlacklist(const ConfigOpts& copts)
     }
 }
 
+bool ConnectionBase::reloadBlacklistRules(const std::string& filename)
+{
+    assert(m_blackList);
+    LOG_PRINT_L1("Reloading blacklist from file " << filename);
+    std::string error;
+    try
+    {
+        m_blackList->readRules(filename.c_str());
+    }
+    catch(std::exception& e)
+    {
+        error = e.what();
+    }
+    std::string warns = m_blackList->getWarnings();
+    if(!warns.empty())
+    {
+        LOG_PRINT_L1("Blacklist warnings :\n" << warns);
+    }
+    if(!error.empty())
+    {
+        LOG_PRINT_L0("Cannot reload blacklist, '" << error << "', the previous rules are kept");
+        return false;
+    }
+    LOG_PRINT_L1("Blacklist reloaded, " << m_blackList->rulesCount() << " rules");
+    return true;
+}
+
+void ConnectionBase::reconfigure(const ConfigOpts& copts)
+{
+    assert(m_blackList);
+    const IPFilterOpts& cur = getCopts().ipfilter;
+    const IPFilterOpts& ipfilter = copts.ipfilter;
+
+    if(cur.requests_per_sec != ipfilter.requests_per_sec
+            || cur.window_size_sec != ipfilter.window_size_sec
+            || cur.ban_ip_sec != ipfilter.ban_ip_sec)
+    {
+        LOG_PRINT_L1("Blacklist limits changed, current bans are dropped");
+        m_blackList->setLimits(ipfilter.requests_per_sec, ipfilter.window_size_sec, ipfilter.ban_ip_sec);
+    }
+
+    auto sameLimit = [](const RouteLimitOpts& a, const RouteLimitOpts& b)
+    {
+        return a.prefix == b.prefix && a.requests_per_sec == b.requests_per_sec && a.burst == b.burst;
+    };
+    if(!std::equal(cur.route_limits.begin(), cur.route_limits.end(),
+                   ipfilter.route_limits.begin(), ipfilter.route_limits.end(), sameLimit))
+    {
+        LOG_PRINT_L1("Route limits changed");
+        m_blackList->removeRouteLimits();
+        for(auto& limit : ipfilter.route_limits)
+        {
+            m_blackList->addRouteLimit(limit.prefix, limit.requests_per_sec, limit.burst);
+        }
+    }
+
+    //the rules file is read again even if its name is the same
+    if(!ipfilter.rules_filename.empty())
+    {
+        reloadBlacklistRules(ipfilter.rules_filename);
+    }
+    else if(!cur.rules_filename.empty())
+    {
+        std::istringstream none;
+        m_blackList->readRules(none);
+        LOG_PRINT_L1("Blacklist rules removed");
+    }
+
+    getLooper().reconfigure(copts);
+}
+
 void ConnectionBase::setSysInfoCounter(std::unique_ptr<SysInfoCounter>& counter)
 {
     assert(!m_sysInfo);
@@ -285,6 +364,12 @@ void ConnectionBase::initConnectionManagers()
     assert(res2.second);
 }
 
+void ConnectionBase::addConnectionManager(std::unique_ptr<ConnectionManager> cm)
+{
+    auto res = m_conManagers.emplace(cm->getProto(), std::move(cm));
+    assert(res.second);
+}
+
 void ConnectionBase::bindConnectionManagers()
 {
     for(auto& it : m_conManagers)
@@ -341,9 +426,14 @@ void Looper::serve()
         }
         getTimerList().eval();
         checkUpstreamBlockingIO();
+        checkUpstreamAsyncIO();
         checkPeriodicTaskIO();
+        checkResumeTaskIO();
         executePostponedTasks();
         expelWorkers();
+        publishRuntimeSnapshot();
+        if(m_reload.exchange(false) && m_reloadHandler && !stopped()) m_reloadHandler();
+        reconfigureIdle();
         if( stopped() && canStop() ) break;
     }
 
@@ -403,16 +493,21 @@ void HttpConnectionManager::bind(Looper& looper)
     mg_mgr* mgr = looper.getMgMgr();
 
     const ConfigOpts& opts = looper.getCopts();
+    const std::string& address = m_address.empty()? opts.http_address : m_address;
 
-    mg_connection *nc_http = mg_bind(mgr, opts.http_address.c_str(), ev_handler_http);
+    mg_connection *nc_http = mg_bind(mgr, address.c_str(), ev_handler_http);
     if(!nc_http)
     {
         std::ostringstream oss;
-        oss << "Cannot bind to " << opts.http_address << ". Please check if the address is valid and the port is not used.";
+        oss << "Cannot bind to " << address << ". Please check if the address is valid and the port is not used.";
         throw exit_error(oss.str());
     }
     nc_http->user_data = this;
     mg_set_protocol_http_websocket(nc_http);
+
+    char buf[128];
+    mg_conn_addr_to_str(nc_http, buf, sizeof(buf), MG_SOCK_STRINGIFY_IP | MG_SOCK_STRINGIFY_PORT);
+    m_boundAddress = buf;
 }
 
 void CoapConnectionManager::bind(Looper& looper)
@@ -485,22 +580,32 @@ void HttpConnectionManager::ev_handler_http(mg_connection *client, int ev, void
         int method = translateMethod(hm->method.p, hm->method.len);
         if (method < 0) return;
 
-        const sockaddr_in& remote_address = client->sa.sin;
-        uint16_t remote_port = static_cast<uint16_t>(remote_address.sin_port);
-        char remote_address_host_str[INET_ADDRSTRLEN];
-        if (!inet_ntop(AF_INET, &(remote_address.sin_addr), remote_address_host_str, sizeof remote_address_host_str))
-            *remote_address_host_str = '\0';
+        const IpAddress remote_address = IpAddress::fromSockaddr(&client->sa.sa);
+        uint16_t remote_port = static_cast<uint16_t>(client->sa.sin.sin_port);
+        std::string remote_address_host_str = remote_address.toString();
 
         std::string s_method(hm->method.p, hm->method.len);
         LOG_PRINT_CLN(1,client,"New HTTP client. uri:" << std::string(hm->uri.p, hm->uri.len) << " method:" << s_method
             << " remote: " << remote_address_host_str << ":" << remote_port);
 
         HttpConnectionManager* httpcm = HttpConnectionManager::from_accepted(client);
+        Tracer::Clock::time_point acceptTime;
+        if(conBase->getLooper().tracer().enabled()) acceptTime = Tracer::Clock::now();
         Router::JobParams prms;
         if (httpcm->matchRoute(uri, method, prms))
         {
             conBase->getLooper().runtimeSysInfo().count_http_request_routed();
 
+            if(!conBase->getBlackList().processRequest(remote_address, uri))
+            {
+                conBase->getLooper().runtimeSysInfo().count_http_resp_status_busy();
+
+                LOG_PRINT_CLN(2,client,"Route limit exceeded; closing connection");
+                mg_http_send_error(client, 429, "Too Many Requests");
+                client->flags |= MG_F_SEND_AND_CLOSE;
+                break;
+            }
+
             mg_str& body = hm->body;
             prms.input = Input(*hm, client_host(client));
 
@@ -514,6 +619,13 @@ void HttpConnectionManager::ev_handler_http(mg_connection *client, int ev, void
             client->user_data = ptr;
             client->handler = static_ev_handler<ClientTask>;
 
+            if(ptr->isTraced())
+            {
+                Tracer& tracer = conBase->getLooper().tracer();
+                tracer.instant(ptr->getCtx().getId(), "accept", acceptTime, s_method + ' ' + uri);
+                tracer.span(ptr->getCtx().getId(), "route_match", acceptTime, ptr->getCreateTime(), *prms.endpoint);
+            }
+
             conBase->getLooper().onNewClient(ptr->getSelf());
         }
         else
@@ -535,7 +647,7 @@ void HttpConnectionManager::ev_handler_http(mg_connection *client, int ev, void
             break;
         }
 
-        if(!conBase->getBlackList().processIp( client->sa.sin.sin_addr.s_addr ))
+        if(!conBase->getBlackList().processIp( IpAddress::fromSockaddr(&client->sa.sa) ))
         {
             LOG_PRINT_CLN(2,client,"The address is in the black-list; closing connection");
             client->flags |= MG_F_CLOSE_IMMEDIATELY;
@@ -646,6 +758,7 @@ void ConnectionManager::respond(ClientTask* ct, const std::string& s)
         case Status::InternalError:
         case Status::Error:           { code = 500; rsi.count_http_resp_status_error(); } break;
         case Status::Busy:            { code = 503; rsi.count_http_resp_status_busy(); }  break;
+        case Status::TooManyRequests: { code = 429; rsi.count_http_resp_status_busy(); }  break;
         case Status::Drop:            { code = 400; rsi.count_http_resp_status_drop(); }  break;
         default:                      assert(false);                                      break;
     }
@@ -654,7 +767,12 @@ void ConnectionManager::respond(ClientTask* ct, const std::string& s)
     LOG_PRINT_CLN(2, client, "Reply to client: " << s);
     if(Status::Ok == ctx.local.getLastStatus())
     {
-        mg_send_head(client, code, s.size(), "Content-Type: application/json\r\nConnection: close");
+        //a handler can set its own headers of a successful response, like Content-Type of non-JSON body
+        const std::string& extra_headers = ct->getOutput().extra_headers;
+        if(extra_headers.empty())
+            mg_send_head(client, code, s.size(), "Content-Type: application/json\r\nConnection: close");
+        else
+            mg_send_head(client, code, s.size(), (extra_headers + "Connection: close").c_str());
         mg_send(client, s.c_str(), s.size());
         rsi.count_http_resp_bytes_raw(s.size());
     }
@@ -0,0 +1,75 @@
+#include "lib/graft/ip_address.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace graft {
+
+namespace
+{
+
+constexpr uint64_t v4Mapped = uint64_t(0xffff) << 32;
+
+}
+
+IpAddress IpAddress::fromV4(in_addr_t addr, bool networkOrder)
+{
+    if(networkOrder) addr = ntohl(addr);
+    return IpAddress(0, v4Mapped | addr);
+}
+
+IpAddress IpAddress::fromV6(const uint8_t* bytes)
+{
+    uint64_t hi = 0, lo = 0;
+    for(int i = 0; i < 8; ++i) hi = (hi << 8) | bytes[i];
+    for(int i = 8; i < 16; ++i) lo = (lo << 8) | bytes[i];
+    return IpAddress(hi, lo);
+}
+
+IpAddress IpAddress::fromSockaddr(const sockaddr* sa)
+{
+    switch(sa->sa_family)
+    {
+    case AF_INET: return fromV4(reinterpret_cast<const sockaddr_in*>(sa)->sin_addr.s_addr);
+    case AF_INET6: return fromV6(reinterpret_cast<const sockaddr_in6*>(sa)->sin6_addr.s6_addr);
+    default: return IpAddress();
+    }
+}
+
+bool IpAddress::parse(const char* str, IpAddress& addr)
+{
+    in_addr addr4;
+    if(inet_pton(AF_INET, str, &addr4) == 1)
+    {
+        addr = fromV4(addr4.s_addr);
+        return true;
+    }
+    in6_addr addr6;
+    if(inet_pton(AF_INET6, str, &addr6) == 1)
+    {
+        addr = fromV6(addr6.s6_addr);
+        return true;
+    }
+    return false;
+}
+
+std::string IpAddress::toString() const
+{
+    char buf[INET6_ADDRSTRLEN];
+    if(isV4())
+    {
+        in_addr addr4;
+        addr4.s_addr = htonl(v4());
+        return inet_ntop(AF_INET, &addr4, buf, sizeof(buf));
+    }
+    in6_addr addr6;
+    for(int i = 0; i < 8; ++i)
+    {
+        addr6.s6_addr[i] = static_cast<uint8_t>(m_hi >> (56 - 8 * i));
+        addr6.s6_addr[8 + i] = static_cast<uint8_t>(m_lo >> (56 - 8 * i));
+    }
+    return inet_ntop(AF_INET6, &addr6, buf, sizeof(buf));
+}
+
+} //namespace graft
@@ -1,47 +1,96 @@
 
 #include "lib/graft/log.h"
 
+#include <cstdint>
+#include <cstring>
+
 namespace graft
 {
 
-std::string make_dump_output(const std::string& in, int trunc_size)
+namespace
+{
+
+struct DumpTable
 {
-    static char mask[0x100];
-    static std::string val[0x100];
-    static bool inited = false;
-    if(!inited)
+    //escape sequence of each character, empty for printable ones
+    char esc[0x100][5];
+    unsigned char len[0x100];
+
+    DumpTable()
     {
-        inited = true;
         for(int i=0; i<0x100; ++i)
         {
             int i1 = i/16, i2 = i%16;
-            char ch1 = (i1<10)? ('0'+i1) : ('A'+i1-10);
-            char ch2 = (i2<10)? ('0'+i2) : ('A'+i2-10);
-            val[i] = std::string("\\x") + ch1 + ch2;
+            char* e = esc[i];
+            e[0] = '\\'; e[1] = 'x';
+            e[2] = (i1<10)? ('0'+i1) : ('A'+i1-10);
+            e[3] = (i2<10)? ('0'+i2) : ('A'+i2-10);
+            len[i] = 4;
         }
-        val['\t'] = "\\t"; val['\r'] = "\\r"; val['\n'] = "\\n";
-
-        for(int i=0; i<0x100; ++i) mask[i] = 2;
-        mask['\t'] = 1; mask['\r'] = 1; mask['\n'] = 1;
-        for(int i=0x20; i<0x7F; ++i) mask[i] = 0;
+        std::memcpy(esc['\t'], "\\t", 2); len['\t'] = 2;
+        std::memcpy(esc['\r'], "\\r", 2); len['\r'] = 2;
+        std::memcpy(esc['\n'], "\\n", 2); len['\n'] = 2;
+        for(int i=0x20; i<0x7F; ++i) len[i] = 0;
     }
+};
+
+constexpr uint64_t ONES = ~uint64_t(0) / 255;
+constexpr uint64_t HIGHS = ONES * 0x80;
+
+//true if all 8 characters are in [0x20, 0x7E]
+inline bool allPrintable(const char* p)
+{
+    uint64_t w;
+    std::memcpy(&w, p, sizeof(w));
+    uint64_t less = (w - ONES * 0x20) & ~w & HIGHS;     //some byte < 0x20
+    uint64_t more = ((w + ONES * (0x7F - 0x7E)) | w) & HIGHS; //some byte > 0x7E
+    return !(less | more);
+}
+
+inline bool printable(unsigned char ch)
+{
+    return 0x20 <= ch && ch < 0x7F;
+}
+
+}
+
+std::string make_dump_output(const std::string& in, int trunc_size)
+{
+    static const DumpTable table;
 
     std::string res;
-    bool bin_found = false;
-    for(auto it = in.begin(), eit = in.end(); it !=eit; ++it)
+    res.reserve((0 <= trunc_size && size_t(trunc_size) < in.size())? trunc_size + 8 : in.size());
+
+    const char* p = in.data();
+    const char* end = p + in.size();
+    while(p != end)
     {
-        int ch = (unsigned char)*it;
-        if(mask[ch]==2) bin_found = true;
-        if(mask[ch]==0)
-        {
-            res += ch;
-        }
-        else
+        //printable characters are copied by runs, a run is found 8 bytes at a time
+        const char* run = p;
+        while(8 <= end - p && allPrintable(p)) p += 8;
+        while(p != end && printable(*p)) ++p;
+
+        if(run != p)
         {
-            res += val[ch];
+            size_t count = p - run;
+            if(0 <= trunc_size)
+            {
+                //at least one character is written before the size is checked
+                size_t left = (res.size() < size_t(trunc_size))? trunc_size - res.size() : 1;
+                if(left <= count)
+                {
+                    res.append(run, left);
+                    res += "...";
+                    return res;
+                }
+            }
+            res.append(run, count);
+            if(p == end) break;
         }
-//        if(bin_found && hint_len < res.size())
-        if(0<=trunc_size && trunc_size <= res.size())
+
+        unsigned char ch = *p++;
+        res.append(table.esc[ch], table.len[ch]);
+        if(0 <= trunc_size && size_t(trunc_size) <= res.size())
         {
             res += "...";
             break;
@@ -51,4 +100,3 @@ std::string make_dump_output(const std::string& in, int trunc_size)
 }
 
 }//namespace graft
-
@@ -0,0 +1,197 @@
+
+#include "lib/graft/metrics_request.h"
+
+#include "lib/graft/context.h"
+#include "lib/graft/handler_api.h"
+#include "lib/graft/inout.h"
+#include "lib/graft/router.h"
+#include "lib/graft/sys_info.h"
+
+#include <sstream>
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "supernode.metrics"
+
+namespace graft::request::metrics {
+
+using namespace graft::request::system_info;
+
+namespace
+{
+
+const char* CONTENT_TYPE = "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n";
+
+std::string escapeLabel(const std::string& value)
+{
+    std::string res;
+    res.reserve(value.size());
+    for(char c : value)
+    {
+        switch(c)
+        {
+        case '\\': res += "\\\\"; break;
+        case '"': res += "\\\""; break;
+        case '\n': res += "\\n"; break;
+        default: res += c; break;
+        }
+    }
+    return res;
+}
+
+class Writer
+{
+public:
+    explicit Writer(std::ostringstream& os) : m_os(os) { }
+
+    void family(const char* name, const char* type, const char* help)
+    {
+        m_os << "# HELP " << name << ' ' << help << '\n';
+        m_os << "# TYPE " << name << ' ' << type << '\n';
+    }
+
+    template<typename T>
+    void sample(const std::string& name, T value, const std::string& labels = std::string())
+    {
+        m_os << name;
+        if(!labels.empty()) m_os << '{' << labels << '}';
+        m_os << ' ' << value << '\n';
+    }
+
+    template<typename T>
+    void single(const char* name, const char* type, const char* help, T value)
+    {
+        family(name, type, help);
+        sample(name, value);
+    }
+
+    // latencies are recorded in microseconds, Prometheus convention is seconds
+    void summary(const char* name, const std::string& labels, const LatencyHistogram& histogram)
+    {
+        const std::string prefix = labels.empty() ? std::string() : labels + ',';
+        for(double q : {0.5, 0.9, 0.99, 0.999})
+        {
+            std::ostringstream ql;
+            ql << prefix << "quantile=\"" << q << '"';
+            sample(name, histogram.percentile(q) / 1e6, ql.str());
+        }
+        sample(std::string(name) + "_sum", histogram.sum() / 1e6, labels);
+        sample(std::string(name) + "_count", histogram.count(), labels);
+    }
+
+private:
+    std::ostringstream& m_os;
+};
+
+std::string label(const char* name, const std::string& value)
+{
+    return std::string(name) + "=\"" + escapeLabel(value) + '"';
+}
+
+void renderCounters(const Counter& c, Writer& w)
+{
+    w.single("graft_http_requests_total", "counter", "HTTP requests received.", c.http_request_total_cnt());
+    w.single("graft_http_requests_routed_total", "counter", "HTTP requests matched to a route.", c.http_request_routed_cnt());
+    w.single("graft_http_requests_unrouted_total", "counter", "HTTP requests not matched to any route.", c.http_request_unrouted_cnt());
+
+    w.family("graft_http_responses_total", "counter", "HTTP responses by status.");
+    w.sample("graft_http_responses_total", c.http_resp_status_ok_cnt(), label("status", "ok"));
+    w.sample("graft_http_responses_total", c.http_resp_status_error_cnt(), label("status", "error"));
+    w.sample("graft_http_responses_total", c.http_resp_status_drop_cnt(), label("status", "drop"));
+    w.sample("graft_http_responses_total", c.http_resp_status_busy_cnt(), label("status", "busy"));
+
+    w.single("graft_http_request_bytes_total", "counter", "Raw bytes of HTTP requests.", c.http_req_bytes_raw_cnt());
+    w.single("graft_http_response_bytes_total", "counter", "Raw bytes of HTTP responses.", c.http_resp_bytes_raw_cnt());
+
+    w.single("graft_upstream_requests_total", "counter", "Requests sent to upstreams.", c.upstrm_http_req_cnt());
+    w.family("graft_upstream_responses_total", "counter", "Upstream responses by result.");
+    w.sample("graft_upstream_responses_total", c.upstrm_http_resp_ok_cnt(), label("result", "ok"));
+    w.sample("graft_upstream_responses_total", c.upstrm_http_resp_err_cnt(), label("result", "error"));
+    w.single("graft_upstream_request_bytes_total", "counter", "Raw bytes of upstream requests.", c.upstrm_http_req_bytes_raw_cnt());
+    w.single("graft_upstream_response_bytes_total", "counter", "Raw bytes of upstream responses.", c.upstrm_http_resp_bytes_raw_cnt());
+
+    w.single("graft_uptime_seconds", "gauge", "Time since the server start.", c.system_uptime_sec());
+}
+
+void renderLatencies(const Counter& c, Writer& w)
+{
+    w.family("graft_route_latency_seconds", "summary", "Time from request to response by route.");
+    c.route_latency().for_each([&w](const std::string& name, const LatencyHistogram& histogram)
+    {
+        w.summary("graft_route_latency_seconds", label("route", name), histogram);
+    });
+
+    w.family("graft_stage_latency_seconds", "summary", "Duration of task stages.");
+    for(int i = 0; i < static_cast<int>(Counter::Stage::Count); ++i)
+    {
+        auto stage = static_cast<Counter::Stage>(i);
+        w.summary("graft_stage_latency_seconds", label("stage", Counter::stage_name(stage)), c.stage_latency(stage));
+    }
+
+    w.family("graft_upstream_latency_seconds", "summary", "Duration of upstream requests by upstream.");
+    c.upstream_latency().for_each([&w](const std::string& name, const LatencyHistogram& histogram)
+    {
+        w.summary("graft_upstream_latency_seconds", label("upstream", name), histogram);
+    });
+}
+
+void renderSnapshot(const RuntimeSnapshot& s, Writer& w)
+{
+    w.single("graft_thread_pool_jobs", "gauge", "Jobs posted to the thread pool and not processed yet.", s.thread_pool_jobs);
+    w.single("graft_thread_pool_capacity", "gauge", "Max number of jobs in the thread pool.", s.thread_pool_capacity);
+    w.single("graft_thread_pool_active_workers", "gauge", "Active worker threads.", s.thread_pool_active_workers);
+    w.single("graft_thread_pool_expelled_workers", "gauge", "Expelled worker threads.", s.thread_pool_expelled_workers);
+    w.single("graft_postponed_tasks", "gauge", "Tasks waiting to be resumed.", s.postponed_tasks);
+    w.single("graft_tasks_ready_to_resume", "gauge", "Resumed tasks waiting for execution.", s.tasks_ready_to_resume);
+    w.single("graft_global_context_entries", "gauge", "Entries of the global context.", s.global_context_entries);
+
+    w.family("graft_upstream_connections", "gauge", "Kept alive upstream connections by state.");
+    for(auto& u : s.upstreams)
+    {
+        w.sample("graft_upstream_connections", u.idle_connections, label("upstream", u.name) + ',' + label("state", "idle"));
+        w.sample("graft_upstream_connections", u.active_connections, label("upstream", u.name) + ',' + label("state", "active"));
+    }
+    w.family("graft_upstream_max_connections", "gauge", "Max upstream connections, 0 means unlimited.");
+    for(auto& u : s.upstreams)
+    {
+        w.sample("graft_upstream_max_connections", u.max_connections, label("upstream", u.name));
+    }
+    w.family("graft_upstream_queued_tasks", "gauge", "Tasks waiting for a free upstream connection.");
+    for(auto& u : s.upstreams)
+    {
+        w.sample("graft_upstream_queued_tasks", u.queued_tasks, label("upstream", u.name));
+    }
+}
+
+Status handler(const Router::vars_t& vars, const graft::Input& input, graft::Context& ctx, graft::Output& output)
+{
+    output.body = render(ctx.handlerAPI()->runtimeSysInfo());
+    output.extra_headers = CONTENT_TYPE;
+    return Status::Ok;
+}
+
+}
+
+std::string render(const Counter& counter)
+{
+    std::ostringstream os;
+    os.precision(12);
+    Writer w(os);
+
+    renderCounters(counter, w);
+    renderLatencies(counter, w);
+
+    // the snapshot appears after the first iteration of the IO thread
+    RuntimeSnapshotPtr snapshot = counter.runtime_snapshot();
+    if(snapshot) renderSnapshot(*snapshot, w);
+
+    return os.str();
+}
+
+void register_request(Router& router)
+{
+    Router::Handler3 h3(nullptr, handler, nullptr);
+    router.addRoute("/metrics", METHOD_GET, h3);
+}
+
+}
+
@@ -0,0 +1,107 @@
+#include "lib/graft/prefix_trie.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace graft {
+
+PrefixTrie::PrefixTrie()
+{
+    //the root is the empty prefix
+    addNode(0, 0, -1);
+}
+
+int32_t PrefixTrie::addNode(Bits prefix, int len, int8_t value)
+{
+    m_nodes.push_back(Node{mask(prefix, len), len, {-1, -1}, value});
+    return static_cast<int32_t>(m_nodes.size() - 1);
+}
+
+int PrefixTrie::commonLen(Bits a, Bits b, int max)
+{
+    Bits diff = a ^ b;
+    uint64_t hi = static_cast<uint64_t>(diff >> 64);
+    uint64_t lo = static_cast<uint64_t>(diff);
+    int len = hi? __builtin_clzll(hi) : lo? 64 + __builtin_clzll(lo) : 128;
+    return std::min(len, max);
+}
+
+bool PrefixTrie::insert(Bits prefix, int len, bool value)
+{
+    assert(0 <= len && len <= 128);
+    prefix = mask(prefix, len);
+    int32_t cur = 0;
+    while(true)
+    {
+        //the prefix of cur is a prefix of the inserted one
+        if(m_nodes[cur].len == len)
+        {
+            if(m_nodes[cur].value != -1) return false;
+            m_nodes[cur].value = value;
+            ++m_size;
+            return true;
+        }
+        int bit = bitAt(prefix, m_nodes[cur].len);
+        int32_t next = m_nodes[cur].child[bit];
+        if(next == -1)
+        {
+            int32_t leaf = addNode(prefix, len, value);
+            m_nodes[cur].child[bit] = leaf;
+            ++m_size;
+            return true;
+        }
+        int common = commonLen(m_nodes[next].prefix, prefix, std::min(m_nodes[next].len, len));
+        if(common == m_nodes[next].len)
+        {
+            cur = next;
+            continue;
+        }
+        //split the edge to next
+        int32_t middle = addNode(prefix, common, (common == len)? value : -1);
+        m_nodes[middle].child[bitAt(m_nodes[next].prefix, common)] = next;
+        if(common != len)
+        {
+            int32_t leaf = addNode(prefix, len, value);
+            m_nodes[middle].child[bitAt(prefix, common)] = leaf;
+        }
+        m_nodes[cur].child[bit] = middle;
+        ++m_size;
+        return true;
+    }
+}
+
+bool PrefixTrie::erase(Bits prefix, int len)
+{
+    prefix = mask(prefix, len);
+    int32_t cur = 0;
+    while(m_nodes[cur].len < len)
+    {
+        cur = m_nodes[cur].child[bitAt(prefix, m_nodes[cur].len)];
+        if(cur == -1 || len < m_nodes[cur].len || commonLen(m_nodes[cur].prefix, prefix, m_nodes[cur].len) < m_nodes[cur].len)
+            return false;
+    }
+    if(m_nodes[cur].value == -1) return false;
+    //the node is left in place, erase is rare
+    m_nodes[cur].value = -1;
+    --m_size;
+    return true;
+}
+
+int PrefixTrie::longestMatch(Bits addr, int len) const
+{
+    int res = -1;
+    int32_t cur = 0;
+    while(true)
+    {
+        const Node& node = m_nodes[cur];
+        if(node.value != -1) res = node.value;
+        if(len <= node.len) break;
+        cur = node.child[bitAt(addr, node.len)];
+        if(cur == -1) break;
+        const Node& next = m_nodes[cur];
+        if(len < next.len || commonLen(next.prefix, addr, next.len) < next.len) break;
+    }
+    return res;
+}
+
+} //namespace graft
@@ -0,0 +1,99 @@
+#include "lib/graft/rate_limiter.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace graft {
+
+constexpr RateLimiter::Clock::duration RateLimiter::NoBan;
+constexpr RateLimiter::Clock::duration RateLimiter::BanForever;
+
+RateLimiter::RateLimiter(double requests_per_sec, size_t burst, Clock::duration ban_time, size_t shards)
+    : m_interval(Clock::duration::zero())
+    , m_capacity(Clock::duration::zero())
+    , m_banTime(ban_time)
+{
+    if(0 < requests_per_sec)
+    {
+        m_interval = std::max(Clock::duration(1), std::chrono::duration_cast<Clock::duration>(
+                                  std::chrono::duration<double>(1.0 / requests_per_sec)));
+        m_capacity = m_interval * std::max<size_t>(burst, 1);
+    }
+
+    int bits = 0;
+    while((size_t(1) << bits) < std::max<size_t>(shards, 1)) ++bits;
+    m_shardShift = 64 - bits;
+    m_shardCount = size_t(1) << bits;
+    m_shards = std::make_unique<Shard[]>(m_shardCount);
+}
+
+RateLimiter::Result RateLimiter::check(Key key, Clock::time_point now)
+{
+    if(!enabled()) return Result::Allowed;
+
+    Shard& shard = shardOf(key);
+    std::lock_guard<std::mutex> lk(shard.mutex);
+
+    auto it = shard.index.find(key);
+    if(it == shard.index.end())
+    {
+        shard.lru.push_front(Bucket{key, now, Clock::time_point()});
+        shard.index.emplace(key, shard.lru.begin());
+    }
+    else
+    {
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    }
+
+    Result res = take(shard.lru.front(), now);
+    //the bucket just taken is never evicted, it is either not full or banned
+    evict(shard, now);
+    return res;
+}
+
+RateLimiter::Result RateLimiter::take(Bucket& bucket, Clock::time_point now)
+{
+    if(now < bucket.banned_until) return Result::Banned;
+
+    Clock::time_point full_at = std::max(bucket.full_at, now);
+    if(m_capacity < full_at + m_interval - now)
+    {
+        if(m_banTime == NoBan) return Result::Limited;
+        bucket.banned_until = (m_banTime == BanForever)? Clock::time_point::max() : now + m_banTime;
+        //the bucket is full when the ban expires
+        bucket.full_at = now;
+        return Result::Banned;
+    }
+    bucket.full_at = full_at + m_interval;
+    return Result::Allowed;
+}
+
+void RateLimiter::evict(Shard& shard, Clock::time_point now)
+{
+    //a couple of buckets per check is enough to keep up with the new ones
+    for(int i = 0; i < 2 && !shard.lru.empty(); ++i)
+    {
+        Bucket& tail = shard.lru.back();
+        if(now < tail.banned_until)
+        {//keep the ban, let the next bucket be checked next time
+            shard.lru.splice(shard.lru.begin(), shard.lru, std::prev(shard.lru.end()));
+            continue;
+        }
+        if(now < tail.full_at) break;
+        shard.index.erase(tail.key);
+        shard.lru.pop_back();
+    }
+}
+
+size_t RateLimiter::size() const
+{
+    size_t res = 0;
+    for(size_t i = 0; i < m_shardCount; ++i)
+    {
+        std::lock_guard<std::mutex> lk(m_shards[i].mutex);
+        res += m_shards[i].lru.size();
+    }
+    return res;
+}
+
+} //namespace graft
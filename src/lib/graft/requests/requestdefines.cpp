@@ -15,4 +15,15 @@ Status errorInvalidParams(Output& output)
     return Status::Error;
 }
 
+Status errorTooManyRequests(Output& output)
+{
+    JsonRpcError err;
+    err.code = ERROR_TOO_MANY_REQUESTS;
+    err.message = MESSAGE_TOO_MANY_REQUESTS;
+    JsonRpcErrorResponse resp;
+    resp.error = err;
+    output.load(resp);
+    return Status::TooManyRequests;
+}
+
 }
@@ -44,7 +44,9 @@ bool RouterT<In,Out>::Root::match(const std::string& target, int method, JobPara
                 std::move(std::string(entry->vars.tokens.entries[i].base, entry->vars.tokens.entries[i].len))
             ));
 
-        params.h3 = static_cast<Route*>(m->data)->h3;
+        Route* route = static_cast<Route*>(m->data);
+        params.h3 = route->h3;
+        params.endpoint = &route->endpoint;
         ret = true;
     }
     match_entry_free(entry);
@@ -1,8 +1,85 @@
 
 #include "lib/graft/sys_info.h"
 
+#include <algorithm>
+
 namespace graft::request::system_info {
 
+LatencyHistogram::LatencyHistogram(void)
+: m_count(0)
+, m_sum(0)
+, m_max(0)
+{
+    for(auto& bucket : m_buckets) bucket.store(0, std::memory_order_relaxed);
+}
+
+u64 LatencyHistogram::bucket_upper_bound(int index)
+{
+    if(index < SUB_BUCKETS) return index;
+    const int shift = index / SUB_BUCKETS - 1;
+    const u64 lower = u64(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    return lower + (u64(1) << shift) - 1;
+}
+
+u64 LatencyHistogram::percentile(double q) const
+{
+    const u64 total = count();
+    if(total == 0) return 0;
+
+    q = std::min(std::max(q, 0.0), 1.0);
+    const u64 rank = std::max<u64>(1, static_cast<u64>(q * total + 0.5));
+
+    // buckets are updated concurrently, so the total is recomputed from the buckets themselves
+    u64 seen = 0;
+    for(int i = 0; i < BUCKETS; ++i)
+    {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if(rank <= seen) return std::min(bucket_upper_bound(i), max());
+    }
+    return max();
+}
+
+LatencyHistogramSet::LatencyHistogramSet(void)
+: m_overflow(OVERFLOW_NAME)
+{
+    for(auto& entry : m_entries) entry.store(nullptr, std::memory_order_relaxed);
+}
+
+LatencyHistogramSet::~LatencyHistogramSet(void)
+{
+    for(auto& entry : m_entries) delete entry.load(std::memory_order_relaxed);
+}
+
+LatencyHistogram& LatencyHistogramSet::get(const std::string& name)
+{
+    const size_t hash = std::hash<std::string>()(name);
+    for(int probe = 0; probe < CAPACITY; ++probe)
+    {
+        std::atomic<Entry*>& slot = m_entries[(hash + probe) % CAPACITY];
+        Entry* entry = slot.load(std::memory_order_acquire);
+        if(!entry)
+        {
+            Entry* created = new Entry(name);
+            if(slot.compare_exchange_strong(entry, created, std::memory_order_acq_rel))
+                return created->histogram;
+            // another thread has taken the slot, entry is its value now
+            delete created;
+        }
+        if(entry->name == name) return entry->histogram;
+    }
+    return m_overflow.histogram;
+}
+
+void LatencyHistogramSet::for_each(const std::function<void (const std::string& name, const LatencyHistogram& histogram)>& f) const
+{
+    for(auto& slot : m_entries)
+    {
+        const Entry* entry = slot.load(std::memory_order_acquire);
+        if(entry) f(entry->name, entry->histogram);
+    }
+    if(m_overflow.histogram.count()) f(m_overflow.name, m_overflow.histogram);
+}
+
 Counter::Counter(void)
 : m_http_req_total_cnt(0)
 , m_http_req_routed_cnt(0)
@@ -26,5 +103,17 @@ Counter::~Counter(void)
 {
 }
 
+const char* Counter::stage_name(Stage stage)
+{
+    switch(stage)
+    {
+    case Stage::PreAction: return "pre_action";
+    case Stage::QueueWait: return "queue_wait";
+    case Stage::WorkerAction: return "worker_action";
+    case Stage::PostAction: return "post_action";
+    default: return "unknown";
+    }
+}
+
 }
 
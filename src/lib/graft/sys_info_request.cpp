@@ -17,6 +17,44 @@ using Input = graft::Input;
 using Ctx = graft::Context;
 using Output = graft::Output;
 
+namespace
+{
+
+LatencyStats latencyStats(const std::string& name, const LatencyHistogram& histogram)
+{
+    LatencyStats stats;
+    stats.name = name;
+    stats.count = histogram.count();
+    stats.avg_us = stats.count ? histogram.sum() / stats.count : 0;
+    stats.p50_us = histogram.percentile(0.5);
+    stats.p90_us = histogram.percentile(0.9);
+    stats.p99_us = histogram.percentile(0.99);
+    stats.p999_us = histogram.percentile(0.999);
+    stats.max_us = histogram.max();
+    return stats;
+}
+
+void fillLatency(const Counter& rsi, Latency& latency)
+{
+    rsi.route_latency().for_each([&latency](const std::string& name, const LatencyHistogram& histogram)
+    {
+        latency.routes.push_back(latencyStats(name, histogram));
+    });
+
+    for(int i = 0; i < static_cast<int>(Counter::Stage::Count); ++i)
+    {
+        auto stage = static_cast<Counter::Stage>(i);
+        latency.stages.push_back(latencyStats(Counter::stage_name(stage), rsi.stage_latency(stage)));
+    }
+
+    rsi.upstream_latency().for_each([&latency](const std::string& name, const LatencyHistogram& histogram)
+    {
+        latency.upstreams.push_back(latencyStats(name, histogram));
+    });
+}
+
+}
+
 Status handler(const Vars& vars, const Input& input, Ctx& ctx, Output& output)
 {
     auto& rsi = ctx.handlerAPI()->runtimeSysInfo();
@@ -45,6 +83,8 @@ Status handler(const Vars& vars, const Input& input, Ctx& ctx, Output& output)
 
     ri.uptime_sec = rsi.system_uptime_sec();
 
+    fillLatency(rsi, out.latency);
+
     auto& cfg = out.configuration;
     const ConfigOpts& co = ctx.handlerAPI()->configOpts();
 
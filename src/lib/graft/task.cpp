@@ -15,6 +15,33 @@ namespace graft {
 
 thread_local bool TaskManager::io_thread = false;
 
+namespace
+{
+
+uint64_t elapsedUs(BaseTask::Clock::time_point from, BaseTask::Clock::time_point to = BaseTask::Clock::now())
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
+
+//log category of the handler for the current thread, it is restored on exceptions too;
+//handlers without a name keep the default category and the thread_local string is not touched
+class LogCategoryScope
+{
+public:
+    explicit LogCategoryScope(const std::string& category) : m_set(!category.empty())
+    {
+        if(m_set) mlog_current_log_category = category;
+    }
+    ~LogCategoryScope()
+    {
+        if(m_set) mlog_current_log_category.clear();
+    }
+private:
+    bool m_set;
+};
+
+}
+
 void StateMachine::process(BaseTaskPtr bt)
 {
     static const char *state_strs[] = { GRAFT_STATE_LIST(EXP_TO_STR) };
@@ -49,9 +76,11 @@ void StateMachine::process(BaseTaskPtr bt)
         State prev_state = m_state;
         m_state = std::get<smStateEnd>(r);
 
-        mlog_current_log_category = "sm";
-        LOG_PRINT_RQS_BT(3,bt, "sm: " << state_strs[int(prev_state)] << "->" << state_strs[int(m_state)] );
-        mlog_current_log_category.clear();
+        if(GRAFT_LOG_COMPILED(3))
+        {
+            LogCategoryScope logCategory("sm");
+            LOG_PRINT_RQS_BT(3,bt, "sm: " << state_strs[int(prev_state)] << "->" << state_strs[int(m_state)] );
+        }
 
         return;
     }
@@ -99,6 +128,7 @@ void StateMachine::init_table()
     {
         assert(St::Error == bt->getLastStatus() ||
                St::InternalError == bt->getLastStatus() ||
+               St::TooManyRequests == bt->getLastStatus() ||
                St::Stop == bt->getLastStatus());
         bt->getManager().respondAndDie(bt, bt->getOutput().data());
     };
@@ -153,7 +183,7 @@ void StateMachine::init_table()
         {CHK_PRE_ACTION,        {St::Again},    PRE_ACTION,         nullptr,            run_response },
         {CHK_PRE_ACTION,        {St::Ok},       WORKER_ACTION,      has(&H3::pre_action), nullptr },
         {CHK_PRE_ACTION,        {St::Forward},  POST_ACTION,        has(&H3::pre_action), nullptr },
-        {CHK_PRE_ACTION,        {St::Error, St::InternalError, St::Stop},
+        {CHK_PRE_ACTION,        {St::Error, St::InternalError, St::TooManyRequests, St::Stop},
                                                 EXIT,               has(&H3::pre_action), run_error_response },
         {CHK_PRE_ACTION,        {St::Drop},     EXIT,               has(&H3::pre_action), run_drop },
         {CHK_PRE_ACTION,        {St::None, St::Ok, St::Forward, St::Postpone},
@@ -168,7 +198,7 @@ void StateMachine::init_table()
         {CHK_POST_ACTION,       {St::Again},    POST_ACTION,        nullptr,            run_response },
         {CHK_POST_ACTION,       {St::Forward},  EXIT,               nullptr,            run_forward },
         {CHK_POST_ACTION,       {St::Ok},       EXIT,               nullptr,            run_ok_response },
-        {CHK_POST_ACTION,       {St::Error, St::InternalError, St::Stop},
+        {CHK_POST_ACTION,       {St::Error, St::InternalError, St::TooManyRequests, St::Stop},
                                                 EXIT,               nullptr,            run_error_response },
         {CHK_POST_ACTION,       {St::Drop},     EXIT,               nullptr,            run_drop },
         {CHK_POST_ACTION,       {St::Postpone}, EXIT,               nullptr,            run_postpone },
@@ -184,7 +214,7 @@ public:
     Uuid_Input() = default;
     Uuid_Input(const Context::uuid_t& uuid) { first = uuid; }
     Uuid_Input(const Context::uuid_t& uuid, const Input& input) { first = uuid; second = std::make_shared<Input>(input); }
-    Uuid_Input(const Context::uuid_t& uuid, Input&& input) { first = uuid; second = std::make_shared<Input>(input); }
+    Uuid_Input(const Context::uuid_t& uuid, Input&& input) { first = uuid; second = std::make_shared<Input>(std::move(input)); }
     Uuid_Input(Context::uuid_t&& uuid) { first = std::move(uuid); }
     Uuid_Input(const Uuid_Input& ui) { *this = ui; }
     Uuid_Input& operator = (const Uuid_Input& ui) { first = ui.first; second = ui.second; return *this; }
@@ -244,6 +274,43 @@ public:
 
         createUpstreamSender(connItem, bt);
     }
+
+    void getStats(std::vector<request::system_info::RuntimeSnapshot::Upstream>& stats) const
+    {
+        auto add = [&stats](const ConnItem& connItem)
+        {
+            request::system_info::RuntimeSnapshot::Upstream item;
+            item.name = connItem.m_name;
+            item.max_connections = connItem.m_maxConnections;
+            item.idle_connections = connItem.m_idleConnections.size();
+            //connections are tracked for keep-alive upstreams only
+            item.active_connections = connItem.m_activeConnections.size();
+            item.queued_tasks = connItem.m_taskQueue.size();
+            stats.emplace_back(std::move(item));
+        };
+
+        add(m_default);
+        for(auto& it : m_conn2item)
+        {
+            add(it.second);
+        }
+    }
+
+    //closes idle keep-alive connections, it is called when the manager is replaced and before it is destroyed
+    void closeIdleConnections()
+    {
+        for(auto& it : m_conn2item)
+        {
+            ConnItem& connItem = it.second;
+            for(auto& idle : connItem.m_idleConnections)
+            {
+                mg_connection* upstream = idle.first;
+                upstream->flags |= MG_F_CLOSE_IMMEDIATELY;
+                upstream->handler = static_empty_ev_handler;
+            }
+            connItem.m_idleConnections.clear();
+        }
+    }
 private:
     uint64_t m_cntUpstreamSender = 0;
     uint64_t m_cntUpstreamSenderDone = 0;
@@ -330,6 +397,8 @@ private:
         std::map<mg_connection*, ConnectionId> m_idleConnections;
         std::map<ConnectionId, mg_connection*> m_activeConnections;
         UpstreamStub m_upstreamStub;
+        std::string m_name;
+        request::system_info::LatencyHistogram* m_latency = nullptr;
     };
 
     void onDone(UpstreamSender& uss, ConnItem* connItem, ConnItem::ConnectionId connectionId, mg_connection* client)
@@ -347,6 +416,8 @@ private:
         int uriId = 0;
         const ConfigOpts& opts = m_manager.getCopts();
         m_default = ConnItem(uriId++, opts.cryptonode_rpc_address.c_str(), 0, false, opts.upstream_request_timeout);
+        m_default.m_name = opts.cryptonode_rpc_address;
+        m_default.m_latency = &m_manager.runtimeSysInfo().upstream_latency(m_default.m_name);
 
         for(auto& subs : OutHttp::uri_substitutions)
         {
@@ -355,14 +426,21 @@ private:
             auto res = m_conn2item.emplace(subs.first, ConnItem(uriId, std::get<0>(subs.second), std::get<1>(subs.second), std::get<2>(subs.second), timeout));
             assert(res.second);
             ConnItem* connItem = &res.first->second;
+            connItem->m_name = "$" + subs.first;
+            connItem->m_latency = &m_manager.runtimeSysInfo().upstream_latency(connItem->m_name);
             connItem->m_upstreamStub.setCallback([connItem](mg_connection* client){ connItem->onCloseIdle(client); });
         }
     }
 
     void createUpstreamSender(ConnItem* connItem, BaseTaskPtr bt)
     {
-        auto onDoneAct = [this, connItem](UpstreamSender& uss, uint64_t connectionId, mg_connection* client)
+        BaseTask::Clock::time_point start = BaseTask::Clock::now();
+        auto onDoneAct = [this, connItem, start](UpstreamSender& uss, uint64_t connectionId, mg_connection* client)
         {
+            BaseTask::Clock::time_point end = BaseTask::Clock::now();
+            connItem->m_latency->record(elapsedUs(start, end));
+            BaseTaskPtr& bt = uss.getTask();
+            if(bt->isTraced()) m_manager.tracer().span(bt->getCtx().getId(), "upstream", start, end, connItem->m_name);
             onDone(uss, connItem, connectionId, client);
         };
 
@@ -394,6 +472,7 @@ private:
 TaskManager::TaskManager(const ConfigOpts& copts, SysInfoCounter& sysInfoCounter)
     : m_copts(copts)
     , m_sysInfoCounter(sysInfoCounter)
+    , m_tracer(std::make_unique<Tracer>(copts.trace.sample_rate, copts.trace.buffer_size))
     , m_gcm(this)
     , m_futurePostponeUuids(std::make_unique<ExpiringList>(1000 * copts.http_connection_timeout))
     , m_stateMachine(std::make_unique<StateMachine>())
@@ -402,6 +481,13 @@ TaskManager::TaskManager(const ConfigOpts& copts, SysInfoCounter& sysInfoCounter
 
     // TODO: validate options, throw exception if any mandatory options missing
     initThreadPool(copts.workers_count, copts.worker_queue_len, copts.workers_expelling_interval_ms);
+
+    size_t resQueueSize = next_pow2( m_threadPoolInputSize );
+    //each resume request originates from a job of the thread pool or from a service working on behalf of it
+    m_resumeQueue = std::make_unique<ResumeQueue>(resQueueSize);
+    //the same holds for async upstream requests
+    m_upstreamAsyncQueue = std::make_unique<UpstreamAsyncQueue>(resQueueSize);
+    m_upstreamManager = std::make_unique<UpstreamManager>(*this, [this](UpstreamSender& uss){ onUpstreamDone(uss); } );
 }
 
 TaskManager::~TaskManager()
@@ -449,6 +535,45 @@ const ConfigOpts& TaskManager::configOpts() const
     return m_copts;
 }
 
+Tracer& TaskManager::tracer()
+{
+    return *m_tracer;
+}
+
+bool TaskManager::resumePostponedTask(const Context::uuid_t& uuid, const Input& input)
+{
+    bool ok = m_resumeQueue->push( std::make_pair(uuid, input) );
+    if(!ok)
+    {//the task fails at once instead of waiting for the postpone timeout
+        std::lock_guard<std::mutex> lk(m_resumeFailedMutex);
+        m_resumeFailed.push_back(uuid);
+    }
+    notifyJobReady();
+    return ok;
+}
+
+void TaskManager::checkResumeTaskIO()
+{
+    while(true)
+    {
+        ResumeItem ri;
+        bool res = m_resumeQueue->pop(ri);
+        if(!res) break;
+        resumeTask(ri.first, std::move(ri.second));
+    }
+
+    std::vector<Context::uuid_t> failed;
+    {
+        std::lock_guard<std::mutex> lk(m_resumeFailedMutex);
+        if(m_resumeFailed.empty()) return;
+        failed.swap(m_resumeFailed);
+    }
+    for(auto& uuid : failed)
+    {
+        failResumeTask(uuid);
+    }
+}
+
 void TaskManager::checkPeriodicTaskIO()
 {
     while(true)
@@ -497,6 +622,37 @@ void TaskManager::checkUpstreamBlockingIO()
     }
 }
 
+bool TaskManager::sendUpstreamAsync(Output&& output)
+{
+    //queue cells are preallocated, output is moved into one of them
+    bool ok = m_upstreamAsyncQueue->push( std::move(output) );
+    if(!ok) return false;
+    notifyJobReady();
+    return true;
+}
+
+void TaskManager::checkUpstreamAsyncIO()
+{
+    while(true)
+    {
+        Output output;
+        bool res = m_upstreamAsyncQueue->pop(output);
+        if(!res) break;
+        BaseTaskPtr bt = BaseTask::Create<UpstreamAsyncTask>(*this, std::move(output));
+        //the response is dropped in upstreamDoneProcess
+        try
+        {
+            sendUpstream(bt);
+        }
+        catch(std::exception& ex)
+        {
+            const Output& out = bt->getOutput();
+            LOG_PRINT_L1("Cannot send request to " << out.host << ":" << out.port << out.path << ": " << ex.what());
+            bt->finalize();
+        }
+    }
+}
+
 void TaskManager::sendUpstream(BaseTaskPtr bt)
 {
     assert(m_upstreamManager);
@@ -516,6 +672,12 @@ void TaskManager::respondAndDie(BaseTaskPtr bt, const std::string& s, bool die)
     if(ct)
     {
         ct->m_connectionManager->respond(ct, s);
+        BaseTask::Clock::time_point end = BaseTask::Clock::now();
+        if(ct->getParams().endpoint)
+        {
+            runtimeSysInfo().record_route_latency(*ct->getParams().endpoint, elapsedUs(ct->getCreateTime(), end));
+        }
+        if(ct->isTraced()) m_tracer->span(ct->getCtx().getId(), "request", ct->getCreateTime(), end, ct->getStrStatus());
     }
     else
     {
@@ -531,7 +693,25 @@ void TaskManager::respondAndDie(BaseTaskPtr bt, const std::string& s, bool die)
     }
 
     if(die)
+    {
+        if(Status::Ok != bt->getLastStatus()) runOnFailure(bt);
         bt->finalize();
+    }
+}
+
+void TaskManager::runOnFailure(BaseTaskPtr bt)
+{
+    Context& ctx = bt->getCtx();
+    std::function<void(Context&)> onFailure = ctx.local.takeOnFailure();
+    if(!onFailure) return;
+    try
+    {
+        onFailure(ctx);
+    }
+    catch(const std::exception& e)
+    {
+        LOG_PRINT_RQS_BT(1,bt,"failure handler has thrown: " << e.what());
+    }
 }
 
 void TaskManager::schedule(PeriodicTask* pt)
@@ -543,6 +723,7 @@ bool TaskManager::canStop()
 {
     return (m_cntBaseTask == m_cntBaseTaskDone)
             && (!m_upstreamManager->busy())
+            && m_drainingUpstreamManagers.empty()
             && (m_cntJobSent == m_cntJobDone);
 }
 
@@ -590,9 +771,12 @@ void TaskManager::runPreAction(BaseTaskPtr bt)
     {
         // Please read the comment about exceptions and noexcept specifier
         // near 'void terminate()' function in main.cpp
-        mlog_current_log_category = params.h3.name;
+        LogCategoryScope logCategory(params.h3.name);
+        BaseTask::Clock::time_point start = BaseTask::Clock::now();
         Status status = params.h3.pre_action(params.vars, params.input, ctx, output);
-        mlog_current_log_category.clear();
+        BaseTask::Clock::time_point end = BaseTask::Clock::now();
+        runtimeSysInfo().record_stage_latency(SysInfoCounter::Stage::PreAction, elapsedUs(start, end));
+        if(bt->isTraced()) m_tracer->span(ctx.getId(), "pre_action", start, end, params.h3.name);
 
         bt->setLastStatus(status);
         if(Status::Ok == status && (params.h3.worker_action || params.h3.post_action)
@@ -623,6 +807,7 @@ void TaskManager::runWorkerAction(BaseTaskPtr bt)
     if(params.h3.worker_action)
     {
         ++m_cntJobSent;
+        bt->setJobPostTime(BaseTask::Clock::now());
         m_threadPool->post(
                     GJPtr( bt, m_resQueue.get(), this ),
                     true
@@ -643,9 +828,17 @@ void TaskManager::runWorkerActionFromTheThreadPool(BaseTaskPtr bt)
         // Please read the comment about exceptions and noexcept specifier
         // near 'void terminate()' function in main.cpp
 
-        mlog_current_log_category = params.h3.name;
+        LogCategoryScope logCategory(params.h3.name);
+        BaseTask::Clock::time_point start = BaseTask::Clock::now();
+        runtimeSysInfo().record_stage_latency(SysInfoCounter::Stage::QueueWait, elapsedUs(bt->getJobPostTime(), start));
         Status status = params.h3.worker_action(params.vars, params.input, ctx, output);
-        mlog_current_log_category.clear();
+        BaseTask::Clock::time_point end = BaseTask::Clock::now();
+        runtimeSysInfo().record_stage_latency(SysInfoCounter::Stage::WorkerAction, elapsedUs(start, end));
+        if(bt->isTraced())
+        {
+            m_tracer->span(ctx.getId(), "queue_wait", bt->getJobPostTime(), start);
+            m_tracer->span(ctx.getId(), "worker_action", start, end, params.h3.name);
+        }
 
         bt->setLastStatus(status);
         if(Status::Ok == status && params.h3.post_action || Status::Forward == status)
@@ -679,9 +872,12 @@ void TaskManager::runPostAction(BaseTaskPtr bt)
 
     try
     {
-        mlog_current_log_category = params.h3.name;
+        LogCategoryScope logCategory(params.h3.name);
+        BaseTask::Clock::time_point start = BaseTask::Clock::now();
         Status status = params.h3.post_action(params.vars, params.input, ctx, output);
-        mlog_current_log_category.clear();
+        BaseTask::Clock::time_point end = BaseTask::Clock::now();
+        runtimeSysInfo().record_stage_latency(SysInfoCounter::Stage::PostAction, elapsedUs(start, end));
+        if(bt->isTraced()) m_tracer->span(ctx.getId(), "post_action", start, end, params.h3.name);
 
         //in case of pre_action or worker_action return Forward we call post_action in any case
         //but we should ignore post_action result status and output
@@ -713,13 +909,21 @@ void TaskManager::postponeTask(BaseTaskPtr bt)
 {
     Context::uuid_t uuid = bt->getCtx().getId();
     assert(!uuid.is_nil());
+    if(bt->isTraced()) m_tracer->instant(uuid, "postpone");
 
     //find already recieved uuid
     auto res = m_futurePostponeUuids->extract(uuid);
     if(res.first)
     {//found
+        if(!res.second.getInputPtr())
+        {//see failResumeTask
+            LOG_PRINT_RQS_BT(2,bt,"the task with uuid '" << uuid << "' cannot be resumed, the resume queue is full.");
+            std::string msg = "Resume queue is full";
+            bt->setError(msg.c_str(), Status::Error);
+            respondAndDie(bt, msg);
+            return;
+        }
         //set saved input
-        assert(res.second.getInputPtr());
         bt->getParams().input = *res.second.getInputPtr();
         m_readyToResume.push_back(bt);
         LOG_PRINT_RQS_BT(2,bt,"for the task with uuid '" << uuid << "' an answer found; it will be resumed.");
@@ -745,6 +949,7 @@ void TaskManager::executePostponedTasks()
         BaseTaskPtr& bt = m_readyToResume.front();
         Context::uuid_t uuid = bt->getCtx().getId();
         LOG_PRINT_RQS_BT(2,bt,"task with uuid '" << uuid << "' resumed.");
+        if(bt->isTraced()) m_tracer->instant(uuid, "resume");
         Execute(bt);
         m_readyToResume.pop_front();
     }
@@ -763,6 +968,7 @@ void TaskManager::executePostponedTasks()
             BaseTaskPtr& bt = it->second;
             Context::uuid_t uuid = bt->getCtx().getId();
             LOG_PRINT_RQS_BT(2,bt,"postponed task with uuid '" << uuid << "' expired.");
+            if(bt->isTraced()) m_tracer->instant(uuid, "postpone_expired");
             std::string msg = "Postpone task response timeout";
             bt->setError(msg.c_str(), Status::Error);
             respondAndDie(bt, msg);
@@ -772,6 +978,27 @@ void TaskManager::executePostponedTasks()
     }
 }
 
+void TaskManager::publishRuntimeSnapshot()
+{
+    auto now = std::chrono::steady_clock::now();
+    if(now < m_nextRuntimeSnapshotTime) return;
+    m_nextRuntimeSnapshotTime = now + std::chrono::milliseconds(RUNTIME_SNAPSHOT_INTERVAL_MS);
+
+    auto snapshot = std::make_shared<request::system_info::RuntimeSnapshot>();
+    snapshot->thread_pool_jobs = m_cntJobSent - m_cntJobDone;
+    snapshot->thread_pool_capacity = m_threadPoolInputSize;
+    getThreadPoolInfo(snapshot->thread_pool_active_workers, snapshot->thread_pool_expelled_workers);
+    snapshot->postponed_tasks = m_postponedTasks.size();
+    snapshot->tasks_ready_to_resume = m_readyToResume.size();
+    snapshot->global_context_entries = m_gcm.size();
+    m_upstreamManager->getStats(snapshot->upstreams);
+
+    //readers keep the previous snapshot if nothing has changed
+    auto prev = m_sysInfoCounter.runtime_snapshot();
+    if(prev && *prev == *snapshot) return;
+    m_sysInfoCounter.set_runtime_snapshot(std::move(snapshot));
+}
+
 void TaskManager::expelWorkers()
 {
     if(getCopts().workers_expelling_interval_ms == 0) return;
@@ -784,6 +1011,51 @@ void TaskManager::getThreadPoolInfo(uint64_t& activeWorkers, uint64_t& expelledW
     expelledWorkers = m_threadPool->getExpelledWorkersCount();
 }
 
+void TaskManager::reconfigure(const ConfigOpts& copts)
+{
+    assert(io_thread);
+    copts.check_asserts();
+
+    //the timeouts are read on each use
+    m_copts.http_connection_timeout = copts.http_connection_timeout;
+    m_copts.timer_poll_interval_ms = copts.timer_poll_interval_ms;
+    m_copts.log_trunc_to_size = copts.log_trunc_to_size;
+    m_copts.ipfilter = copts.ipfilter;
+
+    if(m_copts.upstream_request_timeout != copts.upstream_request_timeout)
+    {
+        m_copts.upstream_request_timeout = copts.upstream_request_timeout;
+        reinitUpstreams();
+    }
+}
+
+void TaskManager::reinitUpstreams()
+{
+    assert(io_thread);
+    //the previous manager keeps its pending and queued requests, idle connections are not reused
+    m_upstreamManager->closeIdleConnections();
+    m_drainingUpstreamManagers.emplace_back(std::move(m_upstreamManager));
+    m_upstreamManager = std::make_unique<UpstreamManager>(*this, [this](UpstreamSender& uss){ onUpstreamDone(uss); } );
+    LOG_PRINT_L1("Upstreams reinitialized, " << m_drainingUpstreamManagers.size() << " previous upstream managers are draining");
+}
+
+void TaskManager::reconfigureIdle()
+{
+    for(auto it = m_drainingUpstreamManagers.begin(); it != m_drainingUpstreamManagers.end();)
+    {
+        UpstreamManager& upstreamManager = **it;
+        if(upstreamManager.busy())
+        {
+            ++it;
+            continue;
+        }
+        //connections released by the last requests become idle
+        upstreamManager.closeIdleConnections();
+        it = m_drainingUpstreamManagers.erase(it);
+        LOG_PRINT_L1("Previous upstream manager drained");
+    }
+}
+
 
 void TaskManager::processForward(BaseTaskPtr bt)
 {
@@ -797,27 +1069,49 @@ void TaskManager::processOk(BaseTaskPtr bt)
     Context::uuid_t nextUuid = bt->getCtx().getNextTaskId();
     if(!nextUuid.is_nil())
     {
-        auto it = m_postponedTasks.find(nextUuid);
-        if(it == m_postponedTasks.end())
-        {
-            LOG_PRINT_RQS_BT(2,bt,"attempt to resume task with uuid '" << nextUuid << "' failed, maybe it is not postponed yet.");
-            Input input = bt->getInput();
-            m_futurePostponeUuids->add(Uuid_Input(nextUuid, std::move(input)));
-        }
-        else
-        {
-            LOG_PRINT_RQS_BT(2,bt,"resuming task with uuid '" << nextUuid << "'.");
-            //redirect callback input to postponed task
-            BaseTaskPtr& bt_next = it->second;
-            bt_next->getInput() = bt->getInput();
-
-            m_readyToResume.push_back(bt_next);
-            m_postponedTasks.erase(it);
-        }
+        //redirect callback input to postponed task
+        Input input = bt->getInput();
+        resumeTask(nextUuid, std::move(input));
     }
     respondAndDie(bt, bt->getOutput().data());
 }
 
+void TaskManager::failResumeTask(const Context::uuid_t& uuid)
+{
+    auto it = m_postponedTasks.find(uuid);
+    if(it == m_postponedTasks.end())
+    {//the task is not postponed yet, an entry without input makes it fail in postponeTask
+        LOG_PRINT_L2("task with uuid '" << uuid << "' cannot be resumed, maybe it is not postponed yet.");
+        m_futurePostponeUuids->add(Uuid_Input(uuid));
+        return;
+    }
+    BaseTaskPtr bt = it->second;
+    LOG_PRINT_RQS_BT(2,bt,"the task with uuid '" << uuid << "' cannot be resumed, the resume queue is full.");
+    if(bt->isTraced()) m_tracer->instant(uuid, "resume_failed");
+    std::string msg = "Resume queue is full";
+    bt->setError(msg.c_str(), Status::Error);
+    respondAndDie(bt, msg);
+}
+
+void TaskManager::resumeTask(const Context::uuid_t& uuid, Input&& input)
+{
+    auto it = m_postponedTasks.find(uuid);
+    if(it == m_postponedTasks.end())
+    {
+        LOG_PRINT_L2("attempt to resume task with uuid '" << uuid << "' failed, maybe it is not postponed yet.");
+        m_futurePostponeUuids->add(Uuid_Input(uuid, std::move(input)));
+    }
+    else
+    {
+        LOG_PRINT_L2("resuming task with uuid '" << uuid << "'.");
+        BaseTaskPtr& bt_next = it->second;
+        bt_next->getInput() = std::move(input);
+
+        m_readyToResume.push_back(bt_next);
+        m_postponedTasks.erase(it);
+    }
+}
+
 void TaskManager::addPeriodicTask(
         const Router::Handler3& h3, std::chrono::milliseconds interval_ms, std::chrono::milliseconds initial_interval_ms, double random_factor)
 {
@@ -862,7 +1156,6 @@ void TaskManager::initThreadPool(int threadCount, int workersQueueSize, int expe
     m_promiseQueue = std::make_unique<PromiseQueue>( threadCount );
     //TODO: it is not clear how many items we need in PeriodicTaskQueue, maybe we should make it dynamically but this requires additional synchronization
     m_periodicTaskQueue = std::make_unique<PeriodicTaskQueue>(2*threadCount);
-    m_upstreamManager = std::make_unique<UpstreamManager>(*this, [this](UpstreamSender& uss){ onUpstreamDone(uss); } );
 
     LOG_PRINT_L1("Thread pool created with " << threadCount
                  << " workers with " << workersQueueSize
@@ -904,6 +1197,16 @@ void TaskManager::upstreamDoneProcess(UpstreamSender& uss)
         runtimeSysInfo().count_upstrm_http_resp_err();
 
     BaseTaskPtr bt = uss.getTask();
+    if(UpstreamAsyncTask* uat = dynamic_cast<UpstreamAsyncTask*>(bt.get()))
+    {//nobody waits for the response
+        if(Status::Ok != uss.getStatus())
+        {
+            const Output& output = bt->getOutput();
+            LOG_PRINT_L1("Request to " << output.host << ":" << output.port << output.path << " failed: " << uss.getError());
+        }
+        uat->finalize();
+        return;
+    }
     UpstreamTask* ust = dynamic_cast<UpstreamTask*>(bt.get());
     if(ust)
     {
@@ -936,6 +1239,7 @@ void TaskManager::upstreamDoneProcess(UpstreamSender& uss)
         LOG_PRINT_RQS_BT(2,bt, "CryptoNode answered : '" << make_dump_output( bt->getInput().body, getCopts().log_trunc_to_size ) << "'");
         if(!bt->getSelf())
         {//it is possible that a client has closed connection already
+            runOnFailure(bt);
             return;
         }
         Execute(bt);
@@ -946,6 +1250,7 @@ BaseTask::BaseTask(TaskManager& manager, const Router::JobParams& params)
     : m_manager(manager)
     , m_params(params)
     , m_ctx(manager.getGcm())
+    , m_createTime(Clock::now())
 {
 }
 
@@ -966,6 +1271,11 @@ void UpstreamTask::finalize()
     releaseItself();
 }
 
+void UpstreamAsyncTask::finalize()
+{
+    releaseItself();
+}
+
 void PeriodicTask::finalize()
 {
     if(m_ctx.local.getLastStatus() == Status::Stop)
@@ -995,6 +1305,12 @@ ClientTask::ClientTask(ConnectionManager* connectionManager, mg_connection *clie
     , m_connectionManager(connectionManager)
     , m_client(client)
 {
+    if(m_manager.tracer().sample())
+    {
+        m_traced = true;
+        //the uuid is the key of trace events, so it is generated in advance
+        m_ctx.getId();
+    }
 }
 
 void ClientTask::finalize()
@@ -0,0 +1,150 @@
+#include "lib/graft/trace.h"
+
+#include <boost/uuid/uuid_io.hpp>
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+namespace graft {
+
+namespace
+{
+
+void writeJsonString(std::ostringstream& os, const std::string& s)
+{
+    os << '"';
+    for(char c : s)
+    {
+        switch(c)
+        {
+        case '"': os << "\\\""; break;
+        case '\\': os << "\\\\"; break;
+        case '\n': os << "\\n"; break;
+        case '\r': os << "\\r"; break;
+        case '\t': os << "\\t"; break;
+        default:
+            if(static_cast<unsigned char>(c) < 0x20)
+            {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                os << buf;
+            }
+            else
+            {
+                os << c;
+            }
+        }
+    }
+    os << '"';
+}
+
+}
+
+Tracer::Tracer(int sampleRate, size_t capacity)
+    : m_sampleRate(std::max(sampleRate, 0))
+    , m_start(Clock::now())
+    , m_events(enabled()? std::max<size_t>(capacity, 1) : 0)
+{
+}
+
+uint32_t Tracer::threadNumber()
+{
+    static std::atomic<uint32_t> last{0};
+    thread_local uint32_t number = ++last;
+    return number;
+}
+
+void Tracer::span(const Uuid& uuid, const char* name, Clock::time_point start, Clock::time_point end, std::string detail)
+{
+    Event event;
+    event.uuid = uuid;
+    event.name = name;
+    event.ts_us = std::chrono::duration_cast<std::chrono::microseconds>(start - m_start).count();
+    event.dur_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    event.thread = threadNumber();
+    event.detail = std::move(detail);
+    add(std::move(event));
+}
+
+void Tracer::instant(const Uuid& uuid, const char* name, Clock::time_point at, std::string detail)
+{
+    Event event;
+    event.uuid = uuid;
+    event.name = name;
+    event.instant = true;
+    event.ts_us = std::chrono::duration_cast<std::chrono::microseconds>(at - m_start).count();
+    event.thread = threadNumber();
+    event.detail = std::move(detail);
+    add(std::move(event));
+}
+
+void Tracer::add(Event&& event)
+{
+    if(m_events.empty()) return;
+
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_events[m_next] = std::move(event);
+    if(++m_next == m_events.size())
+    {
+        m_next = 0;
+        m_full = true;
+    }
+}
+
+std::string Tracer::dumpChromeTrace() const
+{
+    std::vector<Event> events;
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if(m_full)
+        {
+            events.reserve(m_events.size());
+            events.insert(events.end(), m_events.begin() + m_next, m_events.end());
+        }
+        events.insert(events.end(), m_events.begin(), m_events.begin() + m_next);
+    }
+
+    //each task is shown as a separate row named by its uuid, the thread that produced an event is in its args
+    std::map<Uuid, size_t> rows;
+    for(auto& e : events)
+    {
+        rows.emplace(e.uuid, rows.size() + 1);
+    }
+
+    std::ostringstream os;
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for(auto& row : rows)
+    {
+        if(!first) os << ',';
+        first = false;
+        os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << row.second << ",\"args\":{\"name\":";
+        writeJsonString(os, boost::uuids::to_string(row.first));
+        os << "}}";
+    }
+    for(auto& e : events)
+    {
+        if(!first) os << ',';
+        first = false;
+        os << "{\"name\":";
+        writeJsonString(os, e.name);
+        os << ",\"cat\":\"task\",\"ph\":\"" << (e.instant? "i" : "X") << '"';
+        os << ",\"ts\":" << e.ts_us;
+        if(e.instant) os << ",\"s\":\"t\"";
+        else os << ",\"dur\":" << e.dur_us;
+        os << ",\"pid\":1,\"tid\":" << rows[e.uuid];
+        os << ",\"args\":{\"thread\":" << e.thread;
+        if(!e.detail.empty())
+        {
+            os << ",\"detail\":";
+            writeJsonString(os, e.detail);
+        }
+        os << "}}";
+    }
+    os << "]}";
+    return os.str();
+}
+
+}//namespace graft
+
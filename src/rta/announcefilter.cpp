@@ -0,0 +1,112 @@
+#include "rta/announcefilter.h"
+
+#include <misc_log_ex.h>
+
+#include <algorithm>
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "supernode.announcefilter"
+
+namespace graft {
+
+AnnounceFilter::AnnounceFilter(std::chrono::milliseconds min_interval, size_t burst, std::chrono::seconds dedup_ttl, size_t max_remembered)
+    : m_min_interval(min_interval)
+    , m_burst(std::max<size_t>(burst, 1))
+    , m_dedup_ttl(dedup_ttl)
+    , m_max_remembered(max_remembered)
+{
+}
+
+AnnounceFilter::Result AnnounceFilter::check(const std::string &supernode_public_id, uint64_t height, const std::string &signature,
+                                             Clock::time_point now)
+{
+    // key covers all signed fields and the signature, so only exact copies are dropped
+    std::string data;
+    data.reserve(supernode_public_id.size() + sizeof(height) + signature.size() + 1);
+    data.append(supernode_public_id).push_back('\0');
+    data.append(reinterpret_cast<const char*>(&height), sizeof(height));
+    data.append(signature);
+
+    crypto::hash key;
+    crypto::cn_fast_hash(data.data(), data.size(), key);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    expire(now);
+
+    if (m_remembered.count(key))
+    {
+        ++m_duplicates;
+        return Result::Duplicate;
+    }
+
+    m_remembered.insert(key);
+    m_remembered_order.emplace_back(now, key);
+
+    return Result::Accepted;
+}
+
+AnnounceFilter::Result AnnounceFilter::charge(const std::string &supernode_public_id, Clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_senders.find(supernode_public_id);
+
+    if (it == m_senders.end())
+    {
+        it = m_senders.emplace(supernode_public_id, Sender{double(m_burst), now}).first;
+    }
+    else
+    {
+        Sender& sender = it->second;
+        const double elapsed = std::chrono::duration<double, std::milli>(now - sender.last_time).count();
+
+        if (m_min_interval.count() > 0)
+            sender.tokens = std::min(double(m_burst), sender.tokens + elapsed / m_min_interval.count());
+        else
+            sender.tokens = double(m_burst);
+
+        sender.last_time = now;
+    }
+
+    if (it->second.tokens < 1)
+    {
+        ++m_throttled;
+        return Result::Throttled;
+    }
+
+    it->second.tokens -= 1;
+
+    ++m_accepted;
+    return Result::Accepted;
+}
+
+void AnnounceFilter::expire(Clock::time_point now)
+{
+    while (!m_remembered_order.empty() &&
+           (m_remembered_order.front().first + m_dedup_ttl <= now || m_remembered_order.size() >= m_max_remembered))
+    {
+        m_remembered.erase(m_remembered_order.front().second);
+        m_remembered_order.pop_front();
+    }
+
+    if (now < m_next_senders_cleanup)
+        return;
+
+    m_next_senders_cleanup = now + m_dedup_ttl;
+
+    // senders which have full buckets are in the same state as unknown ones
+    const auto refill_time = m_min_interval * m_burst;
+
+    for (auto it = m_senders.begin(); it != m_senders.end();)
+    {
+        if (it->second.last_time + refill_time <= now)
+            it = m_senders.erase(it);
+        else
+            ++it;
+    }
+
+    MDEBUG("announce filter: " << m_remembered.size() << " announces, " << m_senders.size() << " senders remembered");
+}
+
+} // namespace graft
@@ -1,16 +1,19 @@
 #include "rta/fullsupernodelist.h"
+#include "supernode/requests/send_supernode_announce.h"
 
 #include <wallet/api/wallet_manager.h>
 #include <cryptonote_basic/cryptonote_basic_impl.h>
 #include <cryptonote_protocol/blobdatatype.h>
 #include <misc_log_ex.h>
 
+#include <boost/make_shared.hpp>
 #include <boost/multiprecision/cpp_int.hpp>
 #include <boost/filesystem.hpp>
 
 #include <algorithm>
 #include <iostream>
 #include <future>
+#include <unordered_set>
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "supernode.fullsupernodelist"
@@ -126,14 +129,15 @@ std::future<void> ThreadPool::runAsync()
 #ifndef __cpp_inline_variables
 constexpr int32_t FullSupernodeList::TIERS, FullSupernodeList::ITEMS_PER_TIER, FullSupernodeList::AUTH_SAMPLE_SIZE;
 constexpr int64_t FullSupernodeList::AUTH_SAMPLE_HASH_HEIGHT, FullSupernodeList::ANNOUNCE_TTL_SECONDS;
+constexpr size_t FullSupernodeList::ANNOUNCE_BATCH_SIZE;
 #endif
 
 FullSupernodeList::FullSupernodeList(const string &daemon_address, bool testnet)
-    : m_daemon_address(daemon_address)
+    : m_snapshot(std::make_shared<Snapshot>())
+    , m_daemon_address(daemon_address)
     , m_testnet(testnet)
     , m_rpc_client(daemon_address, "", "")
     , m_tp(new utils::ThreadPool())
-    , m_blockchain_based_list_max_block_number()
     , m_stakes_max_block_number()
     , m_next_recv_stakes(boost::date_time::not_a_date_time)
     , m_next_recv_blockchain_based_list(boost::date_time::not_a_date_time)
@@ -143,8 +147,31 @@ FullSupernodeList::FullSupernodeList(const string &daemon_address, bool testnet)
 
 FullSupernodeList::~FullSupernodeList()
 {
-    boost::unique_lock<boost::shared_mutex> writerLock(m_access);
-    m_list.clear();
+    boost::unique_lock<boost::mutex> writerLock(m_write_access);
+    publish(std::shared_ptr<Snapshot>());
+}
+
+FullSupernodeList::SnapshotPtr FullSupernodeList::snapshot() const
+{
+    std::lock_guard<std::mutex> lock(m_snapshot_access);
+    return m_snapshot;
+}
+
+std::shared_ptr<FullSupernodeList::Snapshot> FullSupernodeList::cloneSnapshot() const
+{
+    return std::make_shared<Snapshot>(*snapshot());
+}
+
+void FullSupernodeList::publish(std::shared_ptr<Snapshot> snapshot)
+{
+    SnapshotPtr next(std::move(snapshot));
+
+    {
+        std::lock_guard<std::mutex> lock(m_snapshot_access);
+        m_snapshot.swap(next);
+    }
+
+    // previous version is released outside the lock, it may be the last reference to it
 }
 
 bool FullSupernodeList::add(Supernode *item)
@@ -154,21 +181,24 @@ bool FullSupernodeList::add(Supernode *item)
 
 bool FullSupernodeList::add(SupernodePtr item)
 {
-    if (exists(item->idKeyAsString())) {
+    boost::unique_lock<boost::mutex> writerLock(m_write_access);
+
+    if (snapshot()->list.count(item->idKeyAsString())) {
         LOG_ERROR("item already exists: " << item->idKeyAsString());
         return false;
     }
 
-    boost::unique_lock<boost::shared_mutex> writerLock(m_access);
-    addImpl(item);
+    std::shared_ptr<Snapshot> next = cloneSnapshot();
+    addImpl(*next, item);
+    publish(std::move(next));
     return true;
 }
 
-void FullSupernodeList::addImpl(SupernodePtr item)
+void FullSupernodeList::addImpl(Snapshot& snapshot, SupernodePtr item)
 {
-    m_list.insert(std::make_pair(item->idKeyAsString(), item));
+    snapshot.list.insert(std::make_pair(item->idKeyAsString(), item));
     LOG_PRINT_L1("added supernode: " << item->idKeyAsString());
-    LOG_PRINT_L1("list size: " << m_list.size());
+    LOG_PRINT_L1("list size: " << snapshot.list.size());
 }
 
 size_t FullSupernodeList::loadFromDir(const string &base_dir)
@@ -202,21 +232,26 @@ size_t FullSupernodeList::loadFromDirThreaded(const string &base_dir, size_t &fo
 
 bool FullSupernodeList::remove(const string &id)
 {
-    boost::unique_lock<boost::shared_mutex> writerLock(m_access);
-    return m_list.erase(id) > 0;
+    boost::unique_lock<boost::mutex> writerLock(m_write_access);
+
+    if (!snapshot()->list.count(id))
+        return false;
+
+    std::shared_ptr<Snapshot> next = cloneSnapshot();
+    next->list.erase(id);
+    publish(std::move(next));
+    return true;
 }
 
 size_t FullSupernodeList::size() const
 {
-    boost::shared_lock<boost::shared_mutex> readerLock(m_access);
-    return m_list.size();
+    return snapshot()->list.size();
 }
 
 bool FullSupernodeList::exists(const string &id) const
 {
-
-    boost::shared_lock<boost::shared_mutex> readerLock(m_access);
-    return m_list.find(id) != m_list.end();
+    SnapshotPtr snap = snapshot();
+    return snap->list.find(id) != snap->list.end();
 }
 
 //bool FullSupernodeList::update(const string &address, const vector<Supernode::SignedKeyImage> &key_images)
@@ -233,14 +268,15 @@ bool FullSupernodeList::exists(const string &id) const
 
 SupernodePtr FullSupernodeList::get(const string &address) const
 {
-    boost::shared_lock<boost::shared_mutex> readerLock(m_access);
-    auto it = m_list.find(address);
-    if (it != m_list.end())
+    SnapshotPtr snap = snapshot();
+    auto it = snap->list.find(address);
+    if (it != snap->list.end())
         return it->second;
     return SupernodePtr(nullptr);
 }
 
-bool FullSupernodeList::selectSupernodes(size_t items_count, const std::string& payment_id, const blockchain_based_list_tier& src_array, supernode_array& dst_array)
+bool FullSupernodeList::selectSupernodes(const Snapshot& snapshot, std::mt19937_64& rng, size_t items_count, const std::string& payment_id,
+                                         const blockchain_based_list_tier& src_array, supernode_array& dst_array)
 {
     size_t src_array_size = src_array.size();
 
@@ -249,9 +285,9 @@ bool FullSupernodeList::selectSupernodes(size_t items_count, const std::string&
 
     for (size_t i=0; i<src_array_size; i++)
     {
-        auto supernode_it = m_list.find(src_array[i].supernode_public_id);
+        auto supernode_it = snapshot.list.find(src_array[i].supernode_public_id);
 
-        if (supernode_it == m_list.end())
+        if (supernode_it == snapshot.list.end())
         {
             LOG_ERROR("attempt to select unknown supernode " << src_array[i].supernode_public_id);
             return false;
@@ -259,7 +295,7 @@ bool FullSupernodeList::selectSupernodes(size_t items_count, const std::string&
 
         SupernodePtr supernode = supernode_it->second;    
         
-        size_t random_value = m_rng();
+        size_t random_value = rng();
 
         MDEBUG(".....select random value " << random_value << " items count is " << items_count << " with clamp to " << (src_array_size - i) << " items; result is " << (random_value % (src_array_size - i)));
 
@@ -280,13 +316,16 @@ bool FullSupernodeList::selectSupernodes(size_t items_count, const std::string&
 
 uint64_t FullSupernodeList::getBlockchainBasedListForAuthSample(uint64_t block_number, blockchain_based_list& list) const
 {
-    boost::shared_lock<boost::shared_mutex> readerLock(m_access);
+    return getBlockchainBasedListForAuthSample(*snapshot(), block_number, list);
+}
 
+uint64_t FullSupernodeList::getBlockchainBasedListForAuthSample(const Snapshot& snapshot, uint64_t block_number, blockchain_based_list& list)
+{
     uint64_t blockchain_based_list_height = block_number - BLOCKCHAIN_BASED_LIST_DELAY_BLOCK_COUNT;
 
-    blockchain_based_list_map::const_iterator it = m_blockchain_based_lists.find(block_number);
+    blockchain_based_list_map::const_iterator it = snapshot.blockchain_based_lists.find(block_number);
 
-    if (it == m_blockchain_based_lists.end())
+    if (it == snapshot.blockchain_based_lists.end())
         return 0;
 
     blockchain_based_list     result;
@@ -296,11 +335,11 @@ uint64_t FullSupernodeList::getBlockchainBasedListForAuthSample(uint64_t block_n
     {
         blockchain_based_list_tier dst;
 
-        std::copy_if(src.begin(), src.end(), std::back_inserter(dst), [this](const blockchain_based_list_entry& entry)->bool
+        std::copy_if(src.begin(), src.end(), std::back_inserter(dst), [&snapshot](const blockchain_based_list_entry& entry)->bool
         {
-            auto it = m_list.find(entry.supernode_public_id);
+            auto it = snapshot.list.find(entry.supernode_public_id);
 
-            if (it == m_list.end())
+            if (it == snapshot.list.end())
                 return false;
 
             const SupernodePtr& sn              = it->second;
@@ -322,14 +361,17 @@ uint64_t FullSupernodeList::getBlockchainBasedListForAuthSample(uint64_t block_n
 
 bool FullSupernodeList::buildAuthSample(uint64_t height, const std::string& payment_id, supernode_array &out, uint64_t &out_auth_block_number)
 {
+    // whole selection works with a single version of the list, so concurrent writers neither block nor affect it
+    SnapshotPtr snap = snapshot();
+
     blockchain_based_list bbl;
 
-    out_auth_block_number = getBlockchainBasedListForAuthSample(height, bbl);
+    out_auth_block_number = getBlockchainBasedListForAuthSample(*snap, height, bbl);
 
     if (!out_auth_block_number)
     {
         LOG_ERROR("unable to build auth sample for block height " << height << " (blockchain_based_list_height=" << (height - BLOCKCHAIN_BASED_LIST_DELAY_BLOCK_COUNT) << ") and PaymentID "
-           << payment_id << ". Blockchain based list for this block is absent, latest block is " << getBlockchainBasedListMaxBlockNumber());
+           << payment_id << ". Blockchain based list for this block is absent, latest block is " << snap->blockchain_based_list_max_block_number);
         return false;
     }
 
@@ -337,14 +379,12 @@ bool FullSupernodeList::buildAuthSample(uint64_t height, const std::string& paym
 
     std::array<supernode_array, TIERS> tier_supernodes;
     {
-        boost::unique_lock<boost::shared_mutex> writerLock(m_access);
-
            //seed RNG
  
         std::seed_seq seed(reinterpret_cast<const unsigned char*>(payment_id.c_str()),
                            reinterpret_cast<const unsigned char*>(payment_id.c_str() + payment_id.size()));
  
-        m_rng.seed(seed);
+        std::mt19937_64 rng(seed);
  
             //select supernodes for a full supernode list
 
@@ -366,7 +406,7 @@ bool FullSupernodeList::buildAuthSample(uint64_t height, const std::string& paym
             
             dst_array.reserve(AUTH_SAMPLE_SIZE);
 
-            if (!selectSupernodes(AUTH_SAMPLE_SIZE, payment_id, src_array, dst_array))
+            if (!selectSupernodes(*snap, rng, AUTH_SAMPLE_SIZE, payment_id, src_array, dst_array))
             {
               LOG_ERROR("unable to select supernodes for auth sample");
               return false;
@@ -417,7 +457,7 @@ bool FullSupernodeList::buildAuthSample(uint64_t height, const std::string& paym
             if (i > 0) tier_sample_str += ", ";
             tier_sample_str += std::to_string(select[i]) + " T"  + std::to_string(i+1);
         }
-        MDEBUG("selected " << tier_sample_str << " supernodes of " << size() << " for auth sample");
+        MDEBUG("selected " << tier_sample_str << " supernodes of " << snap->list.size() << " for auth sample");
         MTRACE("auth sample: \n" << auth_sample_str);
     }
 
@@ -436,10 +476,10 @@ bool FullSupernodeList::buildAuthSample(const string &payment_id, FullSupernodeL
 
 vector<string> FullSupernodeList::items() const
 {
-    boost::shared_lock<boost::shared_mutex> readerLock(m_access);
+    SnapshotPtr snap = snapshot();
     vector<string> result;
-    result.reserve(m_list.size());
-    for (auto const& it: m_list)
+    result.reserve(snap->list.size());
+    for (auto const& it: snap->list)
         result.push_back(it.first);
 
     return result;
@@ -475,11 +515,162 @@ size_t FullSupernodeList::refreshedItems() const
     return m_refresh_counter;
 }
 
+namespace
+{
+
+// returns supernode of the next snapshot which can be changed; supernodes shared with the published snapshot are copied first
+SupernodePtr detachSupernode(const FullSupernodeList::Snapshot& published, std::unordered_map<std::string, SupernodePtr>::iterator it)
+{
+    auto published_it = published.list.find(it->first);
+
+    if (published_it != published.list.end() && published_it->second == it->second)
+        it->second = boost::make_shared<Supernode>(*it->second);
+
+    return it->second;
+}
+
+}
+
+size_t FullSupernodeList::queueAnnounce(const supernode::request::SupernodeAnnounce& announce)
+{
+    std::shared_ptr<const supernode::request::SupernodeAnnounce> queued = std::make_shared<const supernode::request::SupernodeAnnounce>(announce);
+
+    std::lock_guard<std::mutex> lock(m_announces_mutex);
+
+    std::shared_ptr<const supernode::request::SupernodeAnnounce>& slot = m_queued_announces[announce.supernode_public_id];
+
+    if (!slot || slot->height <= announce.height)
+        slot = std::move(queued);
+
+    return m_queued_announces.size();
+}
+
+size_t FullSupernodeList::applyQueuedAnnounces()
+{
+    std::unordered_map<std::string, std::shared_ptr<const supernode::request::SupernodeAnnounce>> announces;
+
+    {
+        std::lock_guard<std::mutex> lock(m_announces_mutex);
+        announces.swap(m_queued_announces);
+    }
+
+    if (announces.empty())
+        return 0;
+
+    SnapshotPtr current = snapshot();
+
+    size_t applied = 0;
+    std::vector<const supernode::request::SupernodeAnnounce*> updated;
+    std::vector<SupernodePtr> added;
+
+    for (const auto& queued : announces)
+    {
+        const supernode::request::SupernodeAnnounce& announce = *queued.second;
+
+        auto it = current->list.find(queued.first);
+
+        if (it != current->list.end() && it->second)
+        {
+            // known supernode is updated in the next list version
+            if (it->second->busy()) {
+                MWARNING("Unable to update supernode with announce: " << announce.supernode_public_id << ", BUSY");
+                continue;
+            }
+            updated.push_back(&announce);
+            continue;
+        }
+
+        SupernodePtr sn(Supernode::createFromAnnounce(announce, m_daemon_address, m_testnet, false));
+        if (!sn) {
+            LOG_ERROR("Cant create watch-only supernode wallet for id: " << announce.supernode_public_id);
+            continue;
+        }
+        added.push_back(sn);
+    }
+
+    if (!updated.empty() || !added.empty())
+    {
+        boost::unique_lock<boost::mutex> writerLock(m_write_access);
+
+        SnapshotPtr published = snapshot();
+        std::shared_ptr<Snapshot> next = cloneSnapshot();
+
+        for (const supernode::request::SupernodeAnnounce* announce : updated)
+        {
+            // could be removed meanwhile
+            auto it = next->list.find(announce->supernode_public_id);
+
+            if (it == next->list.end() || !it->second)
+                continue;
+
+            if (!detachSupernode(*published, it)->updateFromAnnounce(*announce, false)) {
+                LOG_ERROR("Failed to update supernode with announce: " << announce->supernode_public_id);
+                continue;
+            }
+            ++applied;
+        }
+
+        for (const SupernodePtr& sn : added)
+        {
+            // could be added by stakes or other batch meanwhile
+            if (next->list.count(sn->idKeyAsString()))
+                continue;
+
+            MINFO("About to add supernode to list [" << sn << "]: " << sn->idKeyAsString());
+            addImpl(*next, sn);
+            ++applied;
+        }
+
+        publish(std::move(next));
+    }
+
+    MDEBUG("applied " << applied << " of " << announces.size() << " queued announces, " << added.size() << " new supernodes");
+
+    return applied;
+}
+
+FullSupernodeList::stakes_delta FullSupernodeList::diffStakes(const supernode_stake_map& prev, const supernode_stake_array& stakes)
+{
+    stakes_delta delta;
+    std::unordered_set<std::string> ids;
+
+    ids.reserve(stakes.size());
+
+    for (const supernode_stake& stake : stakes)
+    {
+        ids.insert(stake.supernode_public_id);
+
+        auto it = prev.find(stake.supernode_public_id);
+
+        if (it == prev.end())
+        {
+            delta.added.push_back(stake);
+            continue;
+        }
+
+        const supernode_stake& prev_stake = it->second;
+
+        if (prev_stake.amount != stake.amount || prev_stake.block_height != stake.block_height || prev_stake.unlock_time != stake.unlock_time ||
+            prev_stake.supernode_public_address != stake.supernode_public_address)
+        {
+            delta.changed.push_back(stake);
+        }
+    }
+
+    for (const supernode_stake_map::value_type& prev_stake : prev)
+    {
+        if (!ids.count(prev_stake.first))
+            delta.removed.push_back(prev_stake.first);
+    }
+
+    return delta;
+}
+
 void FullSupernodeList::updateStakes(uint64_t block_number, const supernode_stake_array& stakes, const std::string& cryptonode_rpc_address, bool testnet)
 {
     MDEBUG("update stakes");
 
-    boost::unique_lock<boost::shared_mutex> writerLock(m_access);
+    boost::unique_lock<boost::mutex> writerLock(m_write_access);
 
     if (block_number <= m_stakes_max_block_number)
     {
@@ -487,47 +678,109 @@ void FullSupernodeList::updateStakes(uint64_t block_number, const supernode_stak
       return;
     }
 
-      //clear supernode data
+    stakes_delta delta = diffStakes(m_stakes, stakes);
 
-    for (const std::unordered_map<std::string, SupernodePtr>::value_type& sn_desc : m_list)
+    // supernodes removed from the list are added again even if their stakes are unchanged
+    SnapshotPtr current = snapshot();
+
+    for (const supernode_stake& stake : stakes)
     {
-        SupernodePtr sn = sn_desc.second;
+        if (m_stakes.count(stake.supernode_public_id) && !current->list.count(stake.supernode_public_id))
+            delta.added.push_back(stake);
+    }
 
-        if (!sn)
-            continue;
+    // the first received list is applied to all supernodes, supernodes loaded otherwise have no stakes
+    const bool full_update = m_stakes.empty();
 
-        sn->setStake(0, 0, 0);
+    if (delta.empty() && !full_update)
+    {
+        MDEBUG("stakes for block #" << block_number << " are unchanged");
     }
+    else
+    {
+        MDEBUG("stakes for block #" << block_number << ": " << delta.added.size() << " added, " << delta.changed.size() << " changed, "
+               << delta.removed.size() << " removed");
 
-      //update supernodes
+        std::shared_ptr<Snapshot> next = cloneSnapshot();
 
-    for (const supernode_stake& stake : stakes)
-    {
-        auto it = m_list.find(stake.supernode_public_id);
+          //clear supernode data; supernodes are copied before changes, so readers of the current snapshot keep their stakes
 
-        if (it == m_list.end())
+        if (full_update)
         {
-            SupernodePtr sn (Supernode::createFromStake(stake, cryptonode_rpc_address, testnet));
+            for (auto it = next->list.begin(); it != next->list.end(); ++it)
+            {
+                if (!it->second)
+                    continue;
+
+                detachSupernode(*current, it)->setStake(0, 0, 0);
+            }
+        }
 
-            if (!sn)
+        for (const std::string& id : delta.removed)
+        {
+            auto it = next->list.find(id);
+
+            if (it != next->list.end() && it->second)
+                detachSupernode(*current, it)->setStake(0, 0, 0);
+        }
+
+          //update supernodes
+
+        auto apply_stake = [&](const supernode_stake& stake)
+        {
+            auto it = next->list.find(stake.supernode_public_id);
+
+            if (it == next->list.end())
             {
-                LOG_ERROR("Cant create watch-only supernode wallet for id: " << stake.supernode_public_id);
-                continue;
+                SupernodePtr sn (Supernode::createFromStake(stake, cryptonode_rpc_address, testnet));
+
+                if (!sn)
+                {
+                    LOG_ERROR("Cant create watch-only supernode wallet for id: " << stake.supernode_public_id);
+                    return;
+                }
+
+                MINFO("About to add supernode to list [" << sn << "]: " << sn->idKeyAsString());
+
+                addImpl(*next, sn);
+
+                return;
             }
 
-            MINFO("About to add supernode to list [" << sn << "]: " << sn->idKeyAsString());
+              //update stake
 
-            addImpl(sn);
+            SupernodePtr sn = detachSupernode(*current, it);
 
-            continue;
+            sn->setStake(stake.amount, stake.block_height, stake.unlock_time);
+            sn->setWalletAddress(stake.supernode_public_address);
+        };
+
+        if (full_update)
+        {
+            for (const supernode_stake& stake : stakes)
+                apply_stake(stake);
         }
+        else
+        {
+            for (const supernode_stake& stake : delta.added)
+                apply_stake(stake);
 
-          //update stake
+            for (const supernode_stake& stake : delta.changed)
+                apply_stake(stake);
+        }
 
-        SupernodePtr sn = it->second;
+        ++next->stakes_version;
 
-        sn->setStake(stake.amount, stake.block_height, stake.unlock_time);
-        sn->setWalletAddress(stake.supernode_public_address);
+        publish(std::move(next));
+
+        for (const std::string& id : delta.removed)
+            m_stakes.erase(id);
+
+        for (const supernode_stake& stake : delta.added)
+            m_stakes[stake.supernode_public_id] = stake;
+
+        for (const supernode_stake& stake : delta.changed)
+            m_stakes[stake.supernode_public_id] = stake;
     }
 
     m_stakes_max_block_number = block_number;
@@ -553,14 +806,22 @@ bool check_timeout_expired(boost::posix_time::ptime& next_recv_time)
 
 void FullSupernodeList::synchronizeWithCryptonode(const char* network_address, const char* address)
 {
-    if (check_timeout_expired(m_next_recv_stakes))
+    bool request_stakes = false, request_blockchain_based_list = false;
+
+    {
+        boost::unique_lock<boost::mutex> writerLock(m_write_access);
+        request_stakes = check_timeout_expired(m_next_recv_stakes);
+        request_blockchain_based_list = check_timeout_expired(m_next_recv_blockchain_based_list);
+    }
+
+    if (request_stakes)
     {
         m_rpc_client.send_supernode_stakes(network_address, address);
     }
 
-    if (check_timeout_expired(m_next_recv_blockchain_based_list))
+    if (request_blockchain_based_list)
     {
-        m_rpc_client.send_supernode_blockchain_based_list(network_address, address, m_blockchain_based_list_max_block_number);
+        m_rpc_client.send_supernode_blockchain_based_list(network_address, address, getBlockchainBasedListMaxBlockNumber());
     }
 }
 
@@ -571,53 +832,148 @@ uint64_t FullSupernodeList::getBlockchainHeight() const
     return ret ? result : 0;
 }
 
+FullSupernodeList::blockchain_based_list_delta FullSupernodeList::diffBlockchainBasedLists(const blockchain_based_list& prev, const blockchain_based_list& list)
+{
+    static const blockchain_based_list_tier empty_tier;
+
+    blockchain_based_list_delta delta;
+
+    const size_t tiers_count = std::max(prev.size(), list.size());
+
+    for (size_t tier = 0; tier < tiers_count; ++tier)
+    {
+        const blockchain_based_list_tier& prev_tier = tier < prev.size() ? prev[tier] : empty_tier;
+        const blockchain_based_list_tier& new_tier  = tier < list.size() ? list[tier] : empty_tier;
+
+        std::unordered_map<std::string, const blockchain_based_list_entry*> prev_entries;
+
+        prev_entries.reserve(prev_tier.size());
+
+        for (const blockchain_based_list_entry& entry : prev_tier)
+            prev_entries[entry.supernode_public_id] = &entry;
+
+        for (const blockchain_based_list_entry& entry : new_tier)
+        {
+            auto it = prev_entries.find(entry.supernode_public_id);
+
+            if (it != prev_entries.end() && *it->second == entry)
+            {
+                prev_entries.erase(it);
+                continue;
+            }
+
+            delta.added.emplace_back(tier, entry);
+        }
+
+          //entries left are not in the new tier or have been changed
+
+        for (const blockchain_based_list_entry& entry : prev_tier)
+        {
+            if (prev_entries.count(entry.supernode_public_id))
+                delta.removed.emplace_back(tier, entry);
+        }
+    }
+
+    return delta;
+}
+
 void FullSupernodeList::setBlockchainBasedList(uint64_t block_number, const blockchain_based_list_ptr& list)
 {
-    boost::unique_lock<boost::shared_mutex> writerLock(m_access);
+    boost::unique_lock<boost::mutex> writerLock(m_write_access);
 
     MDEBUG("update blockchain based list for height " << block_number);
-    int t = 1;
-    for (const blockchain_based_list_tier& l : *list)
+
+    SnapshotPtr current = snapshot();
+
+      //find list to compare with: the list for the same block if it is overridden, otherwise the latest one
+
+    blockchain_based_list_map::const_iterator existing_it = current->blockchain_based_lists.find(block_number), prev_it = existing_it;
+
+    if (prev_it == current->blockchain_based_lists.end())
+        prev_it = current->blockchain_based_lists.find(current->blockchain_based_list_max_block_number);
+
+    blockchain_based_list_ptr stored_list = list;
+    bool changed = true;
+
+    if (prev_it != current->blockchain_based_lists.end() && *prev_it->second == *list)
     {
-      MDEBUG("...tier #" << t);
-      int j=0;
-      for (const blockchain_based_list_entry& e : l)
-        MDEBUG(".....[" << j++ << "]=" << e.supernode_public_id);
-      t++;
+        MDEBUG("...same as list for height " << prev_it->first);
+        stored_list = prev_it->second;
+        changed = false;
     }
+    else if (ELPP->vRegistry()->allowed(el::Level::Debug, MONERO_DEFAULT_LOG_CATEGORY))
+    {
+          //the received list is stored as is, the difference is computed for the debug output only
 
-    blockchain_based_list_map::iterator it = m_blockchain_based_lists.find(block_number);
+        if (prev_it == current->blockchain_based_lists.end())
+        {
+            int t = 1;
+            for (const blockchain_based_list_tier& l : *list)
+            {
+              MDEBUG("...tier #" << t);
+              int j=0;
+              for (const blockchain_based_list_entry& e : l)
+                MDEBUG(".....[" << j++ << "]=" << e.supernode_public_id);
+              t++;
+            }
+        }
+        else
+        {
+            blockchain_based_list_delta delta = diffBlockchainBasedLists(*prev_it->second, *list);
+
+            MDEBUG("...changed since list for height " << prev_it->first << ": " << delta.added.size() << " added, " << delta.removed.size() << " removed");
 
-    if (it != m_blockchain_based_lists.end())
+            for (const std::pair<size_t, blockchain_based_list_entry>& e : delta.added)
+                MDEBUG(".....tier #" << e.first + 1 << " +" << e.second.supernode_public_id);
+
+            for (const std::pair<size_t, blockchain_based_list_entry>& e : delta.removed)
+                MDEBUG(".....tier #" << e.first + 1 << " -" << e.second.supernode_public_id);
+        }
+    }
+
+    if (existing_it != current->blockchain_based_lists.end())
     {
+        if (!changed)
+            return;
+
         MWARNING("Overriding blockchain based list for block " << block_number);
-        it->second = list;
+        std::shared_ptr<Snapshot> next = cloneSnapshot();
+        next->blockchain_based_lists[block_number] = stored_list;
+        ++next->blockchain_based_list_version;
+        publish(std::move(next));
         return;
     }
 
+    std::shared_ptr<Snapshot> next = cloneSnapshot();
+
     m_next_recv_blockchain_based_list = boost::posix_time::second_clock::local_time() + boost::posix_time::seconds(BLOCKCHAIN_BASED_LIST_RECV_TIMEOUT_SECONDS);
 
-    m_blockchain_based_lists[block_number] = list;
+    next->blockchain_based_lists[block_number] = stored_list;
 
-    if (block_number > m_blockchain_based_list_max_block_number)
-        m_blockchain_based_list_max_block_number = block_number;
+    if (changed)
+        ++next->blockchain_based_list_version;
+
+    if (block_number > next->blockchain_based_list_max_block_number)
+        next->blockchain_based_list_max_block_number = block_number;
 
       //flush cache - remove old blockchain based lists
 
-    uint64_t oldest_block_number = m_blockchain_based_list_max_block_number - config::graft::SUPERNODE_HISTORY_SIZE;
+    uint64_t oldest_block_number = next->blockchain_based_list_max_block_number - config::graft::SUPERNODE_HISTORY_SIZE;
 
-    for (blockchain_based_list_map::iterator it=m_blockchain_based_lists.begin(); it!=m_blockchain_based_lists.end();)
-      if (it->first < oldest_block_number) it = m_blockchain_based_lists.erase(it);
+    for (blockchain_based_list_map::iterator it=next->blockchain_based_lists.begin(); it!=next->blockchain_based_lists.end();)
+      if (it->first < oldest_block_number) it = next->blockchain_based_lists.erase(it);
       else                                 ++it;
+
+    publish(std::move(next));
 }
 
 FullSupernodeList::blockchain_based_list_ptr FullSupernodeList::findBlockchainBasedList(uint64_t block_number) const
 {
-    boost::shared_lock<boost::shared_mutex> readerLock(m_access);
+    SnapshotPtr snap = snapshot();
 
-    blockchain_based_list_map::const_iterator it = m_blockchain_based_lists.find(block_number);
+    blockchain_based_list_map::const_iterator it = snap->blockchain_based_lists.find(block_number);
 
-    if (it == m_blockchain_based_lists.end())
+    if (it == snap->blockchain_based_lists.end())
         return blockchain_based_list_ptr();
 
     return it->second;
@@ -651,8 +1007,7 @@ size_t FullSupernodeList::getSupernodeBlockchainBasedListTier(const std::string&
 
 uint64_t FullSupernodeList::getBlockchainBasedListMaxBlockNumber() const
 {
-    boost::shared_lock<boost::shared_mutex> readerLock(m_access);
-    return m_blockchain_based_list_max_block_number;
+    return snapshot()->blockchain_based_list_max_block_number;
 }
 
 std::ostream& operator<<(std::ostream& os, const std::vector<SupernodePtr> supernodes)
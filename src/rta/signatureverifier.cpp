@@ -0,0 +1,144 @@
+#include "rta/signatureverifier.h"
+
+#include <misc_log_ex.h>
+
+#include <future>
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "supernode.signatureverifier"
+
+namespace graft {
+
+#ifndef __cpp_inline_variables
+constexpr size_t SignatureVerifier::MAX_BATCH_SIZE;
+#endif
+
+SignatureVerifier::SignatureVerifier(size_t threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t i = 0; i < threads; ++i)
+        m_threads.emplace_back([this]() { run(); });
+
+    MDEBUG("signature verifier started with " << threads << " threads");
+}
+
+SignatureVerifier::~SignatureVerifier()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+
+    for (std::thread& th : m_threads)
+        th.join();
+}
+
+SignatureVerifier::Item SignatureVerifier::makeItem(const std::string &msg, const crypto::public_key &pkey, const crypto::signature &signature)
+{
+    Item item;
+    crypto::cn_fast_hash(msg.data(), msg.size(), item.hash);
+    item.pkey = pkey;
+    item.signature = signature;
+    return item;
+}
+
+void SignatureVerifier::verifyAsync(Batch batch, Callback callback)
+{
+    if (batch.empty())
+    {
+        callback(Results());
+        return;
+    }
+
+    std::shared_ptr<Request> request = std::make_shared<Request>();
+    request->items = std::move(batch);
+    request->results.resize(request->items.size(), 0);
+    request->remaining = request->items.size();
+    request->callback = std::move(callback);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < request->items.size(); ++i)
+            m_pending.emplace_back(request, i);
+    }
+
+    if (request->items.size() > 1)
+        m_cv.notify_all();
+    else
+        m_cv.notify_one();
+}
+
+SignatureVerifier::Results SignatureVerifier::verify(Batch batch)
+{
+    std::promise<Results> promise;
+    std::future<Results> future = promise.get_future();
+
+    verifyAsync(std::move(batch), [&promise](const Results& results) { promise.set_value(results); });
+
+    return future.get();
+}
+
+void SignatureVerifier::run()
+{
+    std::vector<PendingItem> batch;
+    batch.reserve(MAX_BATCH_SIZE);
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return m_stop || !m_pending.empty(); });
+
+            if (m_pending.empty())
+                return; // stopped and nothing left
+
+            // take no more than a fair share of pending items, so other threads get their part of a large batch
+            size_t count = std::min(MAX_BATCH_SIZE, (m_pending.size() + m_threads.size() - 1) / m_threads.size());
+            count = std::max<size_t>(count, 1);
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                batch.push_back(std::move(m_pending.front()));
+                m_pending.pop_front();
+            }
+        }
+
+        for (PendingItem& pi : batch)
+        {
+            Request& request = *pi.first;
+            const Item& item = request.items[pi.second];
+            request.results[pi.second] = crypto::check_signature(item.hash, item.pkey, item.signature);
+        }
+
+        m_verified += batch.size();
+
+        for (PendingItem& pi : batch)
+        {
+            Request& request = *pi.first;
+            // the last finished item delivers results; acq_rel makes results written by other threads visible here
+            if (request.remaining.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                continue;
+
+            Results results(request.results.begin(), request.results.end());
+            try
+            {
+                request.callback(results);
+            }
+            catch (const std::exception& e)
+            {
+                LOG_ERROR("signature verification callback thrown: " << e.what());
+            }
+            catch (...)
+            {
+                LOG_ERROR("signature verification callback thrown unknown exception");
+            }
+        }
+
+        batch.clear();
+    }
+}
+
+} // namespace graft
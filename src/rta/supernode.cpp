@@ -18,6 +18,7 @@ using namespace std;
 namespace graft {
 
 using graft::supernode::request::SupernodeAnnounce;
+using graft::supernode::request::PAYLOAD_FORMAT_BINARY;
 
 
 #ifndef __cpp_inline_variables
@@ -37,10 +38,26 @@ Supernode::Supernode(const string &wallet_address, const crypto::public_key &id_
     MINFO("supernode created: " << "[" << this << "] " <<  this->walletAddress() << ", " << this->idKeyAsString());
 }
 
+Supernode::Supernode(const Supernode &other)
+    : m_last_update_time {other.lastUpdateTime()}
+    , m_accepts_binary_payload {other.acceptsBinaryPayload()}
+{
+    boost::shared_lock<boost::shared_mutex> readerLock(other.m_access);
+
+    m_wallet_address = other.m_wallet_address;
+    m_id_key = other.m_id_key;
+    m_secret_key = other.m_secret_key;
+    m_has_secret_key = other.m_has_secret_key;
+    m_stake_amount = other.m_stake_amount;
+    m_stake_block_height = other.m_stake_block_height;
+    m_stake_unlock_time = other.m_stake_unlock_time;
+    m_testnet = other.m_testnet;
+    m_network_address = other.m_network_address;
+}
 
 Supernode::~Supernode()
 {
-    LOG_PRINT_L0("destroying supernode: " << "[" << this << "] " <<  this->walletAddress() << ", " << this->idKeyAsString());
+    MDEBUG("destroying supernode: " << "[" << this << "] " <<  this->walletAddress() << ", " << this->idKeyAsString());
 }
 
 uint64_t Supernode::stakeAmount() const
@@ -72,15 +89,16 @@ void Supernode::setWalletAddress(const std::string &address)
     m_wallet_address = address;
 }
 
-bool Supernode::updateFromAnnounce(const SupernodeAnnounce &announce)
+bool Supernode::updateFromAnnounce(const SupernodeAnnounce &announce, bool verify_signature)
 {
     // check if address match
     //setNetworkAddress(announce.network_address);
     crypto::public_key id_key;
-    if (!Supernode::validateAnnounce(announce, id_key))
+    if (verify_signature && !Supernode::validateAnnounce(announce, id_key))
         return false;
 
     setLastUpdateTime(std::time(nullptr));
+    setAcceptsBinaryPayload(announce.payload_formats & PAYLOAD_FORMAT_BINARY);
     uint64 stake_amount = stakeAmount();
     MDEBUG("update from announce done for: " << walletAddress() <<
             "; last update time updated to: " << m_last_update_time <<
@@ -89,15 +107,23 @@ bool Supernode::updateFromAnnounce(const SupernodeAnnounce &announce)
 }
 
 Supernode *Supernode::createFromAnnounce(const SupernodeAnnounce &announce, const std::string &daemon_address,
-                                         bool testnet)
+                                         bool testnet, bool verify_signature)
 {
 
     crypto::public_key id_key;
-    if (!Supernode::validateAnnounce(announce, id_key))
-        return nullptr;
+    if (verify_signature) {
+        if (!Supernode::validateAnnounce(announce, id_key))
+            return nullptr;
+    } else {
+        crypto::signature sign;
+        std::string msg;
+        if (!Supernode::parseAnnounce(announce, id_key, sign, msg))
+            return nullptr;
+    }
 
     Supernode * result = new Supernode("",  id_key, daemon_address, testnet);
     result->setLastUpdateTime(time(nullptr));
+    result->setAcceptsBinaryPayload(announce.payload_formats & PAYLOAD_FORMAT_BINARY);
     // TODO: get stake amount here?
     return result;
 }
@@ -112,6 +138,8 @@ bool Supernode::prepareAnnounce(SupernodeAnnounce &announce)
         return false;
     announce.signature = epee::string_tools::pod_to_hex(sign);
     announce.network_address = this->networkAddress();
+    // binary payloads are always decoded, sending them is enabled by configuration
+    announce.payload_formats = PAYLOAD_FORMAT_BINARY;
 
     return true;
 }
@@ -323,7 +351,8 @@ string Supernode::idKeyAsString() const
     return epee::string_tools::pod_to_hex(m_id_key);
 }
 
-bool Supernode::validateAnnounce(const SupernodeAnnounce& announce, crypto::public_key &id_key)
+bool Supernode::parseAnnounce(const SupernodeAnnounce &announce, crypto::public_key &id_key,
+                              crypto::signature &signature, string &msg)
 {
     if (announce.supernode_public_id.empty()) {
         MERROR("Empty public id");
@@ -335,13 +364,22 @@ bool Supernode::validateAnnounce(const SupernodeAnnounce& announce, crypto::publ
         return false;
     }
 
-    crypto::signature sign;
-    if (!epee::string_tools::hex_to_pod(announce.signature, sign)) {
+    if (!epee::string_tools::hex_to_pod(announce.signature, signature)) {
         MERROR("Failed to parse signature from announce: " << announce.signature);
         return false;
     }
 
-    string msg = announce.supernode_public_id + to_string(announce.height);
+    msg = announce.supernode_public_id + to_string(announce.height);
+    return true;
+}
+
+bool Supernode::validateAnnounce(const SupernodeAnnounce& announce, crypto::public_key &id_key)
+{
+    crypto::signature sign;
+    string msg;
+    if (!Supernode::parseAnnounce(announce, id_key, sign, msg))
+        return false;
+
     if (!Supernode::verifySignature(msg, id_key, sign)) {
         MERROR("Signature check failed ");
         return false;
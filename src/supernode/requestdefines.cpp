@@ -3,6 +3,7 @@
 #include "lib/graft/jsonrpc.h"
 #include "lib/graft/context.h"
 #include "rta/supernode.h"
+#include "rta/fullsupernodelist.h"
 #include "supernode/requests/broadcast.h"
 #include "supernode/requests/sale_status.h"
 
@@ -118,14 +119,8 @@ Status errorCustomError(const std::string& message, int code, Output& output)
 }
 
 
-void cleanPaySaleData(const std::string& payment_id, Context& ctx)
-{
-    ctx.global.remove(payment_id + CONTEXT_KEY_PAY);
-    ctx.global.remove(payment_id + CONTEXT_KEY_SALE);
-    ctx.global.remove(payment_id + CONTEXT_KEY_STATUS);
-}
-
-void buildBroadcastSaleStatusOutput(const std::string& payment_id, int status, const SupernodePtr& supernode, Output& output)
+void buildBroadcastSaleStatusOutput(const std::string& payment_id, int status, const SupernodePtr& supernode, Output& output,
+                                    bool binary_payload)
 {
     UpdateSaleStatusBroadcast ussb;
     ussb.id_key = supernode->idKeyAsString();
@@ -139,7 +134,7 @@ void buildBroadcastSaleStatusOutput(const std::string& payment_id, int status, c
     ussb.signature = epee::string_tools::pod_to_hex(sign);
 
     Output innerOut;
-    innerOut.loadT<serializer::JSON_B64>(ussb);
+    loadPayload(innerOut, ussb, binary_payload);
 
     // send payload
     BroadcastRequestJsonRpc cryptonode_req;
@@ -151,6 +146,41 @@ void buildBroadcastSaleStatusOutput(const std::string& payment_id, int status, c
     output.load(cryptonode_req);
 }
 
+bool useBinaryPayload(Context &ctx, const std::vector<std::string> &receivers)
+{
+    if (!ctx.global.get(CONTEXT_KEY_BINARY_PAYLOADS, false))
+        return false;
+
+    FullSupernodeListPtr fsl = ctx.global.get(CONTEXT_KEY_FULLSUPERNODELIST, FullSupernodeListPtr());
+    if (!fsl)
+        return false;
+
+    FullSupernodeList::SnapshotPtr snapshot = fsl->snapshot();
+    for (const std::string &id : receivers) {
+        auto it = snapshot->list.find(id);
+        if (it == snapshot->list.end() || !it->second->acceptsBinaryPayload())
+            return false;
+    }
+    return true;
+}
+
+bool useBinaryPayload(Context &ctx)
+{
+    if (!ctx.global.get(CONTEXT_KEY_BINARY_PAYLOADS, false))
+        return false;
+
+    FullSupernodeListPtr fsl = ctx.global.get(CONTEXT_KEY_FULLSUPERNODELIST, FullSupernodeListPtr());
+    if (!fsl)
+        return false;
+
+    FullSupernodeList::SnapshotPtr snapshot = fsl->snapshot();
+    for (const auto &item : snapshot->list) {
+        if (!item.second->acceptsBinaryPayload())
+            return false;
+    }
+    return true;
+}
+
 GRAFT_DEFINE_IO_STRUCT_INITED(ResultResponse,
                         (int, Result, STATUS_OK)
                        );
@@ -20,6 +20,7 @@
 
 namespace graft::supernode::request::debug { void __registerDebugRequests(Router& router); }
 namespace graft::request::system_info { void register_request(Router& router); }
+namespace graft::request::metrics { void register_request(Router& router); }
 
 namespace graft::supernode::request {
 
@@ -54,6 +55,7 @@ void registerDebugRequests(Router &router)
 {
     debug::__registerDebugRequests(router);
     graft::request::system_info::register_request(router);
+    graft::request::metrics::register_request(router);
 }
 
 }
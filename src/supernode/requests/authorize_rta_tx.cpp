@@ -33,6 +33,9 @@
 #include "supernode/requests/multicast.h"
 #include "supernode/requests/broadcast.h"
 #include "rta/supernode.h"
+#include "rta/signatureverifier.h"
+#include "supernode/rtasession.h"
+#include "supernode/rtatxcache.h"
 #include <misc_log_ex.h>
 #include <exception>
 
@@ -45,27 +48,19 @@ namespace {
     static const char * PATH_RESPONSE = "/cryptonode/authorize_rta_tx_response";
     static const size_t RTA_VOTES_TO_REJECT =  1/*2*/; // TODO: 1 and 3 while testing
     static const size_t RTA_VOTES_TO_APPROVE = 4/*7*/;
+    // key to store rta auth response waiting for signature verification in local context
+    static const std::string CONTEXT_AUTH_RESPONSE_CHECK("auth_response_check");
+    // keys to store multicast receivers and decoded rta auth request in local context
+    static const std::string CONTEXT_AUTH_REQUEST_RECEIVERS("auth_request_receivers");
+    static const std::string CONTEXT_AUTH_REQUEST_DECODED("auth_request_decoded");
 }
 
 namespace graft::supernode::request {
 
-GRAFT_DEFINE_IO_STRUCT_INITED(SupernodeSignature,
-                              (std::string, id_key, std::string()),
-                              (std::string, result_signature, std::string()), // signarure for tx_id + result
-                              (std::string, tx_signature, std::string())      // signature for tx_id only
-                              );
-
 GRAFT_DEFINE_IO_STRUCT_INITED(AuthorizeRtaTxRequestResponse,
                         (int, Result, STATUS_OK)
                        );
 
-
-GRAFT_DEFINE_IO_STRUCT_INITED(AuthorizeRtaTxResponse,
-                       (std::string, tx_id, std::string()),
-                       (int, result, int(RTAAuthResult::Invalid)),
-                       (SupernodeSignature, signature, SupernodeSignature())
-                       );
-
 GRAFT_DEFINE_IO_STRUCT_INITED(AuthorizeRtaTxResponseResponse,
                        (int, Result, STATUS_OK)
                        );
@@ -82,35 +77,14 @@ enum class RtaAuthRequestHandlerState : int {
 enum class RtaAuthResponseHandlerState : int {
     // Multicast call from cryptonode auth rta auth response
     RtaAuthReply = 0,
+    // signatures of the auth response verified, task resumed by signature verifier
+    SignatureVerified,
     // we pushed tx to tx pool, next is to broadcast status,
     TransactionPushReply,
     // Status broadcast reply
     StatusBroadcastReply
 };
 
-struct RtaAuthResult
-{
-    std::vector<SupernodeSignature> approved;
-    std::vector<SupernodeSignature> rejected;
-    bool alreadyApproved(const std::string &id)
-    {
-        return contains(approved, id);
-    }
-
-    bool alreadyRejected(const std::string &id)
-    {
-        return contains(rejected, id);
-    }
-
-private:
-    bool contains(const std::vector<SupernodeSignature> &v, const std::string &id)
-    {
-        return std::find_if(v.begin(), v.end(), [&](const SupernodeSignature &item) {
-            return item.id_key == id;
-        }) != v.end();
-    }
-};
-
 // TODO: this function duplicates PendingTransaction::putRtaSignatures
 void putRtaSignaturesToTx(cryptonote::transaction &tx, const std::vector<SupernodeSignature> &signatures, bool testnet)
 {
@@ -185,30 +159,75 @@ bool validateAuthResponse(const AuthorizeRtaTxResponse &arg, const SupernodePtr
     return r1 && r2;
 }
 
+/*!
+ * \brief makeAuthResponseCheck - makes items to verify signatures of RTA auth result with SignatureVerifier
+ * \param arg
+ * \param batch - output items: result signature and tx signature
+ * \return      - false if signatures or keys can't be parsed
+ */
+bool makeAuthResponseCheck(const AuthorizeRtaTxResponse &arg, SignatureVerifier::Batch &batch)
+{
+    crypto::signature sign_result;
+    crypto::signature sign_tx_id;
+    crypto::hash tx_id;
+    crypto::public_key id_key;
+    if (!epee::string_tools::hex_to_pod(arg.signature.result_signature, sign_result)) {
+        LOG_ERROR("Error parsing signature: " << arg.signature.result_signature);
+        return false;
+    }
+
+    if (!epee::string_tools::hex_to_pod(arg.signature.tx_signature, sign_tx_id)) {
+        LOG_ERROR("Error parsing signature: " << arg.signature.tx_signature);
+        return false;
+    }
+
+    if (!epee::string_tools::hex_to_pod(arg.tx_id, tx_id)) {
+        LOG_ERROR("Error parsing tx_id: " << arg.tx_id);
+        return false;
+    }
+
+    if (!epee::string_tools::hex_to_pod(arg.signature.id_key, id_key)) {
+        LOG_ERROR("Error parsing id_key: " << arg.signature.id_key);
+        return false;
+    }
+
+    batch.push_back(SignatureVerifier::makeItem(arg.tx_id + ":" + to_string(arg.result), id_key, sign_result));
+    batch.push_back(SignatureVerifier::Item{tx_id, id_key, sign_tx_id});
+    return true;
+}
+
+// rta auth response waiting for signature verification
+struct RtaAuthResponseCheck
+{
+    AuthorizeRtaTxResponse response;
+    RtaSessionPtr session;
+    // written by verifier thread before the task is resumed
+    SignatureVerifier::Results results;
+};
+
+using RtaAuthResponseCheckPtr = std::shared_ptr<RtaAuthResponseCheck>;
+
 Status storeRequestAndReplyOk(const Router::vars_t& vars, const graft::Input& input,
                             graft::Context& ctx, graft::Output& output) noexcept
 {
-    // store input in local ctx.
     MDEBUG(__FUNCTION__ << " begin");
-    ctx.local["request"] = input.data();
 
-    // here request parsed for the logging purposes. normally we don't need to parse it here;
+    // request parsed and decoded once here, results kept in local ctx for the "again" state.
+    // duplicate deliveries of the same payload take decoded request and tx from the cache
     MulticastRequestJsonRpc req;
     if (!input.get(req)) { // can't parse request
         return errorCustomError(string("failed to parse request: ")  + input.data(), ERROR_INVALID_REQUEST, output);
     }
 
-    SupernodePtr supernode = ctx.global.get(CONTEXT_KEY_SUPERNODE, SupernodePtr());
-
-    AuthorizeRtaTxRequest authReq;
-    Input innerInput;
-    innerInput.load(req.params.data);
-
-    if (!innerInput.getT<serializer::JSON_B64>(authReq)) {
+    DecodedTxAuthRequestPtr decoded = RtaTxCache::decodeTxAuthRequest(ctx, req.params.data);
+    if (!decoded->valid) {
         return errorInvalidParams(output);
     }
     MDEBUG("incoming tx auth request from: " << req.params.sender_address
-           << ", payment: " << authReq.payment_id);
+           << ", payment: " << decoded->request.payment_id);
+
+    ctx.local[CONTEXT_AUTH_REQUEST_RECEIVERS] = std::move(req.params.receiver_addresses);
+    ctx.local[CONTEXT_AUTH_REQUEST_DECODED] = decoded;
 
     // reply ok to the client
     AuthorizeRtaTxRequestJsonRpcResponse out;
@@ -234,58 +253,41 @@ Status handleTxAuthRequest(const Router::vars_t& vars, const graft::Input& /*inp
     MDEBUG(__FUNCTION__ << " begin");
     assert(ctx.local.getLastStatus() == Status::Again);
 
-    if (!ctx.local.hasKey("request")) {
+    if (!ctx.local.hasKey(CONTEXT_AUTH_REQUEST_DECODED)) {
         LOG_ERROR("Internal error. no input for 'again' status");
         return Status::Error;
     }
 
-    graft::Input input;
-    string body = ctx.local["request"];
-    input.body = body;
-
-    MulticastRequestJsonRpc req;
-    if (!input.get(req)) { // can't parse request
-        return errorCustomError(string("failed to parse request: ")  + input.data(), ERROR_INVALID_REQUEST, output);
-    }
+    std::vector<std::string> &receivers = ctx.local[CONTEXT_AUTH_REQUEST_RECEIVERS];
+    DecodedTxAuthRequestPtr decoded = ctx.local[CONTEXT_AUTH_REQUEST_DECODED];
+    const AuthorizeRtaTxRequest &authReq = decoded->request;
 
     SupernodePtr supernode = ctx.global.get(CONTEXT_KEY_SUPERNODE, SupernodePtr());
 
-    AuthorizeRtaTxRequest authReq;
-    Input innerInput;
-    innerInput.load(req.params.data);
-
-    if (!innerInput.getT<serializer::JSON_B64>(authReq)) {
-        return errorInvalidParams(output);
-    }
-
-    // de-serialize transaction
-    cryptonote::transaction tx;
-    crypto::hash tx_hash, tx_prefix_hash;
-    cryptonote::blobdata tx_blob;
-
-    if (!epee::string_tools::parse_hexstr_to_binbuff(authReq.tx_hex, tx_blob)) {
-        LOG_ERROR("Failed to parse hex tx: " << authReq.tx_hex);
+    // transaction decoded and validated together with the request
+    if (!decoded->tx->valid) {
         return errorInvalidTransaction(authReq.tx_hex, output);
     }
-
-    if (!cryptonote::parse_and_validate_tx_from_blob(tx_blob, tx, tx_hash, tx_prefix_hash)) {
-        LOG_ERROR("Failed to parse and validate tx from blob: " << authReq.tx_hex);
-        return errorInvalidTransaction(authReq.tx_hex, output);
-    }
-
-    string tx_id_str = epee::string_tools::pod_to_hex(tx_hash);
+    const cryptonote::transaction &tx = decoded->tx->tx;
+    const string &tx_id_str = decoded->tx->tx_id;
     MDEBUG("incoming auth req for payment: " << authReq.payment_id
            << ", tx_id: " << tx_id_str);
     // check if we already processed this tx
-    if (ctx.global.hasKey(tx_id_str + CONTEXT_KEY_TX_BY_TXID)) {
+    if (RtaSession::findByTxId(ctx, tx_id_str)) {
         LOG_ERROR("tx already processed: " << tx_id_str);
         return errorCustomError("tx already processed", ERROR_INVALID_PARAMS, output);
     }
 
-    // store tx amount in global context
+    if (authReq.payment_id.empty()) {
+        return errorInvalidPaymentID(output);
+    }
+
+    RtaSessionPtr session = RtaSession::getOrCreate(ctx, authReq.payment_id);
+
+    // store tx amount in session
     MDEBUG("storing amount for payment: " << authReq.payment_id
            << ", tx_id: " << tx_id_str << ", amount: " << authReq.amount);
-    ctx.global.set(tx_id_str + CONTEXT_KEY_AMOUNT_BY_TX_ID, authReq.amount, RTA_TX_TTL);
+    session->setAmount(authReq.amount);
     // check if we have a fee assigned by sender wallet
     uint64 amount = 0;
     if (!supernode->getAmountFromTx(tx, amount)) {
@@ -297,7 +299,7 @@ Status handleTxAuthRequest(const Router::vars_t& vars, const graft::Input& /*inp
     MulticastRequestJsonRpc authResponseMulticast;
     authResponseMulticast.method = "multicast";
     authResponseMulticast.params.sender_address = supernode->idKeyAsString();
-    authResponseMulticast.params.receiver_addresses = req.params.receiver_addresses;
+    authResponseMulticast.params.receiver_addresses = receivers;
     authResponseMulticast.params.callback_uri = PATH_RESPONSE;
     AuthorizeRtaTxResponse authResponse;
     authResponse.tx_id = tx_id_str;
@@ -307,16 +309,15 @@ Status handleTxAuthRequest(const Router::vars_t& vars, const graft::Input& /*inp
     signAuthResponse(authResponse, supernode);
     authResponse.signature.id_key  = supernode->idKeyAsString();
 
-    // store tx
-    ctx.global.set(authResponse.tx_id + CONTEXT_KEY_TX_BY_TXID, tx, RTA_TX_TTL);
-    // TODO: remove it when payment id will be in tx.extra
-    ctx.global.set(authResponse.tx_id + CONTEXT_KEY_PAYMENT_ID_BY_TXID, authReq.payment_id, RTA_TX_TTL);
+    // store tx and map tx_id -> payment
+    // TODO: payment id should be read from tx.extra
+    RtaSession::bindTx(ctx, session, authResponse.tx_id, tx);
 
     // store payment id in local ctx for the logging purposes
     ctx.local["payment_id"] = authReq.payment_id;
 
     Output innerOut;
-    innerOut.loadT<serializer::JSON_B64>(authResponse);
+    loadPayload(innerOut, authResponse, useBinaryPayload(ctx, receivers));
     authResponseMulticast.params.data = innerOut.data();
     output.load(authResponseMulticast);
     output.path = "/json_rpc/rta";
@@ -361,129 +362,66 @@ Status handleCryptonodeMulticastStatus(const Router::vars_t& vars, const graft::
 }
 
 /*!
- * \brief handleRtaAuthResponseMulticast - handles cryptonode/authorize_rta_tx_response call
- * \param vars
- * \param input
+ * \brief handleRtaAuthResponseVerified - counts vote of rta auth response which signatures are verified
+ * \param rtaAuthResp
+ * \param session     - session of the payment the tx belongs to
  * \param ctx
  * \param output
  * \return
  */
-Status handleRtaAuthResponseMulticast(const Router::vars_t& vars, const graft::Input& input,
+Status handleRtaAuthResponseVerified(const AuthorizeRtaTxResponse &rtaAuthResp, const RtaSessionPtr &session,
                             graft::Context& ctx, graft::Output& output)
 {
-
     try {
-
-        MulticastRequestJsonRpc req;
-        MDEBUG(__FUNCTION__ << " begin");
-
-        if (!input.get(req)) { // can't parse request
-            LOG_ERROR("failed to parse request: " + input.data());
-            return errorCustomError(string("failed to parse request: ")  + input.data(), ERROR_INVALID_REQUEST, output);
-        }
-
-        // TODO: check if our address is listed in "receiver_addresses"
-        AuthorizeRtaTxResponse rtaAuthResp;
-        Input innerIn;
-
-        innerIn.load(req.params.data);
-
-        if (!innerIn.getT<serializer::JSON_B64>(rtaAuthResp)) {
-            LOG_ERROR("error deserialize rta auth response");
-            return errorInvalidParams(output);
-        }
-
         SupernodePtr supernode = ctx.global.get(CONTEXT_KEY_SUPERNODE, SupernodePtr());
-
         RTAAuthResult result = static_cast<RTAAuthResult>(rtaAuthResp.result);
-        // sanity check
-        if (result != RTAAuthResult::Approved && result != RTAAuthResult::Rejected) {
-            LOG_ERROR("Invalid rta auth result: " << rtaAuthResp.result);
-            return errorInvalidParams(output);
-        }
-
-
-        string ctx_payment_id_key = rtaAuthResp.tx_id + CONTEXT_KEY_PAYMENT_ID_BY_TXID;
-
-        if (!ctx.global.hasKey(ctx_payment_id_key)) {
-            LOG_ERROR("no payment_id for tx: " << rtaAuthResp.tx_id);
-            return errorCustomError(string("unknown tx: ") + rtaAuthResp.tx_id, ERROR_INTERNAL_ERROR, output);
-        }
-        string payment_id = ctx.global.get(ctx_payment_id_key, std::string());
-        MDEBUG("incoming tx auth response payment: " << payment_id
-                     << ", tx_id: " << rtaAuthResp.tx_id
-                     << ", from: " << rtaAuthResp.signature.id_key
-                     << ", result: " << int(result));
-
-        // store payment id for a logging purposes
-        ctx.local["payment_id"] = payment_id;
+        const string &payment_id = session->paymentId();
 
-        // validate signature
-        bool signOk = validateAuthResponse(rtaAuthResp, supernode);
-        if (!signOk) {
-            string msg = "failed to validate signature for rta auth response";
-            LOG_ERROR(msg);
-            return errorCustomError(msg,
-                                    ERROR_RTA_SIGNATURE_FAILED,
-                                    output);
-        }
         // stop handling it if we already processed response
-        RtaAuthResult authResult;
-        string ctx_tx_to_auth_resp = rtaAuthResp.tx_id + CONTEXT_KEY_AUTH_RESULT_BY_TXID;
-        if (ctx.global.hasKey(ctx_tx_to_auth_resp)) {
-            authResult = ctx.global.get(ctx_tx_to_auth_resp, authResult);
-        }
-
-        if (authResult.alreadyApproved(rtaAuthResp.signature.id_key)
-                || authResult.alreadyRejected(rtaAuthResp.signature.id_key)) {
+        size_t approved_votes = 0, rejected_votes = 0;
+        if (!session->addAuthVote(rtaAuthResp.signature, result == RTAAuthResult::Approved, approved_votes, rejected_votes)) {
             return errorCustomError(string("supernode: ") + rtaAuthResp.signature.id_key + " already processed",
                                     ERROR_ADDRESS_INVALID, output);
         }
 
-        if (result == RTAAuthResult::Approved) {
-            authResult.approved.push_back(rtaAuthResp.signature);
-        } else {
-            authResult.rejected.push_back(rtaAuthResp.signature);
-        }
-
         MDEBUG("rta result accepted from " << rtaAuthResp.signature.id_key
                << ", payment: " << payment_id);
+        // payment is kept while auth sample votes
+        session->touch(ctx);
 
-        // store result in context
-        ctx.global.set(ctx_tx_to_auth_resp, authResult, RTA_TX_TTL);
-        if (!ctx.global.hasKey(rtaAuthResp.tx_id + CONTEXT_KEY_AMOUNT_BY_TX_ID)) {
+        uint64_t tx_amount = 0;
+        if (!session->amount(tx_amount)) {
             string msg = string("no amount found for tx id: ") + rtaAuthResp.tx_id;
             LOG_ERROR(msg);
             return errorCustomError(msg, ERROR_INTERNAL_ERROR, output);
         }
 
-        uint64_t tx_amount = ctx.global.get(rtaAuthResp.tx_id + CONTEXT_KEY_AMOUNT_BY_TX_ID, uint64_t(0));
-
         size_t rta_votes_to_approve = tx_amount / COIN > 100 ? 4 : 2;
 
-        MDEBUG("approved votes: " << authResult.approved.size()
+        MDEBUG("approved votes: " << approved_votes
                << "/" << rta_votes_to_approve
-               << ", rejected votes: " << authResult.rejected.size()
+               << ", rejected votes: " << rejected_votes
                << ", payment: " << payment_id);
 
 
-        if (!ctx.global.hasKey(rtaAuthResp.tx_id + CONTEXT_KEY_TX_BY_TXID)) {
+        if (!session->hasTx()) {
             string msg = string("rta auth response processed but no tx found for tx id: ") + rtaAuthResp.tx_id;
             LOG_ERROR(msg);
             return errorCustomError(msg, ERROR_INTERNAL_ERROR, output);
         }
 
-        if (authResult.rejected.size() >= RTA_VOTES_TO_REJECT) {
+        if (rejected_votes >= RTA_VOTES_TO_REJECT) {
             MDEBUG("payment: " << payment_id
                    << ", tx_id: " << rtaAuthResp.tx_id
                    << " rejected by auth sample, updating status");
 
             // tx rejected by auth sample, broadcast status;
             ctx.global[__FUNCTION__] = RtaAuthResponseHandlerState::StatusBroadcastReply;
-            ctx.global.set(payment_id + CONTEXT_KEY_STATUS, static_cast<int> (RTAStatus::Fail), RTA_TX_TTL);
-            buildBroadcastSaleStatusOutput(payment_id, static_cast<int> (RTAStatus::Fail), supernode, output);
+            session->setStatus(ctx, RTAStatus::Fail);
+            buildBroadcastSaleStatusOutput(payment_id, static_cast<int> (RTAStatus::Fail), supernode, output,
+                                           useBinaryPayload(ctx));
             return Status::Forward;
-        } else if (authResult.approved.size() >= rta_votes_to_approve) {
+        } else if (approved_votes >= rta_votes_to_approve) {
             MDEBUG("payment: " << payment_id
                    << ", tx_id: " << rtaAuthResp.tx_id
                    << " approved by auth sample, pushing tx to pool");
@@ -491,8 +429,9 @@ Status handleRtaAuthResponseMulticast(const Router::vars_t& vars, const graft::I
             SendRawTxRequest req;
             // store tx_id in local context so we can use it when broadcasting status
             ctx.local[CONTEXT_TX_ID] = rtaAuthResp.tx_id;
-            cryptonote::transaction tx = ctx.global.get(rtaAuthResp.tx_id + CONTEXT_KEY_TX_BY_TXID, cryptonote::transaction());
-            putRtaSignaturesToTx(tx, authResult.approved, supernode->testnet());
+            cryptonote::transaction tx;
+            session->tx(tx);
+            putRtaSignaturesToTx(tx, session->approvedVotes(), supernode->testnet());
             createSendRawTxRequest(tx, req);
 #if 0
             // kept for future debugging
@@ -538,6 +477,148 @@ Status handleRtaAuthResponseMulticast(const Router::vars_t& vars, const graft::I
 }
 
 
+/*!
+ * \brief handleRtaAuthResponseMulticast - handles cryptonode/authorize_rta_tx_response call
+ * \param vars
+ * \param input
+ * \param ctx
+ * \param output
+ * \return
+ */
+Status handleRtaAuthResponseMulticast(const Router::vars_t& vars, const graft::Input& input,
+                            graft::Context& ctx, graft::Output& output)
+{
+
+    try {
+
+        MulticastRequestJsonRpc req;
+        MDEBUG(__FUNCTION__ << " begin");
+
+        if (!input.get(req)) { // can't parse request
+            LOG_ERROR("failed to parse request: " + input.data());
+            return errorCustomError(string("failed to parse request: ")  + input.data(), ERROR_INVALID_REQUEST, output);
+        }
+
+        // TODO: check if our address is listed in "receiver_addresses"
+        // the same vote can be delivered more than once, payload decoded only the first time
+        auto decoded = RtaTxCache::decodePayload<AuthorizeRtaTxResponse>(ctx, req.params.data);
+        if (!decoded->valid) {
+            LOG_ERROR("error deserialize rta auth response");
+            return errorInvalidParams(output);
+        }
+        AuthorizeRtaTxResponse rtaAuthResp = decoded->value;
+
+        SupernodePtr supernode = ctx.global.get(CONTEXT_KEY_SUPERNODE, SupernodePtr());
+
+        RTAAuthResult result = static_cast<RTAAuthResult>(rtaAuthResp.result);
+        // sanity check
+        if (result != RTAAuthResult::Approved && result != RTAAuthResult::Rejected) {
+            LOG_ERROR("Invalid rta auth result: " << rtaAuthResp.result);
+            return errorInvalidParams(output);
+        }
+
+
+        RtaSessionPtr session = RtaSession::findByTxId(ctx, rtaAuthResp.tx_id);
+        if (!session) {
+            LOG_ERROR("no payment_id for tx: " << rtaAuthResp.tx_id);
+            return errorCustomError(string("unknown tx: ") + rtaAuthResp.tx_id, ERROR_INTERNAL_ERROR, output);
+        }
+        const string &payment_id = session->paymentId();
+        MDEBUG("incoming tx auth response payment: " << payment_id
+                     << ", tx_id: " << rtaAuthResp.tx_id
+                     << ", from: " << rtaAuthResp.signature.id_key
+                     << ", result: " << int(result));
+
+        // store payment id for a logging purposes
+        ctx.local["payment_id"] = payment_id;
+
+        SignatureVerifierPtr verifier = ctx.global.get(CONTEXT_KEY_SIGNATURE_VERIFIER, SignatureVerifierPtr());
+        if (!verifier) {
+            // no verifier, validate signature in place
+            if (!validateAuthResponse(rtaAuthResp, supernode)) {
+                string msg = "failed to validate signature for rta auth response";
+                LOG_ERROR(msg);
+                return errorCustomError(msg,
+                                        ERROR_RTA_SIGNATURE_FAILED,
+                                        output);
+            }
+            return handleRtaAuthResponseVerified(rtaAuthResp, session, ctx, output);
+        }
+
+        SignatureVerifier::Batch batch;
+        if (!makeAuthResponseCheck(rtaAuthResp, batch)) {
+            string msg = "failed to validate signature for rta auth response";
+            LOG_ERROR(msg);
+            return errorCustomError(msg,
+                                    ERROR_RTA_SIGNATURE_FAILED,
+                                    output);
+        }
+
+        // signatures are checked by verifier threads together with other pending checks,
+        // the task is postponed until the verifier resumes it
+        RtaAuthResponseCheckPtr check = std::make_shared<RtaAuthResponseCheck>();
+        check->response = std::move(rtaAuthResp);
+        check->session = session;
+        ctx.local[CONTEXT_AUTH_RESPONSE_CHECK] = check;
+
+        HandlerAPI* handlerAPI = ctx.handlerAPI();
+        Context::uuid_t uuid = ctx.getId();
+        verifier->verifyAsync(std::move(batch), [handlerAPI, uuid, check](const SignatureVerifier::Results& results) {
+            check->results = results;
+            if (!handlerAPI->resumePostponedTask(uuid, Input())) {
+                LOG_ERROR("failed to resume task " << boost::uuids::to_string(uuid) << " after signature verification");
+            }
+        });
+
+        MDEBUG(__FUNCTION__ << " end, waiting for signature verification");
+        return Status::Postpone;
+
+    } catch (const std::exception &e) {
+        LOG_ERROR("std::exception  catched: " << e.what());
+        return errorInternalError(string("exception in cryptonode/authorize_rta_tx_response handler: ") +  e.what(),
+                                  output);
+    } catch (...) {
+        LOG_ERROR("unhandled exception");
+        return errorInternalError(string("unknown exception in cryptonode/authorize_rta_tx_response handler"),
+                                  output);
+    }
+}
+
+/*!
+ * \brief handleRtaAuthResponseSignatureVerified - handles rta auth response when the task resumed by signature verifier
+ * \param vars
+ * \param input
+ * \param ctx
+ * \param output
+ * \return
+ */
+Status handleRtaAuthResponseSignatureVerified(const Router::vars_t& vars, const graft::Input& input,
+                            graft::Context& ctx, graft::Output& output)
+{
+    try {
+        RtaAuthResponseCheckPtr check = ctx.local[CONTEXT_AUTH_RESPONSE_CHECK];
+        bool signOk = check->results.size() == 2 && check->results[0] && check->results[1];
+        if (!signOk) {
+            string msg = "failed to validate signature for rta auth response";
+            LOG_ERROR(msg);
+            return errorCustomError(msg,
+                                    ERROR_RTA_SIGNATURE_FAILED,
+                                    output);
+        }
+        return handleRtaAuthResponseVerified(check->response, check->session, ctx, output);
+
+    } catch (const std::exception &e) {
+        LOG_ERROR("std::exception  catched: " << e.what());
+        return errorInternalError(string("exception in cryptonode/authorize_rta_tx_response handler: ") +  e.what(),
+                                  output);
+    } catch (...) {
+        LOG_ERROR("unhandled exception");
+        return errorInternalError(string("unknown exception in cryptonode/authorize_rta_tx_response handler"),
+                                  output);
+    }
+}
+
+
 // handles "/sendrawtransaction" response
 Status handleCryptonodeTxPushResponse(const Router::vars_t& vars, const graft::Input& input,
                                graft::Context& ctx, graft::Output& output)
@@ -556,13 +637,15 @@ Status handleCryptonodeTxPushResponse(const Router::vars_t& vars, const graft::I
         abort();
     }
 
-    // obtain payment id for given tx_id
-    string payment_id = ctx.global.get(tx_id + CONTEXT_KEY_PAYMENT_ID_BY_TXID, std::string());
-    if (payment_id.empty()) {
+    // obtain payment for given tx_id
+    RtaSessionPtr session = RtaSession::findByTxId(ctx, tx_id);
+    if (!session) {
         LOG_ERROR("Internal error, payment id not found for tx id: " << tx_id);
+        return errorInvalidParams(output);
     }
+    const string &payment_id = session->paymentId();
 
-    RTAStatus status = static_cast<RTAStatus>(ctx.global.get(payment_id + CONTEXT_KEY_STATUS, int(RTAStatus::None)));
+    RTAStatus status = session->status();
     if (status == RTAStatus::None) {
         LOG_ERROR("can't find status for payment_id: " << payment_id);
         return errorInvalidParams(output);
@@ -599,7 +682,7 @@ Status handleCryptonodeTxPushResponse(const Router::vars_t& vars, const graft::I
     SupernodePtr supernode = ctx.global.get(CONTEXT_KEY_SUPERNODE, SupernodePtr());
 
     MDEBUG("broadcasting status for payment id: " << payment_id << ", status : " << int(status));
-    buildBroadcastSaleStatusOutput(payment_id, int(status), supernode, output);
+    buildBroadcastSaleStatusOutput(payment_id, int(status), supernode, output, useBinaryPayload(ctx));
     ctx.local[__FUNCTION__] = RtaAuthResponseHandlerState::StatusBroadcastReply;
     MDEBUG(__FUNCTION__ << " end");
     return Status::Forward;
@@ -684,9 +767,16 @@ Status authorizeRtaTxResponseHandler(const Router::vars_t& vars, const graft::In
 
         switch (state) {
         // actually not a reply, just incoming multicast. same as "called by client" and client is cryptonode here
-        case RtaAuthResponseHandlerState::RtaAuthReply:
+        case RtaAuthResponseHandlerState::RtaAuthReply: {
+            Status status = handleRtaAuthResponseMulticast(vars, input, ctx, output);
+            ctx.local[__FUNCTION__] = status == Status::Postpone ? RtaAuthResponseHandlerState::SignatureVerified
+                                                                 : RtaAuthResponseHandlerState::TransactionPushReply;
+            return status;
+        }
+
+        case RtaAuthResponseHandlerState::SignatureVerified:
             ctx.local[__FUNCTION__] = RtaAuthResponseHandlerState::TransactionPushReply;
-            return handleRtaAuthResponseMulticast(vars, input, ctx, output);
+            return handleRtaAuthResponseSignatureVerified(vars, input, ctx, output);
 
         case RtaAuthResponseHandlerState::TransactionPushReply:
             ctx.local[__FUNCTION__] = RtaAuthResponseHandlerState::StatusBroadcastReply;
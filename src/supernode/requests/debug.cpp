@@ -7,6 +7,8 @@
 #include "supernode/requests/pay.h"
 #include "supernode/requestdefines.h"
 #include "lib/graft/requesttools.h"
+#include "lib/graft/handler_api.h"
+#include "lib/graft/trace.h"
 #include "rta/supernode.h"
 #include "rta/fullsupernodelist.h"
 
@@ -55,11 +57,12 @@ Status getSupernodeList(const Router::vars_t& vars, const graft::Input& input,
     }
 
     FullSupernodeListPtr fsl = ctx.global.get(CONTEXT_KEY_FULLSUPERNODELIST, FullSupernodeListPtr());
-    auto supernodes = fsl->items();
+    // single consistent version of the list for the whole listing
+    FullSupernodeList::SnapshotPtr snapshot = fsl->snapshot();
 
     SupernodeListJsonRpcResult resp;
 
-    resp.result.height = fsl->getBlockchainBasedListMaxBlockNumber();
+    resp.result.height = snapshot->blockchain_based_list_max_block_number;
     resp.result.has_blockchain_based_list = fsl->hasBlockchainBasedList(resp.result.height);
 
     FullSupernodeList::blockchain_based_list auth_sample_base_list;
@@ -78,9 +81,9 @@ Status getSupernodeList(const Router::vars_t& vars, const graft::Input& input,
         return false;
     };
 
-    for (auto& sa : supernodes)
+    for (const auto& sn_desc : snapshot->list)
     {
-        auto sPtr = fsl->get(sa);
+        const SupernodePtr& sPtr = sn_desc.second;
         MDEBUG("checking supernode: " << sPtr->walletAddress());
         if (sPtr->busy()) {
             MDEBUG("supernode: " << sPtr->walletAddress() << " is currently busy");
@@ -264,6 +267,14 @@ Status getBlockchainBasedList(const Router::vars_t& vars, const graft::Input& in
   return getBlockchainBasedListImpl(vars, input, ctx, output, mode);
 }
 
+Status getTrace(const Router::vars_t& vars, const graft::Input& input,
+                graft::Context& ctx, graft::Output& output)
+{
+    // open the result in chrome://tracing or Perfetto
+    output.body = ctx.handlerAPI()->tracer().dumpChromeTrace();
+    return Status::Ok;
+}
+
 void __registerDebugRequests(Router &router)
 {
 #define _HANDLER(h) {nullptr, graft::supernode::request::debug::h, nullptr}
@@ -275,6 +286,7 @@ void __registerDebugRequests(Router &router)
     router.addRoute("/debug/announce", METHOD_POST, _HANDLER(doAnnounce));
     router.addRoute("/debug/close_wallets/", METHOD_POST, _HANDLER(closeStakeWallets));
     router.addRoute("/debug/auth_sample/{payment_id:[0-9a-zA-Z]+}", METHOD_GET, _HANDLER(getAuthSample));
+    router.addRoute("/debug/trace", METHOD_GET, _HANDLER(getTrace));
 }
 
 }
@@ -3,6 +3,8 @@
 #include "lib/graft/jsonrpc.h"
 #include "supernode/requests/pay.h"
 #include "supernode/requestdefines.h"
+#include "supernode/rtasession.h"
+#include "supernode/rtatxcache.h"
 #include "lib/graft/requesttools.h"
 #include "supernode/requests/broadcast.h"
 #include "supernode/requests/multicast.h"
@@ -38,29 +40,24 @@ Status processAuthorizationRequest(const std::string &tx_hex, const PayRequest &
                                    graft::Output& output)
 {
     MDEBUG(__FUNCTION__ << " begin");
-    // parse tx and validate tx, read tx id
-    cryptonote::transaction tx;
-    crypto::hash tx_hash, tx_prefix_hash;
-    cryptonote::blobdata tx_blob;
-
-    if (!epee::string_tools::parse_hexstr_to_binbuff(tx_hex, tx_blob)) {
-        return errorInvalidTransaction(tx_hex, output);
-    }
-    if (!cryptonote::parse_and_validate_tx_from_blob(tx_blob, tx, tx_hash, tx_prefix_hash)) {
+    // parse tx and validate tx, read tx id. decoded tx is cached, so it is not parsed again
+    // when the auth request with the same tx comes back to this supernode
+    DecodedTxPtr decoded = RtaTxCache::decodeTx(ctx, tx_hex);
+    if (!decoded->valid) {
         return errorInvalidTransaction(tx_hex, output);
     }
 
     MDEBUG("processing pay, payment:  "
            << pay_request.PaymentID
-           << ", tx_id: " <<  epee::string_tools::pod_to_hex(tx_hash)
+           << ", tx_id: " << decoded->tx_id
            << ", block: " << pay_request.BlockNumber
            << ", to: " << pay_request.Address
            << ", amount: " << pay_request.Amount
            << ", auth sample: " << authSample);
 
     // map tx_id -> payment id
-    ctx.global.set(epee::string_tools::pod_to_hex(tx_hash) + CONTEXT_KEY_PAYMENT_ID_BY_TXID,
-                   pay_request.PaymentID, RTA_TX_TTL);
+    RtaSessionPtr session = RtaSession::getOrCreate(ctx, pay_request.PaymentID);
+    RtaSession::bindTx(ctx, session, decoded->tx_id, decoded->tx);
 
     // send multicast to /cryptonode/authorize_rta_tx_request
     MulticastRequestJsonRpc cryptonode_req;
@@ -75,7 +72,7 @@ Status processAuthorizationRequest(const std::string &tx_hex, const PayRequest &
     authTxReq.payment_id = pay_request.PaymentID;
     authTxReq.amount = pay_request.Amount;
 
-    innerOut.loadT<serializer::JSON_B64>(authTxReq);
+    loadPayload(innerOut, authTxReq, useBinaryPayload(ctx, cryptonode_req.params.receiver_addresses));
     cryptonode_req.method = "multicast";
     cryptonode_req.params.callback_uri =  "/cryptonode/authorize_rta_tx_request";
     cryptonode_req.params.data = innerOut.data();
@@ -84,8 +81,8 @@ Status processAuthorizationRequest(const std::string &tx_hex, const PayRequest &
     ctx.local["payment_id"] = pay_request.PaymentID;
     // TODO: what is the purpose of PayData?
     PayData data(pay_request.Address, pay_request.BlockNumber, pay_request.Amount);
-    ctx.global[pay_request.PaymentID + CONTEXT_KEY_PAY] = data;
-    ctx.global[pay_request.PaymentID + CONTEXT_KEY_STATUS] = static_cast<int>(RTAStatus::InProgress);
+    session->setPay(data);
+    session->setStatus(ctx, RTAStatus::InProgress);
 
     output.load(cryptonode_req);
     output.path = "/json_rpc/rta";
@@ -116,7 +113,8 @@ Status handleClientPayRequest(const Router::vars_t& vars, const graft::Input& in
         return errorInvalidAddress(output);
     }
 
-    int current_status = ctx.global.get(in.PaymentID + CONTEXT_KEY_STATUS, static_cast<int>(RTAStatus::None));
+    RtaSessionPtr session = RtaSession::find(ctx, in.PaymentID);
+    int current_status = static_cast<int>(session ? session->status() : RTAStatus::None);
     if (errorFinishedPayment(current_status, output)) {
         return Status::Error;
     }
@@ -207,7 +205,8 @@ Status handleWaitingTxReply(const Router::vars_t& vars, const graft::Input& inpu
         return errorInvalidAddress(output);
     }
 
-    int current_status = ctx.global.get(payData.PaymentID + CONTEXT_KEY_STATUS, static_cast<int>(RTAStatus::None));
+    RtaSessionPtr session = RtaSession::find(ctx, payData.PaymentID);
+    int current_status = static_cast<int>(session ? session->status() : RTAStatus::None);
     if (errorFinishedPayment(current_status, output)) {
         return Status::Error;
     }
@@ -236,8 +235,7 @@ Status handleTxAuthReply(const Router::vars_t& vars, const graft::Input& input,
     JsonRpcErrorResponse error;
     if (!input.get(resp) || resp.error.code != 0 || resp.result.status != STATUS_OK) {
 
-        ctx.global.remove(payment_id + CONTEXT_KEY_PAY);
-        ctx.global.remove(payment_id + CONTEXT_KEY_STATUS);
+        RtaSession::remove(ctx, payment_id);
 
         error.error.code = ERROR_INTERNAL_ERROR;
         error.error.message = "Error multicasting request";
@@ -249,8 +247,9 @@ Status handleTxAuthReply(const Router::vars_t& vars, const graft::Input& input,
     SupernodePtr supernode = ctx.global.get(CONTEXT_KEY_SUPERNODE, SupernodePtr());
     MDEBUG("pay multicasted for payment: " << payment_id);
 
-    int status = ctx.global.get(payment_id + CONTEXT_KEY_STATUS, static_cast<int>((RTAStatus::InProgress)));
-    buildBroadcastSaleStatusOutput(payment_id, status, supernode, output);
+    RtaSessionPtr session = RtaSession::find(ctx, payment_id);
+    int status = static_cast<int>(session ? session->status() : RTAStatus::InProgress);
+    buildBroadcastSaleStatusOutput(payment_id, status, supernode, output, useBinaryPayload(ctx));
     MDEBUG("broadcasting status for payment:  " << payment_id);
     MDEBUG(__FUNCTION__ << " end");
     return Status::Forward;
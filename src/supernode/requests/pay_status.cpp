@@ -1,6 +1,7 @@
 
 #include "supernode/requests/pay_status.h"
 #include "supernode/requestdefines.h"
+#include "supernode/rtasession.h"
 #include "lib/graft/jsonrpc.h"
 #include <misc_log_ex.h>
 
@@ -28,7 +29,8 @@ Status payStatusHandler(const Router::vars_t& vars, const graft::Input& input,
 
     MDEBUG("requested status for payment: " << in.PaymentID);
 
-    int current_status = ctx.global.get(in.PaymentID + CONTEXT_KEY_STATUS, static_cast<int>(RTAStatus::None));
+    RtaSessionPtr session = RtaSession::find(ctx, in.PaymentID);
+    int current_status = static_cast<int>(session ? session->status() : RTAStatus::None);
     if (in.PaymentID.empty() || current_status == 0)
     {
         MWARNING("no status for payment: " << in.PaymentID);
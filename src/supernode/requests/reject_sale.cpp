@@ -1,6 +1,7 @@
 
 #include "supernode/requests/reject_sale.h"
 #include "supernode/requestdefines.h"
+#include "supernode/rtasession.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "supernode.rejectsalerequest"
@@ -11,12 +12,12 @@ Status rejectSaleHandler(const Router::vars_t& vars, const graft::Input& input,
                          graft::Context& ctx, graft::Output& output)
 {
     RejectSaleRequest in = input.get<RejectSaleRequest>();
-    int current_status = ctx.global.get(in.PaymentID + CONTEXT_KEY_STATUS, static_cast<int>(RTAStatus::None));
-    if (in.PaymentID.empty() || current_status == 0)
+    RtaSessionPtr session = RtaSession::find(ctx, in.PaymentID);
+    if (!session || session->status() == RTAStatus::None)
     {
         return errorInvalidPaymentID(output);
     }
-    ctx.global[in.PaymentID + CONTEXT_KEY_STATUS] = static_cast<int>(RTAStatus::RejectedByPOS);
+    session->setStatus(ctx, RTAStatus::RejectedByPOS);
     // TODO: Reject Sale: Add broadcast and another business logic
     RejectSaleResponse out;
     out.Result = STATUS_OK;
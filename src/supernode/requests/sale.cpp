@@ -5,6 +5,7 @@
 #include "supernode/requests/sale_status.h"
 
 #include "supernode/requestdefines.h"
+#include "supernode/rtasession.h"
 #include "lib/graft/requesttools.h"
 #include "rta/supernode.h"
 #include "rta/fullsupernodelist.h"
@@ -22,8 +23,6 @@ BOOST_HANA_ADAPT_STRUCT(graft::SaleData,
 
 namespace graft::supernode::request {
 
-static const std::chrono::seconds SALE_TTL = std::chrono::seconds(60);
-
 // message to be multicasted to auth sample
 GRAFT_DEFINE_IO_STRUCT(SaleDataMulticast,
                        (SaleData, sale_data),
@@ -73,12 +72,14 @@ Status handleClientSaleRequest(const Router::vars_t& vars, const graft::Input& i
     // reply to caller (POS)
     SaleData data(in.IdKey, fsl->getBlockchainBasedListMaxBlockNumber(), in.Amount);
 
+    RtaSessionPtr session = RtaSession::getOrCreate(ctx, payment_id);
+
     // what needs to be multicasted to auth sample ?
     // 1. payment_id
     // 2. SaleData
     if (!in.SaleDetails.empty())
     {
-        ctx.global.set(payment_id + CONTEXT_KEY_SALE_DETAILS, in.SaleDetails, SALE_TTL);
+        session->setSaleDetails(in.SaleDetails);
     }
 
     // generate auth sample
@@ -91,8 +92,8 @@ Status handleClientSaleRequest(const Router::vars_t& vars, const graft::Input& i
     // here we need to perform two actions:
     // 1. multicast sale over auth sample
     // 2. broadcast sale status
-    ctx.global.set(payment_id + CONTEXT_KEY_SALE, data, SALE_TTL);
-    ctx.global.set(payment_id + CONTEXT_KEY_STATUS, static_cast<int>(RTAStatus::Waiting), SALE_TTL);
+    session->setSale(data);
+    session->setStatus(ctx, RTAStatus::Waiting);
 
     // store SaleData, payment_id and status in local context, so when we got reply from cryptonode, we just pass it to client
     ctx.local["sale_data"]  = data;
@@ -105,8 +106,6 @@ Status handleClientSaleRequest(const Router::vars_t& vars, const graft::Input& i
     sdm.sale_data = data;
     sdm.status = static_cast<int>(RTAStatus::Waiting);
     sdm.details = in.SaleDetails;
-    Output innerOut;
-    innerOut.loadT<serializer::JSON_B64>(sdm);
 
     MulticastRequestJsonRpc cryptonode_req;
 
@@ -114,6 +113,9 @@ Status handleClientSaleRequest(const Router::vars_t& vars, const graft::Input& i
         cryptonode_req.params.receiver_addresses.push_back(sn->idKeyAsString());
     }
 
+    Output innerOut;
+    loadPayload(innerOut, sdm, useBinaryPayload(ctx, cryptonode_req.params.receiver_addresses));
+
     MINFO("processed, payment_id: " << payment_id
            << ", block: " << data.BlockNumber
            << ", auth sample: [" << authSample << "]");
@@ -145,9 +147,10 @@ Status handleSaleMulticastReply(const Router::vars_t& vars, const graft::Input&
     SupernodePtr supernode = ctx.global.get(CONTEXT_KEY_SUPERNODE, SupernodePtr());
 
     string payment_id = ctx.local["payment_id"];
-    int status = ctx.global.get(payment_id + CONTEXT_KEY_STATUS, static_cast<int>((RTAStatus::Waiting)));
+    RtaSessionPtr session = RtaSession::find(ctx, payment_id);
+    int status = static_cast<int>(session ? session->status() : RTAStatus::Waiting);
 
-    buildBroadcastSaleStatusOutput(payment_id, status, supernode, output);
+    buildBroadcastSaleStatusOutput(payment_id, status, supernode, output, useBinaryPayload(ctx));
     MINFO("sale multicast sent, broadcasting sale status: "
            << status <<  ", payment_id: " << payment_id);
     MDEBUG("broadcasting:  " << output.data());
@@ -244,7 +247,7 @@ Status saleCryptonodeHandler(const Router::vars_t& vars, const graft::Input& inp
     graft::Input innerInput;
     innerInput.load(req.params.data);
 
-    if (!innerInput.getT<serializer::JSON_B64>(sdm)) {
+    if (!innerInput.getT<serializer::ANY_B64>(sdm)) {
         return errorInvalidParams(output);
     }
     const std::string &payment_id = sdm.paymentId;
@@ -252,11 +255,15 @@ Status saleCryptonodeHandler(const Router::vars_t& vars, const graft::Input& inp
 
     // TODO: should be signed by sender??
 
-    if (!ctx.global.hasKey(payment_id + CONTEXT_KEY_SALE)) {
-        // TODO: clenup after payment done;
-        ctx.global[payment_id + CONTEXT_KEY_SALE] = sdm.sale_data;
-        ctx.global[payment_id + CONTEXT_KEY_STATUS] = sdm.status;
-        ctx.global[payment_id + CONTEXT_KEY_SALE_DETAILS] = sdm.details;
+    if (payment_id.empty()) {
+        return errorInvalidPaymentID(output);
+    }
+
+    RtaSessionPtr session = RtaSession::getOrCreate(ctx, payment_id);
+    if (!session->hasSale()) {
+        session->setSale(sdm.sale_data);
+        session->setStatus(ctx, static_cast<RTAStatus>(sdm.status));
+        session->setSaleDetails(sdm.details);
     } else {
         MWARNING("payment " << payment_id << " already known");
     }
@@ -2,6 +2,7 @@
 #include "supernode/requests/sale_details.h"
 #include "supernode/requests/unicast.h"
 #include "supernode/requestdefines.h"
+#include "supernode/rtasession.h"
 #include "lib/graft/jsonrpc.h"
 #include "lib/graft/router.h"
 #include "rta/fullsupernodelist.h"
@@ -24,22 +25,18 @@ GRAFT_DEFINE_JSON_RPC_RESPONSE_RESULT(SaleDetailsResponseJsonRpc, SaleDetailsRes
 
 
 // helper function. prepares sale details response for given request
-bool prepareSaleDetailsResponse(const SaleDetailsRequest &req, graft::Context &ctx, SaleDetailsResponse &resp, JsonRpcError &error,
+bool prepareSaleDetailsResponse(const SaleDetailsRequest &req, const RtaSessionPtr &session, SaleDetailsResponse &resp, JsonRpcError &error,
                                 const std::vector<SupernodePtr> &authSample)
 {
-    // generate auth sample
-    SaleDetailsResponseJsonRpc out;
-
-
-    if (!ctx.global.hasKey(req.PaymentID + CONTEXT_KEY_SALE)) {
+    SaleData sale_data;
+    if (!session || !session->sale(sale_data)) {
         error.code = ERROR_PAYMENT_ID_INVALID;
         error.message = string("sale data missing for payment: ") + req.PaymentID;
         LOG_ERROR(__FUNCTION__ << " " << error.message);
         return false;
     }
 
-    resp.Details = ctx.global.get(req.PaymentID + CONTEXT_KEY_SALE_DETAILS, std::string());
-    SaleData sale_data = ctx.global.get(req.PaymentID + CONTEXT_KEY_SALE, SaleData());
+    session->saleDetails(resp.Details);
 
     uint64_t total_fee = static_cast<uint64_t>(std::round(sale_data.Amount * AUTHSAMPLE_FEE_PERCENTAGE / 100.0));
 
@@ -79,7 +76,8 @@ Status handleClientRequest(const Router::vars_t& vars, const graft::Input& input
         return errorInvalidPaymentID(output);
     }
 
-    int current_status = ctx.global.get(in.PaymentID + CONTEXT_KEY_STATUS, static_cast<int>(RTAStatus::None));
+    RtaSessionPtr session = RtaSession::find(ctx, in.PaymentID);
+    int current_status = static_cast<int>(session ? session->status() : RTAStatus::None);
 
     if (errorFinishedPayment(current_status, output))
     {
@@ -88,9 +86,9 @@ Status handleClientRequest(const Router::vars_t& vars, const graft::Input& input
 
 
     // check if we have cached response
-    if (ctx.global.hasKey(in.PaymentID + CONTEXT_SALE_DETAILS_RESULT)) {
+    SaleDetailsResponse sdr;
+    if (session && session->saleDetailsResult(sdr)) {
         MDEBUG("found cached sale details for payment: " << in.PaymentID);
-        SaleDetailsResponse sdr = ctx.global.get(in.PaymentID + CONTEXT_SALE_DETAILS_RESULT, SaleDetailsResponse());
         SaleDetailsResponseJsonRpc out;
         out.result = sdr;
         output.load(out);
@@ -106,13 +104,12 @@ Status handleClientRequest(const Router::vars_t& vars, const graft::Input& input
         return  errorBuildAuthSample(output);
     }
     // we have sale details locally, easy way
-    bool have_data_locally = ctx.global.hasKey(in.PaymentID + CONTEXT_KEY_SALE_DETAILS);
+    bool have_data_locally = session && session->hasSaleDetails();
 
     if (have_data_locally) {
         MDEBUG("found sale details locally for payment id: " << in.PaymentID << ", auth sample: " << authSample);
-        SaleDetailsResponse sdr;
         SaleDetailsResponseJsonRpc out;
-        if (!prepareSaleDetailsResponse(in, ctx, sdr, error, authSample)) {
+        if (!prepareSaleDetailsResponse(in, session, sdr, error, authSample)) {
             JsonRpcErrorResponse er;
             er.error = error;
             output.load(error);
@@ -141,14 +138,14 @@ Status handleClientRequest(const Router::vars_t& vars, const graft::Input& input
 
         // store payment id so we can cache sale_details from remote supernode
         ctx.local["payment_id"] = in.PaymentID;
-        Output innerOut;
         in.callback_uri = "/cryptonode/callback/sale_details/" + boost::uuids::to_string(ctx.getId());
-        innerOut.loadT<serializer::JSON_B64>(in);
         UnicastRequestJsonRpc unicastReq;
         unicastReq.params.sender_address = supernode->idKeyAsString();
         size_t maxIndex = authSample.size() - 1;
         size_t randomIndex = utils::random_number<size_t>(0, maxIndex);
         unicastReq.params.receiver_address = authSample.at(randomIndex)->idKeyAsString();
+        Output innerOut;
+        loadPayload(innerOut, in, useBinaryPayload(ctx, {unicastReq.params.receiver_address}));
         MDEBUG("requesting sale details from remote supernode: "
                << unicastReq.params.receiver_address
                << ", for payment: " << in.PaymentID);
@@ -217,13 +214,15 @@ Status handleSaleDetailsResponse(const Router::vars_t& vars, const graft::Input&
 
     SaleDetailsResponse sdr;
 
-    if (!innerIn.getT<serializer::JSON_B64>(sdr)) {
+    if (!innerIn.getT<serializer::ANY_B64>(sdr)) {
         LOG_ERROR("error deserialize rta auth response");
         return errorInvalidParams(output);
     }
 
     // cache response;
-    ctx.global.set(payment_id + CONTEXT_SALE_DETAILS_RESULT, sdr, RTA_TX_TTL);
+    RtaSessionPtr session = RtaSession::getOrCreate(ctx, payment_id);
+    session->setSaleDetailsResult(sdr);
+    session->touch(ctx);
 
     // remove callback reply
     ctx.global.remove(task_id + CONTEXT_SALE_DETAILS_RESULT);
@@ -280,7 +279,7 @@ Status handleSaleDetailsUnicastRequest(const Router::vars_t& vars, const graft::
 
     SaleDetailsRequest sdr;
 
-    if (!innerIn.getT<serializer::JSON_B64>(sdr)) {
+    if (!innerIn.getT<serializer::ANY_B64>(sdr)) {
         LOG_ERROR("error deserialize rta auth response");
         return sendOkResponseToCryptonode(output); // cryptonode doesn't care about any errors, it's job is only deliver request
     }
@@ -299,20 +298,21 @@ Status handleSaleDetailsUnicastRequest(const Router::vars_t& vars, const graft::
         return sendOkResponseToCryptonode(output); // cryptonode doesn't care about any errors, it's job is only deliver request
     }
 
-    if (ctx.global.hasKey(sdr.PaymentID + CONTEXT_KEY_SALE_DETAILS)) {
+    RtaSessionPtr session = RtaSession::find(ctx, sdr.PaymentID);
+    if (session && session->hasSaleDetails()) {
         MDEBUG("sale details found for payment: " << sdr.PaymentID
                << ", auth sample: " << authSample);
 
         SaleDetailsResponse resp;
 
         JsonRpcError error;
-        if (!prepareSaleDetailsResponse(sdr, ctx, resp, error, authSample)) {
+        if (!prepareSaleDetailsResponse(sdr, session, resp, error, authSample)) {
             LOG_ERROR("Error preparing sale details response for payment: " << sdr.PaymentID);
             return sendOkResponseToCryptonode(output); // cryptonode doesn't care about any errors, it's job is only deliver request
         } else {
             UnicastRequestJsonRpc callbackReq;
             Output innerOut;
-            innerOut.loadT<serializer::JSON_B64>(resp);
+            loadPayload(innerOut, resp, useBinaryPayload(ctx, {unicastReq.sender_address}));
 
             callbackReq.params.data = innerOut.data();
             callbackReq.params.callback_uri = sdr.callback_uri;
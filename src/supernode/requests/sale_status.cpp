@@ -2,6 +2,7 @@
 #include "supernode/requests/sale_status.h"
 #include "supernode/requests/broadcast.h"
 #include "supernode/requestdefines.h"
+#include "supernode/rtasession.h"
 #include <misc_log_ex.h>
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
@@ -29,7 +30,8 @@ Status saleStatusHandler(const Router::vars_t& vars, const graft::Input& input,
 
     const SaleStatusRequest &in = req.params;
     MDEBUG("requested status for payment: " << in.PaymentID);
-    int current_status = ctx.global.get(in.PaymentID + CONTEXT_KEY_STATUS, static_cast<int>(RTAStatus::None));
+    RtaSessionPtr session = RtaSession::find(ctx, in.PaymentID);
+    int current_status = static_cast<int>(session ? session->status() : RTAStatus::None);
     if (in.PaymentID.empty() || current_status == 0)
     {
         MWARNING("no status for payment: " << in.PaymentID);
@@ -63,7 +65,7 @@ Status updateSaleStatusHandler(const Router::vars_t& vars, const graft::Input& i
     graft::Input innerInput;
     innerInput.load(req.params.data);
 
-    if (!innerInput.getT<serializer::JSON_B64>(ussb)) {
+    if (!innerInput.getT<serializer::ANY_B64>(ussb)) {
         return errorInvalidParams(output);
     }
 
@@ -82,13 +84,12 @@ Status updateSaleStatusHandler(const Router::vars_t& vars, const graft::Input& i
         return Status::Error;
     } else {
         // TODO: complete state chart for status transitions
-        RTAStatus currentStatus = static_cast<RTAStatus>(ctx.global.get(ussb.PaymentID + CONTEXT_KEY_STATUS, int(RTAStatus::None)));
-        if (!isFiniteRtaStatus(currentStatus)) {
-            ctx.global.set(ussb.PaymentID + CONTEXT_KEY_STATUS, ussb.Status, RTA_TX_TTL);
+        RtaSessionPtr session = RtaSession::getOrCreate(ctx, ussb.PaymentID);
+        if (session->updateStatus(ctx, static_cast<RTAStatus>(ussb.Status))) {
             MDEBUG("sale status updated for payment: " << ussb.PaymentID << " to: " << ussb.Status);
         } else {
             MWARNING("status already in finite state for payment: " << ussb.PaymentID
-                     << ", current status: " << int(currentStatus)
+                     << ", current status: " << int(session->status())
                      << ", wont update to: " << ussb.Status);
         }
     }
@@ -31,6 +31,8 @@
 #include "supernode/requestdefines.h"
 #include "rta/fullsupernodelist.h"
 #include "rta/supernode.h"
+#include "rta/signatureverifier.h"
+#include "rta/announcefilter.h"
 
 #include <misc_log_ex.h>
 #include <boost/shared_ptr.hpp>
@@ -41,11 +43,49 @@
 
 namespace {
     static const char* PATH = "/send_supernode_announce";
+    static const std::string CONTEXT_ANNOUNCE_CHECK("announce_check");
 
 }
 
 namespace graft::supernode::request {
 
+// announce waiting for signature verification
+struct AnnounceCheck
+{
+    SupernodeAnnounce announce;
+    // written by verifier thread before the task is resumed
+    SignatureVerifier::Results results;
+};
+
+using AnnounceCheckPtr = std::shared_ptr<AnnounceCheck>;
+
+/*!
+ * \brief applyAnnounce - applies announce which signature is already verified, without waiting for other announces
+ * \param fsl
+ * \param announce
+ * \return
+ */
+static bool applyAnnounce(const FullSupernodeListPtr &fsl, const SupernodeAnnounce &announce)
+{
+    // supernodes of the list are never changed in place, the announce is applied as a batch of its own
+    fsl->queueAnnounce(announce);
+    return fsl->applyQueuedAnnounces() > 0;
+}
+
+/*!
+ * \brief chargeAnnounce - DOS protection: too frequent announces of a supernode are dropped;
+ *        only announces with verified signatures are charged, so forged ones can't drain the rate of the supernode
+ * \return false if the announce should be dropped
+ */
+static bool chargeAnnounce(const AnnounceFilterPtr &filter, const SupernodeAnnounce &announce)
+{
+    if (filter && filter->charge(announce.supernode_public_id) == AnnounceFilter::Result::Throttled) {
+        MWARNING("too frequent announces for id: " << announce.supernode_public_id << ", announce dropped");
+        return false;
+    }
+    return true;
+}
+
 /**
  * @brief
  * @param vars
@@ -58,7 +98,6 @@ Status handleSupernodeAnnounce(const Router::vars_t& vars, const graft::Input& i
                                  graft::Context& ctx, graft::Output& output)
 {
     LOG_PRINT_L1(PATH << " called with payload: " << input.data());
-    // TODO: implement DOS protection, ignore too frequent requests
 
     boost::shared_ptr<FullSupernodeList> fsl = ctx.global.get(CONTEXT_KEY_FULLSUPERNODELIST,
                                                               boost::shared_ptr<FullSupernodeList>());
@@ -86,38 +125,79 @@ Status handleSupernodeAnnounce(const Router::vars_t& vars, const graft::Input& i
     const SupernodeAnnounce & announce = req.params;
     MINFO("received announce for id: " << announce.supernode_public_id);
 
-    if (fsl->exists(announce.supernode_public_id)) {
-        // check if supernode currently busy
-        SupernodePtr sn = fsl->get(announce.supernode_public_id);
-        if (sn->busy()) {
-            MWARNING("Unable to update supernode with announce: " << announce.supernode_public_id << ", BUSY");
-            return Status::Error; // we don't care about reply here, already replied to the client
-        }
-        if (!fsl->get(announce.supernode_public_id)->updateFromAnnounce(announce)) {
-            LOG_ERROR("Failed to update supernode with announce: " << announce.supernode_public_id);
-            return Status::Error; // we don't care about reply here, already replied to the client
-        }
-    } else {
-        std::string cryptonode_rpc_address = ctx.global["cryptonode_rpc_address"];
-        bool testnet = ctx.global["testnet"];
-
-        Supernode * s  = Supernode::createFromAnnounce(announce,
-                                                       cryptonode_rpc_address,
-                                                       testnet);
-        if (!s) {
-            LOG_ERROR("Cant create watch-only supernode wallet for id: " << announce.supernode_public_id);
-            return Status::Error;
+    // DOS protection: copies of the same announce are dropped before the signature check
+    AnnounceFilterPtr filter = ctx.global.get(CONTEXT_KEY_ANNOUNCE_FILTER, AnnounceFilterPtr());
+    if (filter && filter->check(announce.supernode_public_id, announce.height, announce.signature) == AnnounceFilter::Result::Duplicate) {
+        MDEBUG("duplicated announce for id: " << announce.supernode_public_id << ", height: " << announce.height);
+        return Status::Ok;
+    }
 
+    crypto::public_key id_key;
+    crypto::signature sign;
+    std::string msg;
+    if (!Supernode::parseAnnounce(announce, id_key, sign, msg)) {
+        LOG_ERROR("Failed to parse announce: " << announce.supernode_public_id);
+        return Status::Error;
+    }
+
+    SignatureVerifierPtr verifier = ctx.global.get(CONTEXT_KEY_SIGNATURE_VERIFIER, SignatureVerifierPtr());
+    if (!verifier) {
+        if (!Supernode::verifySignature(msg, id_key, sign)) {
+            MERROR("Signature check failed for announce: " << announce.supernode_public_id);
+            return Status::Error;
         }
+        if (!chargeAnnounce(filter, announce))
+            return Status::Ok;
+        // we don't care about reply here, already replied to the client
+        return applyAnnounce(fsl, announce) ? Status::Ok : Status::Error;
+    }
 
-        MINFO("About to add supernode to list [" << s << "]: " << s->idKeyAsString());
-        if (!fsl->add(s)) {
-            // DO NOT delete "s" here, it will be deleted by smart pointer;
-            LOG_ERROR("Can't add new supernode to list [" << s << "]" << s->idKeyAsString());
+    // signature is checked by verifier threads together with other pending checks, outside of the list lock;
+    // the task is postponed until the verifier resumes it, verified announce is applied by the task itself
+    AnnounceCheckPtr check = std::make_shared<AnnounceCheck>();
+    check->announce = announce;
+    ctx.local[CONTEXT_ANNOUNCE_CHECK] = check;
+
+    HandlerAPI* handlerAPI = ctx.handlerAPI();
+    Context::uuid_t uuid = ctx.getId();
+    SignatureVerifier::Batch batch{SignatureVerifier::makeItem(msg, id_key, sign)};
+    verifier->verifyAsync(std::move(batch), [handlerAPI, uuid, check](const SignatureVerifier::Results& results) {
+        check->results = results;
+        if (!handlerAPI->resumePostponedTask(uuid, Input())) {
+            LOG_ERROR("failed to resume task " << boost::uuids::to_string(uuid) << " after announce signature verification");
         }
+    });
+    return Status::Postpone;
+
+}
+
+/*!
+ * \brief handleSupernodeAnnounceVerified - queues announce when the task resumed by signature verifier;
+ *        queued announces are applied to the list in a batch with other announces
+ */
+Status handleSupernodeAnnounceVerified(const Router::vars_t& vars, const graft::Input& input,
+                                       graft::Context& ctx, graft::Output& output)
+{
+    AnnounceCheckPtr check = ctx.local[CONTEXT_ANNOUNCE_CHECK];
+    if (check->results.size() != 1 || !check->results[0]) {
+        MERROR("Signature check failed for announce: " << check->announce.supernode_public_id);
+        return Status::Error;
+    }
+
+    AnnounceFilterPtr filter = ctx.global.get(CONTEXT_KEY_ANNOUNCE_FILTER, AnnounceFilterPtr());
+    if (!chargeAnnounce(filter, check->announce))
+        return Status::Ok;
+
+    boost::shared_ptr<FullSupernodeList> fsl = ctx.global.get(CONTEXT_KEY_FULLSUPERNODELIST,
+                                                              boost::shared_ptr<FullSupernodeList>());
+    if (!fsl) {
+        LOG_ERROR("Internal error. Supernode list object missing");
+        return Status::Error;
     }
-    return Status::Ok;
 
+    if (fsl->queueAnnounce(check->announce) >= FullSupernodeList::ANNOUNCE_BATCH_SIZE)
+        fsl->applyQueuedAnnounces();
+    return Status::Ok;
 }
 
 Status sendSupernodeAnnounceHandler(const Router::vars_t& vars, const graft::Input& input,
@@ -126,7 +206,9 @@ Status sendSupernodeAnnounceHandler(const Router::vars_t& vars, const graft::Inp
 
     enum class State : int {
         IncomingRequest = 0,
-        HandleAnnounce
+        HandleAnnounce,
+        // signature of the announce verified, task resumed by signature verifier
+        SignatureVerified
     };
 
     State state = ctx.local.hasKey(__FUNCTION__) ? ctx.local[__FUNCTION__] : State::IncomingRequest;
@@ -136,7 +218,10 @@ Status sendSupernodeAnnounceHandler(const Router::vars_t& vars, const graft::Inp
         ctx.local[__FUNCTION__] = State::HandleAnnounce;
         return storeRequestAndReplyOk<SendSupernodeAnnounceJsonRpcResponse>(vars, input, ctx, output);
     case State::HandleAnnounce:
+        ctx.local[__FUNCTION__] = State::SignatureVerified;
         return handleSupernodeAnnounce(vars, input, ctx, output);
+    case State::SignatureVerified:
+        return handleSupernodeAnnounceVerified(vars, input, ctx, output);
     default:
         LOG_ERROR("Unhandled state: " << (int)state);
         abort();
@@ -182,12 +267,23 @@ Status sendAnnounce(const graft::Router::vars_t& vars, const graft::Input& input
 
             supernode->setLastUpdateTime(static_cast<int64_t>(std::time(nullptr)));
 
+            // the list keeps its own copy of this supernode, stakes are applied to that copy
+            FullSupernodeListPtr fsl = ctx.global.get(CONTEXT_KEY_FULLSUPERNODELIST, FullSupernodeListPtr());
+            SupernodePtr listed = fsl ? fsl->get(supernode->idKeyAsString()) : SupernodePtr();
+            if (listed) {
+                supernode->setStake(listed->stakeAmount(), listed->stakeBlockHeight(), listed->stakeUnlockTime());
+            }
+
             SendSupernodeAnnounceJsonRpcRequest req;
             if (!supernode->prepareAnnounce(req.params)) {
                 return errorCustomError(string("failed to prepare announce: ") + supernode->idKeyAsString(),
                                         ERROR_INTERNAL_ERROR, output);
             }
 
+            // own announce updates the copy in the list like announces of other supernodes
+            if (fsl) {
+                fsl->queueAnnounce(req.params);
+            }
 
             req.method = "send_supernode_announce";
             req.id = 0;
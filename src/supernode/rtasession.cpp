@@ -0,0 +1,252 @@
+
+#include "supernode/rtasession.h"
+
+#include <misc_log_ex.h>
+
+#include <algorithm>
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "supernode.rtasession"
+
+namespace graft {
+
+RtaSession::RtaSession(const std::string &payment_id)
+    : m_payment_id(payment_id)
+{
+}
+
+RtaSessionPtr RtaSession::find(Context &ctx, const std::string &payment_id)
+{
+    if (payment_id.empty())
+        return RtaSessionPtr();
+    return ctx.global.get(payment_id + CONTEXT_KEY_RTA_SESSION, RtaSessionPtr());
+}
+
+RtaSessionPtr RtaSession::findByTxId(Context &ctx, const std::string &tx_id)
+{
+    if (tx_id.empty())
+        return RtaSessionPtr();
+    return ctx.global.get(tx_id + CONTEXT_KEY_RTA_SESSION_BY_TXID, RtaSessionPtr());
+}
+
+RtaSessionPtr RtaSession::getOrCreate(Context &ctx, const std::string &payment_id, bool *created)
+{
+    if (created)
+        *created = false;
+
+    RtaSessionPtr session = find(ctx, payment_id);
+    if (session)
+        return session;
+
+    // serializes creation only, so concurrent handlers of the same payment get the same session
+    static std::mutex create_mutex;
+    std::lock_guard<std::mutex> lock(create_mutex);
+
+    session = find(ctx, payment_id);
+    if (session)
+        return session;
+
+    session = std::make_shared<RtaSession>(payment_id);
+    ctx.global.set(payment_id + CONTEXT_KEY_RTA_SESSION, session, RTA_TX_TTL);
+    if (created)
+        *created = true;
+    MDEBUG("rta session created for payment: " << payment_id);
+    return session;
+}
+
+void RtaSession::bindTx(Context &ctx, const RtaSessionPtr &session, const std::string &tx_id, const cryptonote::transaction &tx)
+{
+    {
+        std::lock_guard<std::mutex> lock(session->m_mutex);
+        session->m_tx_id = tx_id;
+        session->m_tx = tx;
+        session->m_has_tx = true;
+    }
+    ctx.global.set(tx_id + CONTEXT_KEY_RTA_SESSION_BY_TXID, session, RTA_TX_TTL);
+}
+
+void RtaSession::remove(Context &ctx, const std::string &payment_id)
+{
+    RtaSessionPtr session = find(ctx, payment_id);
+    if (!session)
+        return;
+
+    std::string tx_id;
+    {
+        std::lock_guard<std::mutex> lock(session->m_mutex);
+        session->m_removed = true;
+        tx_id = session->m_tx_id;
+    }
+    if (!tx_id.empty())
+        ctx.global.remove(tx_id + CONTEXT_KEY_RTA_SESSION_BY_TXID);
+    ctx.global.remove(payment_id + CONTEXT_KEY_RTA_SESSION);
+    MDEBUG("rta session removed for payment: " << payment_id);
+}
+
+void RtaSession::touch(Context &ctx)
+{
+    std::string tx_id;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_removed)
+            return;
+        tx_id = m_tx_id;
+    }
+
+    RtaSessionPtr self = shared_from_this();
+    ctx.global.set(m_payment_id + CONTEXT_KEY_RTA_SESSION, self, RTA_TX_TTL);
+    if (!tx_id.empty())
+        ctx.global.set(tx_id + CONTEXT_KEY_RTA_SESSION_BY_TXID, self, RTA_TX_TTL);
+}
+
+RTAStatus RtaSession::status() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_status;
+}
+
+void RtaSession::setStatus(Context &ctx, RTAStatus status)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_status = status;
+    }
+    touch(ctx);
+}
+
+bool RtaSession::updateStatus(Context &ctx, RTAStatus status)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (isFiniteRtaStatus(m_status))
+            return false;
+        m_status = status;
+    }
+    touch(ctx);
+    return true;
+}
+
+void RtaSession::setSale(const SaleData &sale)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sale = sale;
+    m_has_sale = true;
+}
+
+bool RtaSession::sale(SaleData &sale) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_has_sale)
+        sale = m_sale;
+    return m_has_sale;
+}
+
+bool RtaSession::hasSale() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_has_sale;
+}
+
+void RtaSession::setSaleDetails(const std::string &details)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sale_details = details;
+    m_has_sale_details = true;
+}
+
+bool RtaSession::saleDetails(std::string &details) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_has_sale_details)
+        details = m_sale_details;
+    return m_has_sale_details;
+}
+
+bool RtaSession::hasSaleDetails() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_has_sale_details;
+}
+
+void RtaSession::setPay(const PayData &pay)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pay = pay;
+    m_has_pay = true;
+}
+
+void RtaSession::setSaleDetailsResult(const SaleDetailsResponse &result)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sale_details_result = result;
+    m_has_sale_details_result = true;
+}
+
+bool RtaSession::saleDetailsResult(SaleDetailsResponse &result) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_has_sale_details_result)
+        result = m_sale_details_result;
+    return m_has_sale_details_result;
+}
+
+bool RtaSession::hasTx() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_has_tx;
+}
+
+bool RtaSession::tx(cryptonote::transaction &tx) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_has_tx)
+        tx = m_tx;
+    return m_has_tx;
+}
+
+std::string RtaSession::txId() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tx_id;
+}
+
+void RtaSession::setAmount(uint64_t amount)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_amount = amount;
+    m_has_amount = true;
+}
+
+bool RtaSession::amount(uint64_t &amount) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_has_amount)
+        amount = m_amount;
+    return m_has_amount;
+}
+
+bool RtaSession::addAuthVote(const SupernodeSignature &signature, bool approved, size_t &approved_count, size_t &rejected_count)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    bool added = !votedLocked(signature.id_key);
+    if (added)
+        (approved ? m_approved : m_rejected).push_back(signature);
+    approved_count = m_approved.size();
+    rejected_count = m_rejected.size();
+    return added;
+}
+
+std::vector<RtaSession::SupernodeSignature> RtaSession::approvedVotes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_approved;
+}
+
+bool RtaSession::votedLocked(const std::string &id_key) const
+{
+    auto same_id = [&id_key](const SupernodeSignature &item) { return item.id_key == id_key; };
+    return std::find_if(m_approved.begin(), m_approved.end(), same_id) != m_approved.end()
+            || std::find_if(m_rejected.begin(), m_rejected.end(), same_id) != m_rejected.end();
+}
+
+}
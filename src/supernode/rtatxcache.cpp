@@ -0,0 +1,69 @@
+
+#include "supernode/rtatxcache.h"
+
+#include <misc_log_ex.h>
+#include <cryptonote_basic/cryptonote_format_utils.h>
+#include <string_tools.h>
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "supernode.rtatxcache"
+
+namespace graft {
+
+std::string RtaTxCache::digest(const std::string &data)
+{
+    crypto::hash hash;
+    crypto::cn_fast_hash(data.data(), data.size(), hash);
+    return epee::string_tools::pod_to_hex(hash);
+}
+
+DecodedTxPtr RtaTxCache::decodeTx(Context &ctx, const std::string &tx_hex)
+{
+    const std::string key = digest(tx_hex) + CONTEXT_KEY_DECODED_TX;
+    DecodedTxPtr cached = ctx.global.get(key, DecodedTxPtr());
+    if (cached) {
+        MDEBUG("decoded tx found in cache, tx_id: " << cached->tx_id);
+        return cached;
+    }
+
+    std::shared_ptr<DecodedTx> decoded = std::make_shared<DecodedTx>();
+    cryptonote::blobdata tx_blob;
+    crypto::hash tx_hash, tx_prefix_hash;
+
+    if (!epee::string_tools::parse_hexstr_to_binbuff(tx_hex, tx_blob)) {
+        LOG_ERROR("Failed to parse hex tx: " << tx_hex);
+    } else if (!cryptonote::parse_and_validate_tx_from_blob(tx_blob, decoded->tx, tx_hash, tx_prefix_hash)) {
+        LOG_ERROR("Failed to parse and validate tx from blob: " << tx_hex);
+    } else {
+        decoded->valid = true;
+        decoded->tx_id = epee::string_tools::pod_to_hex(tx_hash);
+    }
+
+    // invalid tx is not cached, otherwise a flood of distinct garbage would grow the cache until it expires
+    if (decoded->valid)
+        ctx.global.set(key, DecodedTxPtr(decoded), RTA_DECODE_CACHE_TTL);
+    return decoded;
+}
+
+DecodedTxAuthRequestPtr RtaTxCache::decodeTxAuthRequest(Context &ctx, const std::string &data)
+{
+    const std::string key = digest(data) + ":tx_auth_request" + CONTEXT_KEY_DECODED_PAYLOAD;
+    DecodedTxAuthRequestPtr cached = ctx.global.get(key, DecodedTxAuthRequestPtr());
+    if (cached)
+        return cached;
+
+    std::shared_ptr<DecodedTxAuthRequest> decoded = std::make_shared<DecodedTxAuthRequest>();
+    Input in;
+    in.load(data);
+    if (in.getT<serializer::ANY_B64>(decoded->request)) {
+        decoded->tx = decodeTx(ctx, decoded->request.tx_hex);
+        decoded->valid = true;
+    }
+
+    // only requests carrying a valid tx are cached, see decodeTx
+    if (decoded->valid && decoded->tx->valid)
+        ctx.global.set(key, DecodedTxAuthRequestPtr(decoded), RTA_DECODE_CACHE_TTL);
+    return decoded;
+}
+
+}
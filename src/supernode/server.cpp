@@ -1,5 +1,6 @@
 
 #include "supernode/server.h"
+#include "lib/graft/async_logger.h"
 #include "lib/graft/backtrace.h"
 #include "lib/graft/GraftletLoader.h"
 #include "lib/graft/sys_info.h"
@@ -39,7 +40,7 @@ static void signal_handler_terminate(int sig_num)
     if(term_handler) term_handler(sig_num);
 }
 
-static void signal_handler_restart(int sig_num)
+static void signal_handler_reload(int sig_num)
 {
     if(hup_handler) hup_handler(sig_num);
 }
@@ -163,6 +164,7 @@ bool GraftServer::init(int argc, const char** argv, ConfigOpts& configOpts)
     m_connectionBase->createLooper(configOpts);
     initGraftlets();
     addGlobalCtxCleaner();
+    addBlacklistReloader();
 
     initGlobalContext();
 
@@ -204,11 +206,16 @@ GraftServer::RunRes GraftServer::run()
         stop(true);
         res = RunRes::SignalTerminate;
     };
-    //restart
-    hup_handler = [this, &res](int sig_num)
+    //reload, the server restarts gracefully if the changed options cannot be applied on the fly
+    getLooper().setReloadHandler([this, &res]
     {
+        if(!reloadConfig()) return;
         stop();
         res = RunRes::SignalRestart;
+    });
+    hup_handler = [this](int sig_num)
+    {
+        getLooper().requestReload();
     };
 
     serve();
@@ -242,13 +249,15 @@ void GraftServer::initSignals()
     sa.sa_handler = signal_handler_terminate;
     ::sigaction(SIGTERM, &sa, NULL);
 
-    sa.sa_handler = signal_handler_restart;
+    sa.sa_handler = signal_handler_reload;
     ::sigaction(SIGHUP, &sa, NULL);
 }
 
 namespace details
 {
 
+using UriSubstitutions = decltype(OutHttp::uri_substitutions);
+
 std::string trim_comments(std::string s)
 {
     //remove ;; tail
@@ -263,23 +272,30 @@ std::string trim_comments(std::string s)
 
 namespace po = boost::program_options;
 
+std::string get_log_level(const boost::property_tree::ptree& config)
+{
+    const boost::property_tree::ptree& log_conf = config.get_child("logging");
+    boost::optional<std::string> level  = log_conf.get_optional<std::string>("loglevel");
+    return (level)? trim_comments( level.get() ) : "3";
+}
+
 void init_log(const boost::property_tree::ptree& config, const po::variables_map& vm)
 {
-    std::string log_level = "3";
+    std::string log_level = get_log_level(config);
     bool log_console = true;
     std::string log_filename;
     std::string log_format;
 
     //from config
     const boost::property_tree::ptree& log_conf = config.get_child("logging");
-    boost::optional<std::string> level  = log_conf.get_optional<std::string>("loglevel");
-    if(level) log_level = trim_comments( level.get() );
     boost::optional<std::string> log_file  = log_conf.get_optional<std::string>("logfile");
     if(log_file) log_filename = trim_comments( log_file.get() );
     boost::optional<bool> log_to_console  = log_conf.get_optional<bool>("console");
     if(log_to_console) log_console = log_to_console.get();
     boost::optional<std::string> log_fmt  = log_conf.get_optional<std::string>("log-format");
     if(log_fmt) log_format = trim_comments( log_fmt.get() );
+    bool log_async = log_conf.get<bool>("async", false);
+    size_t log_async_ring_size = log_conf.get<size_t>("async-ring-size", 8192);
 
     //override from cmdline
     if (vm.count("log-level")) log_level = vm["log-level"].as<std::string>();
@@ -302,6 +318,10 @@ void init_log(const boost::property_tree::ptree& config, const po::variables_map
 #endif
         {
             mlog_configure(log_filename, log_console, log_format.empty()? nullptr : log_format.c_str());
+            if(log_async)
+            {
+                installAsyncLogger(std::make_shared<AsyncLogger>(log_filename, log_console, log_async_ring_size));
+            }
         }
 
         mlog_set_log(log_level.c_str());
@@ -409,6 +429,169 @@ void parseSubstitutionItem(const std::string& name, const std::string& val, std:
     timeout = std::stod(m[7]);
 }
 
+void parseRouteLimitItem(const std::string& prefix, const std::string& val, int& requests_per_sec, int& burst)
+{
+    std::string s = trim_comments(val);
+    std::regex regex(R"(^\s*(\d+)\s*(,\s*(\d+)\s*)?$)");
+    std::smatch m;
+    if(prefix.empty() || prefix[0] != '/' || !std::regex_match(s, m, regex) || std::stoi(m[1]) == 0)
+    {
+        std::ostringstream oss;
+        oss << "invalid [route-limits] format line with prefix '" << prefix << "' : '" << val << "'";
+        throw graft::exit_error(oss.str());
+    }
+    requests_per_sec = std::stoi(m[1]);
+    burst = (m[3].matched)? std::stoi(m[3]) : 0;
+}
+
+void readConfigOpts(int argc, const char** argv, const boost::property_tree::ptree& config, ConfigOpts& configOpts)
+{
+    namespace fs = boost::filesystem;
+
+    const boost::property_tree::ptree& server_conf = config.get_child("server");
+    configOpts.http_address = server_conf.get<std::string>("http-address");
+    configOpts.coap_address = server_conf.get<std::string>("coap-address");
+    configOpts.timer_poll_interval_ms = server_conf.get<int>("timer-poll-interval-ms");
+    configOpts.http_connection_timeout = server_conf.get<double>("http-connection-timeout");
+    configOpts.workers_count = server_conf.get<int>("workers-count");
+    configOpts.worker_queue_len = server_conf.get<int>("worker-queue-len");
+    configOpts.workers_expelling_interval_ms = server_conf.get<int>("workers-expelling-interval-ms", 1000);
+    configOpts.upstream_request_timeout = server_conf.get<double>("upstream-request-timeout");
+    configOpts.lru_timeout_ms = server_conf.get<int>("lru-timeout-ms");
+    configOpts.common.data_dir = server_conf.get<std::string>("data-dir");
+    configOpts.common.wallet_public_address = server_conf.get<std::string>("wallet-public-address", "");
+    configOpts.common.testnet = server_conf.get<bool>("testnet", false);
+
+    //ipfilter
+    auto opt_ipfilter = config.get_child_optional("ipfilter");
+    if(opt_ipfilter)
+    {
+        IPFilterOpts& ipfilter = configOpts.ipfilter;
+        const auto ipfilter_conf = opt_ipfilter.get();
+        ipfilter.window_size_sec = ipfilter_conf.get<int>("window-size-sec", 0);
+        ipfilter.requests_per_sec = ipfilter_conf.get<int>("requests-per-sec", 0);
+        ipfilter.ban_ip_sec = ipfilter_conf.get<int>("ban-ip-sec", 0);
+        ipfilter.rules_reload_interval_sec = ipfilter_conf.get<int>("rules-reload-interval-sec", 0);
+        //ipfilter.rules_filename
+        ipfilter.rules_filename = ipfilter_conf.get<std::string>("rules", "");
+        if(!ipfilter.rules_filename.empty())
+        {
+            ipfilter.rules_filename = trim_comments(ipfilter.rules_filename);
+            fs::path path = ipfilter.rules_filename;
+            if(path.is_relative())
+            {
+                fs::path selfpath = argv[0];
+                selfpath.remove_filename();
+                path = fs::complete(path, selfpath);
+                ipfilter.rules_filename = path.string();
+            }
+        }
+    }
+
+    //route-limits
+    auto opt_route_limits = config.get_child_optional("route-limits");
+    if(opt_route_limits)
+    {
+        //path prefixes contain dots, so the children are not accessed by name
+        for(auto& item : opt_route_limits.get())
+        {
+            RouteLimitOpts limit;
+            limit.prefix = item.first;
+            parseRouteLimitItem(item.first, item.second.data(), limit.requests_per_sec, limit.burst);
+            configOpts.ipfilter.route_limits.emplace_back(std::move(limit));
+        }
+    }
+
+    //trace
+    auto opt_trace = config.get_child_optional("trace");
+    if(opt_trace)
+    {
+        TraceOpts& trace = configOpts.trace;
+        const auto trace_conf = opt_trace.get();
+        trace.sample_rate = trace_conf.get<int>("sample-rate", 0);
+        trace.buffer_size = trace_conf.get<int>("buffer-size", trace.buffer_size);
+    }
+
+    //configOpts.graftlet_dirs
+    const boost::property_tree::ptree& graftlets_conf = config.get_child("graftlets");
+    boost::optional<std::string> dirs_opt  = graftlets_conf.get_optional<std::string>("dirs");
+    initGraftletDirs(argc, argv, (dirs_opt)? dirs_opt.get() : "", bool(dirs_opt), configOpts.graftlet_dirs);
+
+    const boost::property_tree::ptree& cryptonode_conf = config.get_child("cryptonode");
+    configOpts.cryptonode_rpc_address = cryptonode_conf.get<std::string>("rpc-address");
+
+    const boost::property_tree::ptree& log_conf = config.get_child("logging");
+    boost::optional<int> log_trunc_to_size  = log_conf.get_optional<int>("trunc-to-size");
+    configOpts.log_trunc_to_size = (log_trunc_to_size)? log_trunc_to_size.get() : -1;
+}
+
+void readUpstreams(const boost::property_tree::ptree& config, UriSubstitutions& substitutions)
+{
+    const boost::property_tree::ptree& uri_subst_conf = config.get_child("upstream");
+    substitutions.clear();
+    std::for_each(uri_subst_conf.begin(), uri_subst_conf.end(),[&uri_subst_conf, &substitutions](auto it)
+    {
+        std::string name(it.first);
+        std::string val(uri_subst_conf.get<std::string>(name));
+
+        std::string uri; int cnt; bool keepAlive; double timeout;
+        parseSubstitutionItem(name, val, uri, cnt, keepAlive, timeout);
+        substitutions.emplace(std::move(name), std::make_tuple(std::move(uri), cnt, keepAlive, timeout));
+    });
+}
+
+std::map<std::string, std::string> configValues(const boost::property_tree::ptree& config)
+{
+    std::map<std::string, std::string> values;
+    for(auto& section : config)
+    {
+        if(section.second.empty())
+        {
+            values.emplace(section.first, section.second.data());
+            continue;
+        }
+        for(auto& item : section.second)
+        {
+            values.emplace(section.first + '.' + item.first, item.second.data());
+        }
+    }
+    return values;
+}
+
+std::vector<std::string> changedOptions(const std::map<std::string, std::string>& values1, const std::map<std::string, std::string>& values2)
+{
+    std::vector<std::string> res;
+    auto it1 = values1.begin(), it2 = values2.begin();
+    while(it1 != values1.end() || it2 != values2.end())
+    {
+        if(it2 == values2.end() || (it1 != values1.end() && it1->first < it2->first))
+        {
+            res.push_back(it1->first); ++it1;
+        }
+        else if(it1 == values1.end() || it2->first < it1->first)
+        {
+            res.push_back(it2->first); ++it2;
+        }
+        else
+        {
+            if(trim_comments(it1->second) != trim_comments(it2->second)) res.push_back(it1->first);
+            ++it1; ++it2;
+        }
+    }
+    return res;
+}
+
+bool isLiveOption(const std::string& name)
+{
+    static const std::set<std::string> options = {
+        "logging.loglevel", "logging.trunc-to-size",
+        "server.http-connection-timeout", "server.upstream-request-timeout", "server.timer-poll-interval-ms",
+    };
+    static const std::vector<std::string> sections = { "ipfilter.", "route-limits.", "upstream." };
+    if(options.count(name)) return true;
+    return std::any_of(sections.begin(), sections.end(), [&name](const std::string& section){ return name.compare(0, section.size(), section) == 0; });
+}
+
 } //namespace details
 
 void usage(const boost::program_options::options_description& desc)
@@ -416,7 +599,7 @@ void usage(const boost::program_options::options_description& desc)
     std::string sigmsg = "Supported signals:\n"
             "  INT  - Shutdown server gracefully closing all pending tasks.\n"
             "  TEMP - Shutdown server even if there are pending tasks.\n"
-            "  HUP  - Restart server with updated configuration parameters.\n";
+            "  HUP  - Reload configuration parameters, the server restarts if the parameters which cannot be changed on the fly are changed.\n";
 
     std::cout << desc << "\n" << sigmsg << "\n";
 }
@@ -517,72 +700,15 @@ bool GraftServer::initConfigOption(int argc, const char** argv, ConfigOpts& conf
     // dirs <string:string:...>
 
     details::init_log(config, vm);
-    //
+    m_logLevelFromCmdline = vm.count("log-level") != 0;
 
     configOpts.config_filename = config_filename;
 
-    const boost::property_tree::ptree& server_conf = config.get_child("server");
-    configOpts.http_address = server_conf.get<std::string>("http-address");
-    configOpts.coap_address = server_conf.get<std::string>("coap-address");
-    configOpts.timer_poll_interval_ms = server_conf.get<int>("timer-poll-interval-ms");
-    configOpts.http_connection_timeout = server_conf.get<double>("http-connection-timeout");
-    configOpts.workers_count = server_conf.get<int>("workers-count");
-    configOpts.worker_queue_len = server_conf.get<int>("worker-queue-len");
-    configOpts.workers_expelling_interval_ms = server_conf.get<int>("workers-expelling-interval-ms", 1000);
-    configOpts.upstream_request_timeout = server_conf.get<double>("upstream-request-timeout");
-    configOpts.lru_timeout_ms = server_conf.get<int>("lru-timeout-ms");
-    configOpts.common.data_dir = server_conf.get<std::string>("data-dir");
-    configOpts.common.wallet_public_address = server_conf.get<std::string>("wallet-public-address", "");
-    configOpts.common.testnet = server_conf.get<bool>("testnet", false);
-
-    //ipfilter
-    auto opt_ipfilter = config.get_child_optional("ipfilter");
-    if(opt_ipfilter)
-    {
-        IPFilterOpts& ipfilter = configOpts.ipfilter;
-        const auto ipfilter_conf = opt_ipfilter.get();
-        ipfilter.window_size_sec = ipfilter_conf.get<int>("window-size-sec", 0);
-        ipfilter.requests_per_sec = ipfilter_conf.get<int>("requests-per-sec", 0);
-        ipfilter.ban_ip_sec = ipfilter_conf.get<int>("ban-ip-sec", 0);
-        //ipfilter.rules_filename
-        ipfilter.rules_filename = ipfilter_conf.get<std::string>("rules", "");
-        if(!ipfilter.rules_filename.empty())
-        {
-            ipfilter.rules_filename = details::trim_comments(ipfilter.rules_filename);
-            fs::path path = ipfilter.rules_filename;
-            if(path.is_relative())
-            {
-                fs::path selfpath = argv[0];
-                selfpath.remove_filename();
-                path = fs::complete(path, selfpath);
-                ipfilter.rules_filename = path.string();
-            }
-        }
-    }
-
-    //configOpts.graftlet_dirs
-    const boost::property_tree::ptree& graftlets_conf = config.get_child("graftlets");
-    boost::optional<std::string> dirs_opt  = graftlets_conf.get_optional<std::string>("dirs");
-    details::initGraftletDirs(argc, argv, (dirs_opt)? dirs_opt.get() : "", bool(dirs_opt), configOpts.graftlet_dirs);
-
-    const boost::property_tree::ptree& cryptonode_conf = config.get_child("cryptonode");
-    configOpts.cryptonode_rpc_address = cryptonode_conf.get<std::string>("rpc-address");
-
-    const boost::property_tree::ptree& log_conf = config.get_child("logging");
-    boost::optional<int> log_trunc_to_size  = log_conf.get_optional<int>("trunc-to-size");
-    configOpts.log_trunc_to_size = (log_trunc_to_size)? log_trunc_to_size.get() : -1;
-
-    const boost::property_tree::ptree& uri_subst_conf = config.get_child("upstream");
-    graft::OutHttp::uri_substitutions.clear();
-    std::for_each(uri_subst_conf.begin(), uri_subst_conf.end(),[&uri_subst_conf](auto it)
-    {
-        std::string name(it.first);
-        std::string val(uri_subst_conf.get<std::string>(name));
-
-        std::string uri; int cnt; bool keepAlive; double timeout;
-        details::parseSubstitutionItem(name, val, uri, cnt, keepAlive, timeout);
-        graft::OutHttp::uri_substitutions.emplace(std::move(name), std::make_tuple(std::move(uri), cnt, keepAlive, timeout));
-    });
+    details::readConfigOpts(argc, argv, config, configOpts);
+    details::readUpstreams(config, graft::OutHttp::uri_substitutions);
+    m_argc = argc;
+    m_argv = argv;
+    m_configValues = details::configValues(config);
 
     prepareDataDir(configOpts);
 
@@ -617,4 +743,94 @@ void GraftServer::addGlobalCtxCleaner()
                 );
 }
 
+void GraftServer::addBlacklistReloader()
+{
+    const IPFilterOpts& ipfilter = m_connectionBase->getCopts().ipfilter;
+    if(ipfilter.rules_filename.empty() || ipfilter.rules_reload_interval_sec <= 0) return;
+
+    namespace fs = boost::filesystem;
+    std::string filename = ipfilter.rules_filename;
+    boost::system::error_code ec;
+    auto lastWriteTime = std::make_shared<std::atomic<std::time_t>>(fs::last_write_time(filename, ec));
+    auto active = std::make_shared<std::atomic_bool>(true);
+    m_blacklistReloaderActive = active;
+
+    ConnectionBase* connectionBase = m_connectionBase.get();
+    auto reloader = [connectionBase, filename, lastWriteTime, active](const graft::Router::vars_t& vars, const graft::Input& input, graft::Context& ctx, graft::Output& output)->graft::Status
+    {
+        if(!*active) return graft::Status::Stop;
+        boost::system::error_code ec;
+        std::time_t time = fs::last_write_time(filename, ec);
+        if(ec) return graft::Status::Ok;
+        //periodic tasks can run concurrently, only one of them reloads
+        std::time_t prev = lastWriteTime->load();
+        if(time == prev || !lastWriteTime->compare_exchange_strong(prev, time)) return graft::Status::Ok;
+        connectionBase->reloadBlacklistRules(filename);
+        return graft::Status::Ok;
+    };
+    m_connectionBase->getLooper().addPeriodicTask(
+                graft::Router::Handler3(nullptr, reloader, nullptr),
+                std::chrono::seconds(ipfilter.rules_reload_interval_sec)
+                );
+}
+
+bool GraftServer::reloadConfig()
+{
+    const ConfigOpts& cur = getCopts();
+    LOG_PRINT_L0("Reloading configuration from " << cur.config_filename);
+
+    boost::property_tree::ptree config;
+    ConfigOpts copts;
+    details::UriSubstitutions substitutions;
+    try
+    {
+        boost::property_tree::ini_parser::read_ini(cur.config_filename, config);
+        copts.config_filename = cur.config_filename;
+        details::readConfigOpts(m_argc, m_argv, config, copts);
+        details::readUpstreams(config, substitutions);
+    }
+    catch(std::exception& e)
+    {
+        LOG_PRINT_L0("Cannot reload configuration, '" << e.what() << "', the current one is kept");
+        return false;
+    }
+
+    std::vector<std::string> changed = details::changedOptions(m_configValues, details::configValues(config));
+    changed.erase(std::remove_if(changed.begin(), changed.end(), details::isLiveOption), changed.end());
+    if(!changed.empty())
+    {
+        std::ostringstream oss;
+        for(auto& name : changed) oss << ' ' << name;
+        LOG_PRINT_L0("Changed parameters cannot be applied on the fly, restarting:" << oss.str());
+        return true;
+    }
+
+    if(!m_logLevelFromCmdline)
+    {
+        mlog_set_log(details::get_log_level(config).c_str());
+    }
+
+    if(substitutions != OutHttp::uri_substitutions)
+    {
+        //nothing but the upstreams uses the substitutions
+        OutHttp::uri_substitutions = std::move(substitutions);
+        getLooper().reinitUpstreams();
+    }
+
+    bool reloaderChanged = cur.ipfilter.rules_filename != copts.ipfilter.rules_filename
+            || cur.ipfilter.rules_reload_interval_sec != copts.ipfilter.rules_reload_interval_sec;
+
+    m_connectionBase->reconfigure(copts);
+
+    if(reloaderChanged)
+    {
+        if(m_blacklistReloaderActive) *m_blacklistReloaderActive = false;
+        m_blacklistReloaderActive.reset();
+        addBlacklistReloader();
+    }
+
+    LOG_PRINT_L0("Configuration reloaded");
+    return false;
+}
+
 }//namespace graft
@@ -7,6 +7,8 @@
 #include "supernode/requests/send_supernode_announce.h"
 #include "rta/supernode.h"
 #include "rta/fullsupernodelist.h"
+#include "rta/signatureverifier.h"
+#include "rta/announcefilter.h"
 #include "lib/graft/graft_exception.h"
 
 #include <boost/property_tree/ini_parser.hpp>
@@ -18,6 +20,9 @@ namespace consts {
    static const char * STAKE_WALLET_PATH = "stake-wallet";
    static const char * WATCHONLY_WALLET_PATH = "stake-wallet";
    static const size_t DEFAULT_STAKE_WALLET_REFRESH_INTERFAL_MS = 5 * 1000;
+   static const size_t DEFAULT_ANNOUNCE_MIN_INTERVAL_MS = 5 * 1000;
+   static const size_t DEFAULT_ANNOUNCE_BURST = 3;
+   static const size_t ANNOUNCE_FILTER_MAX_REMEMBERED = 100000;
 }
 
 namespace graft
@@ -42,6 +47,9 @@ bool Supernode::initConfigOption(int argc, const char** argv, ConfigOpts& config
     m_configEx.stake_wallet_refresh_interval_ms = server_conf.get<size_t>("stake-wallet-refresh-interval-ms",
                                                                       consts::DEFAULT_STAKE_WALLET_REFRESH_INTERFAL_MS);
     m_configEx.stake_wallet_refresh_interval_random_factor = server_conf.get<double>("stake-wallet-refresh-interval-random-factor", 0);
+    m_configEx.binary_payloads = server_conf.get<bool>("binary-payloads", false);
+    m_configEx.announce_min_interval_ms = server_conf.get<size_t>("announce-min-interval-ms", consts::DEFAULT_ANNOUNCE_MIN_INTERVAL_MS);
+    m_configEx.announce_burst = server_conf.get<size_t>("announce-burst", consts::DEFAULT_ANNOUNCE_BURST);
 
     if(m_configEx.common.wallet_public_address.empty())
     {
@@ -95,16 +103,28 @@ void Supernode::prepareSupernode()
     }
 
     supernode->setNetworkAddress(m_configEx.http_address + "/dapi/v2.0");
+    supernode->setAcceptsBinaryPayload(true);
 
     // create fullsupernode list instance and put it into global context
     graft::FullSupernodeListPtr fsl = boost::make_shared<graft::FullSupernodeList>(
                 m_configEx.cryptonode_rpc_address, m_configEx.common.testnet);
-    fsl->add(supernode);
+    // the list changes only its own copies of supernodes
+    fsl->add(boost::make_shared<graft::Supernode>(*supernode));
+
+    // signature checks of incoming multicasts and announces are offloaded to the verifier threads
+    graft::SignatureVerifierPtr verifier = boost::make_shared<graft::SignatureVerifier>();
+
+    graft::AnnounceFilterPtr announce_filter = boost::make_shared<graft::AnnounceFilter>(
+                std::chrono::milliseconds(m_configEx.announce_min_interval_ms), m_configEx.announce_burst,
+                std::chrono::seconds(graft::FullSupernodeList::ANNOUNCE_TTL_SECONDS), consts::ANNOUNCE_FILTER_MAX_REMEMBERED);
 
     //put fsl into global context
     Context ctx(getLooper().getGcm());
     ctx.global[CONTEXT_KEY_SUPERNODE] = supernode;
     ctx.global[CONTEXT_KEY_FULLSUPERNODELIST] = fsl;
+    ctx.global[CONTEXT_KEY_SIGNATURE_VERIFIER] = verifier;
+    ctx.global[CONTEXT_KEY_ANNOUNCE_FILTER] = announce_filter;
+    ctx.global[CONTEXT_KEY_BINARY_PAYLOADS] = m_configEx.binary_payloads;
     ctx.global["testnet"] = m_configEx.common.testnet;
     ctx.global["watchonly_wallets_path"] = m_configEx.watchonly_wallets_path;
     ctx.global["cryptonode_rpc_address"] = m_configEx.cryptonode_rpc_address;
@@ -163,6 +183,23 @@ void Supernode::startSupernodePeriodicTasks()
                 graft::Router::Handler3(nullptr, handler, nullptr),
                 std::chrono::milliseconds(CRYPTONODE_SYNCHRONIZATION_PERIOD_MS)
                 );
+
+    // apply announces which have not filled a batch
+
+    auto apply_announces = [](const graft::Router::vars_t& vars, const graft::Input& input, graft::Context& ctx, graft::Output& output)->graft::Status
+    {
+        if (FullSupernodeListPtr fsl = ctx.global.get(CONTEXT_KEY_FULLSUPERNODELIST, FullSupernodeListPtr()))
+            fsl->applyQueuedAnnounces();
+
+        return graft::Status::Ok;
+    };
+
+    static const size_t ANNOUNCES_APPLY_PERIOD_MS = 200;
+
+    getConnectionBase().getLooper().addPeriodicTask(
+                graft::Router::Handler3(nullptr, apply_announces, nullptr),
+                std::chrono::milliseconds(ANNOUNCES_APPLY_PERIOD_MS)
+                );
 }
 
 void Supernode::setHttpRouters(ConnectionManager& httpcm)
@@ -247,6 +284,7 @@ void Supernode::initRouters()
 
 bool Supernode::run(int argc, const char** argv)
 {
+    // the command line is kept on restart, the config file is read again
     for(bool run = true; run;)
     {
         run = false;
@@ -255,7 +293,6 @@ bool Supernode::run(int argc, const char** argv)
             MERROR("Failed to initialize supernode");
             return false;
         }
-        argc = 1;
         RunRes res = GraftServer::run();
         if(res == RunRes::SignalRestart) run = true;
     }
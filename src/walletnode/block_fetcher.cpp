@@ -0,0 +1,148 @@
+#include "walletnode/block_fetcher.h"
+
+#include <crypto/hash.h>
+#include <string_tools.h>
+
+#include <algorithm>
+
+using namespace graft::walletnode;
+
+SharedBlockFetcher::SharedBlockFetcher(std::chrono::milliseconds cache_ttl, std::chrono::milliseconds fetch_timeout, size_t max_cached_responses)
+  : m_cache_ttl(cache_ttl)
+  , m_fetch_timeout(fetch_timeout)
+  , m_max_cached_responses(max_cached_responses)
+  , m_fetches_count(0)
+  , m_shared_count(0)
+{
+}
+
+std::string SharedBlockFetcher::requestKey(const std::string& request_body)
+{
+  // cryptographic hash, so crafted request can't get response of other request
+  crypto::hash hash;
+  crypto::cn_fast_hash(request_body.data(), request_body.size(), hash);
+  return epee::string_tools::pod_to_hex(hash);
+}
+
+SharedBlockFetcher::Result SharedBlockFetcher::acquire(const std::string& key, const Waiter& waiter, std::string& response)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = m_entries.find(key);
+
+  if (it == m_entries.end() || (!it->second.fetching && it->second.expiration_time <= Clock::now()))
+  {
+    Entry& entry = m_entries[key];
+
+    if (!entry.fetching)
+      m_cached_keys.remove(key);
+
+    entry = Entry();
+    entry.expiration_time = Clock::now() + m_fetch_timeout;
+
+    ++m_fetches_count;
+
+    return Result::Fetch;
+  }
+
+  ++m_shared_count;
+
+  if (it->second.fetching)
+  {
+    it->second.waiters.push_back(waiter);
+    return Result::Wait;
+  }
+
+  response = it->second.response;
+
+  return Result::Cached;
+}
+
+SharedBlockFetcher::Waiters SharedBlockFetcher::complete(const std::string& key, const std::string& response)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = m_entries.find(key);
+
+  // the fetch has been expired, its waiters are fetching themselves
+  if (it == m_entries.end() || !it->second.fetching)
+    return Waiters();
+
+  Entry& entry = it->second;
+
+  Waiters waiters;
+  waiters.swap(entry.waiters);
+
+  entry.fetching        = false;
+  entry.response        = response;
+  entry.expiration_time = Clock::now() + m_cache_ttl;
+
+  m_cached_keys.push_back(key);
+
+  while (m_cached_keys.size() > m_max_cached_responses)
+  {
+    m_entries.erase(m_cached_keys.front());
+    m_cached_keys.pop_front();
+  }
+
+  return waiters;
+}
+
+SharedBlockFetcher::Waiters SharedBlockFetcher::abandon(const std::string& key)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = m_entries.find(key);
+
+  // the fetch has been expired already or the response is cached
+  if (it == m_entries.end() || !it->second.fetching)
+    return Waiters();
+
+  Waiters waiters;
+  waiters.swap(it->second.waiters);
+
+  m_entries.erase(it);
+
+  return waiters;
+}
+
+SharedBlockFetcher::Waiters SharedBlockFetcher::expire()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  const Clock::time_point now = Clock::now();
+
+  Waiters waiters;
+
+  for (auto it = m_entries.begin(); it != m_entries.end();)
+  {
+    Entry& entry = it->second;
+
+    if (entry.expiration_time > now)
+    {
+      ++it;
+      continue;
+    }
+
+    if (entry.fetching)
+      waiters.insert(waiters.end(), entry.waiters.begin(), entry.waiters.end());
+    else
+      m_cached_keys.remove(it->first);
+
+    it = m_entries.erase(it);
+  }
+
+  return waiters;
+}
+
+uint64_t SharedBlockFetcher::fetchesCount() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_fetches_count;
+}
+
+uint64_t SharedBlockFetcher::sharedCount() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_shared_count;
+}
@@ -0,0 +1,157 @@
+#include "walletnode/requests.h"
+#include "walletnode/block_fetcher.h"
+
+#include <boost/uuid/uuid_io.hpp>
+
+namespace
+{
+
+const char* CONTEXT_KEY_BLOCKS_REQUEST = "walletnode_blocks_request";
+const char* CONTEXT_KEY_BLOCKS_KEY     = "walletnode_blocks_key";
+
+}
+
+namespace graft {
+
+namespace walletnode {
+
+namespace request {
+
+namespace
+{
+
+Status forwardBlocksRequest(const std::string& body, Output& output)
+{
+    output.body = body;
+    output.path = "/getblocks.bin";
+    return Status::Forward;
+}
+
+void resumeBlockWaiters(HandlerAPI* handlerAPI, const SharedBlockFetcher::Waiters& waiters, const Input& input)
+{
+    for (const SharedBlockFetcher::Waiter& waiter : waiters)
+    {
+        if (!handlerAPI->resumePostponedTask(waiter, input))
+            LOG_ERROR("failed to resume task " << boost::uuids::to_string(waiter) << " waiting for blocks");
+    }
+}
+
+/// getblocks.bin of wallets, identical requests share one download from the cryptonode
+Status getBlocksHandler(const Router::vars_t& vars, const Input& input, Context& ctx, SharedBlockFetcher& fetcher, Output& output)
+{
+    switch (ctx.local.getLastStatus())
+    {
+    case Status::None:
+    {
+        const std::string key = SharedBlockFetcher::requestKey(input.body);
+
+        switch (fetcher.acquire(key, ctx.getId(), output.body))
+        {
+        case SharedBlockFetcher::Result::Cached:
+            return Status::Ok;
+        case SharedBlockFetcher::Result::Wait:
+            // request is kept to fetch it directly if the shared fetch fails
+            ctx.local[CONTEXT_KEY_BLOCKS_REQUEST] = input.body;
+            return Status::Postpone;
+        case SharedBlockFetcher::Result::Fetch:
+        {
+            ctx.local[CONTEXT_KEY_BLOCKS_KEY] = key;
+
+            // the handler is not called again if the forward fails, waiters are released to fetch themselves
+            SharedBlockFetcher* shared_fetcher = &fetcher;
+            ctx.local.setOnFailure([shared_fetcher, key](Context& task_ctx) {
+                resumeBlockWaiters(task_ctx.handlerAPI(), shared_fetcher->abandon(key), Input());
+            });
+
+            return forwardBlocksRequest(input.body, output);
+        }
+        }
+    } break;
+    case Status::Postpone:
+    {
+        // empty input means the shared fetch has failed
+        if (!input.body.empty())
+        {
+            output.body = input.body;
+            return Status::Ok;
+        }
+
+        std::string body = ctx.local[CONTEXT_KEY_BLOCKS_REQUEST];
+        return forwardBlocksRequest(body, output);
+    }
+    case Status::Forward:
+    {
+        output.body = input.body;
+
+        if (ctx.local.hasKey(CONTEXT_KEY_BLOCKS_KEY))
+        {
+            std::string key = ctx.local[CONTEXT_KEY_BLOCKS_KEY];
+
+            ctx.local.setOnFailure(nullptr);
+
+            // error response of the cryptonode is not shared, waiters fetch themselves
+            if (input.resp_code != 200)
+                resumeBlockWaiters(ctx.handlerAPI(), fetcher.abandon(key), Input());
+            else
+                resumeBlockWaiters(ctx.handlerAPI(), fetcher.complete(key, input.body), input);
+        }
+
+        return Status::Ok;
+    }
+    default:
+        break;
+    }
+
+    return Status::Error;
+}
+
+/// other requests of wallets are forwarded to the cryptonode as is
+Status forwardHandler(const Router::vars_t& vars, const Input& input, Context& ctx, Output& output)
+{
+    if (ctx.local.getLastStatus() == Status::None)
+    {
+        auto it = vars.find("forward");
+        if (it == vars.end())
+            throw std::runtime_error("cannot find 'forward' var");
+
+        output.body = input.body;
+        output.path = it->second;
+        return Status::Forward;
+    }
+
+    if (ctx.local.getLastStatus() == Status::Forward)
+    {
+        output.body = input.body;
+        return Status::Ok;
+    }
+
+    return Status::Error;
+}
+
+}
+
+void registerDaemonRequests(Router& router, SharedBlockFetcher& fetcher)
+{
+    SharedBlockFetcher* shared_fetcher = &fetcher;
+
+    Router::Handler get_blocks = [shared_fetcher](const Router::vars_t& vars, const Input& input, Context& ctx, Output& output) {
+        return getBlocksHandler(vars, input, ctx, *shared_fetcher, output);
+    };
+
+    // handlers run in the IO thread, so waiting wallets don't occupy worker threads which wallets run in
+    //METHOD_GET is required here because some GET requests from the wallet has body
+    router.addRoute("/getblocks.bin", METHOD_POST|METHOD_GET, Router::Handler3(get_blocks, nullptr, nullptr));
+    router.addRoute("/{forward:gethashes.bin|json_rpc|gettransactions|sendrawtransaction|getheight|get_transaction_pool_hashes.bin|get_outs.bin|get_o_indexes.bin|is_key_image_spent|get_info}",
+                    METHOD_POST|METHOD_GET, Router::Handler3(forwardHandler, nullptr, nullptr));
+}
+
+void resumeExpiredBlockWaiters(Context& ctx, SharedBlockFetcher& fetcher)
+{
+    resumeBlockWaiters(ctx.handlerAPI(), fetcher.expire(), Input());
+}
+
+}
+
+}
+
+}
@@ -3,6 +3,7 @@
 #include "walletnode/requests/restore_account_request.h"
 #include "walletnode/requests/prepare_transfer_request.h"
 #include "walletnode/requests/transaction_history_request.h"
+#include "walletnode/requests/queue_stats_request.h"
 #include "supernode/requestdefines.h"
 #include "walletnode/wallet_manager.h"
 
@@ -58,7 +59,9 @@ Status walletCreateAccountRequestHandler
         return errorInvalidParams(output);
     }
 
-    wallet_manager.createAccount(context, request.params.Password, request.params.Language, getCallbackString(input));
+    if (!wallet_manager.createAccount(context, request.params.Password, request.params.Language, getCallbackString(input))) {
+        return errorTooManyRequests(output);
+    }
 
     WalletCreateAccountResponse out;
 
@@ -80,7 +83,9 @@ Status walletRestoreAccountRequestHandler
         return errorInvalidParams(output);
     }
 
-    wallet_manager.restoreAccount(context, request.params.Password, request.params.Seed, getCallbackString(input));
+    if (!wallet_manager.restoreAccount(context, request.params.Password, request.params.Seed, getCallbackString(input))) {
+        return errorTooManyRequests(output);
+    }
 
     WalletRestoreAccountResponse out;
 
@@ -102,7 +107,9 @@ Status walletBalanceRequestHandler
         return errorInvalidParams(output);
     }
 
-    wallet_manager.requestBalance(context, request.params.WalletId, request.params.Account, request.params.Password, getCallbackString(input));
+    if (!wallet_manager.requestBalance(context, request.params.WalletId, request.params.Account, request.params.Password, getCallbackString(input))) {
+        return errorTooManyRequests(output);
+    }
 
     WalletBalanceResponse out;
 
@@ -131,7 +138,9 @@ Status walletPrepareTransferRequestHandler
     for (const auto& dest : request.params.Destinations)
         destinations.push_back(WalletManager::TransferDestination(dest.Address, std::stoull(dest.Amount)));
 
-    wallet_manager.prepareTransfer(context, request.params.WalletId, request.params.Account, request.params.Password, destinations, getCallbackString(input));
+    if (!wallet_manager.prepareTransfer(context, request.params.WalletId, request.params.Account, request.params.Password, destinations, getCallbackString(input))) {
+        return errorTooManyRequests(output);
+    }
 
     WalletPrepareTransferResponse out;
 
@@ -140,6 +149,46 @@ Status walletPrepareTransferRequestHandler
     return Status::Ok;
 }
 
+Status walletPrepareTransfersRequestHandler
+ (const Router::vars_t& vars, 
+  const graft::Input&   input,
+  graft::Context&       context,
+  WalletManager&        wallet_manager,
+  graft::Output&        output)
+{
+    WalletPrepareTransfersRequestJsonRpc request;
+
+    if (!input.get(request) || request.params.Transfers.size() > WalletManager::maxBatchTransfers()) {
+        return errorInvalidParams(output);
+    }
+
+    WalletManager::TransferArray transfers;
+
+    transfers.reserve(request.params.Transfers.size());
+
+    for (const auto& transfer : request.params.Transfers)
+    {
+        WalletManager::TransferDestinationArray destinations;
+
+        destinations.reserve(transfer.Destinations.size());
+
+        for (const auto& dest : transfer.Destinations)
+            destinations.push_back(WalletManager::TransferDestination(dest.Address, std::stoull(dest.Amount)));
+
+        transfers.push_back(std::move(destinations));
+    }
+
+    if (!wallet_manager.prepareTransfers(context, request.params.WalletId, request.params.Account, request.params.Password, transfers, getCallbackString(input))) {
+        return errorTooManyRequests(output);
+    }
+
+    WalletPrepareTransfersResponse out;
+
+    output.load(out);
+
+    return Status::Ok;
+}
+
 Status walletTransactionHistoryRequestHandler
  (const Router::vars_t& vars, 
   const graft::Input&   input,
@@ -153,7 +202,9 @@ Status walletTransactionHistoryRequestHandler
         return errorInvalidParams(output);
     }
 
-    wallet_manager.requestTransactionHistory(context, request.params.WalletId, request.params.Account, request.params.Password, getCallbackString(input));
+    if (!wallet_manager.requestTransactionHistory(context, request.params.WalletId, request.params.Account, request.params.Password, getCallbackString(input))) {
+        return errorTooManyRequests(output);
+    }
 
     WalletTransactionHistoryResponse out;
 
@@ -162,6 +213,31 @@ Status walletTransactionHistoryRequestHandler
     return Status::Ok;
 }
 
+Status walletQueueStatsRequestHandler
+ (const Router::vars_t& vars,
+  const graft::Input&   input,
+  graft::Context&       context,
+  WalletManager&        wallet_manager,
+  graft::Output&        output)
+{
+    WalletManager::QueueStats stats = wallet_manager.queueStats();
+
+    WalletQueueStatsResponse out;
+
+    out.OutstandingOperations    = stats.outstanding_operations;
+    out.MaxOutstandingOperations = stats.max_outstanding_operations;
+    out.MaxPendingRequests       = stats.max_pending_requests;
+    out.RejectedRequests         = stats.rejected_requests;
+    out.BusyWallets              = stats.busy_wallets;
+    out.PendingRequests          = stats.pending_requests;
+    out.PendingJobs              = stats.pending_jobs;
+    out.MaxWalletPendingJobs     = stats.max_wallet_pending_jobs;
+
+    output.load(out);
+
+    return Status::Ok;
+}
+
 namespace
 {
 
@@ -190,7 +266,9 @@ void registerWalletRequests(graft::Router& router, WalletManager& wallet_manager
     registerWalletRequest(router, wallet_manager, "/api/restore_account", METHOD_GET, walletRestoreAccountRequestHandler);
     registerWalletRequest(router, wallet_manager, "/api/wallet_balance", METHOD_GET, walletBalanceRequestHandler);
     registerWalletRequest(router, wallet_manager, "/api/prepare_transfer", METHOD_GET, walletPrepareTransferRequestHandler);
+    registerWalletRequest(router, wallet_manager, "/api/prepare_transfers", METHOD_GET, walletPrepareTransfersRequestHandler);
     registerWalletRequest(router, wallet_manager, "/api/transaction_history", METHOD_GET, walletTransactionHistoryRequestHandler);
+    registerWalletRequest(router, wallet_manager, "/api/queue_stats", METHOD_GET, walletQueueStatsRequestHandler);
 }
 
 }
@@ -6,7 +6,21 @@
 #include <boost/program_options.hpp>
 #include <boost/property_tree/ini_parser.hpp>
 
+#include <algorithm>
+
 const int WALLET_DISK_CACHES_UPDATE_TIME_MS = 10 * 60 * 1000; //TODO: move to config
+const size_t DEFAULT_WALLET_MAX_RESIDENT_COUNT = 1024;
+const size_t DEFAULT_WALLET_MEMORY_CACHE_TTL_MS = 10 * 60 * 1000;
+const size_t DEFAULT_WALLET_REFRESH_INTERVAL_MS = 5000;
+const size_t DEFAULT_WALLET_REFRESH_CONCURRENCY = 4;
+const int WALLET_CACHE_FLUSH_INTERVAL_MS = 1000;
+const size_t DEFAULT_WALLET_CACHE_FLUSH_DELAY_MS = 60 * 1000;
+const uint64_t DEFAULT_WALLET_CACHE_FLUSH_BANDWIDTH = 8 * 1024 * 1024;
+const size_t DEFAULT_SHARED_BLOCK_FETCH_TTL_MS = 500;
+const int SHARED_BLOCK_FETCH_EXPIRE_INTERVAL_MS = 1000;
+const size_t DEFAULT_WALLET_QUEUE_SIZE = 256;
+const size_t DEFAULT_WALLET_MAX_PENDING_REQUESTS = 64;
+const size_t DEFAULT_WALLET_MAX_OUTSTANDING_OPERATIONS = 4096;
 
 namespace po = boost::program_options;
 
@@ -14,6 +28,15 @@ namespace graft {
 
 namespace walletnode {
 
+namespace {
+
+// wallets use the walletnode as their cryptonode, the proxy listens on the loopback interface only,
+// so it is not open to clients of the walletnode; the port is chosen by the system
+const char* DAEMON_PROXY_PROTO   = "DAEMON";
+const char* DAEMON_PROXY_ADDRESS = "127.0.0.1:0";
+
+}
+
 WalletServer::WalletServer()
 {
 }
@@ -40,6 +63,21 @@ void WalletServer::setHttpRouters(ConnectionManager& httpcm)
     registerWalletRequests(httpcm);
 }
 
+void WalletServer::setDaemonProxyRouters()
+{
+    SharedBlockFetcher* fetcher = m_walletManager->blockFetcher();
+    if (!fetcher)
+        return;
+
+    std::unique_ptr<HttpConnectionManager> daemoncm = std::make_unique<HttpConnectionManager>(DAEMON_PROXY_PROTO, DAEMON_PROXY_ADDRESS);
+
+    Router daemon_router;
+    graft::walletnode::request::registerDaemonRequests(daemon_router, *fetcher);
+    daemoncm->addRouter(daemon_router);
+
+    addConMgr(std::move(daemoncm));
+}
+
 void WalletServer::initMisc(ConfigOpts& configOpts)
 {
     Context ctx(getLooper().getGcm());
@@ -54,14 +92,28 @@ void WalletServer::initMisc(ConfigOpts& configOpts)
 
 bool WalletServer::run(int argc, const char** argv)
 {
+    // the command line is kept on restart, the config file is read again
     for(;;)
     {
         if(!init(argc, argv, m_configOpts))
             return false;
 
-        argc = 1;
+        // wallets request the daemon proxy, which forwards requests to the cryptonode and shares block downloads
+        if (m_walletManager->blockFetcher())
+        {
+            Context ctx(getLooper().getGcm());
+            HttpConnectionManager* daemoncm = static_cast<HttpConnectionManager*>(getConMgr(DAEMON_PROXY_PROTO));
+            ctx.global["cryptonode_rpc_address"] = daemoncm->getBoundAddress();
+        }
 
-        if(GraftServer::run() != RunRes::SignalRestart)
+        RunRes res = GraftServer::run();
+
+        // wallet manager is bound to the looper which is recreated on restart
+        if(res != RunRes::SignalTerminate)
+            m_walletManager->flushAll();
+        m_walletManager.reset();
+
+        if(res != RunRes::SignalRestart)
             break;
     }
 
@@ -73,6 +125,25 @@ bool WalletServer::initConfigOption(int argc, const char** argv, ConfigOpts& con
     if (!GraftServer::initConfigOption(argc, argv, configOpts))
         return false;
 
+    ConfigOptsEx& coptsex = static_cast<ConfigOptsEx&>(configOpts);
+    assert(&m_configOpts == &coptsex);
+
+    boost::property_tree::ptree config;
+    boost::property_tree::ini_parser::read_ini(coptsex.config_filename, config);
+
+    const boost::property_tree::ptree& server_conf = config.get_child("server");
+    coptsex.wallet_max_resident_count = server_conf.get<size_t>("wallet-max-resident-count", DEFAULT_WALLET_MAX_RESIDENT_COUNT);
+    coptsex.wallet_memory_cache_ttl_ms = server_conf.get<size_t>("wallet-memory-cache-ttl-ms", DEFAULT_WALLET_MEMORY_CACHE_TTL_MS);
+    coptsex.wallet_refresh_interval_ms = server_conf.get<size_t>("wallet-refresh-interval-ms", DEFAULT_WALLET_REFRESH_INTERVAL_MS);
+    coptsex.wallet_refresh_concurrency = server_conf.get<size_t>("wallet-refresh-concurrency", DEFAULT_WALLET_REFRESH_CONCURRENCY);
+    coptsex.wallet_cache_flush_delay_ms = server_conf.get<size_t>("wallet-cache-flush-delay-ms", DEFAULT_WALLET_CACHE_FLUSH_DELAY_MS);
+    coptsex.wallet_cache_flush_bandwidth = server_conf.get<uint64_t>("wallet-cache-flush-bandwidth", DEFAULT_WALLET_CACHE_FLUSH_BANDWIDTH);
+    coptsex.shared_block_fetch = server_conf.get<bool>("shared-block-fetch", true);
+    coptsex.shared_block_fetch_ttl_ms = server_conf.get<size_t>("shared-block-fetch-ttl-ms", DEFAULT_SHARED_BLOCK_FETCH_TTL_MS);
+    coptsex.wallet_queue_size = server_conf.get<size_t>("wallet-queue-size", DEFAULT_WALLET_QUEUE_SIZE);
+    coptsex.wallet_max_pending_requests = server_conf.get<size_t>("wallet-max-pending-requests", DEFAULT_WALLET_MAX_PENDING_REQUESTS);
+    coptsex.wallet_max_outstanding_operations = server_conf.get<size_t>("wallet-max-outstanding-operations", DEFAULT_WALLET_MAX_OUTSTANDING_OPERATIONS);
+
     return true;
 }
 
@@ -81,18 +152,30 @@ void WalletServer::initWalletManager()
     assert(!m_walletManager);
 
     m_walletManager = std::make_unique<WalletManager>(getLooper(), m_configOpts.common.testnet);
+    m_walletManager->setResidencyLimits(m_configOpts.wallet_max_resident_count,
+                                        std::chrono::milliseconds(m_configOpts.wallet_memory_cache_ttl_ms));
+    m_walletManager->setMaxConcurrentRefreshes(std::max<size_t>(m_configOpts.wallet_refresh_concurrency, 1));
+    m_walletManager->setFlushDelay(std::chrono::milliseconds(m_configOpts.wallet_cache_flush_delay_ms));
+    m_walletManager->setFlushBandwidth(m_configOpts.wallet_cache_flush_bandwidth);
+    m_walletManager->setQueueLimits(m_configOpts.wallet_queue_size, m_configOpts.wallet_max_pending_requests,
+                                    m_configOpts.wallet_max_outstanding_operations);
+
+    if (m_configOpts.shared_block_fetch)
+        m_walletManager->enableSharedBlockFetch(std::chrono::milliseconds(m_configOpts.shared_block_fetch_ttl_ms));
 }
 
 void WalletServer::initRouters()
 {
     ConnectionManager* httpcm = getConMgr("HTTP");
     setHttpRouters(*httpcm);
+    setDaemonProxyRouters();
 }
 
 void WalletServer::flushWalletDiskCaches()
 {
     assert(&*m_walletManager);
     m_walletManager->flushDiskCaches();
+    m_walletManager->evictIdleWallets();
 }
 
 void WalletServer::startPeriodicTasks()
@@ -104,6 +187,38 @@ void WalletServer::startPeriodicTasks()
  
     getLooper().addPeriodicTask(graft::Router::Handler3(nullptr, flush_caches_handler, nullptr),
         std::chrono::milliseconds(WALLET_DISK_CACHES_UPDATE_TIME_MS), std::chrono::milliseconds(1));
+
+    // write-behind of wallet caches changed by requests and background refresh
+    Router::Handler flush_dirty_wallets_handler = [this](const graft::Router::vars_t&, const graft::Input&, graft::Context&, graft::Output&) {
+        m_walletManager->flushDirtyWallets();
+        return Status::Ok;
+    };
+
+    getLooper().addPeriodicTask(graft::Router::Handler3(nullptr, flush_dirty_wallets_handler, nullptr),
+        std::chrono::milliseconds(WALLET_CACHE_FLUSH_INTERVAL_MS));
+
+    if (SharedBlockFetcher* fetcher = m_walletManager->blockFetcher())
+    {
+        Router::Handler expire_block_fetches_handler = [fetcher](const graft::Router::vars_t&, const graft::Input&, graft::Context& ctx, graft::Output&) {
+            graft::walletnode::request::resumeExpiredBlockWaiters(ctx, *fetcher);
+            return Status::Ok;
+        };
+
+        getLooper().addPeriodicTask(graft::Router::Handler3(nullptr, expire_block_fetches_handler, nullptr),
+            std::chrono::milliseconds(SHARED_BLOCK_FETCH_EXPIRE_INTERVAL_MS));
+    }
+
+    if (m_configOpts.wallet_refresh_interval_ms == 0)
+        return;
+
+    // keeps resident wallets up to date, so refresh in request is usually no-op
+    Router::Handler refresh_wallets_handler = [this](const graft::Router::vars_t&, const graft::Input&, graft::Context&, graft::Output&) {
+        m_walletManager->refreshResidentWallets();
+        return Status::Ok;
+    };
+
+    getLooper().addPeriodicTask(graft::Router::Handler3(nullptr, refresh_wallets_handler, nullptr),
+        std::chrono::milliseconds(m_configOpts.wallet_refresh_interval_ms));
 }
 
 }//namespace walletnode
@@ -6,7 +6,9 @@
 #include "walletnode/requests/restore_account_request.h"
 #include "walletnode/requests/prepare_transfer_request.h"
 #include "walletnode/requests/transaction_history_request.h"
+#include "walletnode/batch_key_images.h"
 #include "supernode/requestdefines.h"
+#include "lib/graft/common/utils.h"
 
 #include "string_tools.h"
 
@@ -14,6 +16,9 @@
 
 #include <wallet/graft_wallet.h>
 
+#include <algorithm>
+#include <cassert>
+
 using namespace graft;
 using namespace graft::walletnode;
 using namespace graft::walletnode::request;
@@ -21,16 +26,81 @@ using namespace graft::walletnode::request;
 namespace
 {
 
-const unsigned int WALLET_MEMORY_CACHE_TTL_SECONDS       = 10 * 60; //TODO: move to config
-const unsigned int WALLET_TRANSACTIONS_QUEUE_SIZE        = 256; //TODO: move to config
+const std::chrono::seconds WALLET_MEMORY_CACHE_TTL(10 * 60);
+const size_t       WALLET_MAX_RESIDENT_COUNT             = 1024;
+const size_t       WALLET_MAX_CONCURRENT_REFRESHES       = 4;
+const std::chrono::seconds WALLET_CACHE_FLUSH_DELAY(60);
+const std::chrono::seconds WALLET_SHUTDOWN_FLUSH_TIMEOUT(120);
+const std::chrono::seconds WALLET_BLOCK_FETCH_TIMEOUT(60);
+const size_t       WALLET_MAX_SHARED_BLOCK_RESPONSES     = 64;
+const size_t       WALLET_TRANSACTIONS_QUEUE_SIZE        = 256;
+const size_t       WALLET_MAX_PENDING_REQUESTS           = 64;
+const size_t       WALLET_MAX_OUTSTANDING_OPERATIONS     = 4096;
+const size_t       WALLET_BACKGROUND_JOBS_RESERVE        = 4; // refresh, flush and unload jobs of a wallet
+const size_t       WALLET_MAX_BATCH_TRANSFERS            = 256;
 const uint64_t     WALLET_DISK_CACHE_FLUSH_DELAY_SECONDS = 3600; //TODO: move to config
 const char*        WALLETS_DIR_PREFIX                    = "wallets"; //TODO: move to config
 
+/// Free list of memory blocks of the same size, blocks are reused instead of going to the heap for each job
+template <size_t Size> class BlockPool
+{
+public:
+  static void* allocate()
+  {
+    BlockPool& pool = instance();
+    {
+      std::lock_guard<std::mutex> lock(pool.m_mutex);
+      if (!pool.m_blocks.empty())
+      {
+        void* block = pool.m_blocks.back();
+        pool.m_blocks.pop_back();
+        return block;
+      }
+    }
+    return ::operator new(Size);
+  }
+
+  static void deallocate(void* block)
+  {
+    BlockPool& pool = instance();
+    {
+      std::lock_guard<std::mutex> lock(pool.m_mutex);
+      if (pool.m_blocks.size() < MAX_FREE_BLOCKS)
+      {
+        pool.m_blocks.push_back(block);
+        return;
+      }
+    }
+    ::operator delete(block);
+  }
+
+private:
+  static const size_t MAX_FREE_BLOCKS = 1024;
+
+  BlockPool() { m_blocks.reserve(MAX_FREE_BLOCKS); }
+
+  ~BlockPool()
+  {
+    for (void* block : m_blocks)
+      ::operator delete(block);
+  }
+
+  static BlockPool& instance()
+  {
+    static BlockPool pool;
+    return pool;
+  }
+
+  std::mutex         m_mutex;
+  std::vector<void*> m_blocks;
+};
+
 /// Holder for lamba to be used inside FixedFunction
 struct FixedFunctionWrapper
 {
   struct IHolder
   {
+    virtual ~IHolder() = default;
     virtual void invoke() = 0;
   };
 
@@ -41,6 +111,10 @@ struct FixedFunctionWrapper
     HolderImpl(const Fn& in_fn) : fn(in_fn) {}
 
     void invoke() override { fn(); }
+
+    // holders of the same lambda have the same size, so they are taken from the pool
+    static void* operator new(size_t size) { assert(size == sizeof(HolderImpl)); return BlockPool<sizeof(HolderImpl)>::allocate(); }
+    static void operator delete(void* block) { BlockPool<sizeof(HolderImpl)>::deallocate(block); }
   };
 
   std::unique_ptr<IHolder> holder;
@@ -118,24 +192,13 @@ struct WebHookCallback
     result.query_string = url.query;
   }
 
+  /// Passes result to the looper which sends it to the callback URL, the result is moved out
   void invoke(TaskManager& task_manager)
   {
-    if (!task_manager.addPeriodicTask(*this, std::chrono::milliseconds(1)))
-      LOG_PRINT_L1("Failed to invoke " << result.proto << "://" << result.host << ":" << result.port << result.path);
-  }
-
-  Status operator()(const Router::vars_t&, const graft::Input&, graft::Context& context, graft::Output& output)
-  {
-    if (context.local.hasKey(__FUNCTION__))
-      return Status::Stop;
-
     LOG_PRINT_L2("Send response to " << result.proto << "://" << result.host << ":" << result.port << ". Body '" << result.body << "'");
 
-    output = result;
-
-    context.local[__FUNCTION__] = true;
-
-    return Status::Forward;
+    if (!task_manager.sendUpstreamAsync(std::move(result)))
+      LOG_PRINT_L1("Failed to invoke callback, queue of callbacks is full");
   }
 };
 
@@ -151,6 +214,53 @@ void invoke_error_http(const char* url, const char* error_text, TaskManager& tas
   callback.invoke(task_manager);
 }
 
+std::vector<cryptonote::tx_destination_entry> make_destinations(const WalletManager::TransferDestinationArray& in_destinations)
+{
+  std::vector<cryptonote::tx_destination_entry> destinations;
+
+  destinations.reserve(in_destinations.size());
+
+  for (const WalletManager::TransferDestination& dest : in_destinations)
+  {
+      cryptonote::account_public_address address;
+
+      memset(&address.m_view_public_key.data[0], 0, sizeof(address.m_view_public_key.data));
+
+      assert(dest.address.size() >= sizeof(address.m_spend_public_key.data));
+
+      memcpy(&address.m_spend_public_key.data[0], dest.address.c_str(), sizeof(address.m_spend_public_key.data));
+
+      destinations.push_back(cryptonote::tx_destination_entry(dest.amount, address));
+  }
+
+  return destinations;
+}
+
+std::vector<tools::GraftWallet::pending_tx> create_transactions(tools::GraftWallet& wallet, const std::vector<cryptonote::tx_destination_entry>& destinations)
+{
+  const size_t fake_outs_count = 0;
+  const uint64_t unlock_time = 0;
+  const uint32_t priority = 0;
+  const std::vector<uint8_t> extra;
+  const bool trusted_daemon = true;
+
+  return wallet.create_transactions(destinations, fake_outs_count, unlock_time, priority, extra, trusted_daemon);
+}
+
+void serialize_transactions(const std::vector<tools::GraftWallet::pending_tx>& transactions, std::vector<std::string>& serialized_transactions, uint64_t& total_fee)
+{
+  serialized_transactions.reserve(transactions.size());
+
+  total_fee = 0;
+
+  for (const tools::GraftWallet::pending_tx& transaction : transactions)
+  {
+      serialized_transactions.push_back(epee::string_tools::buff_to_hex_nodelimer(cryptonote::tx_to_blob(transaction.tx)));
+
+      total_fee += transaction.fee;
+  }
+}
+
 void create_directories(const std::string& file_name)
 {
   boost::filesystem::path path(file_name);
@@ -168,16 +278,135 @@ struct WalletManager::WalletHolder
   tools::GraftWallet wallet;
   StrandX            strand;
 
-  WalletHolder(ThreadPoolX& thread_pool, bool testnet)
+  // following fields are accessed from the wallet's strand only
+  bool         loaded = false; // keys and cache are loaded
+  bool         dirty  = false; // wallet state changed since cache was stored last time
+  crypto::hash credentials_hash = crypto::null_hash; // hash of account data and password the wallet was loaded with
+
+  std::atomic<int64_t>  last_access_time;
+  std::atomic<int64_t>  last_refresh_time;
+  std::atomic<bool>     refresh_scheduled; // background refresh is queued to the strand
+  std::atomic<uint64_t> cache_size;        // size of the cache file stored last time
+  std::atomic<size_t>   pending_requests;  // client requests queued to the strand or running
+
+  WalletHolder(ThreadPoolX& thread_pool, bool testnet, size_t queue_size)
     : wallet(testnet)
-    , strand(thread_pool, WALLET_TRANSACTIONS_QUEUE_SIZE)
+    , strand(thread_pool, queue_size)
+    , last_access_time(time(nullptr))
+    , last_refresh_time(0)
+    , refresh_scheduled(false)
+    , cache_size(0)
+    , pending_requests(0)
+  {
+  }
+
+  static crypto::hash credentialsHash(const std::string& account_data, const std::string& password)
+  {
+    std::string credentials = account_data;
+    credentials.push_back('\0');
+    credentials += password;
+
+    crypto::hash hash;
+    crypto::cn_fast_hash(credentials.data(), credentials.size(), hash);
+    return hash;
+  }
+
+  /// Loads keys and cache unless the wallet is already loaded with the same credentials
+  void load(const std::string& account_data, const std::string& password, const std::string& cache_file_name)
+  {
+    crypto::hash hash = credentialsHash(account_data, password);
+
+    if (loaded && hash == credentials_hash)
+      return;
+
+    // wallet state is undefined if loading fails, so it will be reloaded next time
+    loaded = false;
+
+    wallet.loadFromData(account_data, password);
+    wallet.load_cache(cache_file_name);
+
+    loaded           = true;
+    dirty            = false;
+    credentials_hash = hash;
+  }
+
+  /// Hash of transfers of the wallet in the transaction pool, refresh updates them without new blocks
+  crypto::hash poolTransfersHash()
+  {
+    std::string state;
+
+    std::list<std::pair<crypto::hash, tools::wallet2::payment_details>> payments;
+    wallet.get_unconfirmed_payments(payments);
+
+    for (const auto& payment : payments)
+      state.append(reinterpret_cast<const char*>(&payment.second.m_tx_hash), sizeof(payment.second.m_tx_hash));
+
+    std::list<std::pair<crypto::hash, tools::wallet2::unconfirmed_transfer_details>> payments_out;
+    wallet.get_unconfirmed_payments_out(payments_out);
+
+    for (const auto& payment : payments_out)
+    {
+      state.append(reinterpret_cast<const char*>(&payment.first), sizeof(payment.first));
+      state.push_back(static_cast<char>(payment.second.m_state));
+    }
+
+    crypto::hash hash;
+    crypto::cn_fast_hash(state.data(), state.size(), hash);
+    return hash;
+  }
+
+  /// Scans blocks received since the last refresh and the transaction pool, marks wallet dirty if either changed it
+  void refresh()
   {
+    uint64_t height = wallet.get_blockchain_current_height();
+    crypto::hash pool_transfers = poolTransfersHash();
+
+    wallet.refresh();
+
+    last_refresh_time = time(nullptr);
+
+    if (wallet.get_blockchain_current_height() != height || poolTransfersHash() != pool_transfers)
+      dirty = true;
+  }
+
+  /// Stores cache, the file is replaced atomically so crash never leaves it partially written
+  void store(const std::string& cache_file_name)
+  {
+    utils::storeFileAtomically(cache_file_name, [this](const std::string& tmp_file_name) {
+      wallet.store_cache(tmp_file_name);
+    });
+
+    cache_size = boost::filesystem::file_size(cache_file_name);
+  }
+
+  /// Stores cache if wallet state changed
+  void storeIfDirty(const std::string& cache_file_name)
+  {
+    if (!dirty)
+      return;
+
+    store(cache_file_name);
+    dirty = false;
   }
 };
 
 WalletManager::WalletManager(TaskManager& task_manager, bool testnet)
   : m_testnet(testnet)
   , m_task_manager(task_manager)
+  , m_max_resident_count(WALLET_MAX_RESIDENT_COUNT)
+  , m_memory_cache_ttl(WALLET_MEMORY_CACHE_TTL)
+  , m_max_concurrent_refreshes(WALLET_MAX_CONCURRENT_REFRESHES)
+  , m_refreshes_in_progress(0)
+  , m_flushes_in_progress(0)
+  , m_flush_delay(WALLET_CACHE_FLUSH_DELAY)
+  , m_flush_bandwidth(0)
+  , m_flush_budget(0)
+  , m_flush_budget_time(std::chrono::steady_clock::now())
+  , m_queue_size(WALLET_TRANSACTIONS_QUEUE_SIZE)
+  , m_max_pending_requests(WALLET_MAX_PENDING_REQUESTS)
+  , m_max_outstanding_operations(WALLET_MAX_OUTSTANDING_OPERATIONS)
+  , m_outstanding_operations(0)
+  , m_rejected_requests(0)
 {
   LOG_PRINT_L1("TestNet is " << testnet);
 }
@@ -186,27 +415,445 @@ WalletManager::~WalletManager()
 {
 }
 
+void WalletManager::setResidencyLimits(size_t max_resident_count, std::chrono::milliseconds memory_cache_ttl)
+{
+  m_max_resident_count = std::max<size_t>(max_resident_count, 1);
+  m_memory_cache_ttl   = memory_cache_ttl;
+}
+
+void WalletManager::enableSharedBlockFetch(std::chrono::milliseconds cache_ttl)
+{
+  m_block_fetcher = std::make_unique<SharedBlockFetcher>(cache_ttl, WALLET_BLOCK_FETCH_TIMEOUT, WALLET_MAX_SHARED_BLOCK_RESPONSES);
+}
+
 WalletManager::WalletPtr WalletManager::createWallet(Context& context)
 {
-  WalletPtr wallet(new WalletHolder(m_task_manager.getThreadPool(), m_testnet));
+  WalletPtr wallet(new WalletHolder(m_task_manager.getThreadPool(), m_testnet, m_queue_size));
 
   wallet->wallet.init(context.global["cryptonode_rpc_address"]);
 
   return wallet;
 }
 
-void WalletManager::registerWallet(Context& context, const std::string& wallet_id, const WalletPtr& wallet)
+WalletManager::WalletPtr WalletManager::registerWallet(const WalletId& wallet_id, const WalletPtr& wallet)
+{
+  std::vector<std::pair<WalletId, WalletPtr>> evicted;
+  WalletPtr resident;
+
+  {
+    std::lock_guard<std::mutex> lock(m_wallets_mutex);
+
+    auto it = m_wallets.find(wallet_id);
+
+    if (it != m_wallets.end())
+    {
+      // the registered holder may have jobs queued on its strand, it is kept so a wallet never has two live holders
+      resident = it->second.wallet;
+      resident->last_access_time = time(nullptr);
+      m_wallets_lru.splice(m_wallets_lru.end(), m_wallets_lru, it->second.lru_position);
+      return resident;
+    }
+
+    resident = wallet;
+    m_wallets_lru.push_back(wallet_id);
+    m_wallets.emplace(wallet_id, ResidentWallet{wallet, std::prev(m_wallets_lru.end())});
+
+    while (m_wallets.size() > m_max_resident_count)
+    {
+      const WalletId& lru_id = m_wallets_lru.front();
+      auto lru_it = m_wallets.find(lru_id);
+      evicted.emplace_back(lru_id, lru_it->second.wallet);
+      m_wallets.erase(lru_it);
+      m_wallets_lru.pop_front();
+    }
+  }
+
+  for (const auto& item : evicted)
+    unloadWallet(item.first, item.second);
+
+  return resident;
+}
+
+WalletManager::WalletPtr WalletManager::getResidentWallet(Context& context, const WalletId& wallet_id)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_wallets_mutex);
+
+    auto it = m_wallets.find(wallet_id);
+
+    if (it != m_wallets.end())
+    {
+      m_wallets_lru.splice(m_wallets_lru.end(), m_wallets_lru, it->second.lru_position);
+      it->second.wallet->last_access_time = time(nullptr);
+      return it->second.wallet;
+    }
+  }
+
+  // concurrent request for the same wallet could register its own instance first, that one is used then
+  return registerWallet(wallet_id, createWallet(context));
+}
+
+void WalletManager::unloadWallet(const WalletId& wallet_id, const WalletPtr& wallet)
+{
+  LOG_PRINT_L1("Unload wallet '" << wallet_id << "'");
+
+  // the job is queued after pending operations of the wallet, the wallet is released when the strand is done with it
+  bool posted = wallet->strand.tryPost(FixedFunctionWrapper([wallet_id, wallet]() {
+    try
+    {
+      if (wallet->loaded)
+        wallet->storeIfDirty(getWalletCacheFileName(wallet_id));
+    }
+    catch (std::exception& e)
+    {
+      LOG_PRINT_L1("Excepton " << e.what() << " during unloading wallet '" << wallet_id << "'");
+    }
+  }));
+
+  // queue is full, changes will be stored by background flush
+  if (!posted)
+    scheduleFlush(wallet_id, wallet);
+}
+
+void WalletManager::evictIdleWallets()
 {
-  context.global.set(wallet_id, wallet, std::chrono::seconds(WALLET_MEMORY_CACHE_TTL_SECONDS)); //TODO: what about canceling expiration, when wallet has transactions in queue?
+  const int64_t expiration_time = time(nullptr) - std::chrono::duration_cast<std::chrono::seconds>(m_memory_cache_ttl.load()).count();
+
+  std::vector<std::pair<WalletId, WalletPtr>> evicted;
+
+  {
+    std::lock_guard<std::mutex> lock(m_wallets_mutex);
+
+    // LRU is ordered by access time, so idle wallets are at the front
+    while (!m_wallets_lru.empty())
+    {
+      auto it = m_wallets.find(m_wallets_lru.front());
+
+      if (it->second.wallet->last_access_time > expiration_time)
+        break;
+
+      evicted.emplace_back(it->first, it->second.wallet);
+      m_wallets.erase(it);
+      m_wallets_lru.pop_front();
+    }
+  }
+
+  for (const auto& item : evicted)
+    unloadWallet(item.first, item.second);
 }
 
-std::string WalletManager::getContextWalletId(const std::string& public_address)
+size_t WalletManager::residentWalletsCount() const
 {
-  return "wallet_" + public_address;
+  std::lock_guard<std::mutex> lock(m_wallets_mutex);
+  return m_wallets.size();
+}
+
+void WalletManager::refreshResidentWallets()
+{
+  size_t max_refreshes = m_max_concurrent_refreshes;
+  size_t in_progress   = m_refreshes_in_progress;
+
+  if (in_progress >= max_refreshes)
+    return;
+
+  struct Candidate
+  {
+    int64_t   last_refresh_time; // copied, the wallet's value may change while candidates are sorted
+    WalletId  wallet_id;
+    WalletPtr wallet;
+  };
+
+  std::vector<Candidate> candidates;
+
+  {
+    std::lock_guard<std::mutex> lock(m_wallets_mutex);
+
+    candidates.reserve(m_wallets.size());
+
+    for (const auto& item : m_wallets)
+    {
+      if (!item.second.wallet->refresh_scheduled)
+        candidates.push_back(Candidate{item.second.wallet->last_refresh_time, item.first, item.second.wallet});
+    }
+  }
+
+  // wallets refreshed least recently go first, so every resident wallet gets its turn
+  size_t count = std::min(max_refreshes - in_progress, candidates.size());
+
+  std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), [](const Candidate& a, const Candidate& b) {
+    return a.last_refresh_time < b.last_refresh_time;
+  });
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    const WalletId& wallet_id = candidates[i].wallet_id;
+    WalletPtr       wallet    = candidates[i].wallet;
+
+    if (wallet->refresh_scheduled.exchange(true))
+      continue;
+
+    ++m_refreshes_in_progress;
+
+    bool posted = wallet->strand.tryPost(FixedFunctionWrapper([wallet_id, wallet, this]() {
+      try
+      {
+        // wallet which was never used by a request has no keys to scan blocks with
+        if (wallet->loaded)
+        {
+          wallet->refresh();
+          LOG_PRINT_L2("Wallet '" << wallet_id << "' refreshed in background, height " << wallet->wallet.get_blockchain_current_height());
+
+          if (wallet->dirty)
+            scheduleFlush(wallet_id, wallet);
+        }
+      }
+      catch (std::exception& e)
+      {
+        LOG_PRINT_L1("Excepton " << e.what() << " during background refresh of wallet '" << wallet_id << "'");
+      }
+
+      wallet->refresh_scheduled = false;
+      --m_refreshes_in_progress;
+    }));
+
+    // wallet is busy with requests, which refresh it anyway
+    if (!posted)
+    {
+      wallet->refresh_scheduled = false;
+      --m_refreshes_in_progress;
+    }
+  }
+}
+
+void WalletManager::scheduleFlush(const WalletId& wallet_id, const WalletPtr& wallet)
+{
+  std::lock_guard<std::mutex> lock(m_flush_mutex);
+
+  auto it = m_dirty_wallets.find(wallet_id);
+
+  // wallet already waits for flush, the pending store will include this change as well
+  if (it != m_dirty_wallets.end())
+  {
+    it->second.wallet = wallet;
+    return;
+  }
+
+  m_dirty_wallets.emplace(wallet_id, DirtyWallet{wallet, std::chrono::steady_clock::now()});
+}
+
+void WalletManager::postFlush(const WalletId& wallet_id, const WalletPtr& wallet, int64_t estimated_size)
+{
+  bool posted = wallet->strand.tryPost(FixedFunctionWrapper([wallet_id, wallet, estimated_size, this]() {
+    int64_t stored_size = 0;
+
+    try
+    {
+      if (wallet->loaded && wallet->dirty)
+      {
+        wallet->storeIfDirty(getWalletCacheFileName(wallet_id));
+        stored_size = wallet->cache_size;
+        LOG_PRINT_L2("Wallet '" << wallet_id << "' cache stored, " << stored_size << " bytes");
+      }
+    }
+    catch (std::exception& e)
+    {
+      LOG_PRINT_L1("Excepton " << e.what() << " during storing cache of wallet '" << wallet_id << "'");
+    }
+
+    std::lock_guard<std::mutex> lock(m_flush_mutex);
+
+    // bandwidth was charged with estimation, correct it with the real size
+    m_flush_budget += estimated_size - stored_size;
+
+    --m_flushes_in_progress;
+    m_flush_done.notify_all();
+  }));
+
+  if (posted)
+    return;
+
+  // queue is full, the wallet is flushed next time
+  scheduleFlush(wallet_id, wallet);
+
+  std::lock_guard<std::mutex> lock(m_flush_mutex);
+
+  m_flush_budget += estimated_size;
+
+  --m_flushes_in_progress;
+  m_flush_done.notify_all();
+}
+
+void WalletManager::flushDirtyWallets()
+{
+  using namespace std::chrono;
+
+  struct Candidate
+  {
+    steady_clock::time_point dirty_since;
+    WalletId                 wallet_id;
+    WalletPtr                wallet;
+  };
+
+  std::vector<std::pair<Candidate, int64_t>> flushes;
+
+  {
+    std::lock_guard<std::mutex> lock(m_flush_mutex);
+
+    const steady_clock::time_point now = steady_clock::now();
+    const uint64_t bandwidth = m_flush_bandwidth;
+
+    // budget grows with time, unused budget is accumulated for one second at most
+    if (bandwidth)
+    {
+      int64_t elapsed_ms = duration_cast<milliseconds>(now - m_flush_budget_time).count();
+      m_flush_budget = std::min<int64_t>(m_flush_budget + int64_t(bandwidth) * elapsed_ms / 1000, bandwidth);
+    }
+
+    m_flush_budget_time = now;
+
+    std::vector<Candidate> candidates;
+
+    for (const auto& item : m_dirty_wallets)
+    {
+      if (now - item.second.dirty_since >= m_flush_delay)
+        candidates.push_back(Candidate{item.second.dirty_since, item.first, item.second.wallet});
+    }
+
+    // wallets which wait longest go first, the rest waits for budget
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+      return a.dirty_since < b.dirty_since;
+    });
+
+    for (Candidate& candidate : candidates)
+    {
+      if (bandwidth && m_flush_budget <= 0)
+        break;
+
+      // wallet which has never been stored is charged at least one byte, so the loop ends
+      int64_t estimated_size = std::max<int64_t>(candidate.wallet->cache_size, 1);
+
+      if (bandwidth)
+        m_flush_budget -= estimated_size;
+      else
+        estimated_size = 0;
+
+      m_dirty_wallets.erase(candidate.wallet_id);
+      ++m_flushes_in_progress;
+
+      flushes.emplace_back(std::move(candidate), estimated_size);
+    }
+  }
+
+  for (const auto& flush : flushes)
+    postFlush(flush.first.wallet_id, flush.first.wallet, flush.second);
+}
+
+void WalletManager::flushAll()
+{
+  LOG_PRINT_L1("Flush all dirty wallets");
+
+  const auto deadline = std::chrono::steady_clock::now() + WALLET_SHUTDOWN_FLUSH_TIMEOUT;
+
+  for (;;)
+  {
+    std::vector<std::pair<WalletId, WalletPtr>> flushes;
+
+    {
+      std::unique_lock<std::mutex> lock(m_flush_mutex);
+
+      for (const auto& item : m_dirty_wallets)
+        flushes.emplace_back(item.first, item.second.wallet);
+
+      m_dirty_wallets.clear();
+      m_flushes_in_progress += flushes.size();
+    }
+
+    for (const auto& flush : flushes)
+      postFlush(flush.first, flush.second, 0);
+
+    std::unique_lock<std::mutex> lock(m_flush_mutex);
+
+    if (!m_flush_done.wait_until(lock, deadline, [this]() { return m_flushes_in_progress == 0; }))
+    {
+      LOG_PRINT_L1("Timeout of flushing wallets, " << m_flushes_in_progress << " flushes are not finished");
+      return;
+    }
+
+    // wallet operations which were in progress could mark wallets dirty again
+    if (m_dirty_wallets.empty())
+      return;
+  }
+}
+
+void WalletManager::setQueueLimits(size_t queue_size, size_t max_pending_requests, size_t max_outstanding_operations)
+{
+  // strand queue requires power of 2 size
+  size_t size = 2;
+
+  while (size < queue_size)
+    size *= 2;
+
+  m_queue_size = size;
+
+  // part of the queue is reserved for background jobs, so they are never rejected because of client requests
+  size_t max_pending = size > WALLET_BACKGROUND_JOBS_RESERVE ? size - WALLET_BACKGROUND_JOBS_RESERVE : 1;
+
+  m_max_pending_requests       = std::max<size_t>(std::min(max_pending_requests, max_pending), 1);
+  m_max_outstanding_operations = std::max<size_t>(max_outstanding_operations, 1);
+}
+
+WalletManager::QueueStats WalletManager::queueStats() const
+{
+  QueueStats stats;
+
+  stats.outstanding_operations     = m_outstanding_operations;
+  stats.max_outstanding_operations = m_max_outstanding_operations;
+  stats.max_pending_requests       = m_max_pending_requests;
+  stats.rejected_requests          = m_rejected_requests;
+  stats.busy_wallets               = 0;
+  stats.pending_requests           = 0;
+  stats.pending_jobs               = 0;
+  stats.max_wallet_pending_jobs    = 0;
+
+  std::lock_guard<std::mutex> lock(m_wallets_mutex);
+
+  for (const auto& item : m_wallets)
+  {
+    const WalletHolder& wallet = *item.second.wallet;
+    size_t pending_jobs = wallet.strand.pendingCount();
+
+    if (!pending_jobs)
+      continue;
+
+    ++stats.busy_wallets;
+    stats.pending_requests       += wallet.pending_requests;
+    stats.pending_jobs           += pending_jobs;
+    stats.max_wallet_pending_jobs = std::max(stats.max_wallet_pending_jobs, pending_jobs);
+  }
+
+  return stats;
+}
+
+bool WalletManager::acquireOperation()
+{
+  if (m_outstanding_operations.fetch_add(1) < m_max_outstanding_operations)
+    return true;
+
+  --m_outstanding_operations;
+  ++m_rejected_requests;
+
+  LOG_PRINT_L1("Too many outstanding wallet operations");
+
+  return false;
+}
+
+void WalletManager::releaseOperation()
+{
+  --m_outstanding_operations;
 }
 
 template <class Fn>
-void WalletManager::runAsyncForWallet
+bool WalletManager::runAsyncForWallet
  (Context& context,
   const WalletId& public_address,
   const std::string& account_data,
@@ -214,32 +861,42 @@ void WalletManager::runAsyncForWallet
   const Url& callback_url,
   const Fn& fn)
 {
-  std::string wallet_id = getContextWalletId(public_address);
-  WalletPtr   wallet    = context.global.get<WalletPtr>(wallet_id, WalletPtr());
+  WalletPtr wallet = getResidentWallet(context, public_address);
 
-  if (!wallet)
+  // client is rejected at once instead of waiting behind a long queue
+  if (wallet->pending_requests.fetch_add(1) >= m_max_pending_requests)
   {
-    wallet = createWallet(context);
+    --wallet->pending_requests;
+    ++m_rejected_requests;
+    LOG_PRINT_L1("Too many pending requests for wallet '" << public_address << "'");
+    return false;
+  }
 
-    registerWallet(context, wallet_id, wallet);
+  if (!acquireOperation())
+  {
+    --wallet->pending_requests;
+    return false;
   }
 
-  wallet->strand.post(FixedFunctionWrapper([public_address, wallet, account_data, password, fn, callback_url, this]() {
+  bool posted = wallet->strand.tryPost(FixedFunctionWrapper([public_address, wallet, account_data, password, fn, callback_url, this]() {
     try
     {
-      wallet->wallet.loadFromData(account_data, password);
-
       std::string cache_file_name = getWalletCacheFileName(public_address);
 
-      wallet->wallet.load_cache(cache_file_name);
+      // resident wallet is loaded once and then only scans new blocks
+      wallet->load(account_data, password, cache_file_name);
 
-      wallet->wallet.refresh();
+      wallet->refresh();
 
       WebHookCallback callback(callback_url.c_str());
 
-      fn(wallet->wallet, callback.result);
+      // the operation reports whether it changed the wallet, read-only operations leave the cache as is
+      if (fn(wallet->wallet, callback.result))
+        wallet->dirty = true;
 
-      wallet->wallet.store_cache(cache_file_name);
+      // cache is stored by background flush, so the callback is not delayed by disk writes
+      if (wallet->dirty)
+        scheduleFlush(public_address, wallet);
 
       if (!callback_url.empty())
         callback.invoke(m_task_manager);
@@ -254,13 +911,29 @@ void WalletManager::runAsyncForWallet
       LOG_PRINT_L1("Unhandled excepton during call " << __FUNCTION__);
       invoke_error_http(callback_url.c_str(), "unhandled exception", m_task_manager);
     }
+
+    --wallet->pending_requests;
+    releaseOperation();
   }));
+
+  if (!posted)
+  {
+    --wallet->pending_requests;
+    releaseOperation();
+    ++m_rejected_requests;
+    LOG_PRINT_L1("Queue of wallet '" << public_address << "' is full");
+  }
+
+  return posted;
 }
 
 template <class Fn>
-void WalletManager::runAsync(Context& context, const Url& callback_url, const Fn& fn)
+bool WalletManager::runAsync(Context& context, const Url& callback_url, const Fn& fn)
 {
-  m_task_manager.getThreadPool().post(FixedFunctionWrapper([fn, callback_url, this]() {
+  if (!acquireOperation())
+    return false;
+
+  auto job = FixedFunctionWrapper([fn, callback_url, this]() {
     try
     {    
       WebHookCallback callback(callback_url.c_str());
@@ -280,7 +953,23 @@ void WalletManager::runAsync(Context& context, const Url& callback_url, const Fn
       LOG_PRINT_L1("Unhandled excepton during call " << __FUNCTION__);
       invoke_error_http(callback_url.c_str(), "unhandled exception", m_task_manager);
     }
-  }));
+
+    releaseOperation();
+  });
+
+  try
+  {
+    m_task_manager.getThreadPool().post(std::move(job));
+  }
+  catch (std::exception& e)
+  {
+    releaseOperation();
+    ++m_rejected_requests;
+    LOG_PRINT_L1("Excepton " << e.what() << " during call " << __FUNCTION__);
+    return false;
+  }
+
+  return true;
 }
 
 std::string WalletManager::getWalletCacheFileName(const WalletId& id)
@@ -293,11 +982,11 @@ std::string WalletManager::getWalletCacheFileName(const WalletId& id)
   return std::string(WALLETS_DIR_PREFIX) + "/" + id.substr(0, WALLET_CACHE_FILE_NAME_PREFIX_SIZE) + "/" + id + ".cache";
 }
 
-void WalletManager::createAccount(Context& context, const std::string& password, const std::string& language, const Url& callback_url)
+bool WalletManager::createAccount(Context& context, const std::string& password, const std::string& language, const Url& callback_url)
 {
   GlobalContextMap* gcm = &context.global.getGcm();
 
-  runAsync(context, callback_url, [gcm, callback_url, password, language, this](OutHttp& result) {
+  return runAsync(context, callback_url, [gcm, callback_url, password, language, this](OutHttp& result) {
     Context context(*gcm);
 
     LOG_PRINT_L1("Create account (callback=" << callback_url << ")");
@@ -323,11 +1012,13 @@ void WalletManager::createAccount(Context& context, const std::string& password,
 
     create_directories(cache_file_name);
 
-    wallet->wallet.store_cache(cache_file_name);
+    wallet->store(cache_file_name);
 
-    std::string wallet_id = getContextWalletId(public_address);
+    // wallet stays resident, following calls with the returned account data don't load it again
+    wallet->loaded           = true;
+    wallet->credentials_hash = WalletHolder::credentialsHash(account_data, password);
 
-    registerWallet(context, wallet_id, wallet);
+    registerWallet(public_address, wallet);
 
     WalletCreateAccountCallbackRequest out;
 
@@ -344,11 +1035,11 @@ void WalletManager::createAccount(Context& context, const std::string& password,
   });
 }
 
-void WalletManager::restoreAccount(Context& context, const std::string& password, const std::string& seed, const Url& callback_url)
+bool WalletManager::restoreAccount(Context& context, const std::string& password, const std::string& seed, const Url& callback_url)
 {
   GlobalContextMap* gcm = &context.global.getGcm();
 
-  runAsync(context, callback_url, [gcm, callback_url, password, seed, this](OutHttp& result) {
+  return runAsync(context, callback_url, [gcm, callback_url, password, seed, this](OutHttp& result) {
     Context context(*gcm);
 
     LOG_PRINT_L1("Restore account (callback=" << callback_url << ")");
@@ -381,11 +1072,14 @@ void WalletManager::restoreAccount(Context& context, const std::string& password
 
     create_directories(cache_file_name);
 
-    wallet->wallet.store_cache(cache_file_name);
+    wallet->store(cache_file_name);
 
-    std::string wallet_id = getContextWalletId(public_address);
+    // wallet stays resident, following calls with the returned account data don't load it again
+    wallet->loaded           = true;
+    wallet->credentials_hash = WalletHolder::credentialsHash(account_data, password);
 
-    registerWallet(context, wallet_id, wallet);    
+    // the wallet may be resident already, that holder is kept with its queued jobs and this one is dropped
+    registerWallet(public_address, wallet);
 
     WalletRestoreAccountCallbackRequest out;
 
@@ -402,9 +1096,9 @@ void WalletManager::restoreAccount(Context& context, const std::string& password
   });
 }
 
-void WalletManager::requestBalance(Context& context, const WalletId& wallet_id, const std::string& account_data, const std::string& password, const Url& callback_url)
+bool WalletManager::requestBalance(Context& context, const WalletId& wallet_id, const std::string& account_data, const std::string& password, const Url& callback_url)
 {
-  runAsyncForWallet(context, wallet_id, account_data, password, callback_url, [this, wallet_id, callback_url](tools::GraftWallet& wallet, OutHttp& result) {
+  return runAsyncForWallet(context, wallet_id, account_data, password, callback_url, [this, wallet_id, callback_url](tools::GraftWallet& wallet, OutHttp& result) {
     LOG_PRINT_L1("Request balance for wallet '" << wallet_id << "'(callback=" << callback_url << ")");
 
     WalletBalanceCallbackRequest out;
@@ -414,72 +1108,120 @@ void WalletManager::requestBalance(Context& context, const WalletId& wallet_id,
     out.UnlockedBalance = std::to_string(wallet.unlocked_balance());
 
     result.load(out);
+
+    return false;
   });
 }
 
-void WalletManager::prepareTransfer(Context& context, const WalletId& wallet_id, const std::string& account_data, const std::string& password, const TransferDestinationArray& in_destinations, const Url& callback_url)
+bool WalletManager::prepareTransfer(Context& context, const WalletId& wallet_id, const std::string& account_data, const std::string& password, const TransferDestinationArray& in_destinations, const Url& callback_url)
 {
-  std::vector<cryptonote::tx_destination_entry> destinations;
+  std::vector<cryptonote::tx_destination_entry> destinations = make_destinations(in_destinations);
 
-  destinations.reserve(in_destinations.size());
+  return runAsyncForWallet(context, wallet_id, account_data, password, callback_url, [this, wallet_id, destinations, callback_url](tools::GraftWallet& wallet, OutHttp& result) {
+    LOG_PRINT_L1("Prepare transfer for wallet '" << wallet_id << "'(callback=" << callback_url << ")");
 
-  for (const TransferDestination& dest : in_destinations)
-  {
-      cryptonote::account_public_address address;
+    std::vector<tools::GraftWallet::pending_tx> transactions = create_transactions(wallet, destinations);
 
-      memset(&address.m_view_public_key.data[0], 0, sizeof(address.m_view_public_key.data));
+    std::vector<std::string> serialized_transactions;
+    uint64_t total_fee = 0;
 
-      assert(dest.address.size() >= sizeof(address.m_spend_public_key.data));
+    serialize_transactions(transactions, serialized_transactions, total_fee);
 
-      memcpy(&address.m_spend_public_key.data[0], dest.address.c_str(), sizeof(address.m_spend_public_key.data));
+    WalletPrepareTransferCallbackRequest out;
 
-      destinations.push_back(cryptonote::tx_destination_entry(dest.amount, address));
-  }
+    out.Result       = 0;
+    out.Fee          = std::to_string(total_fee);
+    out.Transactions = std::move(serialized_transactions);
 
-  runAsyncForWallet(context, wallet_id, account_data, password, callback_url, [this, wallet_id, destinations, callback_url](tools::GraftWallet& wallet, OutHttp& result) {
-    LOG_PRINT_L1("Prepare transfer for wallet '" << wallet_id << "'(callback=" << callback_url << ")");
+    result.load(out);
 
-    const size_t fake_outs_count = 0;
-    const uint64_t unlock_time = 0;
-    const uint32_t priority = 0;
-    const std::vector<uint8_t> extra;
-    const bool trusted_daemon = true;
+    // transactions are not committed, so the wallet does not change
+    return false;
+  });
+}
 
-    std::vector<tools::GraftWallet::pending_tx> transactions = wallet.create_transactions(destinations, fake_outs_count, unlock_time, priority, extra, trusted_daemon);
+size_t WalletManager::maxBatchTransfers()
+{
+  return WALLET_MAX_BATCH_TRANSFERS;
+}
 
-    std::vector<std::string> serialized_transactions;
+bool WalletManager::prepareTransfers(Context& context, const WalletId& wallet_id, const std::string& account_data, const std::string& password, const TransferArray& in_transfers, const Url& callback_url)
+{
+  if (in_transfers.size() > WALLET_MAX_BATCH_TRANSFERS)
+    throw std::invalid_argument("too many transfers in batch");
 
-    serialized_transactions.reserve(transactions.size());
+  std::vector<std::vector<cryptonote::tx_destination_entry>> transfers;
 
-    uint64_t total_fee = 0;
+  transfers.reserve(in_transfers.size());
+
+  for (const TransferDestinationArray& in_destinations : in_transfers)
+    transfers.push_back(make_destinations(in_destinations));
+
+  // the whole batch is one job of the wallet, so the wallet is loaded and refreshed once for all transfers
+  return runAsyncForWallet(context, wallet_id, account_data, password, callback_url, [this, wallet_id, transfers, callback_url](tools::GraftWallet& wallet, OutHttp& result) {
+    LOG_PRINT_L1("Prepare " << transfers.size() << " transfers for wallet '" << wallet_id << "'(callback=" << callback_url << ")");
+
+    // each transfer selects its outputs on its own, transfers which select outputs of previous transfers
+    // of the batch are rejected, otherwise only one of them could be sent
+    BatchKeyImages batch_key_images;
+
+    WalletPrepareTransfersCallbackRequest out;
 
-    for (const tools::GraftWallet::pending_tx& transaction : transactions)
+    out.Result = 0;
+    out.Transfers.reserve(transfers.size());
+
+    uint64_t batch_fee = 0;
+
+    for (const std::vector<cryptonote::tx_destination_entry>& destinations : transfers)
     {
-        std::string serialized_transaction = epee::string_tools::buff_to_hex_nodelimer(cryptonote::tx_to_blob(transaction.tx));
+      WalletPreparedTransfer prepared;
 
-        serialized_transactions.push_back(serialized_transaction);
+      prepared.Result = 0;
 
-        total_fee += transaction.fee;
-    }
+      try
+      {
+        std::vector<tools::GraftWallet::pending_tx> transactions = create_transactions(wallet, destinations);
 
-    WalletPrepareTransferCallbackRequest out;
+        if (!batch_key_images.reserve(transactions))
+          throw std::runtime_error("outputs selected for transfer are used by previous transfers of the batch");
 
-    out.Result       = 0;
-    out.Fee          = std::to_string(total_fee);
-    out.Transactions = std::move(serialized_transactions);
+        uint64_t fee = 0;
+
+        serialize_transactions(transactions, prepared.Transactions, fee);
+
+        prepared.Fee = std::to_string(fee);
+        batch_fee   += fee;
+      }
+      catch (std::exception& e)
+      {
+        LOG_PRINT_L1("Failed to prepare transfer for wallet '" << wallet_id << "': " << e.what());
+
+        prepared.Result = -1;
+        prepared.Error  = e.what();
+        prepared.Fee    = "0";
+        prepared.Transactions.clear();
+      }
+
+      out.Transfers.push_back(std::move(prepared));
+    }
+
+    out.Fee = std::to_string(batch_fee);
 
     result.load(out);
+
+    // transactions are not committed, so the wallet does not change
+    return false;
   });
 }
 
-void WalletManager::requestTransactionHistory
+bool WalletManager::requestTransactionHistory
  (Context& context,
   const WalletId& wallet_id,
   const std::string& account_data,
   const std::string& password,
   const Url& callback_url)
 {
-  runAsyncForWallet(context, wallet_id, account_data, password, callback_url, [this, wallet_id, callback_url](tools::GraftWallet& wallet, OutHttp& result) {
+  return runAsyncForWallet(context, wallet_id, account_data, password, callback_url, [this, wallet_id, callback_url](tools::GraftWallet& wallet, OutHttp& result) {
     LOG_PRINT_L1("Request transaction history for wallet '" << wallet_id << "'(callback=" << callback_url << ")");
 
     TransactionHistory transaction_history;
@@ -620,6 +1362,8 @@ void WalletManager::requestTransactionHistory
     out.History = std::move(transaction_history);
 
     result.load(out);
+
+    return false;
   });
 }
 
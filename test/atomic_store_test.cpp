@@ -0,0 +1,169 @@
+// Copyright (c) 2018, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "lib/graft/common/utils.h"
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+
+const size_t FILE_SIZE = 4 * 1024 * 1024;
+const size_t CHUNK_SIZE = 4 * 1024;
+
+// file of FILE_SIZE bytes filled with the same character, written in small chunks so the writer can be killed in the middle
+void writeFile(const std::string& file_name, char fill)
+{
+    std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+    const std::string chunk(CHUNK_SIZE, fill);
+    for (size_t written = 0; written < FILE_SIZE; written += CHUNK_SIZE)
+        out.write(chunk.data(), chunk.size());
+    if (!out)
+        throw std::runtime_error("cannot write " + file_name);
+}
+
+std::string readFile(const std::string& file_name)
+{
+    std::ifstream in(file_name, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// file must contain complete content of one of the stores
+void checkComplete(const std::string& file_name)
+{
+    std::string content = readFile(file_name);
+    ASSERT_EQ(content.size(), FILE_SIZE);
+    ASSERT_EQ(content.find_first_not_of(content[0]), std::string::npos);
+}
+
+// temporary files left by killed stores
+void removeTemporaryFiles(const std::string& file_name)
+{
+    const std::string prefix = file_name + ".tmp";
+    DIR* dir = opendir(".");
+    if (!dir)
+        return;
+    while (dirent* entry = readdir(dir))
+    {
+        if (std::string(entry->d_name).compare(0, prefix.size(), prefix) == 0)
+            std::remove(entry->d_name);
+    }
+    closedir(dir);
+}
+
+}
+
+TEST(AtomicStore, replacesContent)
+{
+    const std::string file_name = "atomic_store_test.cache";
+
+    graft::utils::storeFileAtomically(file_name, [](const std::string& tmp) { writeFile(tmp, 'a'); });
+    EXPECT_EQ(readFile(file_name), std::string(FILE_SIZE, 'a'));
+
+    graft::utils::storeFileAtomically(file_name, [](const std::string& tmp) { writeFile(tmp, 'b'); });
+    EXPECT_EQ(readFile(file_name), std::string(FILE_SIZE, 'b'));
+
+    // failed store keeps old content and removes temporary file
+    std::string tmp_file_name;
+    EXPECT_THROW(graft::utils::storeFileAtomically(file_name, [&tmp_file_name](const std::string& tmp) {
+        tmp_file_name = tmp;
+        writeFile(tmp, 'c');
+        throw std::runtime_error("store failed");
+    }), std::runtime_error);
+    EXPECT_EQ(readFile(file_name), std::string(FILE_SIZE, 'b'));
+    EXPECT_NE(tmp_file_name, file_name);
+    EXPECT_FALSE(std::ifstream(tmp_file_name).good());
+
+    std::remove(file_name.c_str());
+}
+
+TEST(AtomicStore, killedInTheMiddle)
+{
+    const std::string file_name = "atomic_store_crash_test.cache";
+
+    graft::utils::storeFileAtomically(file_name, [](const std::string& tmp) { writeFile(tmp, '0'); });
+
+    for (int attempt = 0; attempt < 10; ++attempt)
+    {
+        pid_t pid = fork();
+        ASSERT_NE(pid, -1);
+
+        if (pid == 0)
+        {
+            // child stores different content until it is killed
+            for (char fill = 'a'; ; fill = fill == 'z' ? 'a' : fill + 1)
+                graft::utils::storeFileAtomically(file_name, [fill](const std::string& tmp) { writeFile(tmp, fill); });
+        }
+
+        // different delays hit different phases of the store: writing, syncing, renaming
+        std::this_thread::sleep_for(std::chrono::milliseconds(20 + 37 * attempt));
+        kill(pid, SIGKILL);
+
+        int status = 0;
+        ASSERT_EQ(waitpid(pid, &status, 0), pid);
+        ASSERT_TRUE(WIFSIGNALED(status));
+
+        checkComplete(file_name);
+    }
+
+    std::remove(file_name.c_str());
+    removeTemporaryFiles(file_name);
+}
+
+// two holders of the same wallet may store its cache at the same time
+TEST(AtomicStore, concurrentStores)
+{
+    const std::string file_name = "atomic_store_concurrent_test.cache";
+
+    std::vector<std::thread> threads;
+    for (char fill = 'a'; fill < 'e'; ++fill)
+    {
+        threads.emplace_back([&file_name, fill]()
+        {
+            for (int i = 0; i < 5; ++i)
+                graft::utils::storeFileAtomically(file_name, [fill](const std::string& tmp) { writeFile(tmp, fill); });
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+
+    checkComplete(file_name);
+
+    std::remove(file_name.c_str());
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2018, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "walletnode/batch_key_images.h"
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+using graft::walletnode::BatchKeyImages;
+
+namespace
+{
+
+struct PendingTx
+{
+    cryptonote::transaction tx;
+};
+
+crypto::key_image keyImage(uint8_t value)
+{
+    crypto::key_image key_image;
+    std::memset(&key_image, value, sizeof(key_image));
+    return key_image;
+}
+
+std::vector<PendingTx> transfer(std::initializer_list<uint8_t> key_images)
+{
+    std::vector<PendingTx> transactions(1);
+    for (uint8_t value : key_images)
+    {
+        cryptonote::txin_to_key in;
+        in.k_image = keyImage(value);
+        transactions[0].tx.vin.push_back(in);
+    }
+    return transactions;
+}
+
+}
+
+TEST(BatchKeyImages, rejectsTransfersSpendingReservedOutputs)
+{
+    BatchKeyImages key_images;
+
+    EXPECT_TRUE(key_images.reserve(transfer({1, 2})));
+    EXPECT_TRUE(key_images.reserve(transfer({3})));
+
+    // an output of the first transfer is selected again, the transfer reserves nothing
+    EXPECT_FALSE(key_images.reserve(transfer({4, 2})));
+    EXPECT_TRUE(key_images.reserve(transfer({4})));
+
+    EXPECT_FALSE(key_images.reserve(transfer({4})));
+    EXPECT_TRUE(key_images.reserve(std::vector<PendingTx>()));
+}
@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include "lib/graft/blacklist.h"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <random>
 #include <thread>
 #include "fixture.h"
 
@@ -91,13 +94,8 @@ TEST(Blacklist, activity)
         return std::make_tuple(triggered, seconds, cnt);
     };
 
+    //a bucket of 500 connections refilled at 100 per second
     auto bl = graft::BlackListTest::Create(100, 5, 120);
-    //random IPs
-    for(int i = 0; i < 20; ++i)
-    {
-        in_addr_t addr = 100+i*10;
-        bl->active(addr);
-    }
 
     {
         std::vector<int> vec{501,501,501,501,101,101,101,101,101,101};
@@ -107,44 +105,237 @@ TEST(Blacklist, activity)
         EXPECT_EQ(triggered, true);
         EXPECT_EQ(seconds, 1);
         EXPECT_EQ(cnt, 501);
-        EXPECT_EQ(20, bl->activeCnt());
+        //banned
+        EXPECT_EQ(bl->active(1), true);
     }
 
     {
-        //                   400 460 470 480 490 500  501
-        std::vector<int> vec{400, 60, 10, 10, 10, 10, 101,1,1,1};
+        //tokens left        100 140 230 320 410 490   -1
+        std::vector<int> vec{400, 60, 10, 10, 10, 10, 501,1,1,1};
         bool triggered; int seconds, cnt;
-        std::tie(triggered, seconds, cnt) = act_per_sec(*bl, 1, vec);
+        std::tie(triggered, seconds, cnt) = act_per_sec(*bl, 2, vec);
 
         EXPECT_EQ(triggered, true);
         EXPECT_EQ(seconds, 7);
-        EXPECT_EQ(cnt, 601);
-        EXPECT_EQ(20, bl->activeCnt());
+        EXPECT_EQ(cnt, 1001);
     }
 
     {
-        //                   400 460 470 480 490 500 410 320 230 140  50  10  501
-        std::vector<int> vec{400, 60, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 491, 1,1,1};
+        //tokens left        350 300 250 200 150 100  50   0  -1
+        std::vector<int> vec{150,150,150,150,150,150,150,150,150,150};
         bool triggered; int seconds, cnt;
-        std::tie(triggered, seconds, cnt) = act_per_sec(*bl, 1, vec);
+        std::tie(triggered, seconds, cnt) = act_per_sec(*bl, 3, vec);
 
         EXPECT_EQ(triggered, true);
-        EXPECT_EQ(seconds, 13);
-        EXPECT_EQ(cnt, 1051);
-        EXPECT_EQ(0, bl->activeCnt()); //random IPs become old on 10th second
+        EXPECT_EQ(seconds, 9);
+        //the refill is continuous, so the bucket can get a token more depending on timing
+        EXPECT_NEAR(cnt, 1301, 1);
     }
 
     {
-        //                   10 110 210 310 400 500 500 501
-        std::vector<int> vec{10,100,100,100, 90,100,100,101,1,1};
+        //the refill rate is never exceeded
+        std::vector<int> vec{100,100,100,100,100,100,100};
         bool triggered; int seconds, cnt;
-        std::tie(triggered, seconds, cnt) = act_per_sec(*bl, 1, vec);
+        std::tie(triggered, seconds, cnt) = act_per_sec(*bl, 4, vec);
 
-        EXPECT_EQ(triggered, true);
-        EXPECT_EQ(seconds, 8);
-        EXPECT_EQ(cnt, 701);
-        EXPECT_EQ(0, bl->activeCnt());
+        EXPECT_EQ(triggered, false);
+        EXPECT_EQ(seconds, 7);
+        EXPECT_EQ(cnt, 700);
+    }
+}
+
+TEST(Blacklist, routeLimits)
+{
+    auto bl = graft::BlackListTest::Create(0, 0, 0);
+    bl->addRouteLimit("/dapi", 1, 2);
+    bl->addRouteLimit("/dapi/v2.0/cryptonode", 1000);
+    auto ip1 = graft::IpAddress::fromV4(1, false), ip2 = graft::IpAddress::fromV4(2, false);
+
+    EXPECT_EQ(bl->processRequest(ip1, "/dapi/v2.0/sale"), true);
+    EXPECT_EQ(bl->processRequest(ip1, "/dapi/v2.0/sale"), true);
+    EXPECT_EQ(bl->processRequest(ip1, "/dapi/v2.0/sale"), false);
+    //other IP
+    EXPECT_EQ(bl->processRequest(ip2, "/dapi/v2.0/pay"), true);
+    //the longest prefix is applied
+    for(int i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(bl->processRequest(ip1, "/dapi/v2.0/cryptonode/sale"), true);
+    }
+    //not limited
+    for(int i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(bl->processRequest(ip1, "/debug/trace"), true);
+    }
+    //connections are not limited
+    EXPECT_EQ(bl->processIp(1, false), true);
+
+    //IPv6 hosts of a /64 network share the limit
+    graft::IpAddress ip6a, ip6b, ip6c;
+    ASSERT_TRUE(graft::IpAddress::parse("2001:db8::1", ip6a));
+    ASSERT_TRUE(graft::IpAddress::parse("2001:db8::2", ip6b));
+    ASSERT_TRUE(graft::IpAddress::parse("2001:db8:0:1::1", ip6c));
+    EXPECT_EQ(bl->processRequest(ip6a, "/dapi/v2.0/sale"), true);
+    EXPECT_EQ(bl->processRequest(ip6b, "/dapi/v2.0/sale"), true);
+    EXPECT_EQ(bl->processRequest(ip6a, "/dapi/v2.0/sale"), false);
+    EXPECT_EQ(bl->processRequest(ip6c, "/dapi/v2.0/sale"), true);
+}
+
+TEST(Blacklist, ipAddress)
+{
+    graft::IpAddress addr;
+    EXPECT_TRUE(graft::IpAddress::parse("192.168.1.2", addr));
+    EXPECT_TRUE(addr.isV4());
+    EXPECT_EQ(addr.v4(), 0xC0A80102);
+    EXPECT_EQ(addr.toString(), "192.168.1.2");
+    EXPECT_EQ(addr, graft::IpAddress::fromV4(0xC0A80102, false));
+
+    //IPv4-mapped is the same address
+    graft::IpAddress mapped;
+    EXPECT_TRUE(graft::IpAddress::parse("::ffff:192.168.1.2", mapped));
+    EXPECT_EQ(mapped, addr);
+
+    EXPECT_TRUE(graft::IpAddress::parse("2001:DB8::1", addr));
+    EXPECT_FALSE(addr.isV4());
+    EXPECT_EQ(addr.hi(), 0x20010db800000000ull);
+    EXPECT_EQ(addr.lo(), 1u);
+    EXPECT_EQ(addr.toString(), "2001:db8::1");
+
+    EXPECT_FALSE(graft::IpAddress::parse("192.168.1", addr));
+    EXPECT_FALSE(graft::IpAddress::parse("2001:db8:::1", addr));
+    EXPECT_FALSE(graft::IpAddress::parse("", addr));
+}
+
+TEST(Blacklist, mixedRules)
+{
+    auto bl = graft::BlackListTest::Create(100, 5, 120);
+
+    std::istringstream iss(
+                "deny 2001:db8::1 ;; single host\n"
+                "allow 2001:db8::/32\n"
+                "deny 10.0.0.1\n"
+                "allow 10.0.0.0/8\n"
+                "deny ::ffff:192.168.0.0/112 ;; the same as 192.168.0.0/16\n"
+                "allow 192.168.1.1 ;; superseded\n"
+                "allow ::1\n"
+                "deny all\n");
+    bl->readRules(iss);
+    EXPECT_NE(bl->getWarnings().find("line 6 is superceded"), std::string::npos);
+
+    EXPECT_EQ( bl->find("2001:db8::1"), std::make_pair(true, false));
+    EXPECT_EQ( bl->find("2001:db8::2"), std::make_pair(true, true));
+    EXPECT_EQ( bl->find("2001:db8:ffff::2"), std::make_pair(true, true));
+    EXPECT_EQ( bl->find("2001:db9::1"), std::make_pair(false, false));
+
+    EXPECT_EQ( bl->find("10.0.0.1"), std::make_pair(true, false));
+    EXPECT_EQ( bl->find("10.1.2.3"), std::make_pair(true, true));
+    EXPECT_EQ( bl->find("::ffff:10.1.2.3"), std::make_pair(true, true));
+    //IPv4-compatible address is not IPv4
+    EXPECT_EQ( bl->find("::10.1.2.3"), std::make_pair(false, false));
+
+    EXPECT_EQ( bl->find("192.168.1.1"), std::make_pair(true, false));
+    EXPECT_EQ( bl->find("192.169.1.1"), std::make_pair(false, false));
+    EXPECT_EQ( bl->find("::1"), std::make_pair(true, true));
+
+    graft::IpAddress addr;
+    ASSERT_TRUE(graft::IpAddress::parse("2001:db8::1", addr));
+    EXPECT_EQ(bl->processIp(addr), false);
+    ASSERT_TRUE(graft::IpAddress::parse("2001:db8::2", addr));
+    EXPECT_EQ(bl->processIp(addr), true);
+    EXPECT_EQ(bl->processIp(htonl(0x0A010203)), true);
+
+    //mask length is checked in the family of the address
+    for(const char* rule : {"deny 10.0.0.0/33", "deny 2001:db8::/129", "deny 2001:db8::/0", "deny 10.0.0", "deny 2001:db8::1::1"})
+    {
+        std::istringstream iss(rule);
+        EXPECT_THROW(bl->readRules(iss), std::runtime_error) << rule;
+    }
+    std::istringstream iss6("deny 2001:db8::/96");
+    EXPECT_NO_THROW(bl->readRules(iss6));
+}
+
+TEST(Blacklist, largeRules)
+{
+    struct Rule { uint32_t addr; int len; bool allow; };
+    std::vector<Rule> rules;
+    std::ostringstream oss;
+    std::mt19937 rng(7);
+    for(int i = 0; i < 20000; ++i)
+    {
+        Rule r{static_cast<uint32_t>(rng()) & 0xFFFF0FFF, 8 + static_cast<int>(rng() % 25), (rng() & 1) != 0};
+        rules.push_back(r);
+        oss << (r.allow? "allow " : "deny ") << (r.addr >> 24) << '.' << ((r.addr >> 16) & 0xFF) << '.'
+            << ((r.addr >> 8) & 0xFF) << '.' << (r.addr & 0xFF) << '/' << r.len << " ;; rule " << i << '\n';
+    }
+    oss << "deny all\n";
+
+    auto bl = graft::BlackListTest::Create(0, 0, 0);
+    std::istringstream iss(oss.str());
+    bl->readRules(iss);
+
+    //the first matching rule wins
+    auto matches = [](const Rule& r, uint32_t addr){ return ((addr ^ r.addr) >> (32 - r.len)) == 0; };
+    size_t effective = 0;
+    for(size_t i = 0; i < rules.size(); ++i)
+    {
+        bool superseded = std::any_of(rules.begin(), rules.begin() + i, [&](const Rule& prev)
+        {
+            return prev.len <= rules[i].len && matches(prev, rules[i].addr);
+        });
+        if(!superseded) ++effective;
+    }
+    EXPECT_EQ(bl->rulesCount(), effective);
+
+    for(int i = 0; i < 20000; ++i)
+    {
+        //half of the addresses are near the rules
+        uint32_t addr = (i & 1)? static_cast<uint32_t>(rng()) : rules[rng() % rules.size()].addr ^ (rng() & 0xFF);
+        auto it = std::find_if(rules.begin(), rules.end(), [&](const Rule& r){ return matches(r, addr); });
+        auto expected = (it == rules.end())? std::make_pair(false, false) : std::make_pair(true, it->allow);
+        ASSERT_EQ(bl->find(addr, false), expected) << graft::IpAddress::fromV4(addr, false).toString();
+    }
+}
+
+TEST(Blacklist, reloadRules)
+{
+    auto bl = graft::BlackListTest::Create(0, 0, 0);
+    std::istringstream iss("deny 10.0.0.0/8\nallow 10.0.0.1 ;; superseded\n");
+    bl->readRules(iss);
+    EXPECT_EQ(bl->rulesCount(), 1);
+    EXPECT_NE(bl->getWarnings().find("line 2 is superceded"), std::string::npos);
+    EXPECT_EQ(bl->processIp(htonl(0x0A000001)), false);
+
+    //the rules are kept on error
+    std::istringstream bad("allow 192.168.0.0/16\ndeny 10.0.0.0/8 oops\n");
+    EXPECT_THROW(bl->readRules(bad), std::runtime_error);
+    EXPECT_NE(bl->getWarnings().find("invalid rule format"), std::string::npos);
+    EXPECT_EQ(bl->find("10.1.1.1"), std::make_pair(true, false));
+    EXPECT_EQ(bl->find("192.168.1.1"), std::make_pair(false, true));
+
+    //the rules are replaced as a whole
+    std::istringstream good("allow 192.168.0.0/16\ndeny all\n");
+    bl->readRules(good);
+    EXPECT_EQ(bl->getWarnings(), "");
+    EXPECT_EQ(bl->rulesCount(), 1);
+    EXPECT_EQ(bl->find("10.1.1.1"), std::make_pair(false, false));
+    EXPECT_EQ(bl->find("192.168.1.1"), std::make_pair(true, true));
+
+    //lookups during reloads see either rule set
+    std::atomic<bool> stop{false};
+    std::thread reader([&]
+    {
+        while(!stop)
+        {
+            auto res = bl->find("192.168.1.1");
+            ASSERT_TRUE(res == std::make_pair(true, true) || res == std::make_pair(true, false));
+        }
+    });
+    for(int i = 0; i < 200; ++i)
+    {
+        std::istringstream iss((i & 1)? "allow 192.168.0.0/16\n" : "deny 192.168.1.0/24\n");
+        bl->readRules(iss);
     }
+    stop = true;
+    reader.join();
 }
 
 TEST_F(GraftServerTest, ban)
@@ -0,0 +1,146 @@
+// Copyright (c) 2018, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "walletnode/block_fetcher.h"
+#include <gtest/gtest.h>
+
+#include <boost/uuid/random_generator.hpp>
+
+#include <chrono>
+#include <thread>
+
+using graft::walletnode::SharedBlockFetcher;
+
+namespace
+{
+
+SharedBlockFetcher::Waiter newWaiter()
+{
+    static boost::uuids::random_generator generator;
+    return generator();
+}
+
+}
+
+TEST(SharedBlockFetcher, sharesDownload)
+{
+    using namespace std::chrono_literals;
+
+    const size_t WALLETS_COUNT = 128;
+    const std::string blocks = "blocks from 1000 to 1100";
+
+    SharedBlockFetcher fetcher(10s, 10s, 16);
+    const std::string key = SharedBlockFetcher::requestKey("getblocks.bin request of wallets synchronized to 1000");
+
+    // wallets synchronized to the same block send the same request, only the first one goes to the cryptonode
+    std::string response;
+    EXPECT_EQ(fetcher.acquire(key, newWaiter(), response), SharedBlockFetcher::Result::Fetch);
+
+    std::vector<SharedBlockFetcher::Waiter> expected_waiters;
+    for (size_t i = 1; i < WALLETS_COUNT / 2; ++i)
+    {
+        SharedBlockFetcher::Waiter waiter = newWaiter();
+        expected_waiters.push_back(waiter);
+        EXPECT_EQ(fetcher.acquire(key, waiter, response), SharedBlockFetcher::Result::Wait);
+    }
+
+    EXPECT_EQ(fetcher.complete(key, blocks), expected_waiters);
+
+    // wallets which come after the download get cached response
+    for (size_t i = WALLETS_COUNT / 2; i < WALLETS_COUNT; ++i)
+    {
+        response.clear();
+        EXPECT_EQ(fetcher.acquire(key, newWaiter(), response), SharedBlockFetcher::Result::Cached);
+        EXPECT_EQ(response, blocks);
+    }
+
+    EXPECT_EQ(fetcher.fetchesCount(), 1);
+    EXPECT_EQ(fetcher.sharedCount(), WALLETS_COUNT - 1);
+
+    // wallet synchronized to other block needs its own download
+    EXPECT_EQ(fetcher.acquire(SharedBlockFetcher::requestKey("other request"), newWaiter(), response), SharedBlockFetcher::Result::Fetch);
+}
+
+TEST(SharedBlockFetcher, expiration)
+{
+    using namespace std::chrono_literals;
+
+    SharedBlockFetcher fetcher(50ms, 50ms, 1);
+    const std::string key1 = SharedBlockFetcher::requestKey("request 1");
+    const std::string key2 = SharedBlockFetcher::requestKey("request 2");
+    std::string response;
+
+    // waiters of the fetch which takes too long are released to fetch themselves
+    SharedBlockFetcher::Waiter waiter = newWaiter();
+    EXPECT_EQ(fetcher.acquire(key1, newWaiter(), response), SharedBlockFetcher::Result::Fetch);
+    EXPECT_EQ(fetcher.acquire(key1, waiter, response), SharedBlockFetcher::Result::Wait);
+    EXPECT_TRUE(fetcher.expire().empty());
+
+    std::this_thread::sleep_for(100ms);
+    EXPECT_EQ(fetcher.expire(), SharedBlockFetcher::Waiters{waiter});
+    EXPECT_TRUE(fetcher.complete(key1, "late response").empty());
+
+    // cached response expires
+    EXPECT_EQ(fetcher.acquire(key1, newWaiter(), response), SharedBlockFetcher::Result::Fetch);
+    fetcher.complete(key1, "response 1");
+    EXPECT_EQ(fetcher.acquire(key1, newWaiter(), response), SharedBlockFetcher::Result::Cached);
+    std::this_thread::sleep_for(100ms);
+    EXPECT_EQ(fetcher.acquire(key1, newWaiter(), response), SharedBlockFetcher::Result::Fetch);
+    fetcher.complete(key1, "response 1");
+
+    // number of cached responses is limited, the oldest one is dropped
+    EXPECT_EQ(fetcher.acquire(key2, newWaiter(), response), SharedBlockFetcher::Result::Fetch);
+    fetcher.complete(key2, "response 2");
+    EXPECT_EQ(fetcher.acquire(key2, newWaiter(), response), SharedBlockFetcher::Result::Cached);
+    EXPECT_EQ(fetcher.acquire(key1, newWaiter(), response), SharedBlockFetcher::Result::Fetch);
+}
+
+TEST(SharedBlockFetcher, abandon)
+{
+    using namespace std::chrono_literals;
+
+    SharedBlockFetcher fetcher(10s, 10s, 16);
+    const std::string key = SharedBlockFetcher::requestKey("request");
+    std::string response;
+
+    // waiters of the failed fetch are released at once to fetch themselves
+    SharedBlockFetcher::Waiter waiter = newWaiter();
+    EXPECT_EQ(fetcher.acquire(key, newWaiter(), response), SharedBlockFetcher::Result::Fetch);
+    EXPECT_EQ(fetcher.acquire(key, waiter, response), SharedBlockFetcher::Result::Wait);
+    EXPECT_EQ(fetcher.abandon(key), SharedBlockFetcher::Waiters{waiter});
+    EXPECT_TRUE(fetcher.complete(key, "late response").empty());
+
+    // the next request fetches again
+    EXPECT_EQ(fetcher.acquire(key, newWaiter(), response), SharedBlockFetcher::Result::Fetch);
+    fetcher.complete(key, "response");
+
+    // cached response is kept
+    EXPECT_TRUE(fetcher.abandon(key).empty());
+    EXPECT_EQ(fetcher.acquire(key, newWaiter(), response), SharedBlockFetcher::Result::Cached);
+    EXPECT_EQ(response, "response");
+}
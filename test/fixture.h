@@ -386,6 +386,8 @@ public:
         m_th.join();
     }
 
+    graft::Looper& getLooper() { return m_gserver->getLooper(); }
+
 private:
     std::unique_ptr<detail::GSTest> m_gserver;
     std::atomic_bool m_serverCreated{false};
@@ -5,6 +5,7 @@
 #include "lib/graft/inout.h"
 #include "lib/graft/handler_api.h"
 #include "lib/graft/expiring_list.h"
+#include "lib/graft/trace.h"
 #include "supernode/requests.h"
 #include "supernode/requests/sale.h"
 #include "supernode/requests/sale_status.h"
@@ -17,7 +18,9 @@
 #include "fixture.h"
 
 #include <misc_log_ex.h>
+#include <boost/uuid/uuid_io.hpp>
 
+#include <atomic>
 #include <deque>
 
 GRAFT_DEFINE_IO_STRUCT(Payment,
@@ -1213,6 +1216,30 @@ TEST_F(GraftServerTestBase, forward)
     crypton.stop_and_wait_for();
 }
 
+TEST_F(GraftServerTestBase, forwardFailure)
+{//the handler is not called again when the forward fails, the failure function is called instead
+    MainServer mainServer;
+    std::atomic<int> failures(0);
+    auto action = [&failures](const graft::Router::vars_t& vars, const graft::Input& input, graft::Context& ctx, graft::Output& output)->graft::Status
+    {
+        if(ctx.local.getLastStatus() != graft::Status::None) return graft::Status::Ok;
+        ctx.local.setOnFailure([&failures](graft::Context&){ ++failures; });
+        output.body = input.body;
+        return graft::Status::Forward;
+    };
+    mainServer.m_router.addRoute("/forwardFailure", METHOD_POST, {action, nullptr, nullptr});
+    mainServer.run();
+
+    //no cryptonode is listening
+    Client client;
+    client.serve("http://localhost:9084/forwardFailure", "", "some data");
+    EXPECT_EQ(false, client.get_closed());
+    EXPECT_EQ(500, client.get_resp_code());
+
+    mainServer.stop_and_wait_for();
+    EXPECT_EQ(failures, 1);
+}
+
 GRAFT_DEFINE_IO_STRUCT(GetVersionResp,
                        (std::string, status),
                        (uint32_t, version)
@@ -1292,6 +1319,121 @@ TEST_F(GraftServerTest, genericCallback)
     stop_and_wait_for();
 }
 
+TEST_F(GraftServerTest, reconfigure)
+{
+    //the global context keeps the first id, it should survive reconfiguration
+    auto action = [](const graft::Router::vars_t& vars, const graft::Input& input, graft::Context& ctx, graft::Output& output)->graft::Status
+    {
+        if(!ctx.global.hasKey("first")) ctx.global["first"] = vars.find("id")->second;
+        std::string first = ctx.global["first"];
+        output.body = first;
+        return graft::Status::Ok;
+    };
+    m_httpRouter.addRoute("/reconfigure/{id:[0-9]+}", METHOD_GET, {nullptr, action, nullptr});
+    m_copts.workers_count = 2;
+    m_copts.timer_poll_interval_ms = 50;
+    run();
+
+    auto get = [](const std::string& id)
+    {
+        GraftServerTestBase::Client client;
+        client.serve("http://localhost:28690/reconfigure/" + id);
+        EXPECT_EQ(200, client.get_resp_code());
+        return client.get_body();
+    };
+    graft::Looper& looper = getLooper();
+    auto waitWorkers = [&looper](uint64_t count)
+    {
+        uint64_t activeWorkers = 0, expelledWorkers = 0;
+        for(int i = 0; i < 200; ++i)
+        {
+            looper.getThreadPoolInfo(activeWorkers, expelledWorkers);
+            if(activeWorkers == count) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return activeWorkers;
+    };
+
+    EXPECT_EQ(get("1"), "1");
+    EXPECT_EQ(waitWorkers(2), 2);
+
+    graft::ConfigOpts copts = m_copts;
+    copts.workers_count = 8;
+    copts.http_connection_timeout = 100;
+    std::atomic_bool reconfigured{false};
+    looper.setReloadHandler([&]{ looper.reconfigure(copts); reconfigured = true; });
+    looper.requestReload();
+    while(!reconfigured)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    //workers-count takes effect after restart
+    EXPECT_EQ(looper.getCopts().http_connection_timeout, 100);
+    EXPECT_EQ(looper.getCopts().workers_count, 2);
+    EXPECT_EQ(get("2"), "1");
+    EXPECT_EQ(waitWorkers(2), 2);
+
+    stop_and_wait_for();
+}
+
+TEST_F(GraftServerTestBase, tracing)
+{
+    auto action = [](const graft::Router::vars_t& vars, const graft::Input& input, graft::Context& ctx, graft::Output& output)->graft::Status
+    {
+        output.body = input.body;
+        return graft::Status::Ok;
+    };
+    auto dump = [](const graft::Router::vars_t& vars, const graft::Input& input, graft::Context& ctx, graft::Output& output)->graft::Status
+    {
+        output.body = ctx.handlerAPI()->tracer().dumpChromeTrace();
+        return graft::Status::Ok;
+    };
+
+    MainServer mainServer;
+    mainServer.m_copts.trace.sample_rate = 1;
+    mainServer.m_router.addRoute("/traced", METHOD_POST|METHOD_GET, {action, action, action});
+    mainServer.m_router.addRoute("/trace", METHOD_GET, {dump, nullptr, nullptr});
+    mainServer.run();
+
+    Client client;
+    client.serve("http://localhost:9084/traced", "", "some data");
+    EXPECT_EQ(200, client.get_resp_code());
+
+    client.serve("http://localhost:9084/trace");
+    EXPECT_EQ(200, client.get_resp_code());
+    std::string trace = client.get_body();
+    for(const char* name : {"accept", "route_match", "pre_action", "queue_wait", "worker_action", "post_action", "request"})
+    {
+        EXPECT_NE(trace.find(std::string("\"name\":\"") + name + "\""), std::string::npos) << name;
+    }
+    EXPECT_NE(trace.find("\"detail\":\"/traced\""), std::string::npos);
+
+    mainServer.stop_and_wait_for();
+}
+
+TEST(Tracer, ringBuffer)
+{
+    graft::Tracer off(0, 100);
+    EXPECT_FALSE(off.sample());
+    EXPECT_EQ(off.dumpChromeTrace(), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[]}");
+
+    graft::Tracer tracer(3, 2);
+    int sampled = 0;
+    for(int i = 0; i < 9; ++i) sampled += tracer.sample();
+    EXPECT_EQ(sampled, 3);
+
+    graft::Tracer::Uuid uuid = boost::uuids::random_generator()();
+    tracer.instant(uuid, "first");
+    tracer.instant(uuid, "second");
+    tracer.instant(uuid, "third");
+    std::string trace = tracer.dumpChromeTrace();
+    //the oldest event is overwritten
+    EXPECT_EQ(trace.find("first"), std::string::npos);
+    EXPECT_LT(trace.find("second"), trace.find("third"));
+    EXPECT_NE(trace.find(boost::uuids::to_string(uuid)), std::string::npos);
+}
+
 /////////////////////////////////
 // GraftServerBlockingTest fixture
 
@@ -1420,3 +1562,40 @@ TEST_F(GraftServerBlockingTest, common)
     mainServer.stop_and_wait_for();
     crypton.stop_and_wait_for();
 }
+
+TEST_F(GraftServerBlockingTest, sendUpstreamAsync)
+{
+    TempCryptoN crypton;
+    crypton.run();
+    std::atomic<int> sent(0);
+    auto action = [&](const graft::Router::vars_t& vars, const graft::Input& input, graft::Context& ctx, graft::Output& output)->graft::Status
+    {
+        Sstr ss; ss.s = "async string";
+        graft::Output out; out.load(ss);
+        //the request is sent by the looper, the worker does not wait for it
+        if(ctx.handlerAPI()->sendUpstreamAsync(std::move(out))) ++sent;
+        return graft::Status::Ok;
+    };
+
+    MainServer mainServer;
+    mainServer.m_router.addRoute("/async", METHOD_POST|METHOD_GET,
+                               graft::Router::Handler3(nullptr, action, nullptr));
+    mainServer.run();
+
+    crypton.answer = "crypton answer";
+    std::string post_data = "some data";
+    Client client;
+    client.serve("http://localhost:9084/async", "", post_data);
+    EXPECT_EQ(false, client.get_closed());
+    EXPECT_EQ(200, client.get_resp_code());
+    EXPECT_EQ(sent, 1);
+
+    for(int i = 0; i < 100 && crypton.body.empty(); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    graft::Input in; in.load(crypton.body);
+    Sstr ss = in.get<Sstr>();
+    EXPECT_EQ(ss.s, "async string");
+
+    mainServer.stop_and_wait_for();
+    crypton.stop_and_wait_for();
+}
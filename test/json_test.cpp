@@ -30,6 +30,7 @@
 #include "lib/graft/jsonrpc.h"
 
 #include <gtest/gtest.h>
+#include <limits>
 #include <string>
 
 using namespace std;
@@ -78,3 +79,80 @@ TEST(JsonParseTest, malformed_source)
     EXPECT_FALSE(in.get(resp));
 }
 
+
+GRAFT_DEFINE_IO_STRUCT_INITED(BinaryItem,
+     (std::string, id_key, ""),
+     (bool, flag, false)
+ );
+
+GRAFT_DEFINE_IO_STRUCT_INITED(BinaryMessage,
+     (int, status, 0),
+     (int64_t, delta, 0),
+     (uint64, amount, 0),
+     (double, ratio, 0),
+     (std::string, text, ""),
+     (std::vector<std::string>, receivers, std::vector<std::string>()),
+     (std::vector<BinaryItem>, items, std::vector<BinaryItem>())
+ );
+
+TEST(BinarySerializer, roundTrip)
+{
+    BinaryMessage msg;
+    msg.status = -3;
+    msg.delta = std::numeric_limits<int64_t>::min();
+    msg.amount = std::numeric_limits<uint64_t>::max();
+    msg.ratio = 0.25;
+    msg.text = "not hex: ABCDEF";
+    msg.receivers = {"0123456789abcdef", "", "abc"};
+    BinaryItem item;
+    item.id_key = "ff00";
+    item.flag = true;
+    msg.items.push_back(item);
+
+    std::string bin = serializer::binary::toBinary(msg);
+    BinaryMessage msg2;
+    serializer::binary::fromBinary(bin, msg2);
+    EXPECT_EQ(msg2.toJson().GetString(), std::string(msg.toJson().GetString()));
+
+    // truncated and extended data rejected
+    EXPECT_THROW(serializer::binary::fromBinary(bin.substr(0, bin.size() - 1), msg2), serializer::binary::BinaryParseError);
+    EXPECT_THROW(serializer::binary::fromBinary(bin + '\0', msg2), serializer::binary::BinaryParseError);
+
+    // data starts with the format version, other versions rejected
+    ASSERT_EQ(uint8_t(bin[0]), serializer::binary::FORMAT_VERSION);
+    EXPECT_THROW(serializer::binary::fromBinary(std::string(), msg2), serializer::binary::BinaryParseError);
+    std::string next = bin;
+    next[0] = static_cast<char>(serializer::binary::FORMAT_VERSION + 1);
+    try {
+        serializer::binary::fromBinary(next, msg2);
+        FAIL() << "unknown version accepted";
+    } catch (const serializer::binary::BinaryParseError &e) {
+        EXPECT_NE(std::string(e.what()).find("unsupported format version"), std::string::npos);
+    }
+}
+
+TEST(BinarySerializer, anyB64)
+{
+    BinaryMessage msg;
+    msg.status = 5;
+    msg.text = "payload";
+
+    Output out;
+    out.loadT<serializer::BIN_B64>(msg);
+    EXPECT_EQ(out.data()[0], serializer::BINARY_B64_MARK);
+    Input in;
+    in.load(out.data());
+    BinaryMessage fromBin;
+    EXPECT_TRUE(in.getT<serializer::ANY_B64>(fromBin));
+    EXPECT_EQ(fromBin.status, 5);
+    EXPECT_EQ(fromBin.text, "payload");
+
+    out.loadT<serializer::JSON_B64>(msg);
+    in.load(out.data());
+    BinaryMessage fromJson;
+    EXPECT_TRUE(in.getT<serializer::ANY_B64>(fromJson));
+    EXPECT_EQ(fromJson.text, "payload");
+
+    // JSON payload is not accepted as binary
+    EXPECT_FALSE(in.getT<serializer::BIN_B64>(fromJson));
+}
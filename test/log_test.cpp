@@ -0,0 +1,163 @@
+// Copyright (c) 2018, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "lib/graft/async_logger.h"
+#include "lib/graft/log.h"
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace
+{
+
+//straightforward per character version of make_dump_output
+std::string dumpReference(const std::string& in, int trunc_size)
+{
+    std::string res;
+    for(unsigned char ch : in)
+    {
+        if(0x20 <= ch && ch < 0x7F)
+        {
+            res += ch;
+        }
+        else if(ch == '\t') res += "\\t";
+        else if(ch == '\r') res += "\\r";
+        else if(ch == '\n') res += "\\n";
+        else
+        {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\x%02X", ch);
+            res += buf;
+        }
+        if(0 <= trunc_size && trunc_size <= int(res.size()))
+        {
+            res += "...";
+            break;
+        }
+    }
+    return res;
+}
+
+std::string tempLogFile(const std::string& name)
+{
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path(name + "-%%%%%%%%.log");
+    return path.string();
+}
+
+}
+
+TEST(Log, dumpOutput)
+{
+    EXPECT_EQ(graft::make_dump_output("", -1), "");
+    EXPECT_EQ(graft::make_dump_output("", 0), "");
+    EXPECT_EQ(graft::make_dump_output("plain text", -1), "plain text");
+    EXPECT_EQ(graft::make_dump_output(std::string("a\tb\r\nc\x01\x7F\xFF", 9), -1), "a\\tb\\r\\nc\\x01\\x7F\\xFF");
+    EXPECT_EQ(graft::make_dump_output("abcdef", 3), "abc...");
+    EXPECT_EQ(graft::make_dump_output("abc", 3), "abc...");
+    EXPECT_EQ(graft::make_dump_output("abc", 0), "a...");
+    EXPECT_EQ(graft::make_dump_output("ab\x01" "cd", 3), "ab\\x01...");
+
+    std::mt19937 gen(7);
+    for(int i = 0; i < 100000; ++i)
+    {
+        std::string in(gen() % 48, ' ');
+        for(char& c : in)
+        {
+            int kind = gen() % 10;
+            c = kind < 7 ? char(0x20 + gen() % 95) : kind < 8 ? "\t\r\n"[gen() % 3] : char(gen() % 256);
+        }
+        int trunc_size = int(gen() % 60) - 8;
+        if(trunc_size < -1) trunc_size = -1;
+        ASSERT_EQ(graft::make_dump_output(in, trunc_size), dumpReference(in, trunc_size)) << "trunc_size " << trunc_size;
+    }
+}
+
+TEST(Log, asyncLoggerOrder)
+{
+    const std::string filename = tempLogFile("async-order");
+    const int threads = 4;
+    const int lines = 10000;
+    {
+        graft::AsyncLogger logger(filename, false, lines);
+
+        std::vector<std::thread> th;
+        for(int t = 0; t < threads; ++t)
+        {
+            th.emplace_back([&logger, t]
+            {
+                for(int i = 0; i < lines; ++i)
+                {
+                    logger.write(std::to_string(t) + " " + std::to_string(i) + "\n");
+                }
+            });
+        }
+        for(auto& t : th) t.join();
+
+        logger.flush();
+        EXPECT_EQ(logger.dropped(), 0u);
+        EXPECT_EQ(logger.written(), uint64_t(threads * lines));
+    }
+
+    std::ifstream in(filename);
+    std::vector<int> next(threads, 0);
+    std::string line;
+    while(std::getline(in, line))
+    {
+        std::istringstream is(line);
+        int t, i;
+        is >> t >> i;
+        ASSERT_TRUE(0 <= t && t < threads) << line;
+        //lines of a thread are written in order
+        ASSERT_EQ(i, next[t]++);
+    }
+    for(int t = 0; t < threads; ++t) EXPECT_EQ(next[t], lines);
+
+    boost::filesystem::remove(filename);
+}
+
+TEST(Log, asyncLoggerDrops)
+{
+    const std::string filename = tempLogFile("async-drops");
+    const int lines = 100000;
+    {
+        graft::AsyncLogger logger(filename, false, 16);
+        for(int i = 0; i < lines; ++i)
+        {
+            logger.write("line\n");
+        }
+        logger.flush();
+        //full ring never blocks the thread, excess lines are counted
+        EXPECT_EQ(logger.written() + logger.dropped(), uint64_t(lines));
+        EXPECT_LT(0u, logger.written());
+    }
+    boost::filesystem::remove(filename);
+}
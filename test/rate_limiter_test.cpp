@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include "lib/graft/rate_limiter.h"
+
+using graft::RateLimiter;
+using namespace std::chrono_literals;
+
+TEST(RateLimiter, burstAndRefill)
+{
+    RateLimiter limiter(10, 5);
+    auto t0 = RateLimiter::Clock::now();
+
+    for(int i = 0; i < 5; ++i)
+    {
+        EXPECT_EQ(limiter.check(1, t0), RateLimiter::Result::Allowed);
+    }
+    EXPECT_EQ(limiter.check(1, t0), RateLimiter::Result::Limited);
+    //other key
+    EXPECT_EQ(limiter.check(2, t0), RateLimiter::Result::Allowed);
+
+    //a token per 100ms
+    EXPECT_EQ(limiter.check(1, t0 + 50ms), RateLimiter::Result::Limited);
+    EXPECT_EQ(limiter.check(1, t0 + 100ms), RateLimiter::Result::Allowed);
+    EXPECT_EQ(limiter.check(1, t0 + 100ms), RateLimiter::Result::Limited);
+
+    //full again, not more than burst
+    auto t1 = t0 + 10s;
+    for(int i = 0; i < 5; ++i)
+    {
+        EXPECT_EQ(limiter.check(1, t1), RateLimiter::Result::Allowed);
+    }
+    EXPECT_EQ(limiter.check(1, t1), RateLimiter::Result::Limited);
+}
+
+TEST(RateLimiter, disabled)
+{
+    RateLimiter limiter(0, 0, 10s);
+    auto t0 = RateLimiter::Clock::now();
+
+    EXPECT_EQ(limiter.enabled(), false);
+    for(int i = 0; i < 1000; ++i)
+    {
+        EXPECT_EQ(limiter.check(1, t0), RateLimiter::Result::Allowed);
+    }
+    EXPECT_EQ(limiter.size(), 0);
+}
+
+TEST(RateLimiter, ban)
+{
+    RateLimiter limiter(10, 2, 3s);
+    auto t0 = RateLimiter::Clock::now();
+
+    EXPECT_EQ(limiter.check(1, t0), RateLimiter::Result::Allowed);
+    EXPECT_EQ(limiter.check(1, t0), RateLimiter::Result::Allowed);
+    EXPECT_EQ(limiter.check(1, t0), RateLimiter::Result::Banned);
+    //the bucket is refilled but the ban holds
+    EXPECT_EQ(limiter.check(1, t0 + 1s), RateLimiter::Result::Banned);
+    EXPECT_EQ(limiter.check(1, t0 + 2999ms), RateLimiter::Result::Banned);
+    //the ban is over, the bucket is full
+    EXPECT_EQ(limiter.check(1, t0 + 3s), RateLimiter::Result::Allowed);
+    EXPECT_EQ(limiter.check(1, t0 + 3s), RateLimiter::Result::Allowed);
+    EXPECT_EQ(limiter.check(1, t0 + 3s), RateLimiter::Result::Banned);
+
+    RateLimiter forever(10, 1, RateLimiter::BanForever);
+    EXPECT_EQ(forever.check(1, t0), RateLimiter::Result::Allowed);
+    EXPECT_EQ(forever.check(1, t0), RateLimiter::Result::Banned);
+    EXPECT_EQ(forever.check(1, t0 + 24h), RateLimiter::Result::Banned);
+}
+
+TEST(RateLimiter, eviction)
+{
+    //the only shard, so the LRU order is known
+    RateLimiter limiter(10, 2, 60s, 1);
+    auto t0 = RateLimiter::Clock::now();
+
+    //banned
+    EXPECT_EQ(limiter.check(1000, t0), RateLimiter::Result::Allowed);
+    EXPECT_EQ(limiter.check(1000, t0), RateLimiter::Result::Allowed);
+    EXPECT_EQ(limiter.check(1000, t0), RateLimiter::Result::Banned);
+
+    for(RateLimiter::Key key = 0; key < 100; ++key)
+    {
+        EXPECT_EQ(limiter.check(key, t0), RateLimiter::Result::Allowed);
+    }
+    //nothing is full yet
+    EXPECT_EQ(limiter.size(), 101);
+
+    //the old buckets are full now, a check evicts up to two of them
+    auto t1 = t0 + 1s;
+    for(RateLimiter::Key key = 100; key < 200; ++key)
+    {
+        EXPECT_EQ(limiter.check(key, t1), RateLimiter::Result::Allowed);
+    }
+    //the new buckets and the banned one
+    EXPECT_EQ(limiter.size(), 101);
+    EXPECT_EQ(limiter.check(1000, t1), RateLimiter::Result::Banned);
+
+    //the ban has expired
+    auto t2 = t0 + 61s;
+    EXPECT_EQ(limiter.check(2000, t2), RateLimiter::Result::Allowed);
+    EXPECT_EQ(limiter.check(1000, t2), RateLimiter::Result::Allowed);
+}
@@ -32,12 +32,21 @@
 #include <boost/scoped_ptr.hpp>
 #include "lib/graft/thread_pool/thread_pool.hpp"
 
+#include <atomic>
+#include <iostream>
+#include <thread>
+
 
 // cryptonode includes
 
 #include "supernode/requests/send_supernode_announce.h"
 #include <rta/supernode.h>
 #include <rta/fullsupernodelist.h>
+#include <rta/signatureverifier.h>
+#include <rta/announcefilter.h>
+#include "supernode/rtasession.h"
+#include "supernode/rtatxcache.h"
+#include "supernode/requests/authorize_rta_tx.h"
 #include <misc_log_ex.h>
 
 using namespace graft;
@@ -547,3 +556,747 @@ TEST_F(FullSupernodeListTest, announce1)
 }
 #endif
 
+
+namespace
+{
+
+FullSupernodeList::supernode_stake_array generateStakes(size_t supernodes_per_tier)
+{
+    const uint64_t tier_amounts[FullSupernodeList::TIERS] = {
+        Supernode::TIER1_STAKE_AMOUNT, Supernode::TIER2_STAKE_AMOUNT, Supernode::TIER3_STAKE_AMOUNT, Supernode::TIER4_STAKE_AMOUNT
+    };
+
+    FullSupernodeList::supernode_stake_array stakes;
+
+    for (int tier = 0; tier < FullSupernodeList::TIERS; ++tier)
+    {
+        for (size_t i = 0; i < supernodes_per_tier; ++i)
+        {
+            crypto::public_key id_key;
+            crypto::secret_key secret_key;
+            crypto::generate_keys(id_key, secret_key);
+
+            supernode_stake stake;
+            stake.amount = tier_amounts[tier];
+            stake.block_height = 1;
+            stake.unlock_time = 100000;
+            stake.supernode_public_id = epee::string_tools::pod_to_hex(id_key);
+            stakes.push_back(stake);
+        }
+    }
+
+    return stakes;
+}
+
+FullSupernodeList::blockchain_based_list_ptr makeBlockchainBasedList(const FullSupernodeList::supernode_stake_array& stakes, size_t supernodes_per_tier)
+{
+    FullSupernodeList::blockchain_based_list_ptr list = std::make_shared<FullSupernodeList::blockchain_based_list>();
+
+    for (size_t i = 0; i < stakes.size(); ++i)
+    {
+        if (i % supernodes_per_tier == 0)
+            list->emplace_back();
+
+        FullSupernodeList::blockchain_based_list_entry entry;
+        entry.supernode_public_id = stakes[i].supernode_public_id;
+        entry.amount = stakes[i].amount;
+        list->back().push_back(entry);
+    }
+
+    return list;
+}
+
+graft::supernode::request::SupernodeAnnounce makeAnnounce(uint64_t height, const std::string& supernode_public_id = std::string())
+{
+    crypto::public_key id_key;
+    crypto::secret_key secret_key;
+    crypto::generate_keys(id_key, secret_key);
+
+    graft::supernode::request::SupernodeAnnounce announce;
+    announce.supernode_public_id = supernode_public_id.empty() ? epee::string_tools::pod_to_hex(id_key) : supernode_public_id;
+    announce.height = height;
+    // signature is not checked when verified announces are applied, it only has to be parsed
+    crypto::signature sign;
+    crypto::hash hash;
+    crypto::cn_fast_hash(announce.supernode_public_id.data(), announce.supernode_public_id.size(), hash);
+    crypto::generate_signature(hash, id_key, secret_key, sign);
+    announce.signature = epee::string_tools::pod_to_hex(sign);
+    announce.network_address = "http://localhost:28690/dapi/v2.0";
+    return announce;
+}
+
+std::vector<std::string> sampleIds(const FullSupernodeList::supernode_array& sample)
+{
+    std::vector<std::string> result;
+    for (const SupernodePtr& sn : sample)
+        result.push_back(sn->idKeyAsString());
+    return result;
+}
+
+}
+
+struct FullSupernodeListSnapshotTest : public ::testing::Test
+{
+    FullSupernodeListSnapshotTest()
+    {
+        mlog_configure("", true);
+        mlog_set_log_level(0);
+    }
+
+    const std::string daemon_addr = "localhost:28881";
+    const bool testnet = true;
+};
+
+TEST_F(FullSupernodeListSnapshotTest, snapshotIsImmutable)
+{
+    FullSupernodeList fsl(daemon_addr, testnet);
+
+    FullSupernodeList::supernode_stake_array stakes = generateStakes(2);
+    fsl.updateStakes(1, stakes, daemon_addr, testnet);
+
+    FullSupernodeList::SnapshotPtr before = fsl.snapshot();
+    EXPECT_EQ(before->list.size(), stakes.size());
+
+    EXPECT_TRUE(fsl.remove(stakes.front().supernode_public_id));
+    fsl.setBlockchainBasedList(10, makeBlockchainBasedList(stakes, 2));
+
+    EXPECT_EQ(before->list.size(), stakes.size());
+    EXPECT_TRUE(before->blockchain_based_lists.empty());
+    EXPECT_EQ(before->blockchain_based_list_max_block_number, 0);
+
+    EXPECT_EQ(fsl.size(), stakes.size() - 1);
+    EXPECT_FALSE(fsl.exists(stakes.front().supernode_public_id));
+    EXPECT_TRUE(fsl.hasBlockchainBasedList(10));
+    EXPECT_EQ(fsl.getBlockchainBasedListMaxBlockNumber(), 10);
+}
+
+// stakes and announces are applied to copies of supernodes, a snapshot held by a reader keeps its supernodes unchanged
+TEST_F(FullSupernodeListSnapshotTest, publishedSupernodesAreUnchanged)
+{
+    FullSupernodeList fsl(daemon_addr, testnet);
+
+    FullSupernodeList::supernode_stake_array stakes = generateStakes(1);
+    for (supernode_stake& stake : stakes)
+        stake.supernode_public_address = "address of " + stake.supernode_public_id;
+    fsl.updateStakes(1, stakes, daemon_addr, testnet);
+
+    FullSupernodeList::SnapshotPtr before = fsl.snapshot();
+
+    const supernode_stake changed = stakes[0];
+    const supernode_stake removed = stakes[1];
+
+    stakes[0].amount += 1000;
+    stakes[0].block_height = 2;
+    stakes[0].supernode_public_address = "new address";
+    stakes.erase(stakes.begin() + 1);
+    fsl.updateStakes(2, stakes, daemon_addr, testnet);
+
+    EXPECT_EQ(fsl.get(changed.supernode_public_id)->stakeAmount(), changed.amount + 1000);
+    EXPECT_EQ(fsl.get(changed.supernode_public_id)->walletAddress(), "new address");
+    EXPECT_EQ(fsl.get(removed.supernode_public_id)->stakeAmount(), 0);
+
+    SupernodePtr old_changed = before->list.at(changed.supernode_public_id);
+    EXPECT_EQ(old_changed->stakeAmount(), changed.amount);
+    EXPECT_EQ(old_changed->stakeBlockHeight(), changed.block_height);
+    EXPECT_EQ(old_changed->walletAddress(), changed.supernode_public_address);
+    EXPECT_EQ(before->list.at(removed.supernode_public_id)->stakeAmount(), removed.amount);
+
+    // unchanged supernodes are shared between versions
+    EXPECT_EQ(fsl.get(stakes[1].supernode_public_id), before->list.at(stakes[1].supernode_public_id));
+
+    FullSupernodeList::SnapshotPtr before_announce = fsl.snapshot();
+
+    graft::supernode::request::SupernodeAnnounce announce = makeAnnounce(10, changed.supernode_public_id);
+    announce.payload_formats = graft::supernode::request::PAYLOAD_FORMAT_BINARY;
+    fsl.queueAnnounce(announce);
+    EXPECT_EQ(fsl.applyQueuedAnnounces(), 1);
+
+    EXPECT_TRUE(fsl.get(changed.supernode_public_id)->acceptsBinaryPayload());
+    EXPECT_EQ(fsl.get(changed.supernode_public_id)->stakeAmount(), changed.amount + 1000);
+    EXPECT_FALSE(before_announce->list.at(changed.supernode_public_id)->acceptsBinaryPayload());
+    EXPECT_FALSE(old_changed->acceptsBinaryPayload());
+}
+
+// concurrent buildAuthSample callers see the same sample while a writer republishes the same stakes and blockchain based list
+TEST_F(FullSupernodeListSnapshotTest, buildAuthSampleContention)
+{
+    constexpr size_t SUPERNODES_PER_TIER = 16;
+    constexpr size_t READERS = 4;
+    constexpr size_t UPDATES = 10;
+
+    FullSupernodeList fsl(daemon_addr, testnet);
+
+    FullSupernodeList::supernode_stake_array stakes = generateStakes(SUPERNODES_PER_TIER);
+    FullSupernodeList::blockchain_based_list_ptr bbl = makeBlockchainBasedList(stakes, SUPERNODES_PER_TIER);
+
+    uint64_t block_number = 100;
+    fsl.updateStakes(block_number, stakes, daemon_addr, testnet);
+    fsl.setBlockchainBasedList(block_number, bbl);
+
+    const std::string payment_id = "aabbccddeeff";
+    FullSupernodeList::supernode_array reference_sample;
+    uint64_t auth_block_number = 0;
+    ASSERT_TRUE(fsl.buildAuthSample(block_number, payment_id, reference_sample, auth_block_number));
+    const std::vector<std::string> reference_ids = sampleIds(reference_sample);
+
+    std::atomic_bool stop{false};
+    std::atomic<uint64_t> calls{0}, failures{0};
+
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < READERS; ++i)
+    {
+        readers.emplace_back([&]()
+        {
+            FullSupernodeList::supernode_array sample;
+            uint64_t out_block_number = 0;
+            // at least one call per reader even if the writer is done first
+            do
+            {
+                if (!fsl.buildAuthSample(block_number, payment_id, sample, out_block_number) || sampleIds(sample) != reference_ids)
+                    ++failures;
+                ++calls;
+            } while (!stop);
+        });
+    }
+
+    for (size_t i = 1; i <= UPDATES; ++i)
+    {
+        fsl.updateStakes(block_number + i, stakes, daemon_addr, testnet);
+        fsl.setBlockchainBasedList(block_number + i, bbl);
+    }
+    stop = true;
+    for (auto& th : readers)
+        th.join();
+
+    EXPECT_EQ(failures, 0);
+    EXPECT_GE(calls, READERS);
+    EXPECT_EQ(fsl.getBlockchainBasedListMaxBlockNumber(), block_number + UPDATES);
+}
+
+TEST_F(FullSupernodeListSnapshotTest, queuedAnnounces)
+{
+    FullSupernodeList fsl(daemon_addr, testnet);
+
+    FullSupernodeList::supernode_stake_array stakes = generateStakes(2);
+    fsl.updateStakes(1, stakes, daemon_addr, testnet);
+
+    FullSupernodeList::SnapshotPtr before = fsl.snapshot();
+
+    // announces of known supernodes, the older announce of the same supernode is replaced
+    for (const supernode_stake& stake : stakes)
+        fsl.queueAnnounce(makeAnnounce(10, stake.supernode_public_id));
+    fsl.queueAnnounce(makeAnnounce(5, stakes[0].supernode_public_id));
+
+    constexpr size_t NEW_SUPERNODES = 100;
+    size_t queued = 0;
+    for (size_t i = 0; i < NEW_SUPERNODES; ++i)
+        queued = fsl.queueAnnounce(makeAnnounce(10));
+    EXPECT_EQ(queued, stakes.size() + NEW_SUPERNODES);
+
+    // nothing is changed until the queue is applied
+    EXPECT_EQ(fsl.snapshot(), before);
+
+    EXPECT_EQ(fsl.applyQueuedAnnounces(), stakes.size() + NEW_SUPERNODES);
+    EXPECT_EQ(fsl.size(), stakes.size() + NEW_SUPERNODES);
+    // known supernodes are updated as copies, the previous version keeps its supernodes
+    EXPECT_NE(fsl.get(stakes[0].supernode_public_id), before->list.at(stakes[0].supernode_public_id));
+    EXPECT_EQ(before->list.size(), stakes.size());
+
+    // the queue is empty now
+    FullSupernodeList::SnapshotPtr after = fsl.snapshot();
+    EXPECT_EQ(fsl.applyQueuedAnnounces(), 0);
+    EXPECT_EQ(fsl.snapshot(), after);
+}
+
+// announce storm: announces of new supernodes are applied in batches while readers build auth samples
+TEST_F(FullSupernodeListSnapshotTest, announceStorm)
+{
+    constexpr size_t SUPERNODES_PER_TIER = 16;
+    constexpr size_t ANNOUNCES = 2 * FullSupernodeList::ANNOUNCE_BATCH_SIZE + 1;
+    constexpr size_t READERS = 4;
+
+    FullSupernodeList fsl(daemon_addr, testnet);
+
+    FullSupernodeList::supernode_stake_array stakes = generateStakes(SUPERNODES_PER_TIER);
+    uint64_t block_number = 100;
+    fsl.updateStakes(block_number, stakes, daemon_addr, testnet);
+    fsl.setBlockchainBasedList(block_number, makeBlockchainBasedList(stakes, SUPERNODES_PER_TIER));
+
+    std::vector<graft::supernode::request::SupernodeAnnounce> announces;
+    for (size_t i = 0; i < ANNOUNCES; ++i)
+        announces.push_back(makeAnnounce(block_number));
+
+    const std::string payment_id = "aabbccddeeff";
+    std::atomic_bool stop{false};
+    std::atomic<uint64_t> failures{0};
+
+    // auth samples are built while the announces are applied
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < READERS; ++i)
+    {
+        readers.emplace_back([&]()
+        {
+            FullSupernodeList::supernode_array sample;
+            uint64_t out_block_number = 0;
+            do
+            {
+                if (!fsl.buildAuthSample(block_number, payment_id, sample, out_block_number))
+                    ++failures;
+            }
+            while (!stop);
+        });
+    }
+
+    // announces arrive the way verifier threads deliver them
+    size_t applied = 0;
+    for (const auto& announce : announces)
+    {
+        if (fsl.queueAnnounce(announce) >= FullSupernodeList::ANNOUNCE_BATCH_SIZE)
+            applied += fsl.applyQueuedAnnounces();
+    }
+    EXPECT_EQ(applied, 2 * FullSupernodeList::ANNOUNCE_BATCH_SIZE);
+    applied += fsl.applyQueuedAnnounces();
+
+    stop = true;
+    for (auto& th : readers)
+        th.join();
+
+    EXPECT_EQ(applied, ANNOUNCES);
+    EXPECT_EQ(fsl.size(), stakes.size() + ANNOUNCES);
+    EXPECT_EQ(failures, 0);
+}
+
+// replays stakes and blockchain based lists as cryptonode sends them: full lists for every block, mostly unchanged
+TEST_F(FullSupernodeListSnapshotTest, replayListUpdates)
+{
+    FullSupernodeList fsl(daemon_addr, testnet);
+
+    FullSupernodeList::supernode_stake_array stakes = generateStakes(3);
+    FullSupernodeList::supernode_stake_array spare = generateStakes(1);
+
+    uint64_t block_number = 100;
+    fsl.updateStakes(block_number, stakes, daemon_addr, testnet);
+    fsl.setBlockchainBasedList(block_number, makeBlockchainBasedList(stakes, 3));
+
+    FullSupernodeList::SnapshotPtr initial = fsl.snapshot();
+    EXPECT_EQ(initial->list.size(), stakes.size());
+    EXPECT_EQ(initial->stakes_version, 1);
+    EXPECT_EQ(initial->blockchain_based_list_version, 1);
+
+    // next block, nothing changed: stakes are not republished, list object is shared with the previous block
+    ++block_number;
+    fsl.updateStakes(block_number, stakes, daemon_addr, testnet);
+    fsl.setBlockchainBasedList(block_number, makeBlockchainBasedList(stakes, 3));
+
+    FullSupernodeList::SnapshotPtr unchanged = fsl.snapshot();
+    EXPECT_EQ(unchanged->stakes_version, 1);
+    EXPECT_EQ(unchanged->blockchain_based_list_version, 1);
+    EXPECT_EQ(unchanged->list, initial->list);
+    EXPECT_EQ(fsl.findBlockchainBasedList(block_number), fsl.findBlockchainBasedList(block_number - 1));
+    EXPECT_EQ(fsl.getBlockchainBasedListMaxBlockNumber(), block_number);
+
+    // stake of one supernode changes
+    ++block_number;
+    supernode_stake prev_stake = stakes[0];
+    stakes[0].amount += 1000;
+    FullSupernodeList::stakes_delta delta = FullSupernodeList::diffStakes(
+        {{prev_stake.supernode_public_id, prev_stake}}, {stakes[0]});
+    EXPECT_EQ(delta.changed.size(), 1);
+    EXPECT_TRUE(delta.added.empty() && delta.removed.empty());
+
+    fsl.updateStakes(block_number, stakes, daemon_addr, testnet);
+    EXPECT_EQ(fsl.snapshot()->stakes_version, 2);
+    EXPECT_EQ(fsl.get(stakes[0].supernode_public_id)->stakeAmount(), stakes[0].amount);
+    // supernode objects are kept
+    EXPECT_EQ(fsl.get(stakes[1].supernode_public_id), initial->list.at(stakes[1].supernode_public_id));
+
+    // new supernode stakes and one supernode is replaced in the tier
+    ++block_number;
+    stakes.push_back(spare[0]);
+    fsl.updateStakes(block_number, stakes, daemon_addr, testnet);
+    EXPECT_EQ(fsl.snapshot()->stakes_version, 3);
+    EXPECT_EQ(fsl.size(), stakes.size());
+
+    FullSupernodeList::blockchain_based_list_ptr prev_list = fsl.findBlockchainBasedList(block_number - 1);
+    FullSupernodeList::blockchain_based_list_ptr next_list = std::make_shared<FullSupernodeList::blockchain_based_list>(*prev_list);
+    FullSupernodeList::blockchain_based_list_entry removed_entry = next_list->at(1).at(2);
+    next_list->at(1).at(2).supernode_public_id = spare[0].supernode_public_id;
+    next_list->at(1).at(2).amount = spare[0].amount;
+    std::swap(next_list->at(2).at(0), next_list->at(2).at(1));
+
+    FullSupernodeList::blockchain_based_list_delta list_delta = FullSupernodeList::diffBlockchainBasedLists(*prev_list, *next_list);
+    ASSERT_EQ(list_delta.added.size(), 1);
+    ASSERT_EQ(list_delta.removed.size(), 1);
+    EXPECT_EQ(list_delta.added[0].first, 1);
+    EXPECT_EQ(list_delta.added[0].second.supernode_public_id, spare[0].supernode_public_id);
+    EXPECT_EQ(list_delta.removed[0].first, 1);
+    EXPECT_EQ(list_delta.removed[0].second.supernode_public_id, removed_entry.supernode_public_id);
+
+    // reordering is not a difference of entries, but it changes the list
+    fsl.setBlockchainBasedList(block_number, next_list);
+    EXPECT_EQ(fsl.snapshot()->blockchain_based_list_version, 2);
+    EXPECT_EQ(fsl.findBlockchainBasedList(block_number), next_list);
+    EXPECT_EQ(fsl.getSupernodeBlockchainBasedListTier(spare[0].supernode_public_id, block_number), 2);
+
+    // the same list for the same block again changes nothing
+    FullSupernodeList::SnapshotPtr before_override = fsl.snapshot();
+    fsl.setBlockchainBasedList(block_number, std::make_shared<FullSupernodeList::blockchain_based_list>(*next_list));
+    EXPECT_EQ(fsl.snapshot(), before_override);
+
+    // supernode stake disappears
+    ++block_number;
+    std::string removed_id = stakes.front().supernode_public_id;
+    stakes.erase(stakes.begin());
+    fsl.updateStakes(block_number, stakes, daemon_addr, testnet);
+    EXPECT_EQ(fsl.snapshot()->stakes_version, 4);
+    EXPECT_EQ(fsl.get(removed_id)->stakeAmount(), 0);
+
+    // old stakes are ignored
+    fsl.updateStakes(block_number - 1, {}, daemon_addr, testnet);
+    EXPECT_EQ(fsl.snapshot()->stakes_version, 4);
+}
+
+namespace
+{
+
+SignatureVerifier::Batch makeSignedBatch(size_t count)
+{
+    SignatureVerifier::Batch batch;
+    for (size_t i = 0; i < count; ++i)
+    {
+        crypto::public_key pkey;
+        crypto::secret_key skey;
+        crypto::generate_keys(pkey, skey);
+
+        SignatureVerifier::Item item = SignatureVerifier::makeItem("message " + std::to_string(i), pkey, crypto::signature());
+        crypto::generate_signature(item.hash, pkey, skey, item.signature);
+        batch.push_back(item);
+    }
+    return batch;
+}
+
+}
+
+TEST(SignatureVerifierTest, results)
+{
+    SignatureVerifier verifier(4);
+
+    SignatureVerifier::Batch batch = makeSignedBatch(100);
+    // corrupt every 7th signature
+    for (size_t i = 0; i < batch.size(); i += 7)
+        batch[i].signature.c.data[0] ^= 0xff;
+
+    SignatureVerifier::Results results = verifier.verify(batch);
+    ASSERT_EQ(results.size(), batch.size());
+    for (size_t i = 0; i < batch.size(); ++i)
+        EXPECT_EQ(results[i], i % 7 != 0) << "item " << i;
+
+    EXPECT_TRUE(verifier.verify(SignatureVerifier::Batch()).empty());
+}
+
+// concurrent callers submitting small batches, like multicast handlers do
+TEST(SignatureVerifierTest, asyncBatches)
+{
+    constexpr size_t ITEMS = 256;
+    constexpr size_t ITEMS_PER_REQUEST = 2;
+
+    SignatureVerifier::Batch batch = makeSignedBatch(ITEMS);
+    // corrupt every 5th signature
+    for (size_t i = 0; i < batch.size(); i += 5)
+        batch[i].signature.c.data[0] ^= 0xff;
+
+    SignatureVerifier verifier(4);
+    SignatureVerifier::Results results(ITEMS);
+    size_t done = 0;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    for (size_t i = 0; i < ITEMS; i += ITEMS_PER_REQUEST)
+    {
+        SignatureVerifier::Batch request(batch.begin() + i, batch.begin() + i + ITEMS_PER_REQUEST);
+        verifier.verifyAsync(std::move(request), [&, i](const SignatureVerifier::Results& request_results)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t j = 0; j < request_results.size(); ++j)
+                results[i + j] = request_results[j];
+            done += request_results.size();
+            cv.notify_one();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return done == ITEMS; });
+    }
+
+    for (size_t i = 0; i < ITEMS; ++i)
+        EXPECT_EQ(results[i], i % 5 != 0) << "item " << i;
+    EXPECT_EQ(verifier.verifiedCount(), ITEMS);
+}
+
+TEST(AnnounceFilterTest, duplicatesAndThrottling)
+{
+    AnnounceFilter filter(std::chrono::milliseconds(1000), 2, std::chrono::seconds(60), 1000);
+    AnnounceFilter::Clock::time_point now = AnnounceFilter::Clock::now();
+
+    // announce which passes the check is charged after its signature is verified
+    auto accept = [&filter, &now](const std::string& id, uint64_t height, const std::string& signature)
+    {
+        AnnounceFilter::Result result = filter.check(id, height, signature, now);
+        return result == AnnounceFilter::Result::Accepted ? filter.charge(id, now) : result;
+    };
+
+    EXPECT_EQ(accept("id1", 10, "sig10"), AnnounceFilter::Result::Accepted);
+    EXPECT_EQ(accept("id1", 10, "sig10"), AnnounceFilter::Result::Duplicate);
+    // other signature of the same height is not a copy
+    EXPECT_EQ(accept("id1", 10, "sig10b"), AnnounceFilter::Result::Accepted);
+    // burst is spent
+    EXPECT_EQ(accept("id1", 11, "sig11"), AnnounceFilter::Result::Throttled);
+    // other senders are not affected
+    EXPECT_EQ(accept("id2", 11, "sig11"), AnnounceFilter::Result::Accepted);
+
+    now += std::chrono::milliseconds(1000);
+    // throttled announce is remembered, its copies are dropped
+    EXPECT_EQ(accept("id1", 11, "sig11"), AnnounceFilter::Result::Duplicate);
+    EXPECT_EQ(accept("id1", 12, "sig12"), AnnounceFilter::Result::Accepted);
+    EXPECT_EQ(accept("id1", 13, "sig13"), AnnounceFilter::Result::Throttled);
+
+    // copies are forgotten after ttl
+    now += std::chrono::seconds(61);
+    EXPECT_EQ(accept("id1", 10, "sig10"), AnnounceFilter::Result::Accepted);
+
+    EXPECT_EQ(filter.acceptedCount(), 5);
+    EXPECT_EQ(filter.duplicateCount(), 2);
+    EXPECT_EQ(filter.throttledCount(), 2);
+}
+
+// forged announces are not charged since their signatures are not verified
+TEST(AnnounceFilterTest, forgedAnnouncesDoNotThrottle)
+{
+    AnnounceFilter filter(std::chrono::milliseconds(1000), 1, std::chrono::seconds(60), 1000);
+    AnnounceFilter::Clock::time_point now = AnnounceFilter::Clock::now();
+
+    for (uint64_t height = 10; height < 20; ++height)
+    {
+        // the check only drops copies, signature verification fails and charge is not called
+        EXPECT_EQ(filter.check("id1", height, "forged" + std::to_string(height), now), AnnounceFilter::Result::Accepted);
+    }
+
+    EXPECT_EQ(filter.check("id1", 20, "sig20", now), AnnounceFilter::Result::Accepted);
+    EXPECT_EQ(filter.charge("id1", now), AnnounceFilter::Result::Accepted);
+    EXPECT_EQ(filter.throttledCount(), 0);
+}
+
+// flood of announces relayed many times each, the way announces reach supernode over the network
+TEST(AnnounceFilterTest, duplicatedFlood)
+{
+    constexpr size_t SENDERS = 50;
+    constexpr size_t HEIGHTS = 20;
+    constexpr size_t COPIES = 10;
+    constexpr size_t THREADS = 4;
+
+    AnnounceFilter filter(std::chrono::milliseconds(0), 1, std::chrono::seconds(3600), SENDERS * HEIGHTS + 1);
+
+    std::vector<graft::supernode::request::SupernodeAnnounce> announces;
+    for (size_t sender = 0; sender < SENDERS; ++sender)
+    {
+        for (size_t height = 0; height < HEIGHTS; ++height)
+        {
+            graft::supernode::request::SupernodeAnnounce announce;
+            announce.supernode_public_id = "supernode" + std::to_string(sender);
+            announce.height = height;
+            announce.signature = std::string(128, 'a' + height % 26) + std::to_string(sender);
+            announces.push_back(announce);
+        }
+    }
+
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < THREADS; ++i)
+    {
+        threads.emplace_back([&]()
+        {
+            for (size_t n = next++; n < announces.size() * COPIES; n = next++)
+            {
+                const graft::supernode::request::SupernodeAnnounce& announce = announces[n % announces.size()];
+                if (filter.check(announce.supernode_public_id, announce.height, announce.signature) == AnnounceFilter::Result::Accepted)
+                    filter.charge(announce.supernode_public_id);
+            }
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+
+    EXPECT_EQ(filter.acceptedCount(), announces.size());
+    EXPECT_EQ(filter.duplicateCount(), announces.size() * (COPIES - 1));
+    EXPECT_EQ(filter.throttledCount(), 0);
+}
+
+TEST(RtaSessionTest, lookupAndVotes)
+{
+    graft::GlobalContextMap m;
+    graft::Context ctx(m);
+
+    const std::string payment_id = "payment-1";
+    const std::string tx_id = "0123456789abcdef";
+
+    EXPECT_FALSE(RtaSession::find(ctx, payment_id));
+
+    bool created = false;
+    RtaSessionPtr session = RtaSession::getOrCreate(ctx, payment_id, &created);
+    ASSERT_TRUE(session);
+    EXPECT_TRUE(created);
+    EXPECT_EQ(RtaSession::getOrCreate(ctx, payment_id, &created), session);
+    EXPECT_FALSE(created);
+
+    session->setStatus(ctx, RTAStatus::InProgress);
+    EXPECT_EQ(RtaSession::find(ctx, payment_id)->status(), RTAStatus::InProgress);
+
+    RtaSession::bindTx(ctx, session, tx_id, cryptonote::transaction());
+    EXPECT_EQ(RtaSession::findByTxId(ctx, tx_id), session);
+    EXPECT_TRUE(session->hasTx());
+
+    size_t approved = 0, rejected = 0;
+    graft::supernode::request::SupernodeSignature sign;
+    sign.id_key = "id1";
+    EXPECT_TRUE(session->addAuthVote(sign, true, approved, rejected));
+    EXPECT_FALSE(session->addAuthVote(sign, false, approved, rejected));
+    sign.id_key = "id2";
+    EXPECT_TRUE(session->addAuthVote(sign, false, approved, rejected));
+    EXPECT_EQ(approved, 1);
+    EXPECT_EQ(rejected, 1);
+
+    EXPECT_TRUE(session->updateStatus(ctx, RTAStatus::Success));
+    EXPECT_FALSE(session->updateStatus(ctx, RTAStatus::Fail));
+    EXPECT_EQ(session->status(), RTAStatus::Success);
+
+    RtaSession::remove(ctx, payment_id);
+    EXPECT_FALSE(RtaSession::find(ctx, payment_id));
+    EXPECT_FALSE(RtaSession::findByTxId(ctx, tx_id));
+
+    // late handlers of removed payment don't store it again
+    session->setStatus(ctx, RTAStatus::Fail);
+    EXPECT_FALSE(RtaSession::find(ctx, payment_id));
+    EXPECT_FALSE(RtaSession::findByTxId(ctx, tx_id));
+}
+
+// state changes store the session and its tx index again, so they live RTA_TX_TTL after the last change
+TEST(RtaSessionTest, stateChangeExtendsLifetime)
+{
+    graft::GlobalContextMap m;
+    graft::Context ctx(m);
+
+    const std::string payment_id = "payment-2";
+    const std::string tx_id = "fedcba9876543210";
+
+    RtaSessionPtr session = RtaSession::getOrCreate(ctx, payment_id);
+    RtaSession::bindTx(ctx, session, tx_id, cryptonote::transaction());
+
+    // entries are lost as if they expired while the payment is in progress
+    ctx.global.remove(payment_id + CONTEXT_KEY_RTA_SESSION);
+    ctx.global.remove(tx_id + CONTEXT_KEY_RTA_SESSION_BY_TXID);
+
+    session->setStatus(ctx, RTAStatus::InProgress);
+    EXPECT_EQ(RtaSession::find(ctx, payment_id), session);
+    EXPECT_EQ(RtaSession::findByTxId(ctx, tx_id), session);
+
+    ctx.global.remove(tx_id + CONTEXT_KEY_RTA_SESSION_BY_TXID);
+    EXPECT_TRUE(session->updateStatus(ctx, RTAStatus::Success));
+    EXPECT_EQ(RtaSession::findByTxId(ctx, tx_id), session);
+
+    // finite status is not changed, the session is not touched
+    ctx.global.remove(tx_id + CONTEXT_KEY_RTA_SESSION_BY_TXID);
+    EXPECT_FALSE(session->updateStatus(ctx, RTAStatus::Fail));
+    EXPECT_FALSE(RtaSession::findByTxId(ctx, tx_id));
+}
+
+TEST(RtaTxCacheTest, decodeOnce)
+{
+    graft::GlobalContextMap m;
+    graft::Context ctx(m);
+
+    graft::supernode::request::AuthorizeRtaTxRequest req;
+    req.tx_hex = "not a tx";
+    req.payment_id = "payment-1";
+    req.amount = 10;
+    graft::Output out;
+    out.loadT<graft::serializer::JSON_B64>(req);
+    const std::string data = out.data();
+
+    DecodedTxAuthRequestPtr decoded = RtaTxCache::decodeTxAuthRequest(ctx, data);
+    ASSERT_TRUE(decoded->valid);
+    EXPECT_EQ(decoded->request.payment_id, req.payment_id);
+    ASSERT_TRUE(decoded->tx);
+    EXPECT_FALSE(decoded->tx->valid);
+    // decode failures are not cached
+    EXPECT_NE(RtaTxCache::decodeTxAuthRequest(ctx, data), decoded);
+    EXPECT_NE(RtaTxCache::decodeTx(ctx, req.tx_hex), decoded->tx);
+
+    DecodedTxAuthRequestPtr garbage = RtaTxCache::decodeTxAuthRequest(ctx, "garbage");
+    EXPECT_FALSE(garbage->valid);
+    EXPECT_NE(RtaTxCache::decodeTxAuthRequest(ctx, "garbage"), garbage);
+    EXPECT_FALSE(RtaTxCache::decodePayload<graft::supernode::request::AuthorizeRtaTxRequest>(ctx, "garbage")->valid);
+
+    // duplicate delivery of a valid payload returns the same decoded entry
+    auto payload = RtaTxCache::decodePayload<graft::supernode::request::AuthorizeRtaTxRequest>(ctx, data);
+    ASSERT_TRUE(payload->valid);
+    EXPECT_EQ(payload->value.amount, req.amount);
+    EXPECT_EQ(RtaTxCache::decodePayload<graft::supernode::request::AuthorizeRtaTxRequest>(ctx, data), payload);
+}
+
+namespace {
+
+std::string signedHex(const std::string &msg, const crypto::public_key &pkey, const crypto::secret_key &skey)
+{
+    crypto::hash hash;
+    crypto::cn_fast_hash(msg.data(), msg.size(), hash);
+    crypto::signature sign;
+    crypto::generate_signature(hash, pkey, skey, sign);
+    return epee::string_tools::pod_to_hex(sign);
+}
+
+// BIN_B64 payload of the message decodes to the same message and is much smaller than JSON_B64 one
+template<typename T>
+void comparePayloadFormats(const T &msg)
+{
+    Output out;
+    out.loadT<serializer::JSON_B64>(msg);
+    const std::string json = out.data();
+    out.loadT<serializer::BIN_B64>(msg);
+    const std::string bin = out.data();
+
+    Input in;
+    T decoded;
+    in.load(bin);
+    ASSERT_TRUE(in.getT<serializer::ANY_B64>(decoded));
+    EXPECT_EQ(std::string(decoded.toJson().GetString()), std::string(msg.toJson().GetString()));
+
+    EXPECT_LT(bin.size() * 3, json.size() * 2);
+}
+
+}
+
+TEST(BinaryPayloadTest, authVoteAndAnnounce)
+{
+    crypto::public_key pkey;
+    crypto::secret_key skey;
+    crypto::generate_keys(pkey, skey);
+
+    crypto::hash tx_hash;
+    crypto::cn_fast_hash("tx", 2, tx_hash);
+
+    graft::supernode::request::AuthorizeRtaTxResponse vote;
+    vote.tx_id = epee::string_tools::pod_to_hex(tx_hash);
+    vote.result = static_cast<int>(RTAAuthResult::Approved);
+    vote.signature.id_key = epee::string_tools::pod_to_hex(pkey);
+    vote.signature.result_signature = signedHex(vote.tx_id + ":" + std::to_string(vote.result), pkey, skey);
+    vote.signature.tx_signature = signedHex(vote.tx_id, pkey, skey);
+    comparePayloadFormats(vote);
+
+    graft::supernode::request::SupernodeAnnounce announce;
+    announce.supernode_public_id = epee::string_tools::pod_to_hex(pkey);
+    announce.height = 123456;
+    announce.signature = signedHex(announce.supernode_public_id + std::to_string(announce.height), pkey, skey);
+    announce.network_address = "http://192.168.1.100:28690/dapi/v2.0";
+    announce.payload_formats = graft::supernode::request::PAYLOAD_FORMAT_BINARY;
+    comparePayloadFormats(announce);
+}
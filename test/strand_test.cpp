@@ -66,3 +66,35 @@ TEST(StrandTest, basic)
 
     EXPECT_EQ(value.load(std::memory_order_acquire), max_value);
 }
+
+TEST(StrandTest, overflow)
+{
+    ThreadPool thread_pool;
+    Strand strand(thread_pool, 2);
+
+    std::atomic<bool> started = false;
+    std::atomic<bool> released = false;
+
+    auto blocking = [&started, &released]() {
+        started = true;
+        while (!released)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    };
+
+    EXPECT_TRUE(strand.tryPost(blocking));
+
+    while (!started)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // running handler is out of the queue, two more fit into it
+    EXPECT_TRUE(strand.tryPost([]() {}));
+    EXPECT_TRUE(strand.tryPost([]() {}));
+    EXPECT_FALSE(strand.tryPost([]() {}));
+    EXPECT_THROW(strand.post([]() {}), std::overflow_error);
+    EXPECT_EQ(strand.pendingCount(), 3);
+
+    released = true;
+
+    while (strand.pendingCount() != 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
@@ -5,12 +5,22 @@
 #include "lib/graft/router.h"
 #include "lib/graft/sys_info.h"
 #include "lib/graft/sys_info_request.h"
+#include "lib/graft/metrics_request.h"
 #include "lib/graft/handler_api.h"
+#include "lib/graft/trace.h"
 #include <vector>
 #include <string>
 #include <chrono>
+#include <algorithm>
+#include <random>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <thread>
 
 using SysInfoCounter = graft::request::system_info::Counter;
+using graft::request::system_info::LatencyHistogram;
+using graft::request::system_info::LatencyHistogramSet;
 using graft::request::system_info::Response;
 using graft::ConfigOpts;
 using graft::GlobalContextMap;
@@ -150,6 +160,7 @@ class HandlerAPIImpl : public graft::HandlerAPI
 {
 public:
     virtual void sendUpstreamBlocking(Output& output, Input& input, std::string& err) override { }
+    virtual bool sendUpstreamAsync(Output&& output) override { return false; }
     virtual bool addPeriodicTask(const Router::Handler& h_worker,
                                  std::chrono::milliseconds interval_ms,
                                  std::chrono::milliseconds initial_interval_ms = std::chrono::milliseconds::max(),
@@ -162,11 +173,17 @@ public:
     {
         return m_co;
     }
+    virtual graft::Tracer& tracer() override
+    {
+        return m_tracer;
+    }
+    virtual bool resumePostponedTask(const Ctx::uuid_t& uuid, const Input& input) override { return false; }
 
     HandlerAPIImpl(SysInfoCounter& sic, ConfigOpts& co) : m_sic(sic), m_co(co) { }
 private:
     SysInfoCounter& m_sic;
     ConfigOpts& m_co;
+    graft::Tracer m_tracer{0, 0};
 };
 
 } //namespace detail
@@ -282,5 +299,186 @@ TEST(SysInfo, response_content_initial_and_after_handler)
 
     EXPECT_EQ(resp.running_info.upstrm_http_req_bytes_raw, 1);
     EXPECT_EQ(resp.running_info.upstrm_http_resp_bytes_raw, 1);
+
+    EXPECT_TRUE(resp.latency.routes.empty());
+    EXPECT_EQ(resp.latency.stages.size(), static_cast<size_t>(SysInfoCounter::Stage::Count));
+
+    for(int i = 1; i <= 100; ++i) sic.record_route_latency(req_path, i * 1000);
+    sic.record_stage_latency(SysInfoCounter::Stage::WorkerAction, 10);
+
+    jp.h3.worker_action(vars, inp, ctx, otp); // call the target handler
+    resp = Response::fromJson(otp.body);
+
+    ASSERT_EQ(resp.latency.routes.size(), 1);
+    EXPECT_EQ(resp.latency.routes[0].name, req_path);
+    EXPECT_EQ(resp.latency.routes[0].count, 100);
+    EXPECT_EQ(resp.latency.routes[0].max_us, 100000);
+    EXPECT_NEAR(resp.latency.routes[0].p50_us, 50000, 50000 / LatencyHistogram::SUB_BUCKETS);
+
+    auto& worker = resp.latency.stages[static_cast<int>(SysInfoCounter::Stage::WorkerAction)];
+    EXPECT_EQ(worker.name, "worker_action");
+    EXPECT_EQ(worker.count, 1);
+    EXPECT_EQ(worker.p99_us, 10);
+}
+
+TEST(SysInfo, latency_histogram_buckets)
+{
+    for(int i = 0; i < LatencyHistogram::BUCKETS; ++i)
+    {
+        EXPECT_EQ(LatencyHistogram::bucket_index(LatencyHistogram::bucket_upper_bound(i)), i);
+        EXPECT_EQ(LatencyHistogram::bucket_index(LatencyHistogram::bucket_upper_bound(i) + 1), std::min(i + 1, LatencyHistogram::BUCKETS - 1));
+    }
+    EXPECT_EQ(LatencyHistogram::bucket_index(~0ull), LatencyHistogram::BUCKETS - 1);
 }
 
+TEST(SysInfo, latency_histogram_percentiles)
+{
+    LatencyHistogram h;
+    EXPECT_EQ(h.percentile(0.5), 0);
+
+    std::mt19937_64 gen(1);
+    std::exponential_distribution<double> dist(1.0 / 2000);
+    std::vector<uint64_t> values(100000);
+    for(auto& v : values)
+    {
+        v = static_cast<uint64_t>(dist(gen));
+        h.record(v);
+    }
+    std::sort(values.begin(), values.end());
+
+    EXPECT_EQ(h.count(), values.size());
+    EXPECT_EQ(h.max(), values.back());
+    for(double q : {0.5, 0.9, 0.99, 0.999})
+    {
+        double exact = values[static_cast<size_t>(q * values.size()) - 1];
+        EXPECT_NEAR(h.percentile(q), exact, exact / LatencyHistogram::SUB_BUCKETS + 1) << q;
+    }
+    EXPECT_EQ(h.percentile(1), values.back());
+}
+
+TEST(SysInfo, latency_histogram_concurrent)
+{
+    LatencyHistogram h;
+    LatencyHistogramSet set;
+    const int threads = 4, records = 100000;
+
+    std::vector<std::thread> th;
+    for(int t = 0; t < threads; ++t)
+    {
+        th.emplace_back([&h, &set, t]
+        {
+            for(int i = 0; i < records; ++i)
+            {
+                h.record(i % 1000);
+                set.get("route" + std::to_string(i % 8)).record(t);
+            }
+        });
+    }
+    for(auto& t : th) t.join();
+
+    EXPECT_EQ(h.count(), threads * records);
+    EXPECT_EQ(h.max(), 999);
+
+    int names = 0;
+    uint64_t total = 0;
+    set.for_each([&](const std::string& name, const LatencyHistogram& histogram)
+    {
+        ++names;
+        total += histogram.count();
+    });
+    EXPECT_EQ(names, 8);
+    EXPECT_EQ(total, threads * records);
+}
+
+TEST(SysInfo, latency_histogram_set_overflow)
+{
+    LatencyHistogramSet set;
+    for(int i = 0; i < LatencyHistogramSet::CAPACITY + 10; ++i)
+    {
+        set.get(std::to_string(i)).record(i);
+    }
+
+    int names = 0;
+    uint64_t overflow = 0;
+    set.for_each([&](const std::string& name, const LatencyHistogram& histogram)
+    {
+        ++names;
+        if(name == LatencyHistogramSet::OVERFLOW_NAME) overflow = histogram.count();
+    });
+    EXPECT_EQ(names, LatencyHistogramSet::CAPACITY + 1);
+    EXPECT_EQ(overflow, 10);
+}
+
+TEST(SysInfo, metrics_exposition_format)
+{
+    SysInfoCounter sic;
+    sic.count_http_request_total();
+    sic.count_http_resp_status_ok();
+    sic.record_route_latency("/dapi/v2.0/sale", 1500);
+    sic.record_route_latency("/route \"quoted\"\\", 10);
+    sic.record_upstream_latency("$walletnode", 20000);
+
+    auto snapshot = std::make_shared<graft::request::system_info::RuntimeSnapshot>();
+    snapshot->thread_pool_jobs = 3;
+    snapshot->global_context_entries = 7;
+    snapshot->upstreams.push_back({"$walletnode", 4, 1, 2, 5});
+    sic.set_runtime_snapshot(snapshot);
+
+    const std::string text = graft::request::metrics::render(sic);
+    ASSERT_FALSE(text.empty());
+    EXPECT_EQ(text.back(), '\n');
+
+    // https://prometheus.io/docs/instrumenting/exposition_formats/#text-format-details
+    const std::string name = "[a-zA-Z_:][a-zA-Z0-9_:]*";
+    const std::string labelValue = "\"(?:[^\"\\\\\\n]|\\\\[\\\\\"n])*\"";
+    const std::string labels = "\\{[a-zA-Z_][a-zA-Z0-9_]*=" + labelValue + "(?:,[a-zA-Z_][a-zA-Z0-9_]*=" + labelValue + ")*\\}";
+    const std::regex help("# HELP (" + name + ") .*");
+    const std::regex type("# TYPE (" + name + ") (counter|gauge|summary|histogram|untyped)");
+    const std::regex sample("(" + name + ")(" + labels + ")? ([-+]?[0-9.]+(?:[eE][-+]?[0-9]+)?|NaN|[-+]Inf)");
+
+    std::set<std::string> typed;
+    std::map<std::string, std::string> values;
+    std::istringstream is(text);
+    std::string line;
+    while(std::getline(is, line))
+    {
+        std::smatch m;
+        if(std::regex_match(line, m, help)) continue;
+        if(std::regex_match(line, m, type))
+        {
+            EXPECT_TRUE(typed.insert(m[1]).second) << "duplicated TYPE: " << line;
+            continue;
+        }
+        ASSERT_TRUE(std::regex_match(line, m, sample)) << "invalid line: " << line;
+
+        // samples of summaries have _sum and _count suffixes
+        std::string family = std::regex_replace(std::string(m[1]), std::regex("_(sum|count)$"), "");
+        EXPECT_TRUE(typed.count(m[1]) || typed.count(family)) << "sample without TYPE: " << line;
+        values[std::string(m[1]) + std::string(m[2])] = m[3];
+    }
+
+    EXPECT_EQ(values["graft_http_requests_total"], "1");
+    EXPECT_EQ(values["graft_http_responses_total{status=\"ok\"}"], "1");
+    EXPECT_EQ(values["graft_route_latency_seconds_count{route=\"/dapi/v2.0/sale\"}"], "1");
+    EXPECT_EQ(values["graft_route_latency_seconds_count{route=\"/route \\\"quoted\\\"\\\\\"}"], "1");
+    EXPECT_EQ(values["graft_upstream_latency_seconds_sum{upstream=\"$walletnode\"}"], "0.02");
+    EXPECT_EQ(values["graft_thread_pool_jobs"], "3");
+    EXPECT_EQ(values["graft_global_context_entries"], "7");
+    EXPECT_EQ(values["graft_upstream_connections{upstream=\"$walletnode\",state=\"active\"}"], "2");
+    EXPECT_EQ(values["graft_upstream_queued_tasks{upstream=\"$walletnode\"}"], "5");
+}
+
+TEST(SysInfo, global_context_size)
+{
+    GlobalContextMap gcm;
+    Ctx ctx(gcm);
+    EXPECT_EQ(gcm.size(), 0);
+
+    ctx.global["a"] = 1;
+    ctx.global["b"] = 2;
+    ctx.global["a"] = 3;
+    EXPECT_EQ(gcm.size(), 2);
+
+    ctx.global.remove("a");
+    EXPECT_EQ(gcm.size(), 1);
+}
@@ -62,6 +62,103 @@ TEST_F(GraftServerTestBase, upstreamKeepAlive)
     crypton.stop_and_wait_for();
 }
 
+//the substitution is changed while a request is in flight, new requests go to the new upstream at once
+TEST_F(GraftServerTestBase, upstreamReloadInFlight)
+{
+    auto action = [&](const graft::Router::vars_t& vars, const graft::Input& input, graft::Context& ctx, graft::Output& output)->graft::Status
+    {
+        switch(ctx.local.getLastStatus())
+        {
+        case graft::Status::None :
+        {
+            output.body = input.body;
+            output.uri = "$reloaded";
+            return graft::Status::Forward;
+        } break;
+        case graft::Status::Forward :
+        {
+            output.body = input.body;
+            return graft::Status::Ok;
+        } break;
+        default: assert(false);
+        }
+    };
+
+    std::atomic_bool oldStarted{false}, oldReleased{false};
+    TempCryptoNodeServer oldUpstream;
+    oldUpstream.on_http = [&] (const http_message *hm, int& status_code, std::string& headers, std::string& data) -> bool
+    {
+        oldStarted = true;
+        while(!oldReleased)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        data = "old " + std::string(hm->body.p, hm->body.len);
+        return true;
+    };
+    oldUpstream.keepAlive = true;
+    oldUpstream.run();
+
+    TempCryptoNodeServer newUpstream;
+    newUpstream.port = "1235";
+    newUpstream.on_http = [] (const http_message *hm, int& status_code, std::string& headers, std::string& data) -> bool
+    {
+        data = "new " + std::string(hm->body.p, hm->body.len);
+        return true;
+    };
+    newUpstream.keepAlive = true;
+    newUpstream.run();
+
+    graft::Output::uri_substitutions["reloaded"] = std::make_tuple("127.0.0.1:1234", 1, true, 100);
+    MainServer mainServer;
+    mainServer.m_copts.http_connection_timeout = 10;
+    mainServer.m_router.addRoute("/test_upstream", METHOD_POST, {nullptr, action, nullptr});
+    mainServer.run();
+
+    auto post = [](const std::string& data)
+    {
+        Client client;
+        client.serve("http://localhost:9084/test_upstream", "", data, 5000);
+        EXPECT_EQ(200, client.get_resp_code());
+        return client.get_body();
+    };
+
+    std::string inFlightBody;
+    std::thread inFlight([&]{ inFlightBody = post("first"); });
+    while(!oldStarted)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    graft::Looper& looper = mainServer.getLooper();
+    std::atomic_bool reloaded{false};
+    looper.setReloadHandler([&]
+    {
+        graft::Output::uri_substitutions["reloaded"] = std::make_tuple("127.0.0.1:1235", 1, true, 100);
+        looper.reinitUpstreams();
+        reloaded = true;
+    });
+    looper.requestReload();
+    while(!reloaded)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    //the old upstream is still busy, the only connection of the old substitution is taken
+    EXPECT_EQ(post("second"), "new second");
+
+    //the request in flight is completed by the old upstream
+    oldReleased = true;
+    inFlight.join();
+    EXPECT_EQ(inFlightBody, "old first");
+
+    //the server stops when the old upstream is drained
+    mainServer.stop_and_wait_for();
+    graft::Output::uri_substitutions.erase("reloaded");
+    oldUpstream.stop_and_wait_for();
+    newUpstream.stop_and_wait_for();
+}
+
 
 namespace
 {